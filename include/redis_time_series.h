@@ -2,12 +2,23 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
+#include <bit>
+#include <charconv>
 #include <chrono>
 #include <exception>
 #include <fmt/format.h>
 #include <iomanip>
+#include <limits>
+#include <memory_resource>
+#include <memory>
+#include <mutex>
 #include <optional>
+#include <shared_mutex>
+#include <span>
 #include <sstream>
+#include <string_view>
+#include <unordered_map>
 
 #include <sw/redis++/pipeline.h>
 #include <sw/redis++/redis++.h>
@@ -76,14 +87,22 @@ inline std::string to_string(TsAggregation aggrgation) {
         return "AVG";
     case TsAggregation::SUM:
         return "SUM";
+    case TsAggregation::MIN:
+        return "MIN";
     case TsAggregation::MAX:
         return "MAX";
+    case TsAggregation::RANGE:
+        return "RANGE";
     case TsAggregation::COUNT:
         return "COUNT";
     case TsAggregation::FIRST:
         return "FIRST";
+    case TsAggregation::LAST:
+        return "LAST";
     case TsAggregation::STDP:
         return "STD.P";
+    case TsAggregation::STDS:
+        return "STD.S";
     case TsAggregation::VARP:
         return "VAR.P";
     case TsAggregation::VARS:
@@ -189,18 +208,23 @@ class TimeStamp {
 
     TimeStamp() = default;
     ~TimeStamp() = default;
-    TimeStamp(const TimeStamp &timestamp) : value_{timestamp.value_} {}
-    TimeStamp(TimeStamp &&timestamp) : value_{timestamp.value_} {}
+    TimeStamp(const TimeStamp &timestamp)
+        : isConstant_{timestamp.isConstant_},
+          constantTime_{timestamp.constantTime_}, value_{timestamp.value_} {}
+    TimeStamp(TimeStamp &&timestamp) noexcept
+        : isConstant_{timestamp.isConstant_},
+          constantTime_{std::move(timestamp.constantTime_)},
+          value_{timestamp.value_} {}
     TimeStamp &operator=(const TimeStamp &timestamp) {
         value_ = timestamp.value_;
         isConstant_ = timestamp.isConstant_;
         constantTime_ = timestamp.constantTime_;
         return *this;
     }
-    TimeStamp &operator=(TimeStamp &&timestamp) {
+    TimeStamp &operator=(TimeStamp &&timestamp) noexcept {
         value_ = timestamp.value_;
         isConstant_ = timestamp.isConstant_;
-        constantTime_ = timestamp.constantTime_;
+        constantTime_ = std::move(timestamp.constantTime_);
         return *this;
     }
 
@@ -230,10 +254,10 @@ class TimeStamp {
 class TimeSeriesTuple {
   public:
     TimeSeriesTuple() = default;
-    TimeSeriesTuple(const TimeStamp &time, double val)
-        : time_{time}, value_{val} {}
+    TimeSeriesTuple(TimeStamp time, double val)
+        : time_{std::move(time)}, value_{val} {}
 
-    TimeStamp time() const { return time_; }
+    const TimeStamp &time() const { return time_; }
     double value() const { return value_; }
 
   private:
@@ -241,13 +265,40 @@ class TimeSeriesTuple {
     double value_{};
 };
 
+// Samples of one series stored column-wise: timestamps[i] belongs to
+// values[i]. Bulk readers fill this instead of a vector of TimeSeriesTuple.
+struct TimeSeriesColumns {
+    std::vector<uint64_t> timestamps;
+    std::vector<double> values;
+
+    std::size_t size() const { return timestamps.size(); }
+    bool empty() const { return timestamps.empty(); }
+    void reserve(std::size_t n) {
+        timestamps.reserve(n);
+        values.reserve(n);
+    }
+    void clear() {
+        timestamps.clear();
+        values.clear();
+    }
+    void push_back(uint64_t timestamp, double value) {
+        timestamps.push_back(timestamp);
+        values.push_back(value);
+    }
+    void append(const TimeSeriesColumns &other) {
+        timestamps.insert(timestamps.end(), other.timestamps.begin(),
+                          other.timestamps.end());
+        values.insert(values.end(), other.values.begin(), other.values.end());
+    }
+};
+
 class TimeSeriesRule {
   public:
-    TimeSeriesRule(const std::string &destKey, uint64_t timeBucket,
+    TimeSeriesRule(std::string destKey, uint64_t timeBucket,
                    std::optional<command_operator::TsAggregation> aggregation)
-        : destKey_{destKey_}, timeBucket_{timeBucket}, aggregation_{
-                                                           aggregation} {}
-    std::string destKey() const { return destKey_; }
+        : destKey_{std::move(destKey)}, timeBucket_{timeBucket},
+          aggregation_{aggregation} {}
+    const std::string &destKey() const { return destKey_; }
     uint64_t timeBucket() const { return timeBucket_; }
     std::optional<command_operator::TsAggregation> aggregation() const {
         return aggregation_;
@@ -259,12 +310,121 @@ class TimeSeriesRule {
     std::optional<command_operator::TsAggregation> aggregation_;
 };
 
+// Append-only pool of interned strings. Every distinct string is stored once
+// and identified by a dense 32-bit id; ids and the views returned by view()
+// stay valid for the lifetime of the pool. intern() may be called from any
+// thread, view() is lock-free.
+class StringPool {
+  public:
+    using Id = uint32_t;
+
+    StringPool() = default;
+    StringPool(const StringPool &) = delete;
+    StringPool &operator=(const StringPool &) = delete;
+    ~StringPool() {
+        for (auto &segment : segments_)
+            delete[] segment.load(std::memory_order_relaxed);
+    }
+
+    static StringPool &global() {
+        static StringPool pool;
+        return pool;
+    }
+
+    Id intern(std::string_view str) {
+        if (auto id = find(str)) return *id;
+
+        std::unique_lock lock{mutex_};
+        auto it = index_.find(str);
+        if (it != index_.end()) return it->second;
+
+        auto id = static_cast<Id>(size_.load(std::memory_order_relaxed));
+        if (id == std::numeric_limits<Id>::max())
+            throw std::length_error("String pool is full");
+        auto stored = store(str);
+        auto [segment, offset] = locate(id);
+        auto *slots = segments_[segment].load(std::memory_order_relaxed);
+        if (slots == nullptr) {
+            slots = new std::string_view[kFirstSegment << segment];
+            segments_[segment].store(slots, std::memory_order_release);
+        }
+        slots[offset] = stored;
+        index_.emplace(stored, id);
+        size_.store(id + 1, std::memory_order_release);
+        return id;
+    }
+
+    std::optional<Id> find(std::string_view str) const {
+        std::shared_lock lock{mutex_};
+        auto it = index_.find(str);
+        if (it == index_.end()) return std::nullopt;
+        return it->second;
+    }
+
+    std::string_view view(Id id) const {
+        if (id >= size_.load(std::memory_order_acquire))
+            throw std::out_of_range("Unknown string pool id");
+        auto [segment, offset] = locate(id);
+        return segments_[segment].load(std::memory_order_acquire)[offset];
+    }
+
+    std::size_t size() const { return size_.load(std::memory_order_acquire); }
+
+  private:
+    static constexpr std::size_t kFirstSegment = 1024;
+    static constexpr std::size_t kBlockSize = 64 * 1024;
+    static constexpr std::size_t kSegments = 23;
+
+    // Segment k holds kFirstSegment << k slots, so 23 segments cover the
+    // whole 32-bit id space without ever moving a published slot.
+    static std::pair<std::size_t, std::size_t> locate(Id id) {
+        auto pos = static_cast<std::size_t>(id) + kFirstSegment;
+        auto segment = static_cast<std::size_t>(std::bit_width(pos)) -
+                       std::bit_width(kFirstSegment);
+        return {segment, pos - (kFirstSegment << segment)};
+    }
+
+    std::string_view store(std::string_view str) {
+        if (str.size() > kBlockSize / 4) {
+            blocks_.push_back(std::make_unique<char[]>(str.size()));
+            std::copy(str.begin(), str.end(), blocks_.back().get());
+            return {blocks_.back().get(), str.size()};
+        }
+        if (blocks_.empty() || blockUsed_ + str.size() > kBlockSize) {
+            blocks_.push_back(std::make_unique<char[]>(kBlockSize));
+            block_ = blocks_.back().get();
+            blockUsed_ = 0;
+        }
+        auto *dst = block_ + blockUsed_;
+        std::copy(str.begin(), str.end(), dst);
+        blockUsed_ += str.size();
+        return {dst, str.size()};
+    }
+
+    mutable std::shared_mutex mutex_;
+    std::unordered_map<std::string_view, Id> index_;
+    std::vector<std::unique_ptr<char[]>> blocks_;
+    char *block_{nullptr};
+    std::size_t blockUsed_{0};
+    std::array<std::atomic<std::string_view *>, kSegments> segments_{};
+    std::atomic<std::size_t> size_{0};
+};
+
+// A label is a pair of ids into the global StringPool, so equal keys and
+// values across series share storage and compare as integers.
 class TimeSeriesLabel {
   public:
-    TimeSeriesLabel(const std::string &key, const std::string &value)
+    TimeSeriesLabel(std::string_view key, std::string_view value)
+        : key_{pool().intern(key)}, value_{pool().intern(value)} {}
+    TimeSeriesLabel(StringPool::Id key, StringPool::Id value)
         : key_{key}, value_{value} {}
-    std::string key() const { return key_; }
-    std::string value() const { return value_; }
+
+    std::string_view key() const { return pool().view(key_); }
+    std::string_view value() const { return pool().view(value_); }
+    StringPool::Id keyId() const { return key_; }
+    StringPool::Id valueId() const { return value_; }
+
+    static StringPool &pool() { return StringPool::global(); }
 
     friend bool operator==(const TimeSeriesLabel &lhs,
                            const TimeSeriesLabel &rhs) {
@@ -272,35 +432,81 @@ class TimeSeriesLabel {
     }
 
   private:
-    std::string key_;
-    std::string value_;
+    StringPool::Id key_;
+    StringPool::Id value_;
+};
+
+// Read-only view of a label set, taken wherever labels are only encoded or
+// searched. A vector, an array or a braced list binds without a copy. Like
+// std::string_view it must not outlive what it views; a braced list lives
+// until the end of the full expression, i.e. for the call it is passed to.
+class LabelSpan : public std::span<const TimeSeriesLabel> {
+  public:
+    using std::span<const TimeSeriesLabel>::span;
+    LabelSpan() = default;
+    LabelSpan(std::span<const TimeSeriesLabel> labels) : span{labels} {}
+    LabelSpan(std::initializer_list<TimeSeriesLabel> labels)
+        : span{labels.begin(), labels.size()} {}
+
+    std::vector<TimeSeriesLabel> to_vector() const { return {begin(), end()}; }
 };
 
-class TimeSeriesInformation {
+// Returns the value of label `key` or nullopt. A key that was never interned
+// cannot be on any label, so the lookup never grows the pool.
+inline std::optional<std::string_view>
+findLabel(LabelSpan labels, std::string_view key) {
+    auto id = TimeSeriesLabel::pool().find(key);
+    if (!id.has_value()) return std::nullopt;
+    for (auto &label : labels)
+        if (label.keyId() == *id) return label.value();
+    return std::nullopt;
+}
+
+// True when the label set carries `key=value`; both sides are compared by id.
+inline bool hasLabel(LabelSpan labels, std::string_view key,
+                     std::string_view value) {
+    auto keyId = TimeSeriesLabel::pool().find(key);
+    auto valueId = TimeSeriesLabel::pool().find(value);
+    if (!keyId.has_value() || !valueId.has_value()) return false;
+    return std::find(labels.begin(), labels.end(),
+                     TimeSeriesLabel{*keyId, *valueId}) != labels.end();
+}
+
+// TS.INFO result. The label list, source key and rule list types are
+// parameters so that one variant can keep them on a caller's memory
+// resource; see TimeSeriesInformation and TimeSeriesPmrInformation.
+template <typename Labels, typename String, typename Rules>
+class BasicTimeSeriesInformation {
   public:
-    TimeSeriesInformation(
-        uint64_t totalSamples, uint64_t memoryUsage,
-        const TimeStamp &firstTimeStamp, const TimeStamp &lastTimeStamp,
-        uint64_t retentionTime, uint64_t chunkCount, uint64_t chunkSize,
-        const std::vector<TimeSeriesLabel> &labels,
-        const std::string &sourceKey, const std::vector<TimeSeriesRule> &rules,
+    BasicTimeSeriesInformation(
+        uint64_t totalSamples, uint64_t memoryUsage, TimeStamp firstTimeStamp,
+        TimeStamp lastTimeStamp, uint64_t retentionTime, uint64_t chunkCount,
+        uint64_t chunkSize, Labels labels, String sourceKey, Rules rules,
         std::optional<command_operator::TsDuplicatePolicy> policy)
         : totalSamples_{totalSamples}, memoryUsage_{memoryUsage},
-          firstTimeStamp_{firstTimeStamp}, lastTimeStamp_{lastTimeStamp},
+          firstTimeStamp_{std::move(firstTimeStamp)},
+          lastTimeStamp_{std::move(lastTimeStamp)},
           retentionTime_{retentionTime}, chunkCount_{chunkCount},
-          chunkSize_{chunkSize}, labels_{labels},
-          sourceKey_{sourceKey}, rules_{rules}, duplicatePolicy_{policy} {}
+          chunkSize_{chunkSize}, labels_{std::move(labels)},
+          sourceKey_{std::move(sourceKey)}, rules_{std::move(rules)},
+          duplicatePolicy_{policy} {}
 
     uint64_t totalSamples() const { return totalSamples_; }
     uint64_t memoryUsage() const { return memoryUsage_; }
-    TimeStamp firstTimeStamp() const { return firstTimeStamp_; }
-    TimeStamp lastTimeStamp() const { return lastTimeStamp_; }
+    const TimeStamp &firstTimeStamp() const { return firstTimeStamp_; }
+    const TimeStamp &lastTimeStamp() const { return lastTimeStamp_; }
     uint64_t retentionTime() const { return retentionTime_; }
     uint64_t chunkCount() const { return chunkCount_; }
     uint64_t chunkSize() const { return chunkSize_; }
-    std::vector<TimeSeriesLabel> labels() const { return labels_; }
-    std::string sourceKey() const { return sourceKey_; }
-    std::vector<TimeSeriesRule> rules() const { return rules_; }
+    // Containers are returned by reference; on a temporary, e.g.
+    // `for (auto &rule : timeSeriesInfo(db, key).rules())`, they are moved
+    // out instead so the loop does not dangle.
+    const Labels &labels() const & { return labels_; }
+    Labels labels() && { return std::move(labels_); }
+    const String &sourceKey() const & { return sourceKey_; }
+    String sourceKey() && { return std::move(sourceKey_); }
+    const Rules &rules() const & { return rules_; }
+    Rules rules() && { return std::move(rules_); }
     std::optional<command_operator::TsDuplicatePolicy> duplicatePolicy() const {
         return duplicatePolicy_;
     }
@@ -313,129 +519,187 @@ class TimeSeriesInformation {
     uint64_t retentionTime_{};
     uint64_t chunkCount_{};
     uint64_t chunkSize_{};
-    std::vector<TimeSeriesLabel> labels_;
-    std::string sourceKey_;
-    std::vector<TimeSeriesRule> rules_;
+    Labels labels_;
+    String sourceKey_;
+    Rules rules_;
     std::optional<command_operator::TsDuplicatePolicy> duplicatePolicy_;
 };
 
+using TimeSeriesInformation =
+    BasicTimeSeriesInformation<std::vector<TimeSeriesLabel>, std::string,
+                               std::vector<TimeSeriesRule>>;
+
+// TimeSeriesInformation with its label list, source key and rule list on
+// one memory resource, as returned by the client::timeSeriesInfo overload
+// that takes one. The rules' destination keys are plain std::string.
+using TimeSeriesPmrInformation =
+    BasicTimeSeriesInformation<std::pmr::vector<TimeSeriesLabel>,
+                               std::pmr::string,
+                               std::pmr::vector<TimeSeriesRule>>;
+
+// One series of an MRANGE/MREVRANGE reply: key, labels and samples.
+using TimeSeriesMRangeEntry =
+    std::tuple<std::string, std::vector<TimeSeriesLabel>,
+               std::vector<TimeSeriesTuple>>;
+
+// TimeSeriesMRangeEntry with every container on one memory resource, as
+// returned by the client::timeSeriesMRange overloads that take one.
+using TimeSeriesPmrMRangeEntry =
+    std::tuple<std::pmr::string, std::pmr::vector<TimeSeriesLabel>,
+               std::pmr::vector<TimeSeriesTuple>>;
+
+// One series of an MGET reply: key, labels and last sample. The sample is
+// empty (no timestamp) when the series has none.
+using TimeSeriesMGetEntry =
+    std::tuple<std::string, std::vector<TimeSeriesLabel>, TimeSeriesTuple>;
+
+// Monotonic arena for the allocations of one request. Arguments and parsed
+// replies built against resource() come out of a single bump region (the
+// inline buffer first, then upstream blocks) and are freed together when the
+// arena is released or destroyed. Not thread-safe; use one per request.
+class RequestArena {
+  public:
+    static constexpr std::size_t kInlineBytes = 4096;
+
+    explicit RequestArena(
+        std::pmr::memory_resource *upstream = std::pmr::new_delete_resource())
+        : resource_{buffer_.data(), buffer_.size(), upstream} {}
+    RequestArena(const RequestArena &) = delete;
+    RequestArena &operator=(const RequestArena &) = delete;
+
+    std::pmr::memory_resource *resource() { return &resource_; }
+
+    // Frees everything allocated so far; containers built on the arena must
+    // not be used afterwards.
+    void release() { resource_.release(); }
+
+  private:
+    alignas(std::max_align_t) std::array<std::byte, kInlineBytes> buffer_;
+    std::pmr::monotonic_buffer_resource resource_;
+};
+
 namespace aux {
-inline void addRetentionTime(std::vector<std::string> &args,
+// Command arguments are built into pmr containers so a caller can place a
+// whole request on a RequestArena; the default resource keeps the old
+// global-heap behaviour.
+using ArgList = std::pmr::vector<std::pmr::string>;
+
+inline ArgList makeArgs(std::pmr::memory_resource *resource,
+                        std::size_t capacity) {
+    ArgList args{resource};
+    args.reserve(capacity);
+    return args;
+}
+
+inline void addRetentionTime(ArgList &args,
                              std::optional<uint64_t> retentionTime) {
     if (retentionTime.has_value()) {
-        args.push_back(command_args::RETENTION);
-        args.push_back(std::to_string(retentionTime.value()));
+        args.emplace_back(command_args::RETENTION);
+        args.emplace_back(std::to_string(retentionTime.value()));
     }
 }
 
-inline void addChunkSize(std::vector<std::string> &args,
-                         std::optional<uint64_t> chunkSize) {
+inline void addChunkSize(ArgList &args, std::optional<uint64_t> chunkSize) {
     if (chunkSize.has_value()) {
-        args.push_back(command_args::CHUNK_SIZE);
-        args.push_back(std::to_string(chunkSize.value()));
+        args.emplace_back(command_args::CHUNK_SIZE);
+        args.emplace_back(std::to_string(chunkSize.value()));
     }
 }
 
-inline void addLabels(std::vector<std::string> &args,
-                      std::vector<TimeSeriesLabel> labels) {
+inline void addLabels(ArgList &args, LabelSpan labels) {
     if (labels.size() > 0) {
-        args.push_back(command_args::LABELS);
+        args.emplace_back(command_args::LABELS);
         for (auto &label : labels) {
-            args.push_back(label.key());
-            args.push_back(label.value());
+            args.emplace_back(label.key());
+            args.emplace_back(label.value());
         }
     }
 }
 
-inline void addUncompressed(std::vector<std::string> &args,
-                            std::optional<bool> uncompressed) {
+inline void addUncompressed(ArgList &args, std::optional<bool> uncompressed) {
     if (uncompressed.has_value()) {
-        args.push_back(command_args::UNCOMPRESSED);
+        args.emplace_back(command_args::UNCOMPRESSED);
     }
 }
 
-inline void addCount(std::vector<std::string> &args,
-                     std::optional<uint64_t> count) {
+inline void addCount(ArgList &args, std::optional<uint64_t> count) {
     if (count.has_value()) {
-        args.push_back(command_args::COUNT);
-        args.push_back(std::to_string(count.value()));
+        args.emplace_back(command_args::COUNT);
+        args.emplace_back(std::to_string(count.value()));
     }
 }
 
 inline void
-addDuplicatePolicy(std::vector<std::string> &args,
+addDuplicatePolicy(ArgList &args,
                    std::optional<command_operator::TsDuplicatePolicy> policy) {
     if (policy.has_value()) {
-        args.push_back(command_args::DUPLICATE_POLICY);
-        args.push_back(command_operator::to_string(policy.value()));
+        args.emplace_back(command_args::DUPLICATE_POLICY);
+        args.emplace_back(command_operator::to_string(policy.value()));
     }
 }
 
 inline void
-addOnDuplicate(std::vector<std::string> &args,
+addOnDuplicate(ArgList &args,
                std::optional<command_operator::TsDuplicatePolicy> policy) {
     if (policy.has_value()) {
-        args.push_back(command_args::ON_DUPLICATE);
-        args.push_back(command_operator::to_string(policy.value()));
+        args.emplace_back(command_args::ON_DUPLICATE);
+        args.emplace_back(command_operator::to_string(policy.value()));
     }
 }
 
-inline void addAlign(std::vector<std::string> &args, const TimeStamp &align) {
-    if (!align.hasValue()) {
-        args.push_back(command_args::ALIGN);
-        args.push_back(align.to_string());
+inline void addAlign(ArgList &args, const TimeStamp &align) {
+    if (align.hasValue()) {
+        args.emplace_back(command_args::ALIGN);
+        args.emplace_back(align.to_string());
     }
 }
 
 inline void
-addAggregation(std::vector<std::string> &args,
+addAggregation(ArgList &args,
                std::optional<command_operator::TsAggregation> aggregation,
                std::optional<uint64_t> timeBucket) {
     if (aggregation.has_value()) {
-        args.push_back(command_args::AGGREGATION);
-        args.push_back(command_operator::to_string(aggregation.value()));
+        args.emplace_back(command_args::AGGREGATION);
+        args.emplace_back(command_operator::to_string(aggregation.value()));
         if (!timeBucket.has_value()) {
             throw std::invalid_argument(
                 "RANGE Aggregation should have timeBucket value");
         }
-        args.push_back(std::to_string(timeBucket.value()));
+        args.emplace_back(std::to_string(timeBucket.value()));
     }
 }
 
-inline void addFilters(std::vector<std::string> &args,
-                       const std::vector<std::string> &filter) {
+inline void addFilters(ArgList &args, const std::vector<std::string> &filter) {
     if (filter.size() == 0) {
         throw std::invalid_argument(
             "There should be at least one filter on MRANGE/MREVRANGE");
     }
-    args.push_back(command_args::FILTER);
+    args.emplace_back(command_args::FILTER);
     for (auto &f : filter) {
-        args.push_back(f);
+        args.emplace_back(f);
     }
 }
 
-inline void addFilterByTs(std::vector<std::string> &args,
-                          const std::vector<TimeStamp> &filter) {
+inline void addFilterByTs(ArgList &args, const std::vector<TimeStamp> &filter) {
     if (filter.size() != 0) {
-        args.push_back(command_args::FILTER_BY_TS);
+        args.emplace_back(command_args::FILTER_BY_TS);
         for (auto &ts : filter) {
-            args.push_back(ts.to_string());
+            args.emplace_back(ts.to_string());
         }
     }
 }
 
 inline void
-addFilterByValue(std::vector<std::string> &args,
+addFilterByValue(ArgList &args,
                  std::optional<std::pair<uint64_t, uint64_t>> filter) {
     if (filter.has_value()) {
-        args.push_back(command_args::FILTER_BY_VALUE);
-        args.push_back(std::to_string(filter.value().first));
-        args.push_back(std::to_string(filter.value().second));
+        args.emplace_back(command_args::FILTER_BY_VALUE);
+        args.emplace_back(std::to_string(filter.value().first));
+        args.emplace_back(std::to_string(filter.value().second));
     }
 }
 
-inline void addWithLabels(std::vector<std::string> &args,
-                          std::optional<bool> withLabels,
+inline void addWithLabels(ArgList &args, std::optional<bool> withLabels,
                           const std::vector<std::string> &selectLabels = {}) {
     if (withLabels.has_value() && selectLabels.size() != 0) {
         throw std::invalid_argument(
@@ -444,137 +708,177 @@ inline void addWithLabels(std::vector<std::string> &args,
 
     if (withLabels.has_value() && withLabels.has_value() &&
         withLabels.value()) {
-        args.push_back(command_args::WITHLABELS);
+        args.emplace_back(command_args::WITHLABELS);
     }
 
     if (selectLabels.size() != 0) {
-        args.push_back(command_args::SELECTEDLABELS);
+        args.emplace_back(command_args::SELECTEDLABELS);
         for (auto &label : selectLabels) {
-            args.push_back(label);
+            args.emplace_back(label);
         }
     }
 }
 
-inline void addGroupby(std::vector<std::string> &args,
-                       std::optional<std::string> groupby,
+inline void addGroupby(ArgList &args, std::optional<std::string> groupby,
                        std::optional<command_operator::TsReduce> reduce) {
     if (groupby.has_value() && reduce.has_value()) {
-        args.push_back(command_args::GROPUBY);
-        args.push_back(groupby.value());
-        args.push_back(command_args::REDUCE);
-        args.push_back(command_operator::to_string(reduce.value()));
+        args.emplace_back(command_args::GROPUBY);
+        args.emplace_back(groupby.value());
+        args.emplace_back(command_args::REDUCE);
+        args.emplace_back(command_operator::to_string(reduce.value()));
     }
 }
 
-inline void addTimeStamp(std::vector<std::string> &args,
-                         const TimeStamp &timeStamp) {
-    if (!timeStamp.hasValue()) {
-        args.push_back(command_args::TIMESTAMP);
-        args.push_back(timeStamp.to_string());
+inline void addTimeStamp(ArgList &args, const TimeStamp &timeStamp) {
+    if (timeStamp.hasValue()) {
+        args.emplace_back(command_args::TIMESTAMP);
+        args.emplace_back(timeStamp.to_string());
     }
 }
 
-inline void addRule(std::vector<std::string> &args,
-                    const TimeSeriesRule &rule) {
-    args.push_back(rule.destKey());
-    args.push_back(command_args::AGGREGATION);
-    args.push_back(command_operator::to_string(rule.aggregation().value()));
-    args.push_back(std::to_string(rule.timeBucket()));
+inline void addRule(ArgList &args, const TimeSeriesRule &rule) {
+    args.emplace_back(rule.destKey());
+    args.emplace_back(command_args::AGGREGATION);
+    args.emplace_back(command_operator::to_string(rule.aggregation().value()));
+    args.emplace_back(std::to_string(rule.timeBucket()));
 }
 
-inline std::vector<std::string>
-buildTsCreateArgs(const std::string &key, std::optional<uint64_t> retentionTime,
-                  const std::vector<TimeSeriesLabel> &labels,
-                  std::optional<bool> uncompressed,
-                  std::optional<uint64_t> chunkSizeBytes,
-                  std::optional<command_operator::TsDuplicatePolicy> policy) {
-    std::vector<std::string> args{key};
+// Every builder reserves room for the command name as well, so the client's
+// insert at the front does not reallocate.
+inline ArgList buildTsCreateArgs(
+    std::string_view key, std::optional<uint64_t> retentionTime,
+    LabelSpan labels, std::optional<bool> uncompressed,
+    std::optional<uint64_t> chunkSizeBytes,
+    std::optional<command_operator::TsDuplicatePolicy> policy,
+    std::pmr::memory_resource *resource = std::pmr::get_default_resource()) {
+    auto args = makeArgs(resource, 10 + 2 * labels.size());
+    args.emplace_back(key);
     addRetentionTime(args, retentionTime);
     addChunkSize(args, chunkSizeBytes);
-    addLabels(args, labels);
     addUncompressed(args, uncompressed);
     addDuplicatePolicy(args, policy);
+    // LABELS takes the rest of the command, so it goes last.
+    addLabels(args, labels);
     return args;
 }
 
-inline std::vector<std::string>
-buildTsAlterArgs(const std::string &key, std::optional<uint64_t> retentionTime,
-                 const std::vector<TimeSeriesLabel> &labels) {
-    std::vector<std::string> args{key};
+inline ArgList buildTsAlterArgs(
+    std::string_view key, std::optional<uint64_t> retentionTime,
+    LabelSpan labels,
+    std::optional<command_operator::TsDuplicatePolicy> policy = std::nullopt,
+    std::pmr::memory_resource *resource = std::pmr::get_default_resource()) {
+    auto args = makeArgs(resource, 7 + 2 * labels.size());
+    args.emplace_back(key);
     addRetentionTime(args, retentionTime);
+    addDuplicatePolicy(args, policy);
     addLabels(args, labels);
     return args;
 }
 
-inline std::vector<std::string>
-buildTsAddArgs(const std::string &key, const TimeStamp &timestamp, double value,
-               std::optional<uint64_t> retentionTime,
-               const std::vector<TimeSeriesLabel> &labels,
-               std::optional<bool> uncompressed,
-               std::optional<uint64_t> chunkSizeBytes,
-               std::optional<command_operator::TsDuplicatePolicy> policy) {
-    std::vector<std::string> args{key, timestamp.to_string(),
-                                  std::to_string(value)};
+inline ArgList buildTsAddArgs(
+    std::string_view key, const TimeStamp &timestamp, double value,
+    std::optional<uint64_t> retentionTime, LabelSpan labels,
+    std::optional<bool> uncompressed, std::optional<uint64_t> chunkSizeBytes,
+    std::optional<command_operator::TsDuplicatePolicy> policy,
+    std::pmr::memory_resource *resource = std::pmr::get_default_resource()) {
+    auto args = makeArgs(resource, 12 + 2 * labels.size());
+    args.emplace_back(key);
+    args.emplace_back(timestamp.to_string());
+    args.emplace_back(std::to_string(value));
     addRetentionTime(args, retentionTime);
     addChunkSize(args, chunkSizeBytes);
-    addLabels(args, labels);
     addUncompressed(args, uncompressed);
     addOnDuplicate(args, policy);
+    addLabels(args, labels);
     return args;
 }
 
-inline std::vector<std::string> buildTsIncrDecrByArgs(
-    const std::string &key, double value, const TimeStamp &timestamp,
-    std::optional<uint64_t> retentionTime,
-    const std::vector<TimeSeriesLabel> &labels,
-    std::optional<bool> uncompressed, std::optional<uint64_t> chunkSizeBytes) {
-    std::vector<std::string> args{key, std::to_string(value)};
+inline ArgList buildTsIncrDecrByArgs(
+    std::string_view key, double value, const TimeStamp &timestamp,
+    std::optional<uint64_t> retentionTime, LabelSpan labels,
+    std::optional<bool> uncompressed, std::optional<uint64_t> chunkSizeBytes,
+    std::pmr::memory_resource *resource = std::pmr::get_default_resource()) {
+    auto args = makeArgs(resource, 12 + 2 * labels.size());
+    args.emplace_back(key);
+    args.emplace_back(std::to_string(value));
     addTimeStamp(args, timestamp);
     addRetentionTime(args, retentionTime);
     addChunkSize(args, chunkSizeBytes);
-    addLabels(args, labels);
     addUncompressed(args, uncompressed);
+    addLabels(args, labels);
     return args;
 }
 
-inline std::vector<std::string> buildTsDelArgs(const std::string &key,
-                                               const TimeStamp &fromTimeStamp,
-                                               const TimeStamp &toTimeStamp) {
-    std::vector<std::string> args{key, fromTimeStamp.to_string(),
-                                  toTimeStamp.to_string()};
+inline ArgList buildTsDelArgs(
+    std::string_view key, const TimeStamp &fromTimeStamp,
+    const TimeStamp &toTimeStamp,
+    std::pmr::memory_resource *resource = std::pmr::get_default_resource()) {
+    auto args = makeArgs(resource, 4);
+    args.emplace_back(key);
+    args.emplace_back(fromTimeStamp.to_string());
+    args.emplace_back(toTimeStamp.to_string());
     return args;
 }
 
-inline std::vector<std::string> buildTsMaddArgs(
-    const std::vector<std::tuple<std::string, TimeStamp, double>> &sequence) {
-    std::vector<std::string> args;
+inline ArgList buildTsMaddArgs(
+    const std::vector<std::tuple<std::string, TimeStamp, double>> &sequence,
+    std::pmr::memory_resource *resource = std::pmr::get_default_resource()) {
+    auto args = makeArgs(resource, 1 + 3 * sequence.size());
     for (auto &tuple : sequence) {
-        args.push_back(std::get<0>(tuple));
-        args.push_back(std::get<1>(tuple).to_string());
-        args.push_back(std::to_string(std::get<2>(tuple)));
+        args.emplace_back(std::get<0>(tuple));
+        args.emplace_back(std::get<1>(tuple).to_string());
+        args.emplace_back(std::to_string(std::get<2>(tuple)));
     }
     return args;
 }
 
-inline std::vector<std::string>
-buildTsMgetArgs(const std::vector<std::string> &filter,
-                std::optional<bool> withLabels) {
-    std::vector<std::string> args;
-    addWithLabels(args, withLabels);
+inline ArgList buildTsCreateRuleArgs(
+    std::string_view sourceKey, const TimeSeriesRule &rule,
+    std::pmr::memory_resource *resource = std::pmr::get_default_resource()) {
+    auto args = makeArgs(resource, 6);
+    args.emplace_back(sourceKey);
+    args.emplace_back(rule.destKey());
+    if (rule.aggregation().has_value()) {
+        args.emplace_back(command_args::AGGREGATION);
+        args.emplace_back(
+            command_operator::to_string(rule.aggregation().value()));
+    }
+    args.emplace_back(std::to_string(rule.timeBucket()));
+    return args;
+}
+
+inline ArgList buildTsDeleteRuleArgs(
+    std::string_view sourceKey, std::string_view destKey,
+    std::pmr::memory_resource *resource = std::pmr::get_default_resource()) {
+    auto args = makeArgs(resource, 3);
+    args.emplace_back(sourceKey);
+    args.emplace_back(destKey);
+    return args;
+}
+
+inline ArgList buildTsMgetArgs(
+    const std::vector<std::string> &filter, std::optional<bool> withLabels,
+    const std::vector<std::string> &selectLabels = {},
+    std::pmr::memory_resource *resource = std::pmr::get_default_resource()) {
+    auto args = makeArgs(resource, 4 + filter.size() + selectLabels.size());
+    addWithLabels(args, withLabels, selectLabels);
     addFilters(args, filter);
     return args;
 }
 
-inline std::vector<std::string>
-buildRangeArgs(const std::string &key, const TimeStamp &fromTimeStamp,
-               const TimeStamp &toTimeStamp, std::optional<uint64_t> count,
-               std::optional<command_operator::TsAggregation> aggregation,
-               std::optional<uint64_t> timeBucket,
-               const std::vector<TimeStamp> &filterByTs,
-               std::optional<std::pair<uint64_t, uint64_t>> filterByValue,
-               const TimeStamp &align) {
-    std::vector<std::string> args{key, fromTimeStamp.to_string(),
-                                  toTimeStamp.to_string()};
+inline ArgList buildRangeArgs(
+    std::string_view key, const TimeStamp &fromTimeStamp,
+    const TimeStamp &toTimeStamp, std::optional<uint64_t> count,
+    std::optional<command_operator::TsAggregation> aggregation,
+    std::optional<uint64_t> timeBucket,
+    const std::vector<TimeStamp> &filterByTs,
+    std::optional<std::pair<uint64_t, uint64_t>> filterByValue,
+    const TimeStamp &align,
+    std::pmr::memory_resource *resource = std::pmr::get_default_resource()) {
+    auto args = makeArgs(resource, 15 + filterByTs.size());
+    args.emplace_back(key);
+    args.emplace_back(fromTimeStamp.to_string());
+    args.emplace_back(toTimeStamp.to_string());
     addFilterByTs(args, filterByTs);
     addFilterByValue(args, filterByValue);
     addCount(args, count);
@@ -583,7 +887,7 @@ buildRangeArgs(const std::string &key, const TimeStamp &fromTimeStamp,
     return args;
 }
 
-inline std::vector<std::string> buildMultiRangeArgs(
+inline ArgList buildMultiRangeArgs(
     const TimeStamp &fromTimeStamp, const TimeStamp &toTimeStamp,
     const std::vector<std::string> &filter, std::optional<uint64_t> count,
     std::optional<command_operator::TsAggregation> aggregation,
@@ -592,10 +896,12 @@ inline std::vector<std::string> buildMultiRangeArgs(
     std::optional<command_operator::TsReduce> reduse,
     const std::vector<TimeStamp> &filterByTs,
     std::optional<std::pair<uint64_t, uint64_t>> filterByValue,
-    const std::vector<std::string> &selectLabels, const TimeStamp &align) {
-
-    std::vector<std::string> args{fromTimeStamp.to_string(),
-                                  toTimeStamp.to_string()};
+    const std::vector<std::string> &selectLabels, const TimeStamp &align,
+    std::pmr::memory_resource *resource = std::pmr::get_default_resource()) {
+    auto args = makeArgs(resource, 22 + filterByTs.size() + filter.size() +
+                                       selectLabels.size());
+    args.emplace_back(fromTimeStamp.to_string());
+    args.emplace_back(toTimeStamp.to_string());
     addFilterByTs(args, filterByTs);
     addFilterByValue(args, filterByValue);
     addCount(args, count);
@@ -617,79 +923,258 @@ inline long parseLong(uint64_t result) { return result; }
 
 inline TimeStamp parseTimeStamp(uint64_t result) { return TimeStamp(result); }
 
-inline std::vector<TimeStamp>
-parseTimeStampArray(std::vector<long long> result) {
-    std::vector<TimeStamp> list;
+// Converts each element of `result` with `parse` into a List.
+template <typename List, typename Result, typename Parse>
+List parseArray(const Result &result, Parse parse) {
+    List list;
+    list.reserve(result.size());
     for (auto &res : result)
-        list.push_back(TimeStamp(static_cast<uint64_t>(res)));
+        list.push_back(parse(res));
     return list;
 }
 
+inline TimeStamp parseTimeStampElement(long long result) {
+    return TimeStamp(static_cast<uint64_t>(result));
+}
+
+inline std::vector<TimeStamp>
+parseTimeStampArray(const std::vector<long long> &result) {
+    return parseArray<std::vector<TimeStamp>>(result, parseTimeStampElement);
+}
+
 inline TimeSeriesTuple
 parseTimeSeriesTuple(const std::tuple<std::string, std::string> &result) {
     return TimeSeriesTuple(TimeStamp(std::get<0>(result), ""),
                            std::stod(std::get<1>(result)));
 }
 
+inline double parseDouble(const redisReply &reply) {
+    if (reply.type == REDIS_REPLY_DOUBLE) return reply.dval;
+    if (reply.type != REDIS_REPLY_STRING && reply.type != REDIS_REPLY_STATUS) {
+        throw sw::redis::ProtoError("Expect STRING or DOUBLE reply");
+    }
+    double value{};
+    auto [end, ec] = std::from_chars(reply.str, reply.str + reply.len, value);
+    if (ec != std::errc{} || end != reply.str + reply.len) {
+        throw sw::redis::ProtoError("Invalid sample value");
+    }
+    return value;
+}
+
+inline uint64_t parseSampleTimeStamp(const redisReply &reply) {
+    if (reply.type != REDIS_REPLY_INTEGER) {
+        throw sw::redis::ProtoError("Expect INTEGER reply");
+    }
+    return static_cast<uint64_t>(reply.integer);
+}
+
+// A sample reply is [timestamp, value]; an empty array stands for a series
+// without samples (TS.GET).
+inline TimeSeriesTuple parseSample(const redisReply &reply) {
+    if (reply.type != REDIS_REPLY_ARRAY) {
+        throw sw::redis::ProtoError("Expect ARRAY reply");
+    }
+    if (reply.elements == 0) return TimeSeriesTuple{};
+    if (reply.elements != 2) throw sw::redis::ProtoError("Expect sample");
+    return TimeSeriesTuple(TimeStamp(parseSampleTimeStamp(*reply.element[0])),
+                           parseDouble(*reply.element[1]));
+}
+
+// Fills `list`, a std::vector or a pmr vector bound to a caller's memory
+// resource, straight from the reply.
+template <typename List>
+List parseSampleArray(const redisReply &reply, List list) {
+    if (reply.type != REDIS_REPLY_ARRAY) {
+        throw sw::redis::ProtoError("Expect ARRAY reply");
+    }
+    list.reserve(reply.elements);
+    for (size_t i = 0; i < reply.elements; ++i)
+        list.push_back(parseSample(*reply.element[i]));
+    return list;
+}
+
+inline std::vector<TimeSeriesTuple> parseSampleArray(const redisReply &reply) {
+    return parseSampleArray(reply, std::vector<TimeSeriesTuple>{});
+}
+
+inline std::pmr::vector<TimeSeriesTuple>
+parseSampleArray(const redisReply &reply,
+                 std::pmr::memory_resource *resource) {
+    return parseSampleArray(reply, std::pmr::vector<TimeSeriesTuple>{resource});
+}
+
+// TS.MADD reply: one timestamp per sample, into a std::vector or a pmr
+// vector bound to a caller's memory resource.
+template <typename List>
+List parseTimeStampArray(const redisReply &reply, List list) {
+    if (reply.type != REDIS_REPLY_ARRAY) {
+        throw sw::redis::ProtoError("Expect ARRAY reply");
+    }
+    list.reserve(reply.elements);
+    for (size_t i = 0; i < reply.elements; ++i)
+        list.emplace_back(parseSampleTimeStamp(*reply.element[i]));
+    return list;
+}
+
+inline std::pmr::vector<TimeStamp>
+parseTimeStampArray(const redisReply &reply,
+                    std::pmr::memory_resource *resource) {
+    return parseTimeStampArray(reply, std::pmr::vector<TimeStamp>{resource});
+}
+
+// Appends a TS.RANGE style sample array to `columns`.
+inline void parseSampleColumns(const redisReply &reply,
+                               TimeSeriesColumns &columns) {
+    if (reply.type != REDIS_REPLY_ARRAY) {
+        throw sw::redis::ProtoError("Expect ARRAY reply");
+    }
+    columns.reserve(columns.size() + reply.elements);
+    for (size_t i = 0; i < reply.elements; ++i) {
+        auto &sample = *reply.element[i];
+        if (sample.type != REDIS_REPLY_ARRAY || sample.elements != 2) {
+            throw sw::redis::ProtoError("Expect sample");
+        }
+        columns.push_back(parseSampleTimeStamp(*sample.element[0]),
+                          parseDouble(*sample.element[1]));
+    }
+}
+
 inline std::vector<TimeSeriesTuple> parseTimeSeriesTupleArray(
     const std::vector<std::tuple<std::string, std::string>> &result) {
-    std::vector<TimeSeriesTuple> list;
-    for (auto &res : result)
-        list.push_back(parseTimeSeriesTuple(res));
-    return list;
+    return parseArray<std::vector<TimeSeriesTuple>>(result,
+                                                    parseTimeSeriesTuple);
 }
 
+// Same as parseTimeSeriesTupleArray, parsed from the reply itself into a
+// vector allocated from `resource`.
+inline std::pmr::vector<TimeSeriesTuple>
+parseTimeSeriesTupleArray(const redisReply &reply,
+                          std::pmr::memory_resource *resource) {
+    return parseSampleArray(reply, resource);
+}
+
+inline TimeSeriesLabel
+parseLabel(const std::tuple<std::string, std::string> &result) {
+    return TimeSeriesLabel(std::get<0>(result), std::get<1>(result));
+}
+
+// See parseLabelArray(redisReply *, std::pmr::memory_resource *) below for
+// a variant that neither copies the pairs nor uses the default heap.
 inline std::vector<TimeSeriesLabel> parseLabelArray(
     const std::vector<std::tuple<std::string, std::string>> &result) {
-    std::vector<TimeSeriesLabel> list;
-    for (auto &res : result) {
-        list.push_back(TimeSeriesLabel(std::get<0>(res), std::get<1>(res)));
+    return parseArray<std::vector<TimeSeriesLabel>>(result, parseLabel);
+}
+
+inline std::string_view parseStringView(const redisReply &reply) {
+    if (reply.type != REDIS_REPLY_STRING && reply.type != REDIS_REPLY_STATUS) {
+        throw sw::redis::ProtoError("Expect STRING reply");
+    }
+    return {reply.str, reply.len};
+}
+
+// Interns label pairs straight from the reply buffers, without building the
+// intermediate std::string tuples, into a std::vector or a pmr vector.
+template <typename List>
+List parseLabelArray(redisReply *reply, List list) {
+    if (!sw::redis::reply::is_array(*reply)) {
+        throw sw::redis::ProtoError("Expect ARRAY reply");
+    }
+    list.reserve(reply->elements);
+    for (size_t i = 0; i < reply->elements; ++i) {
+        auto *pair = reply->element[i];
+        if (!sw::redis::reply::is_array(*pair) || pair->elements != 2) {
+            throw sw::redis::ProtoError("Expect label pair");
+        }
+        // SELECTED_LABELS reports a label the series lacks as nil.
+        auto *value = pair->element[1];
+        list.emplace_back(parseStringView(*pair->element[0]),
+                          value->type == REDIS_REPLY_NIL
+                              ? std::string_view{}
+                              : parseStringView(*value));
     }
     return list;
 }
 
-// private
-// static std::vector<(string key, std::vector<TimeSeriesLabel> labels,
-//                       TimeSeriesTuple value)>
-// ParseMGetesponse(RedisResult result) {
-//     RedisResult[] redisResults = (RedisResult[])result;
-//     var list = new List<(string key, std::vector<TimeSeriesLabel> labels,
-//                          TimeSeriesTuple values)>(redisResults.Length);
-//     if (redisResults.Length == 0) return list;
-//     Array.ForEach(
-//         redisResults, MRangeValue = > {
-//             RedisResult[] MRangeTuple = (RedisResult[])MRangeValue;
-//            const std::string&key = (string)MRangeTuple[0];
-//             std::vector<TimeSeriesLabel> labels =
-//                 ParseLabelArray(MRangeTuple[1]);
-//             TimeSeriesTuple value = ParseTimeSeriesTuple(MRangeTuple[2]);
-//             list.Add((key, labels, value));
-//         });
-//     return list;
-// }
-
-// private
-// static std::vector<(string key, std::vector<TimeSeriesLabel> labels,
-//                       std::vector<TimeSeriesTuple> values)>
-// ParseMRangeResponse(RedisResult result) {
-//     RedisResult[] redisResults = (RedisResult[])result;
-//     var list =
-//         new List<(string key, std::vector<TimeSeriesLabel> labels,
-//                   std::vector<TimeSeriesTuple>
-//                   values)>(redisResults.Length);
-//     if (redisResults.Length == 0) return list;
-//     Array.ForEach(
-//         redisResults, MRangeValue = > {
-//             RedisResult[] MRangeTuple = (RedisResult[])MRangeValue;
-//            const std::string&key = (string)MRangeTuple[0];
-//             std::vector<TimeSeriesLabel> labels =
-//                 ParseLabelArray(MRangeTuple[1]);
-//             std::vector<TimeSeriesTuple> values =
-//                 ParseTimeSeriesTupleArray(MRangeTuple[2]);
-//             list.Add((key, labels, values));
-//         });
-//     return list;
-// }
+inline std::vector<TimeSeriesLabel> parseLabelArray(redisReply *reply) {
+    return parseLabelArray(reply, std::vector<TimeSeriesLabel>{});
+}
+
+inline std::pmr::vector<TimeSeriesLabel>
+parseLabelArray(redisReply *reply, std::pmr::memory_resource *resource) {
+    return parseLabelArray(reply, std::pmr::vector<TimeSeriesLabel>{resource});
+}
+
+// Checks one [key, labels, sample] entry of an MGET reply.
+inline const redisReply &checkMGetEntry(const redisReply &entry) {
+    if (entry.type != REDIS_REPLY_ARRAY || entry.elements != 3) {
+        throw sw::redis::ProtoError("Expect MGET entry");
+    }
+    return entry;
+}
+
+// MGET reply: one [key, labels, sample] triple per series. Labels are empty
+// unless WITHLABELS or SELECTED_LABELS was requested.
+inline std::vector<TimeSeriesMGetEntry>
+parseMGetResponse(const redisReply &reply) {
+    if (reply.type != REDIS_REPLY_ARRAY) {
+        throw sw::redis::ProtoError("Expect ARRAY reply");
+    }
+    std::vector<TimeSeriesMGetEntry> list;
+    list.reserve(reply.elements);
+    for (size_t i = 0; i < reply.elements; ++i) {
+        auto &entry = checkMGetEntry(*reply.element[i]);
+        list.emplace_back(std::string{parseStringView(*entry.element[0])},
+                          parseLabelArray(entry.element[1]),
+                          parseSample(*entry.element[2]));
+    }
+    return list;
+}
+
+// Checks one [key, labels, samples] entry of an MRANGE reply.
+inline const redisReply &checkMRangeEntry(const redisReply &entry) {
+    if (entry.type != REDIS_REPLY_ARRAY || entry.elements != 3) {
+        throw sw::redis::ProtoError("Expect MRANGE entry");
+    }
+    return entry;
+}
+
+// MRANGE/MREVRANGE reply: one [key, labels, samples] triple per series.
+// Labels are empty unless WITHLABELS or SELECTED_LABELS was requested.
+inline std::vector<TimeSeriesMRangeEntry>
+parseMRangeResponse(const redisReply &reply) {
+    if (reply.type != REDIS_REPLY_ARRAY) {
+        throw sw::redis::ProtoError("Expect ARRAY reply");
+    }
+    std::vector<TimeSeriesMRangeEntry> list;
+    list.reserve(reply.elements);
+    for (size_t i = 0; i < reply.elements; ++i) {
+        auto &entry = checkMRangeEntry(*reply.element[i]);
+        list.emplace_back(std::string{parseStringView(*entry.element[0])},
+                          parseLabelArray(entry.element[1]),
+                          parseSampleArray(*entry.element[2]));
+    }
+    return list;
+}
+
+// Same as parseMRangeResponse, with the entries, keys, label lists and
+// sample lists all allocated from `resource`.
+inline std::pmr::vector<TimeSeriesPmrMRangeEntry>
+parseMRangeResponse(const redisReply &reply,
+                    std::pmr::memory_resource *resource) {
+    if (reply.type != REDIS_REPLY_ARRAY) {
+        throw sw::redis::ProtoError("Expect ARRAY reply");
+    }
+    std::pmr::vector<TimeSeriesPmrMRangeEntry> list{resource};
+    list.reserve(reply.elements);
+    for (size_t i = 0; i < reply.elements; ++i) {
+        auto &entry = checkMRangeEntry(*reply.element[i]);
+        // The vector's allocator hands `resource` on to every member.
+        list.emplace_back(parseStringView(*entry.element[0]),
+                          parseLabelArray(entry.element[1], resource),
+                          parseSampleArray(*entry.element[2], resource));
+    }
+    return list;
+}
 
 inline TimeSeriesRule
 parseRule(const std::tuple<std::string, std::string, sw::redis::OptionalString>
@@ -706,11 +1191,8 @@ parseRule(const std::tuple<std::string, std::string, sw::redis::OptionalString>
 inline std::vector<TimeSeriesRule> parseRuleArray(
     const std::vector<std::tuple<std::string, std::string,
                                  sw::redis::OptionalString>> &result) {
-    std::vector<TimeSeriesRule> list;
-    for (auto &res : result) {
-        list.push_back(parseRule(res));
-    }
-    return list;
+    return parseArray<std::vector<TimeSeriesRule>>(
+        result, [](const auto &rule) { return parseRule(rule); });
 }
 
 inline std::optional<command_operator::TsDuplicatePolicy>
@@ -720,7 +1202,76 @@ parsePolicy(const sw::redis::OptionalString &result) {
     return std::nullopt;
 }
 
-inline TimeSeriesInformation parseInfo(redisReply *reply) {
+inline uint64_t parseUnsigned(const redisReply &reply) {
+    if (reply.type != REDIS_REPLY_INTEGER) {
+        throw sw::redis::ProtoError("Expect INTEGER reply");
+    }
+    return static_cast<uint64_t>(reply.integer);
+}
+
+// The bucket of a TS.INFO rule is an integer, or a string on old servers.
+inline uint64_t parseRuleBucket(const redisReply &reply) {
+    if (reply.type == REDIS_REPLY_INTEGER) return parseUnsigned(reply);
+    auto text = parseStringView(reply);
+    uint64_t bucket{};
+    auto [end, ec] =
+        std::from_chars(text.data(), text.data() + text.size(), bucket);
+    if (ec != std::errc{} || end != text.data() + text.size()) {
+        throw sw::redis::ProtoError("Invalid rule bucket");
+    }
+    return bucket;
+}
+
+// A TS.INFO rule is [destKey, bucket, aggregation]. Only a destination key
+// too long for the string's inline buffer takes a heap allocation.
+inline TimeSeriesRule parseRule(const redisReply &reply) {
+    if (reply.type != REDIS_REPLY_ARRAY || reply.elements != 3) {
+        throw sw::redis::ProtoError("Expect rule");
+    }
+    std::optional<command_operator::TsAggregation> aggregation;
+    if (reply.element[2]->type != REDIS_REPLY_NIL) {
+        aggregation = command_operator::to_aggregation(
+            std::string{parseStringView(*reply.element[2])});
+    }
+    return TimeSeriesRule{std::string{parseStringView(*reply.element[0])},
+                          parseRuleBucket(*reply.element[1]), aggregation};
+}
+
+// Fills `list`, a std::vector or a pmr vector bound to a caller's memory
+// resource, straight from the reply.
+template <typename List>
+List parseRuleArray(const redisReply &reply, List list) {
+    if (reply.type != REDIS_REPLY_ARRAY) {
+        throw sw::redis::ProtoError("Expect ARRAY reply");
+    }
+    list.reserve(reply.elements);
+    for (size_t i = 0; i < reply.elements; ++i)
+        list.push_back(parseRule(*reply.element[i]));
+    return list;
+}
+
+inline std::vector<TimeSeriesRule> parseRuleArray(const redisReply &reply) {
+    return parseRuleArray(reply, std::vector<TimeSeriesRule>{});
+}
+
+inline std::pmr::vector<TimeSeriesRule>
+parseRuleArray(const redisReply &reply, std::pmr::memory_resource *resource) {
+    return parseRuleArray(reply, std::pmr::vector<TimeSeriesRule>{resource});
+}
+
+inline std::optional<command_operator::TsDuplicatePolicy>
+parsePolicy(const redisReply &reply) {
+    if (reply.type == REDIS_REPLY_NIL) return std::nullopt;
+    return command_operator::to_duplicatPolicy(
+        std::string{parseStringView(reply)});
+}
+
+// Parses a TS.INFO reply into the empty `labels`, `sourceKey` and `rules`,
+// which carry the allocator of the result; field names are compared in
+// place.
+template <typename Labels, typename String, typename Rules>
+BasicTimeSeriesInformation<Labels, String, Rules>
+parseInfo(redisReply *reply, Labels labels, String sourceKey, Rules rules) {
     if (!sw::redis::reply::is_array(*reply)) {
         throw sw::redis::ProtoError("Expect ARRAY reply");
     }
@@ -728,187 +1279,303 @@ inline TimeSeriesInformation parseInfo(redisReply *reply) {
     uint64_t totalSamples = 0, memoryUsage = 0, retentionTime = 0,
              chunkSize = 0, chunkCount = 0;
     TimeStamp firstTimestamp, lastTimestamp;
-    std::vector<TimeSeriesLabel> labels;
-    std::vector<TimeSeriesRule> rules;
-    std::string sourceKey;
     std::optional<command_operator::TsDuplicatePolicy> duplicatePolicy;
 
-    for (size_t i = 0; i < reply->elements; ++i) {
-        auto key = sw::redis::reply::parse<std::string>(*reply->element[i++]);
+    for (size_t i = 0; i + 1 < reply->elements; i += 2) {
+        auto key = parseStringView(*reply->element[i]);
+        auto &value = *reply->element[i + 1];
         if (key == "totalSamples") {
-            totalSamples =
-                sw::redis::reply::parse<long long>(*reply->element[i]);
+            totalSamples = parseUnsigned(value);
         } else if (key == "memoryUsage") {
-            memoryUsage =
-                sw::redis::reply::parse<long long>(*reply->element[i]);
+            memoryUsage = parseUnsigned(value);
         } else if (key == "retentionTime") {
-            retentionTime =
-                sw::redis::reply::parse<long long>(*reply->element[i]);
+            retentionTime = parseUnsigned(value);
         } else if (key == "chunkCount") {
-            chunkCount = sw::redis::reply::parse<long long>(*reply->element[i]);
+            chunkCount = parseUnsigned(value);
         } else if (key == "chunkSize") {
-            chunkSize = sw::redis::reply::parse<long long>(*reply->element[i]);
+            chunkSize = parseUnsigned(value);
         } else if (key == "firstTimestamp") {
-            firstTimestamp = parseTimeStamp(
-                sw::redis::reply::parse<long long>(*reply->element[i]));
+            firstTimestamp = parseTimeStamp(parseUnsigned(value));
         } else if (key == "lastTimestamp") {
-            lastTimestamp = parseTimeStamp(
-                sw::redis::reply::parse<long long>(*reply->element[i]));
+            lastTimestamp = parseTimeStamp(parseUnsigned(value));
         } else if (key == "labels") {
-            labels = parseLabelArray(
-                sw::redis::reply::parse<
-                    std::vector<std::tuple<std::string, std::string>>>(
-                    *reply->element[i]));
+            labels = parseLabelArray(&value, std::move(labels));
         } else if (key == "sourceKey") {
-            auto src = sw::redis::reply::parse<sw::redis::OptionalString>(
-                *reply->element[i]);
-            if (src.has_value()) sourceKey = src.value();
+            if (value.type != REDIS_REPLY_NIL)
+                sourceKey.assign(parseStringView(value));
         } else if (key == "rules") {
-            rules = parseRuleArray(
-                sw::redis::reply::parse<std::vector<std::tuple<
-                    std::string, std::string, sw::redis::OptionalString>>>(
-                    *reply->element[i]));
+            rules = parseRuleArray(value, std::move(rules));
         } else if (key == "duplicatePolicy") {
-            duplicatePolicy =
-                parsePolicy(sw::redis::reply::parse<sw::redis::OptionalString>(
-                    *reply->element[i]));
+            duplicatePolicy = parsePolicy(value);
         }
     }
-    return TimeSeriesInformation{totalSamples,  memoryUsage,    firstTimestamp,
-                                 lastTimestamp, retentionTime,  chunkCount,
-                                 chunkSize,     labels,         sourceKey,
-                                 rules,         duplicatePolicy};
+    return BasicTimeSeriesInformation<Labels, String, Rules>{
+        totalSamples,
+        memoryUsage,
+        std::move(firstTimestamp),
+        std::move(lastTimestamp),
+        retentionTime,
+        chunkCount,
+        chunkSize,
+        std::move(labels),
+        std::move(sourceKey),
+        std::move(rules),
+        duplicatePolicy};
+}
+
+inline TimeSeriesInformation parseInfo(redisReply *reply) {
+    return parseInfo(reply, std::vector<TimeSeriesLabel>{}, std::string{},
+                     std::vector<TimeSeriesRule>{});
 }
 
-// private
-// static std::vector<std::string> ParseStringArray(RedisResult result) {
-//     RedisResult[] redisResults = (RedisResult[])result;
-//     var list = new List<std::string>();
-//     if (redisResults.Length == 0) return list;
-//     Array.ForEach(redisResults, str = > list.Add((string)str));
-//     return list;
-// }
+// Same as parseInfo, with the label list, source key and rule list
+// allocated from `resource`.
+inline TimeSeriesPmrInformation
+parseInfo(redisReply *reply, std::pmr::memory_resource *resource) {
+    return parseInfo(reply, std::pmr::vector<TimeSeriesLabel>{resource},
+                     std::pmr::string{resource},
+                     std::pmr::vector<TimeSeriesRule>{resource});
+}
+
+inline std::vector<std::string> parseStringArray(const redisReply &reply) {
+    if (reply.type != REDIS_REPLY_ARRAY) {
+        throw sw::redis::ProtoError("Expect ARRAY reply");
+    }
+    std::vector<std::string> list;
+    list.reserve(reply.elements);
+    for (size_t i = 0; i < reply.elements; ++i)
+        list.emplace_back(parseStringView(*reply.element[i]));
+    return list;
+}
 } // namespace parser
 
 namespace client {
+// The write commands take an optional memory resource, e.g. a
+// RequestArena's, for their arguments; the overloads without one use the
+// default resource. Only the hiredis reply comes from the global heap.
 inline bool timeSeriesCreate(
-    sw::redis::Redis *db, const std::string &key,
+    sw::redis::Redis *db, std::pmr::memory_resource *resource,
+    const std::string &key,
     std::optional<uint64_t> retentionTime = std::nullopt,
-    std::vector<TimeSeriesLabel> labels = {},
+    LabelSpan labels = {},
     std::optional<bool> uncompressed = std::nullopt,
     std::optional<long> chunkSizeBytes = std::nullopt,
     std::optional<command_operator::TsDuplicatePolicy> duplicatePolicy =
         std::nullopt) {
-    auto args = aux::buildTsCreateArgs(key, retentionTime, labels, uncompressed,
-                                       chunkSizeBytes, duplicatePolicy);
-    args.insert(args.begin(), "TS.CREATE");
+    auto args =
+        aux::buildTsCreateArgs(key, retentionTime, labels, uncompressed,
+                               chunkSizeBytes, duplicatePolicy, resource);
+    args.emplace(args.begin(), command::CREATE);
 
     return parser::parseBoolean(
         db->command<sw::redis::OptionalString>(args.begin(), args.end()));
 }
 
+inline bool timeSeriesCreate(
+    sw::redis::Redis *db, const std::string &key,
+    std::optional<uint64_t> retentionTime = std::nullopt,
+    LabelSpan labels = {},
+    std::optional<bool> uncompressed = std::nullopt,
+    std::optional<long> chunkSizeBytes = std::nullopt,
+    std::optional<command_operator::TsDuplicatePolicy> duplicatePolicy =
+        std::nullopt) {
+    return timeSeriesCreate(db, std::pmr::get_default_resource(), key,
+                            retentionTime, labels, uncompressed,
+                            chunkSizeBytes, duplicatePolicy);
+}
+
 inline bool
-timeSeriesAlter(sw::redis::Redis *db, const std::string &key,
+timeSeriesAlter(sw::redis::Redis *db, std::pmr::memory_resource *resource,
+                const std::string &key,
                 std::optional<uint64_t> retentionTime = std::nullopt,
-                std::vector<TimeSeriesLabel> labels = {}) {
-    auto args = aux::buildTsAlterArgs(key, retentionTime, labels);
-    args.insert(args.begin(), "TS.ALTER");
+                LabelSpan labels = {},
+                std::optional<command_operator::TsDuplicatePolicy>
+                    duplicatePolicy = std::nullopt) {
+    auto args = aux::buildTsAlterArgs(key, retentionTime, labels,
+                                      duplicatePolicy, resource);
+    args.emplace(args.begin(), command::ALTER);
 
     return parser::parseBoolean(
         db->command<sw::redis::OptionalString>(args.begin(), args.end()));
 }
 
+inline bool
+timeSeriesAlter(sw::redis::Redis *db, const std::string &key,
+                std::optional<uint64_t> retentionTime = std::nullopt,
+                LabelSpan labels = {},
+                std::optional<command_operator::TsDuplicatePolicy>
+                    duplicatePolicy = std::nullopt) {
+    return timeSeriesAlter(db, std::pmr::get_default_resource(), key,
+                           retentionTime, labels, duplicatePolicy);
+}
+
 inline TimeStamp timeSeriesAdd(
-    sw::redis::Redis *db, const std::string &key, const TimeStamp &timestamp,
-    double value, std::optional<uint64_t> retentionTime = std::nullopt,
-    std::vector<TimeSeriesLabel> labels = {},
+    sw::redis::Redis *db, std::pmr::memory_resource *resource,
+    const std::string &key, const TimeStamp &timestamp, double value,
+    std::optional<uint64_t> retentionTime = std::nullopt,
+    LabelSpan labels = {},
     std::optional<bool> uncompressed = std::nullopt,
     std::optional<long> chunkSizeBytes = std::nullopt,
     std::optional<command_operator::TsDuplicatePolicy> duplicatePolicy =
         std::nullopt) {
-    auto args =
-        aux::buildTsAddArgs(key, timestamp, value, retentionTime, labels,
-                            uncompressed, chunkSizeBytes, duplicatePolicy);
-    args.insert(args.begin(), "TS.ADD");
+    auto args = aux::buildTsAddArgs(key, timestamp, value, retentionTime,
+                                    labels, uncompressed, chunkSizeBytes,
+                                    duplicatePolicy, resource);
+    args.emplace(args.begin(), command::ADD);
 
     return parser::parseTimeStamp(
         db->command<long long>(args.begin(), args.end()));
 }
 
+inline TimeStamp timeSeriesAdd(
+    sw::redis::Redis *db, const std::string &key, const TimeStamp &timestamp,
+    double value, std::optional<uint64_t> retentionTime = std::nullopt,
+    LabelSpan labels = {},
+    std::optional<bool> uncompressed = std::nullopt,
+    std::optional<long> chunkSizeBytes = std::nullopt,
+    std::optional<command_operator::TsDuplicatePolicy> duplicatePolicy =
+        std::nullopt) {
+    return timeSeriesAdd(db, std::pmr::get_default_resource(), key, timestamp,
+                         value, retentionTime, labels, uncompressed,
+                         chunkSizeBytes, duplicatePolicy);
+}
+
 inline std::vector<TimeStamp> timeSeriesMAdd(
     sw::redis::Redis *db,
     const std::vector<std::tuple<std::string, TimeStamp, double>> &sequence) {
     auto args = aux::buildTsMaddArgs(sequence);
-    args.insert(args.begin(), "TS.MADD");
+    args.emplace(args.begin(), command::MADD);
 
     return parser::parseTimeStampArray(
         db->command<std::vector<long long>>(args.begin(), args.end()));
 }
 
+// Same as timeSeriesMAdd, with the arguments and the timestamps allocated
+// from `resource`.
+inline std::pmr::vector<TimeStamp> timeSeriesMAdd(
+    sw::redis::Redis *db, std::pmr::memory_resource *resource,
+    const std::vector<std::tuple<std::string, TimeStamp, double>> &sequence) {
+    auto args = aux::buildTsMaddArgs(sequence, resource);
+    args.emplace(args.begin(), command::MADD);
+
+    auto reply = db->command(args.begin(), args.end());
+    return parser::parseTimeStampArray(*reply, resource);
+}
+
 inline TimeStamp
-timeSeriesIncrBy(sw::redis::Redis *db, const std::string &key, double value,
+timeSeriesIncrBy(sw::redis::Redis *db, std::pmr::memory_resource *resource,
+                 const std::string &key, double value,
                  const TimeStamp &timestamp = {},
                  std::optional<uint64_t> retentionTime = std::nullopt,
-                 std::vector<TimeSeriesLabel> labels = {},
+                 LabelSpan labels = {},
                  std::optional<bool> uncompressed = std::nullopt,
                  std::optional<long> chunkSizeBytes = std::nullopt) {
 
-    auto args =
-        aux::buildTsIncrDecrByArgs(key, value, timestamp, retentionTime, labels,
-                                   uncompressed, chunkSizeBytes);
-    args.insert(args.begin(), "TS.INCRBY");
+    auto args = aux::buildTsIncrDecrByArgs(key, value, timestamp,
+                                           retentionTime, labels, uncompressed,
+                                           chunkSizeBytes, resource);
+    args.emplace(args.begin(), command::INCRBY);
 
     return parser::parseTimeStamp(
         db->command<long long>(args.begin(), args.end()));
 }
 
 inline TimeStamp
-timeSeriesDecrBy(sw::redis::Redis *db, const std::string &key, double value,
+timeSeriesIncrBy(sw::redis::Redis *db, const std::string &key, double value,
                  const TimeStamp &timestamp = {},
                  std::optional<uint64_t> retentionTime = std::nullopt,
-                 std::vector<TimeSeriesLabel> labels = {},
+                 LabelSpan labels = {},
                  std::optional<bool> uncompressed = std::nullopt,
                  std::optional<long> chunkSizeBytes = std::nullopt) {
+    return timeSeriesIncrBy(db, std::pmr::get_default_resource(), key, value,
+                            timestamp, retentionTime, labels, uncompressed,
+                            chunkSizeBytes);
+}
 
-    auto args =
-        aux::buildTsIncrDecrByArgs(key, value, timestamp, retentionTime, labels,
-                                   uncompressed, chunkSizeBytes);
-    args.insert(args.begin(), "TS.DECRBY");
+inline TimeStamp
+timeSeriesDecrBy(sw::redis::Redis *db, std::pmr::memory_resource *resource,
+                 const std::string &key, double value,
+                 const TimeStamp &timestamp = {},
+                 std::optional<uint64_t> retentionTime = std::nullopt,
+                 LabelSpan labels = {},
+                 std::optional<bool> uncompressed = std::nullopt,
+                 std::optional<long> chunkSizeBytes = std::nullopt) {
+
+    auto args = aux::buildTsIncrDecrByArgs(key, value, timestamp,
+                                           retentionTime, labels, uncompressed,
+                                           chunkSizeBytes, resource);
+    args.emplace(args.begin(), command::DECRBY);
 
     return parser::parseTimeStamp(
         db->command<long long>(args.begin(), args.end()));
 }
 
-inline uint64_t timeSeriesDel(sw::redis::Redis *db, const std::string &key,
+inline TimeStamp
+timeSeriesDecrBy(sw::redis::Redis *db, const std::string &key, double value,
+                 const TimeStamp &timestamp = {},
+                 std::optional<uint64_t> retentionTime = std::nullopt,
+                 LabelSpan labels = {},
+                 std::optional<bool> uncompressed = std::nullopt,
+                 std::optional<long> chunkSizeBytes = std::nullopt) {
+    return timeSeriesDecrBy(db, std::pmr::get_default_resource(), key, value,
+                            timestamp, retentionTime, labels, uncompressed,
+                            chunkSizeBytes);
+}
+
+inline uint64_t timeSeriesDel(sw::redis::Redis *db,
+                              std::pmr::memory_resource *resource,
+                              const std::string &key,
                               const TimeStamp &fromTimeStamp,
                               const TimeStamp &toTimeStamp) {
-    auto args = aux::buildTsDelArgs(key, fromTimeStamp, toTimeStamp);
-    args.insert(args.begin(), "TS.DEL");
+    auto args = aux::buildTsDelArgs(key, fromTimeStamp, toTimeStamp, resource);
+    args.emplace(args.begin(), command::DEL);
 
     return parser::parseLong(db->command<long long>(args.begin(), args.end()));
 }
 
+inline uint64_t timeSeriesDel(sw::redis::Redis *db, const std::string &key,
+                              const TimeStamp &fromTimeStamp,
+                              const TimeStamp &toTimeStamp) {
+    return timeSeriesDel(db, std::pmr::get_default_resource(), key,
+                         fromTimeStamp, toTimeStamp);
+}
+
 inline bool timeSeriesCreateRule(sw::redis::Redis *db,
+                                 std::pmr::memory_resource *resource,
                                  const std::string &sourceKey,
                                  const TimeSeriesRule &rule) {
-    std::vector<std::string> args{"TS.CREATERULE", sourceKey, rule.destKey()};
-    if (rule.aggregation().has_value()) {
-        args.push_back("AGGREGATION");
-        args.push_back(command_operator::to_string(rule.aggregation().value()));
-    }
-    args.push_back(std::to_string(rule.timeBucket()));
+    auto args = aux::buildTsCreateRuleArgs(sourceKey, rule, resource);
+    args.emplace(args.begin(), command::CREATERULE);
+
     return parser::parseBoolean(
         db->command<sw::redis::OptionalString>(args.begin(), args.end()));
 }
 
+inline bool timeSeriesCreateRule(sw::redis::Redis *db,
+                                 const std::string &sourceKey,
+                                 const TimeSeriesRule &rule) {
+    return timeSeriesCreateRule(db, std::pmr::get_default_resource(),
+                                sourceKey, rule);
+}
+
 inline bool timeSeriesDeleteRule(sw::redis::Redis *db,
+                                 std::pmr::memory_resource *resource,
                                  const std::string &sourceKey,
                                  const std::string &destKey) {
-    std::vector<std::string> args{"TS.DELETERULE", sourceKey, destKey};
+    auto args = aux::buildTsDeleteRuleArgs(sourceKey, destKey, resource);
+    args.emplace(args.begin(), command::DELETERULE);
+
     return parser::parseBoolean(
         db->command<sw::redis::OptionalString>(args.begin(), args.end()));
 }
 
+inline bool timeSeriesDeleteRule(sw::redis::Redis *db,
+                                 const std::string &sourceKey,
+                                 const std::string &destKey) {
+    return timeSeriesDeleteRule(db, std::pmr::get_default_resource(),
+                                sourceKey, destKey);
+}
+
 inline TimeSeriesTuple TimeSeriesGet(sw::redis::Redis *db,
                                      const std::string &key) {
     std::vector<std::string> args{"TS.GET", key};
@@ -917,108 +1584,240 @@ inline TimeSeriesTuple TimeSeriesGet(sw::redis::Redis *db,
                                                           args.end()));
 }
 
-// inline std::vector<
-//     std::tuple<std::stringstd::vector<TimeSeriesLabel>, TimeSeriesTuple>>
-// TimeSeriesMGet(sw::redis::Redis *db, const std::vector<std::string> &filter,
-//                std::optional<bool> withLabels = std::nullopt) {
-//     auto args = aux::buildTsMgetArgs(filter, withLabels);
-//     return ParseMGetesponse(db.Execute(TS.MGET, args));
-// }
-
-// inline std::vector<TimeSeriesTuple> TimeSeriesRange(sw::redis::Redis *db,
-//            const std::string&key,
-//             TimeStamp fromTimeStamp,
-//             TimeStamp toTimeStamp,
-//             long? count = null,
-//             TsAggregation? aggregation = null,
-//             long? timeBucket = null,
-//             IReadOnlyCollection<TimeStamp> filterByTs = null,
-//             (long, long)? filterByValue = null,
-//             TimeStamp align = null)
-//         {
-//     var args =
-//         BuildRangeArgs(key, fromTimeStamp, toTimeStamp, count, aggregation,
-//                        timeBucket, filterByTs, filterByValue, align);
-//     return ParseTimeSeriesTupleArray(db.Execute(TS.RANGE, args));
-// }
-
-// inline std::vector<TimeSeriesTuple> TimeSeriesRevRange(sw::redis::Redis *db,
-//            const std::string&key,
-//             TimeStamp fromTimeStamp,
-//             TimeStamp toTimeStamp,
-//             long? count = null,
-//             TsAggregation? aggregation = null,
-//             long? timeBucket = null,
-//             IReadOnlyCollection<TimeStamp> filterByTs = null,
-//             (long, long)? filterByValue = null,
-//             TimeStamp align = null)
-//         {
-//     var args =
-//         BuildRangeArgs(key, fromTimeStamp, toTimeStamp, count, aggregation,
-//                        timeBucket, filterByTs, filterByValue, align);
-//     return ParseTimeSeriesTupleArray(db.Execute(TS.REVRANGE, args));
-// }
-
-// inline std::vector<(string key, std::vector<TimeSeriesLabel> labels,
-// std::vector<TimeSeriesTuple> values)> TimeSeriesMRange(sw::redis::Redis *db,
-//             TimeStamp fromTimeStamp,
-//             TimeStamp toTimeStamp,
-//             IReadOnlyCollection<std::string> filter,
-//             long? count = null,
-//             TsAggregation? aggregation = null,
-//             long? timeBucket = null,
-//             bool? withLabels = null,
-//             (string, TsReduce)? groupbyTuple = null,
-//             IReadOnlyCollection<TimeStamp> filterByTs = null,
-//             (long, long)? filterByValue = null,
-//             IReadOnlyCollection<std::string> selectLabels = null,
-//             TimeStamp align = null)
-//         {
-//     var args =
-//         BuildMultiRangeArgs(fromTimeStamp, toTimeStamp, filter, count,
-//                             aggregation, timeBucket, withLabels,
-//                             groupbyTuple, filterByTs, filterByValue,
-//                             selectLabels, align);
-//     return ParseMRangeResponse(db.Execute(TS.MRANGE, args));
-// }
-
-// inline std::vector<(string key, std::vector<TimeSeriesLabel> labels,
-// std::vector<TimeSeriesTuple> values)> TimeSeriesMRevRange(sw::redis::Redis
-// *db,
-//             TimeStamp fromTimeStamp,
-//             TimeStamp toTimeStamp,
-//             IReadOnlyCollection<std::string> filter,
-//             long? count = null,
-//             TsAggregation? aggregation = null,
-//             long? timeBucket = null,
-//             bool? withLabels = null,
-//             (string, TsReduce)? groupbyTuple = null,
-//             IReadOnlyCollection<TimeStamp> filterByTs = null,
-//             (long, long)? filterByValue = null,
-//             IReadOnlyCollection<std::string> selectLabels = null,
-//             TimeStamp align = null)
-//         {
-//     var args =
-//         BuildMultiRangeArgs(fromTimeStamp, toTimeStamp, filter, count,
-//                             aggregation, timeBucket, withLabels,
-//                             groupbyTuple, filterByTs, filterByValue,
-//                             selectLabels, align);
-//     return ParseMRangeResponse(db.Execute(TS.MREVRANGE, args));
-// }
-
-TimeSeriesInformation timeSeriesInfo(sw::redis::Redis *db,
-                                     const std::string &key) {
-    std::vector<std::string> args{"TS.INFO", key};
+inline std::vector<TimeSeriesMGetEntry>
+timeSeriesMGet(sw::redis::Redis *db, const std::vector<std::string> &filter,
+               std::optional<bool> withLabels = std::nullopt,
+               const std::vector<std::string> &selectLabels = {}) {
+    auto args = aux::buildTsMgetArgs(filter, withLabels, selectLabels);
+    args.emplace(args.begin(), command::MGET);
+
+    auto reply = db->command(args.begin(), args.end());
+    return parser::parseMGetResponse(*reply);
+}
+
+inline std::vector<TimeSeriesTuple> timeSeriesRange(
+    sw::redis::Redis *db, const std::string &key,
+    const TimeStamp &fromTimeStamp, const TimeStamp &toTimeStamp,
+    std::optional<uint64_t> count = std::nullopt,
+    std::optional<command_operator::TsAggregation> aggregation = std::nullopt,
+    std::optional<uint64_t> timeBucket = std::nullopt,
+    const std::vector<TimeStamp> &filterByTs = {},
+    std::optional<std::pair<uint64_t, uint64_t>> filterByValue = std::nullopt,
+    const TimeStamp &align = {}) {
+    auto args =
+        aux::buildRangeArgs(key, fromTimeStamp, toTimeStamp, count, aggregation,
+                            timeBucket, filterByTs, filterByValue, align);
+    args.emplace(args.begin(), command::RANGE);
+
+    auto reply = db->command(args.begin(), args.end());
+    return parser::parseSampleArray(*reply);
+}
+
+inline std::vector<TimeSeriesTuple> timeSeriesRevRange(
+    sw::redis::Redis *db, const std::string &key,
+    const TimeStamp &fromTimeStamp, const TimeStamp &toTimeStamp,
+    std::optional<uint64_t> count = std::nullopt,
+    std::optional<command_operator::TsAggregation> aggregation = std::nullopt,
+    std::optional<uint64_t> timeBucket = std::nullopt,
+    const std::vector<TimeStamp> &filterByTs = {},
+    std::optional<std::pair<uint64_t, uint64_t>> filterByValue = std::nullopt,
+    const TimeStamp &align = {}) {
+    auto args =
+        aux::buildRangeArgs(key, fromTimeStamp, toTimeStamp, count, aggregation,
+                            timeBucket, filterByTs, filterByValue, align);
+    args.emplace(args.begin(), command::REVRANGE);
+
+    auto reply = db->command(args.begin(), args.end());
+    return parser::parseSampleArray(*reply);
+}
+
+// Same as timeSeriesRange and timeSeriesRevRange, with the arguments and
+// the samples allocated from `resource`, e.g. a RequestArena's. Only the
+// hiredis reply itself comes from the global heap.
+inline std::pmr::vector<TimeSeriesTuple> timeSeriesRange(
+    sw::redis::Redis *db, std::pmr::memory_resource *resource,
+    const std::string &key, const TimeStamp &fromTimeStamp,
+    const TimeStamp &toTimeStamp,
+    std::optional<uint64_t> count = std::nullopt,
+    std::optional<command_operator::TsAggregation> aggregation = std::nullopt,
+    std::optional<uint64_t> timeBucket = std::nullopt,
+    const std::vector<TimeStamp> &filterByTs = {},
+    std::optional<std::pair<uint64_t, uint64_t>> filterByValue = std::nullopt,
+    const TimeStamp &align = {}) {
+    auto args = aux::buildRangeArgs(key, fromTimeStamp, toTimeStamp, count,
+                                    aggregation, timeBucket, filterByTs,
+                                    filterByValue, align, resource);
+    args.emplace(args.begin(), command::RANGE);
+
+    auto reply = db->command(args.begin(), args.end());
+    return parser::parseSampleArray(*reply, resource);
+}
+
+inline std::pmr::vector<TimeSeriesTuple> timeSeriesRevRange(
+    sw::redis::Redis *db, std::pmr::memory_resource *resource,
+    const std::string &key, const TimeStamp &fromTimeStamp,
+    const TimeStamp &toTimeStamp,
+    std::optional<uint64_t> count = std::nullopt,
+    std::optional<command_operator::TsAggregation> aggregation = std::nullopt,
+    std::optional<uint64_t> timeBucket = std::nullopt,
+    const std::vector<TimeStamp> &filterByTs = {},
+    std::optional<std::pair<uint64_t, uint64_t>> filterByValue = std::nullopt,
+    const TimeStamp &align = {}) {
+    auto args = aux::buildRangeArgs(key, fromTimeStamp, toTimeStamp, count,
+                                    aggregation, timeBucket, filterByTs,
+                                    filterByValue, align, resource);
+    args.emplace(args.begin(), command::REVRANGE);
+
+    auto reply = db->command(args.begin(), args.end());
+    return parser::parseSampleArray(*reply, resource);
+}
+
+// Same as timeSeriesRange but appends the samples to `columns`, skipping the
+// per-sample TimeSeriesTuple objects.
+inline void timeSeriesRangeColumns(
+    sw::redis::Redis *db, const std::string &key,
+    const TimeStamp &fromTimeStamp, const TimeStamp &toTimeStamp,
+    TimeSeriesColumns &columns,
+    std::optional<uint64_t> count = std::nullopt,
+    std::optional<command_operator::TsAggregation> aggregation = std::nullopt,
+    std::optional<uint64_t> timeBucket = std::nullopt,
+    const TimeStamp &align = {}) {
+    auto args = aux::buildRangeArgs(key, fromTimeStamp, toTimeStamp, count,
+                                    aggregation, timeBucket, {}, std::nullopt,
+                                    align);
+    args.emplace(args.begin(), command::RANGE);
+
+    auto reply = db->command(args.begin(), args.end());
+    parser::parseSampleColumns(*reply, columns);
+}
+
+inline std::vector<TimeSeriesMRangeEntry> timeSeriesMRange(
+    sw::redis::Redis *db, const TimeStamp &fromTimeStamp,
+    const TimeStamp &toTimeStamp, const std::vector<std::string> &filter,
+    std::optional<uint64_t> count = std::nullopt,
+    std::optional<command_operator::TsAggregation> aggregation = std::nullopt,
+    std::optional<uint64_t> timeBucket = std::nullopt,
+    std::optional<bool> withLabels = std::nullopt,
+    std::optional<std::string> groupby = std::nullopt,
+    std::optional<command_operator::TsReduce> reduce = std::nullopt,
+    const std::vector<TimeStamp> &filterByTs = {},
+    std::optional<std::pair<uint64_t, uint64_t>> filterByValue = std::nullopt,
+    const std::vector<std::string> &selectLabels = {},
+    const TimeStamp &align = {}) {
+    auto args = aux::buildMultiRangeArgs(
+        fromTimeStamp, toTimeStamp, filter, count, aggregation, timeBucket,
+        withLabels, groupby, reduce, filterByTs, filterByValue, selectLabels,
+        align);
+    args.emplace(args.begin(), command::MRANGE);
+
+    auto reply = db->command(args.begin(), args.end());
+    return parser::parseMRangeResponse(*reply);
+}
+
+inline std::vector<TimeSeriesMRangeEntry> timeSeriesMRevRange(
+    sw::redis::Redis *db, const TimeStamp &fromTimeStamp,
+    const TimeStamp &toTimeStamp, const std::vector<std::string> &filter,
+    std::optional<uint64_t> count = std::nullopt,
+    std::optional<command_operator::TsAggregation> aggregation = std::nullopt,
+    std::optional<uint64_t> timeBucket = std::nullopt,
+    std::optional<bool> withLabels = std::nullopt,
+    std::optional<std::string> groupby = std::nullopt,
+    std::optional<command_operator::TsReduce> reduce = std::nullopt,
+    const std::vector<TimeStamp> &filterByTs = {},
+    std::optional<std::pair<uint64_t, uint64_t>> filterByValue = std::nullopt,
+    const std::vector<std::string> &selectLabels = {},
+    const TimeStamp &align = {}) {
+    auto args = aux::buildMultiRangeArgs(
+        fromTimeStamp, toTimeStamp, filter, count, aggregation, timeBucket,
+        withLabels, groupby, reduce, filterByTs, filterByValue, selectLabels,
+        align);
+    args.emplace(args.begin(), command::MREVRANGE);
+
+    auto reply = db->command(args.begin(), args.end());
+    return parser::parseMRangeResponse(*reply);
+}
+
+// Same as timeSeriesMRange and timeSeriesMRevRange, with the arguments and
+// every container of the result allocated from `resource`.
+inline std::pmr::vector<TimeSeriesPmrMRangeEntry> timeSeriesMRange(
+    sw::redis::Redis *db, std::pmr::memory_resource *resource,
+    const TimeStamp &fromTimeStamp, const TimeStamp &toTimeStamp,
+    const std::vector<std::string> &filter,
+    std::optional<uint64_t> count = std::nullopt,
+    std::optional<command_operator::TsAggregation> aggregation = std::nullopt,
+    std::optional<uint64_t> timeBucket = std::nullopt,
+    std::optional<bool> withLabels = std::nullopt,
+    std::optional<std::string> groupby = std::nullopt,
+    std::optional<command_operator::TsReduce> reduce = std::nullopt,
+    const std::vector<TimeStamp> &filterByTs = {},
+    std::optional<std::pair<uint64_t, uint64_t>> filterByValue = std::nullopt,
+    const std::vector<std::string> &selectLabels = {},
+    const TimeStamp &align = {}) {
+    auto args = aux::buildMultiRangeArgs(
+        fromTimeStamp, toTimeStamp, filter, count, aggregation, timeBucket,
+        withLabels, groupby, reduce, filterByTs, filterByValue, selectLabels,
+        align, resource);
+    args.emplace(args.begin(), command::MRANGE);
+
+    auto reply = db->command(args.begin(), args.end());
+    return parser::parseMRangeResponse(*reply, resource);
+}
+
+inline std::pmr::vector<TimeSeriesPmrMRangeEntry> timeSeriesMRevRange(
+    sw::redis::Redis *db, std::pmr::memory_resource *resource,
+    const TimeStamp &fromTimeStamp, const TimeStamp &toTimeStamp,
+    const std::vector<std::string> &filter,
+    std::optional<uint64_t> count = std::nullopt,
+    std::optional<command_operator::TsAggregation> aggregation = std::nullopt,
+    std::optional<uint64_t> timeBucket = std::nullopt,
+    std::optional<bool> withLabels = std::nullopt,
+    std::optional<std::string> groupby = std::nullopt,
+    std::optional<command_operator::TsReduce> reduce = std::nullopt,
+    const std::vector<TimeStamp> &filterByTs = {},
+    std::optional<std::pair<uint64_t, uint64_t>> filterByValue = std::nullopt,
+    const std::vector<std::string> &selectLabels = {},
+    const TimeStamp &align = {}) {
+    auto args = aux::buildMultiRangeArgs(
+        fromTimeStamp, toTimeStamp, filter, count, aggregation, timeBucket,
+        withLabels, groupby, reduce, filterByTs, filterByValue, selectLabels,
+        align, resource);
+    args.emplace(args.begin(), command::MREVRANGE);
+
+    auto reply = db->command(args.begin(), args.end());
+    return parser::parseMRangeResponse(*reply, resource);
+}
+
+inline TimeSeriesInformation timeSeriesInfo(sw::redis::Redis *db,
+                                            const std::string &key) {
+    std::vector<std::string> args{command::INFO, key};
     auto reply = db->command(args.begin(), args.end());
     return parser::parseInfo(reply.get());
 }
 
-// inline std::vector<std::string>
-// TimeSeriesQueryIndex(sw::redis::Redis *db,
-//                      IReadOnlyCollection<std::string> filter) {
-//     var args = new List<object>(filter);
-//     return ParseStringArray(db.Execute(TS.QUERYINDEX, args));
-// }
+// Same as timeSeriesInfo, with the arguments, labels, source key and rule
+// list allocated from `resource`.
+inline TimeSeriesPmrInformation
+timeSeriesInfo(sw::redis::Redis *db, std::pmr::memory_resource *resource,
+               const std::string &key) {
+    auto args = aux::makeArgs(resource, 2);
+    args.emplace_back(command::INFO);
+    args.emplace_back(key);
+    auto reply = db->command(args.begin(), args.end());
+    return parser::parseInfo(reply.get(), resource);
+}
+
+inline std::vector<std::string>
+timeSeriesQueryIndex(sw::redis::Redis *db,
+                     const std::vector<std::string> &filter) {
+    if (filter.empty()) {
+        throw std::invalid_argument(
+            "There should be at least one filter on QUERYINDEX");
+    }
+    std::vector<std::string> args{command::QUERYINDEX};
+    args.insert(args.end(), filter.begin(), filter.end());
+    auto reply = db->command(args.begin(), args.end());
+    return parser::parseStringArray(*reply);
+}
 
 } // namespace client
 
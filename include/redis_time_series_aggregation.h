@@ -0,0 +1,128 @@
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace redis_time_series {
+
+// Bucket aggregation with the module's semantics, for the code that has to
+// compute or predict the server's buckets itself. Depends on the standard
+// library only, so the fake server can use it too.
+namespace aggregation {
+
+// Start of the bucket holding `timestamp`, with the server's semantics:
+// buckets are [start, start + timeBucket) and start, like `alignment`, is
+// a multiple of timeBucket plus the same remainder. A bucket that would
+// start before 0 starts at 0, as the server reports it.
+inline uint64_t bucketStart(uint64_t timestamp, uint64_t timeBucket,
+                            uint64_t alignment = 0) {
+    if (timeBucket == 0)
+        throw std::invalid_argument("timeBucket must be greater than zero");
+    auto remainder = alignment % timeBucket;
+    auto shift = (timestamp % timeBucket + timeBucket - remainder) % timeBucket;
+    return timestamp - std::min(shift, timestamp);
+}
+
+// Running aggregate of one bucket, for every aggregation type of the
+// module.
+class Accumulator {
+  public:
+    void add(double value) {
+        if (count_ == 0) {
+            first_ = min_ = max_ = value;
+        } else {
+            min_ = std::min(min_, value);
+            max_ = std::max(max_, value);
+        }
+        last_ = value;
+        sum_ += value;
+        ++count_;
+        // Welford's update keeps the variance numerically stable.
+        auto delta = value - mean_;
+        mean_ += delta / static_cast<double>(count_);
+        m2_ += delta * (value - mean_);
+    }
+
+    bool empty() const { return count_ == 0; }
+    void reset() { *this = Accumulator{}; }
+
+    // `type` is the module's name for the aggregation, e.g. "avg" or
+    // "STD.P", in any case.
+    double value(std::string_view type) const {
+        auto is = [&](std::string_view name) {
+            return std::equal(type.begin(), type.end(), name.begin(),
+                              name.end(), [](char a, char b) {
+                                  return std::tolower(
+                                             static_cast<unsigned char>(a)) ==
+                                         b;
+                              });
+        };
+        auto n = static_cast<double>(count_);
+        if (is("avg")) return sum_ / n;
+        if (is("sum")) return sum_;
+        if (is("min")) return min_;
+        if (is("max")) return max_;
+        if (is("range")) return max_ - min_;
+        if (is("count")) return n;
+        if (is("first")) return first_;
+        if (is("last")) return last_;
+        if (is("std.p")) return std::sqrt(m2_ / n);
+        if (is("std.s")) return count_ < 2 ? 0 : std::sqrt(m2_ / (n - 1));
+        if (is("var.p")) return m2_ / n;
+        if (is("var.s")) return count_ < 2 ? 0 : m2_ / (n - 1);
+        throw std::invalid_argument("TSDB: Unknown aggregation type");
+    }
+
+  private:
+    uint64_t count_{0};
+    double sum_{0}, min_{0}, max_{0}, first_{0}, last_{0};
+    double mean_{0}, m2_{0};
+};
+
+// Aggregates samples added in time order into buckets, as TS.RANGE with
+// AGGREGATION does: emit(start, value) is called once per non-empty
+// bucket, the last one on finish().
+template <typename Emit>
+class Buckets {
+  public:
+    Buckets(std::string type, uint64_t timeBucket, uint64_t alignment,
+            Emit emit)
+        : type_{std::move(type)}, timeBucket_{timeBucket},
+          alignment_{alignment}, emit_{std::move(emit)} {
+        if (timeBucket_ == 0)
+            throw std::invalid_argument(
+                "TSDB: bucketDuration must be greater than zero");
+    }
+
+    void add(uint64_t timestamp, double value) {
+        auto start = bucketStart(timestamp, timeBucket_, alignment_);
+        if (start_ != start) finish();
+        start_ = start;
+        current_.add(value);
+    }
+
+    void finish() {
+        if (current_.empty()) return;
+        emit_(*start_, current_.value(type_));
+        current_.reset();
+    }
+
+  private:
+    std::string type_;
+    uint64_t timeBucket_;
+    uint64_t alignment_;
+    Emit emit_;
+    std::optional<uint64_t> start_;
+    Accumulator current_;
+};
+
+} // namespace aggregation
+
+} // namespace redis_time_series
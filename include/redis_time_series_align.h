@@ -0,0 +1,309 @@
+#pragma once
+
+#include "redis_time_series.h"
+
+#include <cmath>
+#include <functional>
+#include <future>
+
+namespace redis_time_series {
+
+// Aligns irregular series onto a common fixed-step grid, producing a dense
+// matrix (one column per series) for analytics code.
+namespace align {
+
+// Value given to grid point t:
+//   NONE     last sample in (t - step, t], else NaN
+//   LOCF     last sample at or before t
+//   LINEAR   interpolation between the samples around t
+//   NEAREST  the sample closest in time to t (the earlier one on a tie)
+// Before a series' first sample every mode but NEAREST gives NaN. Past its
+// last sample LINEAR gives NaN, NONE keeps the sample for one step and
+// LOCF carries it forward. NEAREST takes the first or last sample on
+// either edge, as long as it is within AlignOptions::maxGap.
+enum class Fill { NONE, LOCF, LINEAR, NEAREST };
+
+enum class Layout { ROW_MAJOR, COLUMN_MAJOR };
+
+// Points start, start + step, ..., for `rows` points.
+struct Grid {
+    uint64_t start{0};
+    uint64_t step{1};
+    std::size_t rows{0};
+
+    uint64_t at(std::size_t row) const { return start + row * step; }
+};
+
+// Grid covering [from, to] with the given step; `from` is the first point.
+inline Grid makeGrid(uint64_t from, uint64_t to, uint64_t step) {
+    if (step == 0) throw std::invalid_argument("Grid step must not be zero");
+    if (from > to) return Grid{from, step, 0};
+    return Grid{from, step, static_cast<std::size_t>((to - from) / step + 1)};
+}
+
+struct AlignOptions {
+    Fill fill = Fill::LOCF;
+    Layout layout = Layout::COLUMN_MAJOR;
+    // Neighbours farther than this from the grid point are ignored, so
+    // long outages show up as NaN instead of being bridged.
+    std::optional<uint64_t> maxGap;
+    // Columns are filled concurrently on up to this many threads.
+    std::size_t threads = 1;
+};
+
+struct Matrix {
+    std::size_t rows{0};
+    std::size_t cols{0};
+    Layout layout{Layout::COLUMN_MAJOR};
+    std::vector<uint64_t> timestamps;
+    std::vector<double> values;
+
+    double at(std::size_t row, std::size_t col) const {
+        return values[layout == Layout::ROW_MAJOR ? row * cols + col
+                                                  : col * rows + row];
+    }
+};
+
+namespace detail {
+
+// Samples on either side of a grid point and their distances to it.
+struct Neighbours {
+    bool hasLo;
+    bool hasHi;
+    double dLo;
+    double dHi;
+    double lo;
+    double hi;
+};
+
+} // namespace detail
+
+// Fills `grid.rows` values of one series at `out`, `stride` apart. Two
+// passes: a merge of the sorted samples with the grid that only records,
+// per point, the last sample at or before it, and then a tight loop per
+// fill mode with no data-dependent branches that the compiler can
+// vectorize.
+inline void alignColumn(const TimeSeriesColumns &series, const Grid &grid,
+                        const AlignOptions &options, double *out,
+                        std::size_t stride = 1) {
+    using detail::Neighbours;
+    const auto nan = std::numeric_limits<double>::quiet_NaN();
+    const auto n = series.size();
+    const auto rows = grid.rows;
+    if (n == 0) {
+        for (std::size_t i = 0; i < rows; ++i)
+            out[i * stride] = nan;
+        return;
+    }
+    const auto *ts = series.timestamps.data();
+    const auto *vs = series.values.data();
+
+    // Pass 1: prev[i] = 1 + index of the last sample <= t, 0 if none.
+    std::vector<std::size_t> prev(rows);
+    std::size_t j = 0;
+    for (std::size_t i = 0; i < rows; ++i) {
+        auto t = grid.at(i);
+        while (j < n && ts[j] <= t)
+            ++j;
+        prev[i] = j;
+    }
+
+    // Pass 2: one loop per fill mode, each point from its neighbours.
+    const auto gap = static_cast<double>(
+        options.maxGap.value_or(std::numeric_limits<uint64_t>::max()));
+    const auto step = static_cast<double>(grid.step);
+    auto fill = [&](auto value) {
+        for (std::size_t i = 0; i < rows; ++i) {
+            auto p = prev[i];
+            auto t = grid.at(i);
+            // Last sample <= t and first sample >= t.
+            auto lo = p == 0 ? std::size_t{0} : p - 1;
+            auto exact = p != 0 && ts[lo] == t;
+            auto hi = exact ? lo : std::min(p, n - 1);
+            Neighbours around{p != 0,
+                              exact || p < n,
+                              static_cast<double>(t - std::min(ts[lo], t)),
+                              static_cast<double>(std::max(ts[hi], t) - t),
+                              vs[lo],
+                              vs[hi]};
+            out[i * stride] = value(around);
+        }
+    };
+    switch (options.fill) {
+    case Fill::NONE:
+        fill([&](const Neighbours &x) {
+            return x.hasLo && x.dLo < step ? x.lo : nan;
+        });
+        break;
+    case Fill::LOCF:
+        fill([&](const Neighbours &x) {
+            return x.hasLo && x.dLo <= gap ? x.lo : nan;
+        });
+        break;
+    case Fill::LINEAR:
+        fill([&](const Neighbours &x) {
+            auto span = x.dLo + x.dHi;
+            auto weight = span > 0 ? x.dLo / span : 0.0;
+            return x.hasLo && x.hasHi && x.dLo <= gap && x.dHi <= gap
+                       ? x.lo + (x.hi - x.lo) * weight
+                       : nan;
+        });
+        break;
+    case Fill::NEAREST:
+        fill([&](const Neighbours &x) {
+            auto useLo = x.hasLo && (!x.hasHi || x.dLo <= x.dHi);
+            auto distance = useLo ? x.dLo : x.dHi;
+            return (x.hasLo || x.hasHi) && distance <= gap
+                       ? (useLo ? x.lo : x.hi)
+                       : nan;
+        });
+        break;
+    }
+}
+
+// Aligns `series` onto `grid`. Columns are processed in parallel when
+// options.threads > 1; each thread writes a disjoint set of columns.
+inline Matrix alignSeries(const std::vector<TimeSeriesColumns> &series,
+                          const Grid &grid, const AlignOptions &options = {}) {
+    Matrix matrix;
+    matrix.rows = grid.rows;
+    matrix.cols = series.size();
+    matrix.layout = options.layout;
+    matrix.timestamps.resize(grid.rows);
+    for (std::size_t i = 0; i < grid.rows; ++i)
+        matrix.timestamps[i] = grid.at(i);
+    matrix.values.resize(matrix.rows * matrix.cols);
+
+    auto fillColumn = [&](std::size_t col) {
+        if (options.layout == Layout::ROW_MAJOR) {
+            alignColumn(series[col], grid, options, matrix.values.data() + col,
+                        matrix.cols);
+        } else {
+            alignColumn(series[col], grid, options,
+                        matrix.values.data() + col * matrix.rows);
+        }
+    };
+    auto columns = std::max<std::size_t>(series.size(), 1);
+    auto threads = std::clamp<std::size_t>(options.threads, 1, columns);
+    if (threads == 1) {
+        for (std::size_t col = 0; col < series.size(); ++col)
+            fillColumn(col);
+        return matrix;
+    }
+    std::vector<std::future<void>> pending;
+    pending.reserve(threads);
+    for (std::size_t worker = 0; worker < threads; ++worker) {
+        pending.push_back(std::async(std::launch::async, [&, worker] {
+            for (auto col = worker; col < series.size(); col += threads)
+                fillColumn(col);
+        }));
+    }
+    for (auto &future : pending)
+        future.get();
+    return matrix;
+}
+
+// Columns of a TS.MRANGE reply, in reply order; `keys` receives the series
+// names when given.
+inline std::vector<TimeSeriesColumns>
+toColumns(const std::vector<TimeSeriesMRangeEntry> &entries,
+          std::vector<std::string> *keys = nullptr) {
+    std::vector<TimeSeriesColumns> columns(entries.size());
+    for (std::size_t i = 0; i < entries.size(); ++i) {
+        auto &samples = std::get<2>(entries[i]);
+        columns[i].reserve(samples.size());
+        for (auto &sample : samples)
+            columns[i].push_back(sample.time().value(), sample.value());
+        if (keys != nullptr) keys->push_back(std::get<0>(entries[i]));
+    }
+    return columns;
+}
+
+// Streaming form of alignSeries for paged reads. Pages of each series are
+// pushed in time order; rows are emitted in blocks as soon as every series
+// has data beyond them (or was finished), and samples no longer needed are
+// dropped, so memory is bounded by a page per series plus one block.
+class StreamingAligner {
+  public:
+    using BlockCallback = std::function<void(const Matrix &)>;
+
+    StreamingAligner(std::size_t series, Grid grid, AlignOptions options,
+                     BlockCallback onBlock)
+        : grid_{grid}, options_{options}, onBlock_{std::move(onBlock)},
+          buffers_(series), done_(series, false) {}
+
+    void push(std::size_t series, const TimeSeriesColumns &page) {
+        auto &buffer = buffers_.at(series);
+        if (!page.empty() && !buffer.empty() &&
+            page.timestamps.front() <= buffer.timestamps.back()) {
+            throw std::invalid_argument("Pages must be pushed in time order");
+        }
+        buffer.append(page);
+        emit();
+    }
+
+    // No more pages for `series`.
+    void finish(std::size_t series) {
+        done_.at(series) = true;
+        emit();
+    }
+
+    // Flushes every remaining row, treating all series as finished.
+    void finish() {
+        std::fill(done_.begin(), done_.end(), true);
+        emit();
+    }
+
+    std::size_t emittedRows() const { return next_; }
+
+  private:
+    // Rows whose value can no longer change: at or before the last sample
+    // of every unfinished series.
+    std::size_t readyRows() const {
+        std::size_t ready = grid_.rows;
+        for (std::size_t s = 0; s < buffers_.size(); ++s) {
+            if (done_[s]) continue;
+            auto &buffer = buffers_[s];
+            if (buffer.empty()) return next_;
+            auto last = buffer.timestamps.back();
+            if (last < grid_.start) return next_;
+            ready = std::min(ready, static_cast<std::size_t>(
+                                        (last - grid_.start) / grid_.step + 1));
+        }
+        return ready;
+    }
+
+    void emit() {
+        auto ready = readyRows();
+        if (ready <= next_) return;
+        Grid block{grid_.at(next_), grid_.step, ready - next_};
+        onBlock_(alignSeries(buffers_, block, options_));
+        next_ = ready;
+        trim(grid_.at(next_ - 1));
+    }
+
+    // Drops samples before the last one at or before `emitted`; later rows
+    // still need that one as their left neighbour.
+    void trim(uint64_t emitted) {
+        for (auto &buffer : buffers_) {
+            auto &ts = buffer.timestamps;
+            auto it = std::upper_bound(ts.begin(), ts.end(), emitted);
+            if (it == ts.begin()) continue;
+            auto drop = static_cast<std::ptrdiff_t>(it - ts.begin()) - 1;
+            ts.erase(ts.begin(), ts.begin() + drop);
+            buffer.values.erase(buffer.values.begin(),
+                                buffer.values.begin() + drop);
+        }
+    }
+
+    Grid grid_;
+    AlignOptions options_;
+    BlockCallback onBlock_;
+    std::vector<TimeSeriesColumns> buffers_;
+    std::vector<bool> done_;
+    std::size_t next_{0};
+};
+
+} // namespace align
+
+} // namespace redis_time_series
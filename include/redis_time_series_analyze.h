@@ -0,0 +1,387 @@
+#pragma once
+
+#include "redis_time_series.h"
+#include "redis_time_series_embedded.h"
+
+#include <cmath>
+#include <map>
+
+namespace redis_time_series {
+
+// Memory footprint analysis: where the bytes go, which series are stored
+// with poor settings, what better settings would save, and an online
+// migration that applies them. Used by tools/ts_analyze.cpp.
+namespace analyze {
+
+struct AnalyzeOptions {
+    // TS.INFO (and TS.REVRANGE, when sampling) commands per pipeline.
+    std::size_t batchSize = 500;
+    // Recent samples read per series to measure its size under the
+    // compressed (Gorilla) encoding; 0 skips the measurement.
+    uint64_t sampleSize = 1000;
+    // Compressed bytes per sample assumed for unsampled uncompressed
+    // series.
+    double typicalBytesPerSample = 2.0;
+    // Memory a chunk costs besides its data (headers, allocator).
+    uint64_t chunkOverhead = 64;
+    // Findings saving less than this fraction of a series' memory are not
+    // reported.
+    double minSavings = 0.1;
+};
+
+enum class Finding { UNCOMPRESSED, CHUNK_TOO_SMALL, CHUNK_TOO_LARGE };
+
+inline std::string to_string(Finding finding) {
+    switch (finding) {
+    case Finding::UNCOMPRESSED:
+        return "UNCOMPRESSED";
+    case Finding::CHUNK_TOO_SMALL:
+        return "CHUNK_TOO_SMALL";
+    case Finding::CHUNK_TOO_LARGE:
+        return "CHUNK_TOO_LARGE";
+    }
+    throw std::out_of_range("Invalid finding.");
+}
+
+struct SeriesFootprint {
+    std::string key;
+    std::vector<TimeSeriesLabel> labels;
+    uint64_t totalSamples{0};
+    uint64_t memoryUsage{0};
+    uint64_t chunkCount{0};
+    uint64_t chunkSize{0};
+    bool compressed{true};
+    // Gorilla-encoded size of the sampled recent data, when measured.
+    std::optional<double> encodedBytesPerSample;
+    std::vector<Finding> findings;
+    // Settings the estimate below assumes.
+    uint64_t recommendedChunkSize{0};
+    uint64_t estimatedMemory{0};
+
+    double bytesPerSample() const {
+        return totalSamples == 0 ? 0.0
+                                 : static_cast<double>(memoryUsage) /
+                                       static_cast<double>(totalSamples);
+    }
+    uint64_t savings() const {
+        return memoryUsage > estimatedMemory ? memoryUsage - estimatedMemory
+                                             : 0;
+    }
+};
+
+struct GroupFootprint {
+    std::size_t series{0};
+    uint64_t totalSamples{0};
+    uint64_t memoryUsage{0};
+    uint64_t savings{0};
+
+    double bytesPerSample() const {
+        return totalSamples == 0 ? 0.0
+                                 : static_cast<double>(memoryUsage) /
+                                       static_cast<double>(totalSamples);
+    }
+};
+
+// Bytes per sample of `samples` under the compressed encoding, in chunks
+// of `chunkSize` bytes. Each chunk restarts the encoding with a raw sample,
+// as the server's chunks do.
+inline double encodedBytesPerSample(const TimeSeriesColumns &samples,
+                                    std::size_t chunkSize = 4096) {
+    if (samples.empty()) return 0;
+    std::size_t bytes = 0;
+    embedded::Chunk chunk{true, chunkSize};
+    for (std::size_t i = 0; i < samples.size(); ++i) {
+        if (chunk.append(samples.timestamps[i], samples.values[i])) continue;
+        bytes += chunk.bytes();
+        chunk = embedded::Chunk{true, chunkSize};
+        chunk.append(samples.timestamps[i], samples.values[i]);
+    }
+    bytes += chunk.bytes();
+    return static_cast<double>(bytes) / static_cast<double>(samples.size());
+}
+
+// Memory model of a series: its data, a fixed overhead per chunk, and on
+// average half of the last chunk left empty.
+inline double estimateMemory(double dataBytes, uint64_t chunkSize,
+                             uint64_t chunkOverhead) {
+    auto size = static_cast<double>(std::max<uint64_t>(chunkSize, 1));
+    return dataBytes +
+           std::ceil(dataBytes / size) * static_cast<double>(chunkOverhead) +
+           size / 2;
+}
+
+// Chunk size minimising estimateMemory(): sqrt(2 * data * overhead),
+// rounded to a multiple of 8 within the server's limits.
+inline uint64_t bestChunkSize(double dataBytes, uint64_t chunkOverhead) {
+    auto best = std::sqrt(2 * dataBytes * static_cast<double>(chunkOverhead));
+    auto size = static_cast<uint64_t>(std::ceil(best / 8)) * 8;
+    return std::clamp<uint64_t>(size, 128, 1048576);
+}
+
+// Footprint and advice for one series. `compressed` is the chunk type
+// from TS.INFO when the server reports it; otherwise a series costing at
+// least 16 bytes per sample (a raw timestamp and value) is taken to be
+// uncompressed. Without a measurement the data size is bounded by what the
+// chunks hold, which includes their unused space, and by
+// options.typicalBytesPerSample.
+inline SeriesFootprint assess(const std::string &key,
+                              const TimeSeriesInformation &info,
+                              std::optional<bool> compressed,
+                              std::optional<double> encodedBytesPerSample,
+                              const AnalyzeOptions &options = {}) {
+    SeriesFootprint footprint;
+    footprint.key = key;
+    footprint.labels = info.labels();
+    footprint.totalSamples = info.totalSamples();
+    footprint.memoryUsage = info.memoryUsage();
+    footprint.chunkCount = info.chunkCount();
+    footprint.chunkSize = info.chunkSize();
+    footprint.compressed =
+        compressed.value_or(footprint.bytesPerSample() < 16);
+    footprint.encodedBytesPerSample = encodedBytesPerSample;
+    footprint.recommendedChunkSize = footprint.chunkSize;
+    footprint.estimatedMemory = footprint.memoryUsage;
+    if (footprint.totalSamples == 0) return footprint;
+
+    auto samples = static_cast<double>(footprint.totalSamples);
+    auto overhead = options.chunkOverhead;
+    double perSample = 0;
+    if (encodedBytesPerSample.has_value()) {
+        perSample = *encodedBytesPerSample;
+    } else if (footprint.compressed) {
+        auto chunks = static_cast<double>(footprint.chunkCount);
+        auto data = static_cast<double>(footprint.memoryUsage) -
+                    chunks * static_cast<double>(overhead);
+        perSample = std::min(std::max(data, 0.0) / samples,
+                             options.typicalBytesPerSample);
+    } else {
+        perSample = options.typicalBytesPerSample;
+    }
+    auto data = perSample * samples;
+    auto best = bestChunkSize(data, overhead);
+    auto estimated = estimateMemory(data, best, overhead);
+    auto threshold =
+        options.minSavings * static_cast<double>(footprint.memoryUsage);
+    if (static_cast<double>(footprint.memoryUsage) - estimated < threshold)
+        return footprint;
+
+    footprint.recommendedChunkSize = best;
+    footprint.estimatedMemory = static_cast<uint64_t>(estimated);
+    if (!footprint.compressed) {
+        footprint.findings.push_back(Finding::UNCOMPRESSED);
+    }
+    // Chunk sizes within a factor of two of the best cost about the same.
+    if (best > 2 * footprint.chunkSize || 2 * best < footprint.chunkSize) {
+        footprint.findings.push_back(best > footprint.chunkSize
+                                         ? Finding::CHUNK_TOO_SMALL
+                                         : Finding::CHUNK_TOO_LARGE);
+    }
+    if (footprint.findings.empty()) {
+        // The saving comes from the measured encoding being denser than
+        // what the server holds, not from settings; nothing to act on.
+        footprint.recommendedChunkSize = footprint.chunkSize;
+        footprint.estimatedMemory = footprint.memoryUsage;
+    }
+    return footprint;
+}
+
+// Totals per value of `label`; series without it count under "".
+inline std::map<std::string, GroupFootprint>
+groupBy(const std::vector<SeriesFootprint> &footprints,
+        const std::string &label) {
+    std::map<std::string, GroupFootprint> groups;
+    for (auto &footprint : footprints) {
+        std::string value;
+        for (auto &candidate : footprint.labels)
+            if (candidate.key() == label) value = candidate.value();
+        auto &group = groups[value];
+        ++group.series;
+        group.totalSamples += footprint.totalSamples;
+        group.memoryUsage += footprint.memoryUsage;
+        group.savings += footprint.savings();
+    }
+    return groups;
+}
+
+namespace detail {
+
+// `chunkType` of a TS.INFO reply, which parser::parseInfo does not keep.
+inline std::optional<bool> parseCompressed(const redisReply &reply) {
+    for (std::size_t i = 0; i + 1 < reply.elements; i += 2) {
+        auto &name = *reply.element[i];
+        auto &value = *reply.element[i + 1];
+        if (std::string_view{name.str, name.len} != "chunkType" ||
+            !sw::redis::reply::is_string(value))
+            continue;
+        return std::string_view{value.str, value.len} == "compressed";
+    }
+    return std::nullopt;
+}
+
+inline std::vector<std::string> buildMaddArgs(const std::string &key,
+                                              const TimeSeriesColumns &columns,
+                                              std::size_t begin,
+                                              std::size_t end) {
+    std::vector<std::string> args;
+    args.reserve(1 + 3 * (end - begin));
+    args.emplace_back(command::MADD);
+    for (auto i = begin; i < end; ++i) {
+        args.push_back(key);
+        args.push_back(std::to_string(columns.timestamps[i]));
+        args.push_back(fmt::format("{}", columns.values[i]));
+    }
+    return args;
+}
+
+} // namespace detail
+
+// Every time series key matching `match`, via SCAN ... TYPE TSDB-TYPE.
+inline std::vector<std::string> scanSeries(sw::redis::Redis *db,
+                                           const std::string &match = "*",
+                                           std::size_t count = 1000) {
+    std::vector<std::string> keys;
+    std::string cursor = "0";
+    do {
+        auto reply = db->command("SCAN", cursor, "MATCH", match, "COUNT",
+                                 std::to_string(count), "TYPE", "TSDB-TYPE");
+        if (!sw::redis::reply::is_array(*reply) || reply->elements != 2) {
+            throw sw::redis::ProtoError("Expect SCAN reply");
+        }
+        auto &next = *reply->element[0];
+        cursor.assign(next.str, next.len);
+        auto page = parser::parseStringArray(*reply->element[1]);
+        keys.insert(keys.end(), page.begin(), page.end());
+    } while (cursor != "0");
+    return keys;
+}
+
+// Footprints of `keys`, from pipelined TS.INFO plus, when sampling,
+// pipelined TS.REVRANGE of the most recent samples. Keys that vanished
+// or are not time series are skipped.
+inline std::vector<SeriesFootprint>
+analyzeSeries(sw::redis::Redis *db, const std::vector<std::string> &keys,
+              const AnalyzeOptions &options = {}) {
+    std::vector<SeriesFootprint> footprints;
+    footprints.reserve(keys.size());
+    auto batchSize = std::max<std::size_t>(options.batchSize, 1);
+    auto sampled = options.sampleSize > 0;
+    for (std::size_t i = 0; i < keys.size(); i += batchSize) {
+        auto last = std::min(i + batchSize, keys.size());
+        auto pipeline = db->pipeline(false);
+        for (auto j = i; j < last; ++j) {
+            pipeline.command(command::INFO, keys[j]);
+            if (sampled)
+                pipeline.command(command::REVRANGE, keys[j], "-", "+",
+                                 command_args::COUNT,
+                                 std::to_string(options.sampleSize));
+        }
+        auto replies = pipeline.exec();
+        std::size_t k = 0;
+        for (auto j = i; j < last; ++j, k += sampled ? 2 : 1) {
+            try {
+                auto &info = replies.get(k);
+                std::optional<double> encoded;
+                if (sampled) {
+                    TimeSeriesColumns recent;
+                    parser::parseSampleColumns(replies.get(k + 1), recent);
+                    std::reverse(recent.timestamps.begin(),
+                                 recent.timestamps.end());
+                    std::reverse(recent.values.begin(), recent.values.end());
+                    if (!recent.empty())
+                        encoded = encodedBytesPerSample(recent);
+                }
+                footprints.push_back(assess(keys[j], parser::parseInfo(&info),
+                                            detail::parseCompressed(info),
+                                            encoded, options));
+            } catch (const sw::redis::ReplyError &) {
+                // Deleted since the scan.
+            }
+        }
+    }
+    return footprints;
+}
+
+struct MigrateOptions {
+    uint64_t chunkSize = 4096;
+    bool compressed = true;
+    // Samples per TS.RANGE page and per TS.MADD.
+    uint64_t pageSize = 10000;
+    // The copy is built under key + suffix and renamed over the original.
+    std::string suffix = ":migrating";
+    // Optimistic swaps tried before giving up on a busy series.
+    std::size_t maxAttempts = 10;
+};
+
+// Rewrites `key` with new chunk settings while it stays writable: the
+// samples are copied page by page into a new series with the same
+// retention, labels and duplicate policy, then a WATCHed transaction
+// copies the last samples and renames the copy over the original, retrying
+// when writes land in between. Samples inserted behind the copy cursor
+// during the migration (late backfill) are not carried over. Series that
+// take part in compaction rules are refused, since rules cannot follow
+// the rename. Returns the number of samples copied.
+inline uint64_t migrateSeries(sw::redis::Redis *db, const std::string &key,
+                              const MigrateOptions &options = {}) {
+    auto info = client::timeSeriesInfo(db, key);
+    if (!info.rules().empty() || !info.sourceKey().empty()) {
+        throw std::invalid_argument(
+            "Series with compaction rules cannot be migrated");
+    }
+    auto temporary = key + options.suffix;
+    client::timeSeriesCreate(
+        db, temporary, info.retentionTime(), info.labels(),
+        options.compressed ? std::nullopt : std::optional<bool>{true},
+        static_cast<long>(options.chunkSize), info.duplicatePolicy());
+
+    auto pageSize = std::max<uint64_t>(options.pageSize, 1);
+    uint64_t cursor = 0, copied = 0;
+    // Copies everything from `cursor` on, outside any transaction.
+    auto catchUp = [&] {
+        TimeSeriesColumns page;
+        while (true) {
+            page.clear();
+            client::timeSeriesRangeColumns(db, key, TimeStamp{cursor},
+                                           TimeStamp{"+"}, page, pageSize);
+            if (page.empty()) return;
+            auto args = detail::buildMaddArgs(temporary, page, 0, page.size());
+            db->command(args.begin(), args.end());
+            copied += page.size();
+            cursor = page.timestamps.back() + 1;
+            if (page.size() < pageSize) return;
+        }
+    };
+
+    try {
+        catchUp();
+        auto transaction = db->transaction(false, false);
+        auto watched = transaction.redis();
+        for (std::size_t attempt = 1;; ++attempt) {
+            try {
+                watched.watch(key);
+                TimeSeriesColumns tail;
+                client::timeSeriesRangeColumns(&watched, key,
+                                               TimeStamp{cursor},
+                                               TimeStamp{"+"}, tail);
+                for (std::size_t i = 0; i < tail.size(); i += pageSize) {
+                    auto args = detail::buildMaddArgs(
+                        temporary, tail, i,
+                        std::min<std::size_t>(i + pageSize, tail.size()));
+                    transaction.command(args.begin(), args.end());
+                }
+                transaction.command("RENAME", temporary, key);
+                transaction.exec();
+                return copied + tail.size();
+            } catch (const sw::redis::WatchError &) {
+                if (attempt >= options.maxAttempts) throw;
+                catchUp();
+            }
+        }
+    } catch (...) {
+        db->del(temporary);
+        throw;
+    }
+}
+
+} // namespace analyze
+
+} // namespace redis_time_series
@@ -0,0 +1,250 @@
+#pragma once
+
+#include "redis_time_series.h"
+#include "redis_time_series_aggregation.h"
+
+#include <functional>
+#include <future>
+
+namespace redis_time_series {
+
+// Backfill of compaction rules. TS.CREATERULE only aggregates samples
+// written after the rule exists; these functions write the history of the
+// destination from the source's existing samples.
+namespace backfill {
+
+struct BackfillTask {
+    std::string sourceKey;
+    TimeSeriesRule rule;
+};
+
+struct BackfillResult {
+    std::string sourceKey;
+    std::string destKey;
+    uint64_t buckets{0};
+    // MADD elements refused by the destination, e.g. a bucket already
+    // written under DUPLICATE_POLICY BLOCK.
+    uint64_t rejected{0};
+    // Set when the task failed; other tasks keep running.
+    std::optional<std::string> error;
+};
+
+struct BackfillOptions {
+    // Tasks run concurrently on this many threads, sharing the connection
+    // pool of the sw::redis::Redis.
+    std::size_t workers = 8;
+    // Buckets per TS.RANGE page.
+    uint64_t pageSize = 10000;
+    // Samples per TS.MADD; a page is written as one pipeline of these.
+    std::size_t batchSize = 1000;
+    // Hash recording, per task, the buckets still to write as
+    // "<from> <until>". The range is planned once and saved before the
+    // first write, then `from` is moved on after every page, so an
+    // interrupted job resumes where it stopped: the destination's first
+    // bucket is by then one the backfill wrote and no longer tells where
+    // the rule's own output begins. Empty disables checkpointing.
+    std::string checkpointKey;
+    // Called after every page is written and checkpointed, with the task's
+    // result so far, from the worker threads and not serialised. An
+    // exception it throws fails the task.
+    std::function<void(const BackfillResult &)> onPage;
+};
+
+// Buckets [from, until) of one task.
+struct BackfillPlan {
+    uint64_t from;
+    uint64_t until;
+
+    friend bool operator==(const BackfillPlan &lhs, const BackfillPlan &rhs) {
+        return lhs.from == rhs.from && lhs.until == rhs.until;
+    }
+};
+
+// What is missing from the destination. The rule's own output begins at
+// the destination's first bucket, which may hold only the samples written
+// after the rule was created, so it is left alone and the backfill stops
+// before it. An empty destination means the rule has not closed a bucket
+// yet: it will write the source's current bucket, so that one is skipped
+// too. Only closed buckets are written, the same way the server only
+// writes a bucket once a sample past it arrives.
+//
+// A checkpoint, the remainder of an earlier plan, is resumed as is: the
+// destination already holds the buckets written before it.
+inline std::optional<BackfillPlan>
+planBackfill(const TimeSeriesInformation &source,
+             const TimeSeriesInformation &dest, uint64_t timeBucket,
+             std::optional<BackfillPlan> checkpoint = std::nullopt) {
+    if (timeBucket == 0) {
+        throw std::invalid_argument("Time bucket must not be zero");
+    }
+    if (source.totalSamples() == 0) return std::nullopt;
+    auto bucketOf = [&](const TimeStamp &timestamp) {
+        return aggregation::bucketStart(timestamp.value(), timeBucket);
+    };
+    auto from = bucketOf(source.firstTimeStamp());
+    uint64_t until;
+    if (checkpoint.has_value()) {
+        from = std::max(from, checkpoint->from);
+        until = checkpoint->until;
+    } else {
+        until = dest.totalSamples() > 0 ? bucketOf(dest.firstTimeStamp())
+                                        : bucketOf(source.lastTimeStamp());
+    }
+    if (from >= until) return std::nullopt;
+    return BackfillPlan{from, until};
+}
+
+inline std::string checkpointField(const BackfillTask &task) {
+    return task.sourceKey + " -> " + task.rule.destKey();
+}
+
+namespace detail {
+
+// TS.MADD arguments with values in shortest round-trip form, so the
+// destination stores the exact double the server aggregated;
+// aux::buildTsMaddArgs rounds to six decimals.
+inline std::vector<std::string>
+buildMaddArgs(const std::string &destKey,
+              const std::vector<TimeSeriesTuple> &buckets, std::size_t begin,
+              std::size_t end) {
+    std::vector<std::string> args;
+    args.reserve(1 + 3 * (end - begin));
+    args.emplace_back(command::MADD);
+    for (auto i = begin; i < end; ++i) {
+        args.push_back(destKey);
+        args.push_back(std::to_string(buckets[i].time().value()));
+        args.push_back(fmt::format("{}", buckets[i].value()));
+    }
+    return args;
+}
+
+inline std::string formatCheckpoint(uint64_t from, uint64_t until) {
+    return fmt::format("{} {}", from, until);
+}
+
+inline std::optional<BackfillPlan> parseCheckpoint(redisReply &reply) {
+    if (sw::redis::reply::is_nil(reply)) return std::nullopt;
+    std::string text{reply.str, reply.len};
+    auto space = text.find(' ');
+    if (space == std::string::npos) {
+        throw std::invalid_argument("Malformed backfill checkpoint: " + text);
+    }
+    return BackfillPlan{std::stoull(text.substr(0, space)),
+                        std::stoull(text.substr(space + 1))};
+}
+
+inline void runTask(sw::redis::Redis *db, const BackfillTask &task,
+                    const BackfillOptions &options, BackfillResult &result) {
+    auto &rule = task.rule;
+    if (!rule.aggregation().has_value()) {
+        throw std::invalid_argument("The rule has no aggregation");
+    }
+    auto field = checkpointField(task);
+    auto pipeline = db->pipeline(false);
+    pipeline.command(command::INFO, task.sourceKey);
+    pipeline.command(command::INFO, rule.destKey());
+    if (!options.checkpointKey.empty())
+        pipeline.command("HGET", options.checkpointKey, field);
+    auto replies = pipeline.exec();
+    std::optional<BackfillPlan> checkpoint;
+    if (!options.checkpointKey.empty())
+        checkpoint = parseCheckpoint(replies.get(2));
+    auto plan = planBackfill(parser::parseInfo(&replies.get(0)),
+                             parser::parseInfo(&replies.get(1)),
+                             rule.timeBucket(), checkpoint);
+    if (!plan.has_value()) return;
+    // Saved before anything is written; see BackfillOptions::checkpointKey.
+    if (!options.checkpointKey.empty() && !checkpoint.has_value())
+        db->hset(options.checkpointKey, field,
+                 formatCheckpoint(plan->from, plan->until));
+
+    auto pageSize = std::max<uint64_t>(options.pageSize, 1);
+    auto batchSize = std::max<std::size_t>(options.batchSize, 1);
+    auto cursor = plan->from;
+    while (cursor < plan->until) {
+        // Default alignment is epoch 0, the same as the rule's buckets, and
+        // the server computes them with the aggregators it compacts with.
+        auto page = client::timeSeriesRange(
+            db, task.sourceKey, TimeStamp{cursor}, TimeStamp{plan->until - 1},
+            pageSize, rule.aggregation(), rule.timeBucket());
+        auto next = page.empty()
+                        ? plan->until
+                        : page.back().time().value() + rule.timeBucket();
+        if (page.size() < pageSize) next = plan->until;
+
+        auto writes = db->pipeline(false);
+        std::size_t batches = 0;
+        for (std::size_t i = 0; i < page.size(); i += batchSize, ++batches) {
+            auto args = buildMaddArgs(rule.destKey(), page, i,
+                                      std::min(i + batchSize, page.size()));
+            writes.command(args.begin(), args.end());
+        }
+        if (!options.checkpointKey.empty())
+            writes.command("HSET", options.checkpointKey, field,
+                           formatCheckpoint(next, plan->until));
+        auto written = writes.exec();
+        for (std::size_t b = 0; b < batches; ++b) {
+            auto &reply = written.get(b);
+            for (std::size_t i = 0; i < reply.elements; ++i)
+                if (sw::redis::reply::is_error(*reply.element[i]))
+                    ++result.rejected;
+        }
+        result.buckets += page.size();
+        cursor = next;
+        if (options.onPage) options.onPage(result);
+    }
+}
+
+} // namespace detail
+
+// Runs `tasks` on options.workers threads and returns one result per task,
+// in task order. `onTask`, when given, is called as each task completes
+// (serialised, from the worker threads).
+inline std::vector<BackfillResult>
+backfillRules(sw::redis::Redis *db, const std::vector<BackfillTask> &tasks,
+              const BackfillOptions &options = {},
+              const std::function<void(const BackfillResult &)> &onTask = {}) {
+    std::vector<BackfillResult> results(tasks.size());
+    std::atomic<std::size_t> next{0};
+    std::mutex progress;
+    auto work = [&] {
+        for (auto i = next++; i < tasks.size(); i = next++) {
+            auto &result = results[i];
+            result.sourceKey = tasks[i].sourceKey;
+            result.destKey = tasks[i].rule.destKey();
+            try {
+                detail::runTask(db, tasks[i], options, result);
+            } catch (const std::exception &error) {
+                result.error = error.what();
+            }
+            if (onTask) {
+                std::lock_guard lock{progress};
+                onTask(result);
+            }
+        }
+    };
+    auto workers =
+        std::clamp<std::size_t>(options.workers, 1,
+                                std::max<std::size_t>(tasks.size(), 1));
+    std::vector<std::future<void>> pending;
+    pending.reserve(workers);
+    for (std::size_t w = 0; w < workers; ++w)
+        pending.push_back(std::async(std::launch::async, work));
+    for (auto &future : pending)
+        future.get();
+    return results;
+}
+
+// Backfills every rule of `sourceKey` as reported by TS.INFO.
+inline std::vector<BackfillResult>
+backfillSource(sw::redis::Redis *db, const std::string &sourceKey,
+               const BackfillOptions &options = {}) {
+    std::vector<BackfillTask> tasks;
+    for (auto &rule : client::timeSeriesInfo(db, sourceKey).rules())
+        tasks.push_back(BackfillTask{sourceKey, rule});
+    return backfillRules(db, tasks, options);
+}
+
+} // namespace backfill
+
+} // namespace redis_time_series
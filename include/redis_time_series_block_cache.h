@@ -0,0 +1,510 @@
+#pragma once
+
+#include "redis_time_series.h"
+#include "redis_time_series_store.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <span>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace redis_time_series {
+
+namespace cache {
+
+// On-disk cache of closed time blocks, in front of range queries.
+//
+// Time is cut into fixed blocks aligned to multiples of blockSpan. A block
+// is closed once it ends before the series' last timestamp minus the
+// out-of-order window (`lateness`); closed blocks are written once, one
+// file each, in columnar layout (all timestamps, then all values) and
+// served straight from a read-only mapping. The open tail, and anything
+// before the retention horizon, is always read from the store.
+//
+// Every query costs a TS.INFO and one TS.RANGE ... AGGREGATION count over
+// the cached blocks, whose per-block sample counts are compared with the
+// counts recorded in the files; a block that lost samples to TS.DEL (or
+// gained late ones) is refetched.
+struct BlockCacheOptions {
+    std::filesystem::path directory;
+    uint64_t blockSpan = 3600 * 1000;
+    uint64_t lateness = 0;
+    // Least recently used block files are deleted past this size.
+    uint64_t maxBytes = uint64_t{1} << 30;
+};
+
+struct BlockCacheStats {
+    uint64_t hits{0};
+    uint64_t misses{0};
+    uint64_t invalidated{0};
+    uint64_t evicted{0};
+};
+
+// Contiguous run of samples, either inside a mapped block file or owned
+// by the result for ranges read live. `owner` keeps the memory alive.
+struct Segment {
+    std::span<const uint64_t> timestamps;
+    std::span<const double> values;
+    std::shared_ptr<const void> owner;
+};
+
+class CachedRange {
+  public:
+    const std::vector<Segment> &segments() const { return segments_; }
+
+    std::size_t size() const {
+        std::size_t n = 0;
+        for (auto &segment : segments_)
+            n += segment.timestamps.size();
+        return n;
+    }
+
+    // Copies the range into one TimeSeriesColumns.
+    TimeSeriesColumns columns() const {
+        TimeSeriesColumns result;
+        result.reserve(size());
+        for (auto &segment : segments_) {
+            result.timestamps.insert(result.timestamps.end(),
+                                     segment.timestamps.begin(),
+                                     segment.timestamps.end());
+            result.values.insert(result.values.end(), segment.values.begin(),
+                                 segment.values.end());
+        }
+        return result;
+    }
+
+    void append(Segment segment) {
+        if (!segment.timestamps.empty())
+            segments_.push_back(std::move(segment));
+    }
+
+  private:
+    std::vector<Segment> segments_;
+};
+
+namespace detail {
+
+inline uint64_t fnv1a(std::string_view data) {
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : data) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// File layout: header, name (key '\n' aggregation) padded to 8 bytes,
+// `count` timestamps, `count` values. Integers are native endian; the
+// files are a local cache, not an interchange format.
+struct BlockHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t start;
+    uint64_t span;
+    uint64_t count;
+    // Raw samples in the block when it was written, for validation.
+    uint64_t sourceCount;
+    uint32_t nameLength;
+    uint32_t reserved;
+};
+static_assert(sizeof(BlockHeader) == 48);
+
+constexpr char kBlockMagic[4] = {'R', 'T', 'S', 'B'};
+constexpr uint32_t kBlockVersion = 1;
+
+inline std::size_t dataOffset(std::size_t nameLength) {
+    return sizeof(BlockHeader) + (nameLength + 7) / 8 * 8;
+}
+
+class MappedFile {
+  public:
+    static std::shared_ptr<const MappedFile>
+    open(const std::filesystem::path &path) {
+        auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return nullptr;
+        struct stat st {};
+        if (::fstat(fd, &st) != 0 || st.st_size <= 0) {
+            ::close(fd);
+            return nullptr;
+        }
+        auto size = static_cast<std::size_t>(st.st_size);
+        auto *data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (data == MAP_FAILED) return nullptr;
+        return std::shared_ptr<const MappedFile>(new MappedFile{data, size});
+    }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    ~MappedFile() { ::munmap(data_, size_); }
+
+    const char *data() const { return static_cast<const char *>(data_); }
+    std::size_t size() const { return size_; }
+
+  private:
+    MappedFile(void *data, std::size_t size) : data_{data}, size_{size} {}
+
+    void *data_;
+    std::size_t size_;
+};
+
+struct MappedBlock {
+    Segment segment;
+    uint64_t sourceCount;
+};
+
+// Maps a block file and checks that it holds `name` at `start`.
+inline std::optional<MappedBlock> mapBlock(const std::filesystem::path &path,
+                                           std::string_view name,
+                                           uint64_t start, uint64_t span) {
+    auto file = MappedFile::open(path);
+    if (!file || file->size() < sizeof(BlockHeader)) return std::nullopt;
+    BlockHeader header;
+    std::memcpy(&header, file->data(), sizeof(header));
+    if (std::memcmp(header.magic, kBlockMagic, 4) != 0 ||
+        header.version != kBlockVersion || header.start != start ||
+        header.span != span || header.nameLength != name.size())
+        return std::nullopt;
+    auto offset = dataOffset(header.nameLength);
+    if (file->size() != offset + header.count * 16 ||
+        name != std::string_view{file->data() + sizeof(header),
+                                 header.nameLength})
+        return std::nullopt;
+    auto count = static_cast<std::size_t>(header.count);
+    const auto *timestamps =
+        reinterpret_cast<const uint64_t *>(file->data() + offset);
+    const auto *values = reinterpret_cast<const double *>(
+        file->data() + offset + count * sizeof(uint64_t));
+    return MappedBlock{Segment{{timestamps, count}, {values, count}, file},
+                       header.sourceCount};
+}
+
+// Writes through a temporary file and a rename, so readers in other
+// processes never see a partial block.
+inline bool writeBlock(const std::filesystem::path &path,
+                       std::string_view name, uint64_t start, uint64_t span,
+                       uint64_t sourceCount, const TimeSeriesColumns &block) {
+    BlockHeader header{};
+    std::memcpy(header.magic, kBlockMagic, 4);
+    header.version = kBlockVersion;
+    header.start = start;
+    header.span = span;
+    header.count = block.size();
+    header.sourceCount = sourceCount;
+    header.nameLength = static_cast<uint32_t>(name.size());
+
+    auto temporary = path;
+    // Unique per writer thread, so two threads filling the same block do
+    // not write into one file.
+    temporary += fmt::format(
+        ".{}.{:x}.tmp", ::getpid(),
+        std::hash<std::thread::id>{}(std::this_thread::get_id()));
+    {
+        std::ofstream out{temporary, std::ios::binary | std::ios::trunc};
+        const char padding[8] = {};
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        out.write(name.data(), static_cast<std::streamsize>(name.size()));
+        out.write(padding, static_cast<std::streamsize>(
+                               dataOffset(name.size()) - sizeof(header) -
+                               name.size()));
+        out.write(reinterpret_cast<const char *>(block.timestamps.data()),
+                  static_cast<std::streamsize>(block.size() * 8));
+        out.write(reinterpret_cast<const char *>(block.values.data()),
+                  static_cast<std::streamsize>(block.size() * 8));
+        if (out.flush()) {
+            out.close();
+            std::error_code error;
+            std::filesystem::rename(temporary, path, error);
+            if (!error) return true;
+        }
+    }
+    std::error_code ignored;
+    std::filesystem::remove(temporary, ignored);
+    return false;
+}
+
+// The part of `segment` with timestamps in [from, to].
+inline Segment slice(const Segment &segment, uint64_t from, uint64_t to) {
+    auto &ts = segment.timestamps;
+    auto begin = std::lower_bound(ts.begin(), ts.end(), from) - ts.begin();
+    auto end = std::upper_bound(ts.begin(), ts.end(), to) - ts.begin();
+    auto offset = static_cast<std::size_t>(begin);
+    auto count = static_cast<std::size_t>(std::max<std::ptrdiff_t>(
+        end - begin, 0));
+    return Segment{ts.subspan(offset, count),
+                   segment.values.subspan(offset, count), segment.owner};
+}
+
+inline TimeSeriesColumns toColumns(const std::vector<TimeSeriesTuple> &rows) {
+    TimeSeriesColumns columns;
+    columns.reserve(rows.size());
+    for (auto &row : rows)
+        columns.push_back(row.time().value(), row.value());
+    return columns;
+}
+
+} // namespace detail
+
+class BlockCache {
+  public:
+    BlockCache(TimeSeriesStore &store, BlockCacheOptions options)
+        : store_{store}, options_{std::move(options)} {
+        if (options_.blockSpan == 0)
+            throw std::invalid_argument("Block span must not be zero");
+        std::filesystem::create_directories(options_.directory);
+        load();
+    }
+
+    // Samples of `key` in [from, to]. With an aggregation the result holds
+    // the buckets starting in [from, to], computed over whole buckets;
+    // aggregations are cached per (aggregation, timeBucket) when blockSpan
+    // is a multiple of timeBucket, and read live otherwise.
+    CachedRange range(
+        const std::string &key, uint64_t from, uint64_t to,
+        std::optional<command_operator::TsAggregation> aggregation =
+            std::nullopt,
+        std::optional<uint64_t> timeBucket = std::nullopt) {
+        CachedRange result;
+        if (from > to) return result;
+        auto span = options_.blockSpan;
+        auto live = [&](uint64_t first, uint64_t last) {
+            if (aggregation.has_value() && timeBucket.value_or(0) > 0) {
+                // Whole buckets: from the first one starting at `first` or
+                // later to the end of the one holding `last`.
+                auto bucket = *timeBucket;
+                if (first % bucket != 0) first += bucket - first % bucket;
+                auto lastStart = last - last % bucket;
+                last = lastStart +
+                       std::min(bucket - 1,
+                                std::numeric_limits<uint64_t>::max() -
+                                    lastStart);
+                if (first > last) return;
+            }
+            auto columns =
+                std::make_shared<const TimeSeriesColumns>(detail::toColumns(
+                    store_.range(key, TimeStamp{first}, TimeStamp{last},
+                                 std::nullopt, aggregation, timeBucket)));
+            result.append(
+                Segment{columns->timestamps, columns->values, columns});
+        };
+
+        auto cacheable =
+            !aggregation.has_value() ||
+            (timeBucket.value_or(0) > 0 && span % *timeBucket == 0);
+        auto info = store_.info(key);
+        auto last = info.lastTimeStamp().value();
+        auto closedEnd = info.totalSamples() == 0 || last < options_.lateness
+                             ? 0
+                             : (last - options_.lateness) / span * span;
+        auto horizon = info.retentionTime() > 0 && last > info.retentionTime()
+                           ? last - info.retentionTime()
+                           : 0;
+        auto firstBlock = std::max((horizon + span - 1) / span * span,
+                                   from / span * span);
+        auto endBlock =
+            to / span < closedEnd / span ? to / span * span + span : closedEnd;
+        if (!cacheable || closedEnd == 0 || firstBlock >= endBlock) {
+            live(from, to);
+            return result;
+        }
+
+        if (from < firstBlock) live(from, firstBlock - 1);
+        auto name = key + '\n' + aggregationName(aggregation, timeBucket);
+        auto prefix = fmt::format("{:016x}-{:016x}-", detail::fnv1a(key),
+                                  detail::fnv1a(name));
+        std::map<uint64_t, uint64_t> counts;
+        for (auto &bucket :
+             store_.range(key, TimeStamp{firstBlock}, TimeStamp{endBlock - 1},
+                          std::nullopt,
+                          command_operator::TsAggregation::COUNT, span))
+            counts[bucket.time().value()] =
+                static_cast<uint64_t>(bucket.value());
+
+        for (auto start = firstBlock; start < endBlock; start += span) {
+            auto path = options_.directory /
+                        fmt::format("{}{:016x}.blk", prefix, start);
+            auto expected = counts.contains(start) ? counts[start] : 0;
+            auto block = detail::mapBlock(path, name, start, span);
+            if (block && block->sourceCount == expected) {
+                touch(path, false);
+                std::lock_guard lock{mutex_};
+                ++stats_.hits;
+            } else {
+                if (block || std::filesystem::exists(path)) {
+                    remove(path);
+                    std::lock_guard lock{mutex_};
+                    ++stats_.invalidated;
+                }
+                // Empty blocks are not stored; the count says so.
+                if (expected == 0) continue;
+                block = fetch(key, name, path, start, expected, aggregation,
+                              timeBucket);
+            }
+            result.append(detail::slice(block->segment, from, to));
+        }
+
+        if (to >= endBlock) live(std::max(from, endBlock), to);
+        evict();
+        return result;
+    }
+
+    // Drops every cached block of `key`.
+    void invalidate(const std::string &key) {
+        auto prefix = fmt::format("{:016x}-", detail::fnv1a(key));
+        std::vector<std::filesystem::path> matching;
+        {
+            std::lock_guard lock{mutex_};
+            for (auto &[path, entry] : entries_)
+                if (path.filename().string().starts_with(prefix))
+                    matching.push_back(path);
+        }
+        for (auto &path : matching)
+            remove(path);
+    }
+
+    uint64_t bytes() const {
+        std::lock_guard lock{mutex_};
+        return bytes_;
+    }
+
+    std::size_t blocks() const {
+        std::lock_guard lock{mutex_};
+        return entries_.size();
+    }
+
+    BlockCacheStats stats() const {
+        std::lock_guard lock{mutex_};
+        return stats_;
+    }
+
+  private:
+    struct Entry {
+        uint64_t bytes;
+        uint64_t lastUse;
+    };
+
+    static std::string aggregationName(
+        std::optional<command_operator::TsAggregation> aggregation,
+        std::optional<uint64_t> timeBucket) {
+        if (!aggregation.has_value()) return "raw";
+        return fmt::format("{}:{}", command_operator::to_string(*aggregation),
+                           timeBucket.value_or(0));
+    }
+
+    // Indexes the files left by earlier runs, oldest first, and clears
+    // temporaries abandoned by writers that died.
+    void load() {
+        std::vector<std::pair<std::filesystem::file_time_type,
+                              std::filesystem::path>>
+            found;
+        using Clock = std::filesystem::file_time_type::clock;
+        auto abandoned = Clock::now() - std::chrono::hours{1};
+        for (auto &file :
+             std::filesystem::directory_iterator{options_.directory}) {
+            if (!file.is_regular_file()) continue;
+            auto extension = file.path().extension();
+            if (extension == ".tmp" && file.last_write_time() < abandoned) {
+                std::error_code ignored;
+                std::filesystem::remove(file.path(), ignored);
+            } else if (extension == ".blk") {
+                found.emplace_back(file.last_write_time(), file.path());
+            }
+        }
+        std::sort(found.begin(), found.end());
+        for (auto &[time, path] : found)
+            touch(path, true);
+        evict();
+    }
+
+    std::optional<detail::MappedBlock>
+    fetch(const std::string &key, std::string_view name,
+          const std::filesystem::path &path, uint64_t start,
+          uint64_t sourceCount,
+          std::optional<command_operator::TsAggregation> aggregation,
+          std::optional<uint64_t> timeBucket) {
+        {
+            std::lock_guard lock{mutex_};
+            ++stats_.misses;
+        }
+        auto columns =
+            std::make_shared<const TimeSeriesColumns>(detail::toColumns(
+                store_.range(key, TimeStamp{start},
+                             TimeStamp{start + options_.blockSpan - 1},
+                             std::nullopt, aggregation, timeBucket)));
+        if (detail::writeBlock(path, name, start, options_.blockSpan,
+                               sourceCount, *columns)) {
+            touch(path, true);
+            auto mapped =
+                detail::mapBlock(path, name, start, options_.blockSpan);
+            if (mapped) return mapped;
+        }
+        // Unwritable cache directory: serve the block from memory.
+        return detail::MappedBlock{
+            Segment{columns->timestamps, columns->values, columns},
+            sourceCount};
+    }
+
+    // Marks `path` as just used, re-reading its size when it was written
+    // or is new to the index.
+    void touch(const std::filesystem::path &path, bool written) {
+        std::lock_guard lock{mutex_};
+        auto [it, added] = entries_.try_emplace(path, Entry{0, 0});
+        auto &entry = it->second;
+        if (written || added) {
+            std::error_code error;
+            auto size = std::filesystem::file_size(path, error);
+            bytes_ = bytes_ - entry.bytes + (error ? 0 : size);
+            entry.bytes = error ? 0 : size;
+        }
+        entry.lastUse = ++clock_;
+    }
+
+    // Unlinking is safe for blocks still mapped by earlier results; the
+    // mapping outlives the directory entry.
+    void remove(const std::filesystem::path &path) {
+        std::error_code ignored;
+        std::filesystem::remove(path, ignored);
+        std::lock_guard lock{mutex_};
+        auto it = entries_.find(path);
+        if (it == entries_.end()) return;
+        bytes_ -= it->second.bytes;
+        entries_.erase(it);
+    }
+
+    void evict() {
+        while (true) {
+            std::filesystem::path victim;
+            {
+                std::lock_guard lock{mutex_};
+                if (bytes_ <= options_.maxBytes || entries_.empty()) return;
+                auto oldest = std::min_element(
+                    entries_.begin(), entries_.end(),
+                    [](const auto &lhs, const auto &rhs) {
+                        return lhs.second.lastUse < rhs.second.lastUse;
+                    });
+                victim = oldest->first;
+                ++stats_.evicted;
+            }
+            remove(victim);
+        }
+    }
+
+    TimeSeriesStore &store_;
+    BlockCacheOptions options_;
+    mutable std::mutex mutex_;
+    std::map<std::filesystem::path, Entry> entries_;
+    uint64_t bytes_{0};
+    uint64_t clock_{0};
+    BlockCacheStats stats_;
+};
+
+} // namespace cache
+
+} // namespace redis_time_series
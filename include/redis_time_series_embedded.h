@@ -0,0 +1,767 @@
+#pragma once
+
+#include "redis_time_series.h"
+#include "redis_time_series_aggregation.h"
+#include "redis_time_series_store.h"
+
+#include <functional>
+#include <map>
+
+namespace redis_time_series {
+
+// In-process time-series engine for nodes without a Redis server. It keeps
+// the RedisTimeSeries storage model: every series is a list of fixed-size
+// chunks, compressed with Gorilla encoding (delta-of-delta timestamps, XOR
+// values) unless created UNCOMPRESSED, and follows the module's retention,
+// duplicate policy and compaction rule semantics.
+namespace embedded {
+
+// MSB-first bit stream over 64-bit words.
+class BitWriter {
+  public:
+    void write(uint64_t value, unsigned count) {
+        if (count < 64) value &= (uint64_t{1} << count) - 1;
+        auto offset = static_cast<unsigned>(bits_ % 64);
+        if (offset == 0) words_.push_back(0);
+        auto space = 64 - offset;
+        if (count <= space) {
+            words_.back() |= value << (space - count);
+        } else {
+            words_.back() |= value >> (count - space);
+            words_.push_back(value << (64 - (count - space)));
+        }
+        bits_ += count;
+    }
+
+    std::size_t bits() const { return bits_; }
+    const std::vector<uint64_t> &words() const { return words_; }
+
+  private:
+    std::vector<uint64_t> words_;
+    std::size_t bits_{0};
+};
+
+class BitReader {
+  public:
+    explicit BitReader(const std::vector<uint64_t> &words) : words_{words} {}
+
+    uint64_t read(unsigned count) {
+        auto index = pos_ / 64;
+        auto offset = static_cast<unsigned>(pos_ % 64);
+        auto space = 64 - offset;
+        pos_ += count;
+        if (count <= space) return (words_[index] << offset) >> (64 - count);
+        auto rest = count - space;
+        auto high = (words_[index] & ((uint64_t{1} << space) - 1)) << rest;
+        return high | (words_[index + 1] >> (64 - rest));
+    }
+
+    bool readBit() { return read(1) != 0; }
+
+  private:
+    const std::vector<uint64_t> &words_;
+    std::size_t pos_{0};
+};
+
+// Fixed-capacity block of samples with strictly increasing timestamps.
+// append() refuses a sample once it would not fit in `capacityBytes`.
+class Chunk {
+  public:
+    Chunk(bool compressed, std::size_t capacityBytes)
+        : compressed_{compressed}, capacityBits_{capacityBytes * 8} {}
+
+    bool compressed() const { return compressed_; }
+    std::size_t size() const { return count_; }
+    bool empty() const { return count_ == 0; }
+    uint64_t firstTimestamp() const { return first_; }
+    uint64_t lastTimestamp() const { return last_; }
+    double lastValue() const { return std::bit_cast<double>(lastBits_); }
+    std::size_t capacityBytes() const { return capacityBits_ / 8; }
+
+    // Bytes used by the encoded samples.
+    std::size_t bytes() const {
+        return compressed_ ? (stream_.bits() + 7) / 8 : count_ * 16;
+    }
+
+    bool append(uint64_t timestamp, double value) {
+        auto bits = std::bit_cast<uint64_t>(value);
+        if (count_ == 0) {
+            if (compressed_) {
+                stream_.write(timestamp, 64);
+                stream_.write(bits, 64);
+            } else {
+                raw_.emplace_back(timestamp, value);
+            }
+            first_ = last_ = timestamp;
+            lastBits_ = bits;
+            ++count_;
+            return true;
+        }
+        if (timestamp <= last_)
+            throw std::logic_error("Chunk timestamps must increase");
+        if (!compressed_) {
+            if ((count_ + 1) * 128 > capacityBits_) return false;
+            raw_.emplace_back(timestamp, value);
+        } else {
+            auto delta = static_cast<int64_t>(timestamp - last_);
+            auto dod = delta - prevDelta_;
+            auto x = bits ^ lastBits_;
+            if (stream_.bits() + timestampBits(dod) + valueBits(x) >
+                capacityBits_)
+                return false;
+            writeTimestamp(dod);
+            writeValue(x);
+            prevDelta_ = delta;
+        }
+        last_ = timestamp;
+        lastBits_ = bits;
+        ++count_;
+        return true;
+    }
+
+    // Calls f(timestamp, value) for every sample in order.
+    template <typename F>
+    void forEach(F f) const {
+        if (!compressed_) {
+            for (auto [timestamp, value] : raw_)
+                f(timestamp, value);
+            return;
+        }
+        if (count_ == 0) return;
+        BitReader in{stream_.words()};
+        auto timestamp = in.read(64);
+        auto bits = in.read(64);
+        f(timestamp, std::bit_cast<double>(bits));
+        int64_t delta = 0;
+        unsigned leading = 0, trailing = 0;
+        for (std::size_t i = 1; i < count_; ++i) {
+            delta += readDeltaOfDelta(in);
+            timestamp += static_cast<uint64_t>(delta);
+            if (in.readBit()) {
+                if (in.readBit()) {
+                    leading = static_cast<unsigned>(in.read(5));
+                    auto meaningful = static_cast<unsigned>(in.read(6)) + 1;
+                    trailing = 64 - leading - meaningful;
+                }
+                bits ^= in.read(64 - leading - trailing) << trailing;
+            }
+            f(timestamp, std::bit_cast<double>(bits));
+        }
+    }
+
+  private:
+    static constexpr unsigned kNoWindow = 65;
+
+    static unsigned timestampBits(int64_t dod) {
+        if (dod == 0) return 1;
+        if (dod >= -63 && dod <= 64) return 2 + 7;
+        if (dod >= -255 && dod <= 256) return 3 + 9;
+        if (dod >= -2047 && dod <= 2048) return 4 + 12;
+        return 4 + 64;
+    }
+
+    unsigned valueBits(uint64_t x) const {
+        if (x == 0) return 1;
+        auto leading = static_cast<unsigned>(std::min(std::countl_zero(x), 31));
+        auto trailing = static_cast<unsigned>(std::countr_zero(x));
+        if (leading_ != kNoWindow && leading >= leading_ &&
+            trailing >= trailing_)
+            return 2 + 64 - leading_ - trailing_;
+        return 2 + 5 + 6 + 64 - leading - trailing;
+    }
+
+    void writeTimestamp(int64_t dod) {
+        auto biased = [](int64_t v, int64_t bias) {
+            return static_cast<uint64_t>(v + bias);
+        };
+        if (dod == 0) {
+            stream_.write(0b0, 1);
+        } else if (dod >= -63 && dod <= 64) {
+            stream_.write(0b10, 2);
+            stream_.write(biased(dod, 63), 7);
+        } else if (dod >= -255 && dod <= 256) {
+            stream_.write(0b110, 3);
+            stream_.write(biased(dod, 255), 9);
+        } else if (dod >= -2047 && dod <= 2048) {
+            stream_.write(0b1110, 4);
+            stream_.write(biased(dod, 2047), 12);
+        } else {
+            stream_.write(0b1111, 4);
+            stream_.write(static_cast<uint64_t>(dod), 64);
+        }
+    }
+
+    static int64_t readDeltaOfDelta(BitReader &in) {
+        if (!in.readBit()) return 0;
+        if (!in.readBit()) return static_cast<int64_t>(in.read(7)) - 63;
+        if (!in.readBit()) return static_cast<int64_t>(in.read(9)) - 255;
+        if (!in.readBit()) return static_cast<int64_t>(in.read(12)) - 2047;
+        return static_cast<int64_t>(in.read(64));
+    }
+
+    void writeValue(uint64_t x) {
+        if (x == 0) {
+            stream_.write(0b0, 1);
+            return;
+        }
+        auto leading = static_cast<unsigned>(std::min(std::countl_zero(x), 31));
+        auto trailing = static_cast<unsigned>(std::countr_zero(x));
+        if (leading_ != kNoWindow && leading >= leading_ &&
+            trailing >= trailing_) {
+            stream_.write(0b10, 2);
+            stream_.write(x >> trailing_, 64 - leading_ - trailing_);
+            return;
+        }
+        auto meaningful = 64 - leading - trailing;
+        stream_.write(0b11, 2);
+        stream_.write(leading, 5);
+        stream_.write(meaningful - 1, 6);
+        stream_.write(x >> trailing, meaningful);
+        leading_ = leading;
+        trailing_ = trailing;
+    }
+
+    bool compressed_;
+    std::size_t capacityBits_;
+    std::size_t count_{0};
+    uint64_t first_{0};
+    uint64_t last_{0};
+    uint64_t lastBits_{0};
+    // Compressed encoding state.
+    BitWriter stream_;
+    int64_t prevDelta_{0};
+    unsigned leading_{kNoWindow};
+    unsigned trailing_{0};
+    // Uncompressed samples.
+    std::vector<std::pair<uint64_t, double>> raw_;
+};
+
+struct EmbeddedOptions {
+    // Used for series created without explicit settings, like the module's
+    // load-time configuration.
+    uint64_t retentionTime = 0;
+    std::size_t chunkSize = 4096;
+    command_operator::TsDuplicatePolicy duplicatePolicy =
+        command_operator::TsDuplicatePolicy::BLOCK;
+    // Source of `*` and default TS.INCRBY timestamps, in milliseconds.
+    std::function<uint64_t()> clock;
+};
+
+// TimeSeriesStore kept in process memory. All operations are thread-safe;
+// writers take an exclusive lock and readers a shared one.
+class EmbeddedStore : public TimeSeriesStore {
+  public:
+    explicit EmbeddedStore(EmbeddedOptions options = {})
+        : options_{std::move(options)} {
+        if (!options_.clock) {
+            options_.clock = [] {
+                return static_cast<uint64_t>(
+                    std::chrono::duration_cast<std::chrono::milliseconds>(
+                        std::chrono::system_clock::now().time_since_epoch())
+                        .count());
+            };
+        }
+    }
+
+  private:
+    bool doCreate(const std::string &key,
+                  std::optional<uint64_t> retentionTime, LabelSpan labels,
+                  std::optional<bool> uncompressed,
+                  std::optional<long> chunkSizeBytes,
+                  std::optional<command_operator::TsDuplicatePolicy>
+                      duplicatePolicy) override {
+        std::unique_lock lock{mutex_};
+        if (series_.count(key) != 0) fail("key already exists");
+        series_.emplace(key, makeSeries(retentionTime, labels,
+                                        uncompressed, chunkSizeBytes,
+                                        duplicatePolicy));
+        return true;
+    }
+
+    bool doAlter(const std::string &key, std::optional<uint64_t> retentionTime,
+                 LabelSpan labels,
+                 std::optional<command_operator::TsDuplicatePolicy>
+                     duplicatePolicy) override {
+        std::unique_lock lock{mutex_};
+        auto &series = existing(key);
+        if (retentionTime.has_value()) series.retention = *retentionTime;
+        if (!labels.empty()) series.labels = labels.to_vector();
+        if (duplicatePolicy.has_value())
+            series.duplicatePolicy = duplicatePolicy;
+        return true;
+    }
+
+    TimeStamp doAdd(const std::string &key, const TimeStamp &timestamp,
+                    double value, std::optional<uint64_t> retentionTime,
+                    LabelSpan labels, std::optional<bool> uncompressed,
+                    std::optional<long> chunkSizeBytes,
+                    std::optional<command_operator::TsDuplicatePolicy>
+                        duplicatePolicy) override {
+        std::unique_lock lock{mutex_};
+        auto it = series_.find(key);
+        if (it == series_.end()) {
+            it = series_
+                     .emplace(key, makeSeries(retentionTime, labels,
+                                              uncompressed, chunkSizeBytes,
+                                              std::nullopt))
+                     .first;
+        }
+        auto time = resolve(timestamp);
+        insert(it->second, time, value, duplicatePolicy);
+        return TimeStamp{time};
+    }
+
+    // Like the module, every entry is attempted and each failure is
+    // reported in its own result.
+    std::vector<MAddResult>
+    doMAdd(const std::vector<std::tuple<std::string, TimeStamp, double>>
+               &sequence) override {
+        std::unique_lock lock{mutex_};
+        std::vector<MAddResult> results;
+        results.reserve(sequence.size());
+        for (auto &[key, timestamp, value] : sequence) {
+            try {
+                auto time = resolve(timestamp);
+                insert(existing(key), time, value, std::nullopt);
+                results.push_back({TimeStamp{time}, std::nullopt});
+            } catch (const sw::redis::ReplyError &e) {
+                results.push_back({TimeStamp{}, e.what()});
+            }
+        }
+        return results;
+    }
+
+    TimeStamp doIncrBy(const std::string &key, double value,
+                       const TimeStamp &timestamp,
+                       std::optional<uint64_t> retentionTime,
+                       LabelSpan labels, std::optional<bool> uncompressed,
+                       std::optional<long> chunkSizeBytes) override {
+        return increment(key, value, timestamp, retentionTime, labels,
+                         uncompressed, chunkSizeBytes);
+    }
+
+    TimeStamp doDecrBy(const std::string &key, double value,
+                       const TimeStamp &timestamp,
+                       std::optional<uint64_t> retentionTime,
+                       LabelSpan labels, std::optional<bool> uncompressed,
+                       std::optional<long> chunkSizeBytes) override {
+        return increment(key, -value, timestamp, retentionTime, labels,
+                         uncompressed, chunkSizeBytes);
+    }
+
+    uint64_t doDel(const std::string &key, const TimeStamp &fromTimeStamp,
+                   const TimeStamp &toTimeStamp) override {
+        std::unique_lock lock{mutex_};
+        auto &series = existing(key);
+        auto from = lowerBound(fromTimeStamp);
+        auto to = upperBound(toTimeStamp);
+        uint64_t removed = 0;
+        for (size_t i = 0; i < series.chunks.size();) {
+            auto &chunk = series.chunks[i];
+            if (chunk.lastTimestamp() < from || chunk.firstTimestamp() > to) {
+                ++i;
+                continue;
+            }
+            TimeSeriesColumns kept;
+            chunk.forEach([&](uint64_t timestamp, double value) {
+                if (timestamp < from || timestamp > to)
+                    kept.push_back(timestamp, value);
+                else
+                    ++removed;
+            });
+            i = replaceChunk(series, i, kept);
+        }
+        return removed;
+    }
+
+    bool doCreateRule(const std::string &sourceKey,
+                      const TimeSeriesRule &rule) override {
+        std::unique_lock lock{mutex_};
+        if (sourceKey == rule.destKey())
+            fail("the source key and destination key should be different");
+        if (!rule.aggregation().has_value() || rule.timeBucket() == 0)
+            fail("wrong aggregation or bucket duration");
+        auto &source = existing(sourceKey);
+        auto &dest = existing(rule.destKey());
+        if (!dest.sourceKey.empty())
+            fail("the destination key already has a src rule");
+        if (!dest.rules.empty())
+            fail("the destination key already has a dst rule");
+        dest.sourceKey = sourceKey;
+        source.rules.push_back(Compaction{rule, std::nullopt, {}});
+        return true;
+    }
+
+    bool doDeleteRule(const std::string &sourceKey,
+                      const std::string &destKey) override {
+        std::unique_lock lock{mutex_};
+        auto &source = existing(sourceKey);
+        auto it = std::find_if(source.rules.begin(), source.rules.end(),
+                               [&](auto &compaction) {
+                                   return compaction.rule.destKey() == destKey;
+                               });
+        if (it == source.rules.end()) fail("compaction rule does not exist");
+        source.rules.erase(it);
+        auto dest = series_.find(destKey);
+        if (dest != series_.end()) dest->second.sourceKey.clear();
+        return true;
+    }
+
+    TimeSeriesTuple doGet(const std::string &key) override {
+        std::shared_lock lock{mutex_};
+        auto &series = existing(key);
+        if (series.chunks.empty()) return TimeSeriesTuple{};
+        auto &last = series.chunks.back();
+        return TimeSeriesTuple{TimeStamp{last.lastTimestamp()},
+                               last.lastValue()};
+    }
+
+    std::vector<TimeSeriesTuple>
+    doRange(const std::string &key, const TimeStamp &fromTimeStamp,
+            const TimeStamp &toTimeStamp, std::optional<uint64_t> count,
+            std::optional<command_operator::TsAggregation> aggregation,
+            std::optional<uint64_t> timeBucket,
+            const std::vector<TimeStamp> &filterByTs,
+            std::optional<std::pair<uint64_t, uint64_t>> filterByValue,
+            const TimeStamp &align) override {
+        return query(key, fromTimeStamp, toTimeStamp, count, aggregation,
+                     timeBucket, filterByTs, filterByValue, align, false);
+    }
+
+    std::vector<TimeSeriesTuple>
+    doRevRange(const std::string &key, const TimeStamp &fromTimeStamp,
+               const TimeStamp &toTimeStamp, std::optional<uint64_t> count,
+               std::optional<command_operator::TsAggregation> aggregation,
+               std::optional<uint64_t> timeBucket,
+               const std::vector<TimeStamp> &filterByTs,
+               std::optional<std::pair<uint64_t, uint64_t>> filterByValue,
+               const TimeStamp &align) override {
+        return query(key, fromTimeStamp, toTimeStamp, count, aggregation,
+                     timeBucket, filterByTs, filterByValue, align, true);
+    }
+
+    TimeSeriesInformation doInfo(const std::string &key) override {
+        std::shared_lock lock{mutex_};
+        auto &series = existing(key);
+        uint64_t samples = 0, memory = sizeof(Series);
+        for (auto &chunk : series.chunks) {
+            samples += chunk.size();
+            memory += sizeof(Chunk) + chunk.capacityBytes();
+        }
+        for (auto &label : series.labels)
+            memory += label.key().size() + label.value().size();
+        TimeStamp first, last;
+        if (!series.chunks.empty()) {
+            first = TimeStamp{series.chunks.front().firstTimestamp()};
+            last = TimeStamp{series.chunks.back().lastTimestamp()};
+        }
+        std::vector<TimeSeriesRule> rules;
+        for (auto &compaction : series.rules)
+            rules.push_back(compaction.rule);
+        return TimeSeriesInformation{
+            samples,          memory,
+            std::move(first), std::move(last),
+            series.retention, static_cast<uint64_t>(series.chunks.size()),
+            series.chunkSize, series.labels,
+            series.sourceKey, std::move(rules),
+            series.duplicatePolicy};
+    }
+
+    struct Compaction {
+        TimeSeriesRule rule;
+        std::optional<uint64_t> bucketStart;
+        aggregation::Accumulator bucket;
+    };
+
+    struct Series {
+        std::vector<Chunk> chunks;
+        std::vector<TimeSeriesLabel> labels;
+        uint64_t retention{0};
+        uint64_t chunkSize{4096};
+        bool uncompressed{false};
+        std::optional<command_operator::TsDuplicatePolicy> duplicatePolicy;
+        std::string sourceKey;
+        std::vector<Compaction> rules;
+    };
+
+    [[noreturn]] static void fail(const std::string &message) {
+        throw sw::redis::ReplyError("TSDB: " + message);
+    }
+
+    Series &existing(const std::string &key) {
+        auto it = series_.find(key);
+        if (it == series_.end()) fail("the key does not exist");
+        return it->second;
+    }
+
+    Series makeSeries(std::optional<uint64_t> retentionTime,
+                      LabelSpan labels, std::optional<bool> uncompressed,
+                      std::optional<long> chunkSizeBytes,
+                      std::optional<command_operator::TsDuplicatePolicy>
+                          duplicatePolicy) const {
+        if (chunkSizeBytes.has_value() && *chunkSizeBytes < 128)
+            fail("CHUNK_SIZE value must be at least 128");
+        Series series;
+        series.retention = retentionTime.value_or(options_.retentionTime);
+        series.labels = labels.to_vector();
+        series.uncompressed = uncompressed.value_or(false);
+        series.chunkSize = chunkSizeBytes.has_value()
+                               ? static_cast<uint64_t>(*chunkSizeBytes)
+                               : options_.chunkSize;
+        series.duplicatePolicy = duplicatePolicy;
+        return series;
+    }
+
+    uint64_t resolve(const TimeStamp &timestamp) const {
+        if (!timestamp.hasValue() || timestamp.to_string() == "*")
+            return options_.clock();
+        return timestamp.value();
+    }
+
+    static uint64_t lowerBound(const TimeStamp &timestamp) {
+        if (timestamp.to_string() == "-") return 0;
+        return timestamp.value();
+    }
+
+    static uint64_t upperBound(const TimeStamp &timestamp) {
+        if (timestamp.to_string() == "+")
+            return std::numeric_limits<uint64_t>::max();
+        return timestamp.value();
+    }
+
+    Chunk newChunk(const Series &series) const {
+        return Chunk{!series.uncompressed, series.chunkSize};
+    }
+
+    static uint64_t lastTimestamp(const Series &series) {
+        return series.chunks.empty() ? 0 : series.chunks.back().lastTimestamp();
+    }
+
+    // Inserts one sample: appended when newer than the series, merged into
+    // its chunk (decode, apply the duplicate policy, re-encode) otherwise.
+    void
+    insert(Series &series, uint64_t timestamp, double value,
+           std::optional<command_operator::TsDuplicatePolicy> onDuplicate) {
+        if (series.chunks.empty() || timestamp > lastTimestamp(series)) {
+            append(series, timestamp, value);
+            return;
+        }
+        auto last = lastTimestamp(series);
+        if (series.retention != 0 && timestamp + series.retention < last)
+            fail("Timestamp is older than retention");
+
+        // Last chunk starting at or before `timestamp`, or the first one.
+        auto it = std::upper_bound(
+            series.chunks.begin(), series.chunks.end(), timestamp,
+            [](uint64_t t, const Chunk &c) { return t < c.firstTimestamp(); });
+        std::size_t index = 0;
+        if (it != series.chunks.begin())
+            index = static_cast<std::size_t>(it - series.chunks.begin()) - 1;
+        auto policy = onDuplicate.value_or(
+            series.duplicatePolicy.value_or(options_.duplicatePolicy));
+        TimeSeriesColumns merged;
+        bool placed = false;
+        auto place = [&] {
+            merged.push_back(timestamp, value);
+            placed = true;
+        };
+        series.chunks[index].forEach([&](uint64_t t, double v) {
+            if (!placed && timestamp < t) place();
+            if (t == timestamp) {
+                placed = true;
+                merged.push_back(t, resolveDuplicate(policy, v, value));
+                return;
+            }
+            merged.push_back(t, v);
+        });
+        if (!placed) place();
+        replaceChunk(series, index, merged);
+    }
+
+    static double resolveDuplicate(command_operator::TsDuplicatePolicy policy,
+                                   double stored, double incoming) {
+        using command_operator::TsDuplicatePolicy;
+        switch (policy) {
+        case TsDuplicatePolicy::BLOCK:
+            fail("Error at upsert, update is not supported when "
+                 "DUPLICATE_POLICY is set to BLOCK mode");
+        case TsDuplicatePolicy::FIRST:
+            return stored;
+        case TsDuplicatePolicy::LAST:
+            return incoming;
+        case TsDuplicatePolicy::MIN:
+            return std::min(stored, incoming);
+        case TsDuplicatePolicy::MAX:
+            return std::max(stored, incoming);
+        case TsDuplicatePolicy::SUM:
+            return stored + incoming;
+        default:
+            throw std::out_of_range("Invalid policy type.");
+        }
+    }
+
+    // Re-encodes `samples` in place of chunk `index`, splitting into as many
+    // chunks as needed. Returns the index after the replacement.
+    std::size_t replaceChunk(Series &series, std::size_t index,
+                             const TimeSeriesColumns &samples) {
+        std::vector<Chunk> encoded;
+        for (size_t i = 0; i < samples.size(); ++i) {
+            if (encoded.empty() ||
+                !encoded.back().append(samples.timestamps[i],
+                                       samples.values[i])) {
+                encoded.push_back(newChunk(series));
+                encoded.back().append(samples.timestamps[i],
+                                      samples.values[i]);
+            }
+        }
+        auto at = series.chunks.erase(series.chunks.begin() +
+                                      static_cast<std::ptrdiff_t>(index));
+        series.chunks.insert(at, std::make_move_iterator(encoded.begin()),
+                             std::make_move_iterator(encoded.end()));
+        return index + encoded.size();
+    }
+
+    void append(Series &series, uint64_t timestamp, double value) {
+        if (series.chunks.empty() ||
+            !series.chunks.back().append(timestamp, value)) {
+            series.chunks.push_back(newChunk(series));
+            series.chunks.back().append(timestamp, value);
+        }
+        compact(series, timestamp, value);
+        // Retention drops whole chunks, as the module does.
+        if (series.retention != 0 && timestamp > series.retention) {
+            auto cutoff = timestamp - series.retention;
+            auto expired = std::find_if(series.chunks.begin(),
+                                        series.chunks.end(), [&](auto &chunk) {
+                                            return chunk.lastTimestamp() >=
+                                                   cutoff;
+                                        });
+            series.chunks.erase(series.chunks.begin(), expired);
+        }
+    }
+
+    // Feeds an appended sample to the compaction rules; a bucket is written
+    // to its destination once a sample of a later bucket arrives.
+    void compact(Series &series, uint64_t timestamp, double value) {
+        for (auto &compaction : series.rules) {
+            auto start = aggregation::bucketStart(
+                timestamp, compaction.rule.timeBucket());
+            if (compaction.bucketStart.has_value() &&
+                *compaction.bucketStart != start &&
+                !compaction.bucket.empty()) {
+                auto dest = series_.find(compaction.rule.destKey());
+                if (dest != series_.end()) {
+                    auto aggregated = compaction.bucket.value(
+                        command_operator::to_string(
+                            *compaction.rule.aggregation()));
+                    insert(dest->second, *compaction.bucketStart, aggregated,
+                           command_operator::TsDuplicatePolicy::LAST);
+                }
+                compaction.bucket.reset();
+            }
+            compaction.bucketStart = start;
+            compaction.bucket.add(value);
+        }
+    }
+
+    TimeStamp increment(const std::string &key, double by,
+                        const TimeStamp &timestamp,
+                        std::optional<uint64_t> retentionTime,
+                        LabelSpan labels, std::optional<bool> uncompressed,
+                        std::optional<long> chunkSizeBytes) {
+        std::unique_lock lock{mutex_};
+        auto it = series_.find(key);
+        if (it == series_.end()) {
+            it = series_
+                     .emplace(key, makeSeries(retentionTime, labels,
+                                              uncompressed, chunkSizeBytes,
+                                              std::nullopt))
+                     .first;
+        }
+        auto &series = it->second;
+        auto time = resolve(timestamp);
+        double current = 0;
+        if (!series.chunks.empty()) {
+            if (time < lastTimestamp(series))
+                fail("timestamp must be equal to or higher than the maximum "
+                     "existing timestamp");
+            current = series.chunks.back().lastValue();
+        }
+        insert(series, time, current + by,
+               command_operator::TsDuplicatePolicy::LAST);
+        return TimeStamp{time};
+    }
+
+    std::vector<TimeSeriesTuple>
+    query(const std::string &key, const TimeStamp &fromTimeStamp,
+          const TimeStamp &toTimeStamp, std::optional<uint64_t> count,
+          std::optional<command_operator::TsAggregation> aggregation,
+          std::optional<uint64_t> timeBucket,
+          const std::vector<TimeStamp> &filterByTs,
+          std::optional<std::pair<uint64_t, uint64_t>> filterByValue,
+          const TimeStamp &align, bool reverse) {
+        std::shared_lock lock{mutex_};
+        auto &series = existing(key);
+        auto from = lowerBound(fromTimeStamp);
+        auto to = upperBound(toTimeStamp);
+        std::vector<uint64_t> allowed;
+        for (auto &timestamp : filterByTs)
+            allowed.push_back(timestamp.value());
+        std::sort(allowed.begin(), allowed.end());
+
+        TimeSeriesColumns samples;
+        for (auto &chunk : series.chunks) {
+            if (chunk.lastTimestamp() < from || chunk.firstTimestamp() > to)
+                continue;
+            chunk.forEach([&](uint64_t timestamp, double value) {
+                if (timestamp < from || timestamp > to) return;
+                if (!allowed.empty() &&
+                    !std::binary_search(allowed.begin(), allowed.end(),
+                                        timestamp))
+                    return;
+                if (filterByValue.has_value() &&
+                    (value < static_cast<double>(filterByValue->first) ||
+                     value > static_cast<double>(filterByValue->second)))
+                    return;
+                samples.push_back(timestamp, value);
+            });
+        }
+
+        std::vector<TimeSeriesTuple> result;
+        if (aggregation.has_value()) {
+            auto bucket = timeBucket.value_or(0);
+            if (bucket == 0) fail("bucketDuration must be greater than zero");
+            uint64_t alignment = 0;
+            if (align.to_string() == "-")
+                alignment = from;
+            else if (align.to_string() == "+")
+                alignment = to;
+            else if (align.hasValue())
+                alignment = align.value();
+            aggregation::Buckets buckets{
+                command_operator::to_string(*aggregation), bucket, alignment,
+                [&](uint64_t start, double value) {
+                    result.emplace_back(TimeStamp{start}, value);
+                }};
+            for (size_t i = 0; i < samples.size(); ++i)
+                buckets.add(samples.timestamps[i], samples.values[i]);
+            buckets.finish();
+        } else {
+            result.reserve(samples.size());
+            for (size_t i = 0; i < samples.size(); ++i)
+                result.emplace_back(TimeStamp{samples.timestamps[i]},
+                                    samples.values[i]);
+        }
+        if (reverse) std::reverse(result.begin(), result.end());
+        if (count.has_value() && result.size() > *count) result.resize(*count);
+        return result;
+    }
+
+    EmbeddedOptions options_;
+    mutable std::shared_mutex mutex_;
+    std::map<std::string, Series> series_;
+};
+
+} // namespace embedded
+
+} // namespace redis_time_series
@@ -0,0 +1,659 @@
+#pragma once
+
+#include "redis_time_series.h"
+#include "redis_time_series_aggregation.h"
+#include "redis_time_series_align.h"
+#include "redis_time_series_store.h"
+
+#include <deque>
+#include <memory>
+#include <span>
+
+namespace redis_time_series {
+
+// Derived series such as `flow = a - b`, `rate(counter)` or the average of
+// a label group, described as expressions and evaluated lazily.
+//
+// An expression is an immutable tree. Evaluator compiles it into a
+// pipeline of operators that run on a fixed grid (see align::Grid) one
+// block of rows at a time: leaves pull TS.RANGE pages only as far as the
+// current block needs, and every operator works in place on the block
+// buffer, so nothing is materialized beyond a block and a page per series.
+// Chains of scalar operations on one expression are fused into a single
+// operator.
+namespace expr {
+
+// Group reductions, computed client-side; NaN inputs are skipped.
+enum class Reducer { SUM, MIN, MAX, AVG, COUNT, RANGE, STDP };
+
+// Moving window functions over the trailing window, NaN inputs skipped.
+enum class Window { SUM, AVG, MIN, MAX };
+
+namespace detail {
+
+enum class Kind {
+    SERIES,
+    GROUP,
+    CONSTANT,
+    MAP,
+    BINARY,
+    RATE,
+    DERIVATIVE,
+    WINDOW
+};
+
+enum class MapOp { ADD, MUL, SUBTRACT_FROM, DIVIDE_INTO, ABS };
+
+struct MapStep {
+    MapOp op;
+    double constant;
+};
+
+enum class BinaryOp { ADD, SUBTRACT, MULTIPLY, DIVIDE };
+
+struct Spec {
+    explicit Spec(Kind kind) : kind{kind} {}
+
+    Kind kind;
+    std::string key;
+    std::vector<std::string> filter;
+    Reducer reducer{Reducer::SUM};
+    double constant{0};
+    std::vector<MapStep> steps;
+    BinaryOp binary{BinaryOp::ADD};
+    Window window{Window::AVG};
+    uint64_t windowLength{0};
+    std::vector<std::shared_ptr<const Spec>> children;
+};
+
+} // namespace detail
+
+class Expr {
+  public:
+    explicit Expr(std::shared_ptr<const detail::Spec> spec)
+        : spec_{std::move(spec)} {}
+
+    const detail::Spec &spec() const { return *spec_; }
+    const std::shared_ptr<const detail::Spec> &shared() const { return spec_; }
+
+  private:
+    std::shared_ptr<const detail::Spec> spec_;
+};
+
+namespace detail {
+
+inline Expr make(Spec spec) {
+    return Expr{std::make_shared<const Spec>(std::move(spec))};
+}
+
+inline Expr map(const Expr &input, MapStep step) {
+    Spec spec{Kind::MAP};
+    spec.steps.push_back(step);
+    spec.children.push_back(input.shared());
+    return make(std::move(spec));
+}
+
+inline Expr binary(const Expr &lhs, const Expr &rhs, BinaryOp op) {
+    Spec spec{Kind::BINARY};
+    spec.binary = op;
+    spec.children = {lhs.shared(), rhs.shared()};
+    return make(std::move(spec));
+}
+
+} // namespace detail
+
+inline Expr series(const std::string &key) {
+    detail::Spec spec{detail::Kind::SERIES};
+    spec.key = key;
+    return detail::make(std::move(spec));
+}
+
+// Every series matching the TS.MRANGE style `filter`, reduced per point.
+inline Expr group(const std::vector<std::string> &filter,
+                  Reducer reducer = Reducer::SUM) {
+    if (filter.empty()) {
+        throw std::invalid_argument("There should be at least one filter");
+    }
+    detail::Spec spec{detail::Kind::GROUP};
+    spec.filter = filter;
+    spec.reducer = reducer;
+    return detail::make(std::move(spec));
+}
+
+inline Expr constant(double value) {
+    detail::Spec spec{detail::Kind::CONSTANT};
+    spec.constant = value;
+    return detail::make(std::move(spec));
+}
+
+// Per-second increase of a monotonic counter such as one fed by
+// TS.INCRBY. A decrease is taken as a counter reset, so the increase over
+// that step is the new value itself.
+inline Expr rate(const Expr &counter) {
+    detail::Spec spec{detail::Kind::RATE};
+    spec.children.push_back(counter.shared());
+    return detail::make(std::move(spec));
+}
+
+// Per-second change between consecutive points, without reset handling.
+inline Expr derivative(const Expr &input) {
+    detail::Spec spec{detail::Kind::DERIVATIVE};
+    spec.children.push_back(input.shared());
+    return detail::make(std::move(spec));
+}
+
+// `function` over the trailing `length` milliseconds, including the point.
+inline Expr moving(const Expr &input, Window function, uint64_t length) {
+    detail::Spec spec{detail::Kind::WINDOW};
+    spec.window = function;
+    spec.windowLength = length;
+    spec.children.push_back(input.shared());
+    return detail::make(std::move(spec));
+}
+
+inline Expr abs(const Expr &input) {
+    return detail::map(input, {detail::MapOp::ABS, 0});
+}
+
+inline Expr operator+(const Expr &lhs, const Expr &rhs) {
+    return detail::binary(lhs, rhs, detail::BinaryOp::ADD);
+}
+inline Expr operator-(const Expr &lhs, const Expr &rhs) {
+    return detail::binary(lhs, rhs, detail::BinaryOp::SUBTRACT);
+}
+inline Expr operator*(const Expr &lhs, const Expr &rhs) {
+    return detail::binary(lhs, rhs, detail::BinaryOp::MULTIPLY);
+}
+inline Expr operator/(const Expr &lhs, const Expr &rhs) {
+    return detail::binary(lhs, rhs, detail::BinaryOp::DIVIDE);
+}
+inline Expr operator+(const Expr &lhs, double rhs) {
+    return detail::map(lhs, {detail::MapOp::ADD, rhs});
+}
+inline Expr operator+(double lhs, const Expr &rhs) { return rhs + lhs; }
+inline Expr operator-(const Expr &lhs, double rhs) { return lhs + -rhs; }
+inline Expr operator-(double lhs, const Expr &rhs) {
+    return detail::map(rhs, {detail::MapOp::SUBTRACT_FROM, lhs});
+}
+inline Expr operator-(const Expr &input) { return 0.0 - input; }
+inline Expr operator*(const Expr &lhs, double rhs) {
+    return detail::map(lhs, {detail::MapOp::MUL, rhs});
+}
+inline Expr operator*(double lhs, const Expr &rhs) { return rhs * lhs; }
+inline Expr operator/(const Expr &lhs, double rhs) {
+    return detail::map(lhs, {detail::MapOp::MUL, 1 / rhs});
+}
+inline Expr operator/(double lhs, const Expr &rhs) {
+    return detail::map(rhs, {detail::MapOp::DIVIDE_INTO, lhs});
+}
+
+// Keys of the series matching a label filter.
+using KeyResolver =
+    std::function<std::vector<std::string>(const std::vector<std::string> &)>;
+
+struct EvalOptions {
+    // Points at which the expression is evaluated.
+    align::Grid grid{};
+    // Rows computed per pass through the pipeline.
+    std::size_t blockRows = 4096;
+    // How raw series are read at grid points (align::Fill).
+    align::Fill fill = align::Fill::LOCF;
+    std::optional<uint64_t> maxGap;
+    // Samples per TS.RANGE page.
+    uint64_t pageSize = 10000;
+};
+
+namespace detail {
+
+struct Context {
+    TimeSeriesStore &store;
+    const EvalOptions &options;
+    uint64_t samplesFetched{0};
+    uint64_t requests{0};
+};
+
+// One operator of a compiled pipeline. fill() is called for consecutive
+// blocks of the grid and writes block.rows values to `out`.
+class Node {
+  public:
+    virtual ~Node() = default;
+    virtual void fill(const align::Grid &block, double *out) = 0;
+};
+
+// Reads a stored series at the grid points, fetching pages on demand.
+class SeriesNode : public Node {
+  public:
+    SeriesNode(Context &context, std::string key)
+        : context_{context}, key_{std::move(key)} {
+        align_.fill = context.options.fill;
+        align_.maxGap = context.options.maxGap;
+    }
+
+    void fill(const align::Grid &block, double *out) override {
+        if (block.rows == 0) return;
+        auto end = block.at(block.rows - 1);
+        if (!primed_) prime(block.start);
+        while (!exhausted_ &&
+               (buffer_.empty() || buffer_.timestamps.back() < end))
+            fetch();
+        align::alignColumn(buffer_, block, align_, out);
+        trim(end);
+    }
+
+  private:
+    // The last sample before the grid, for LOCF/LINEAR/NEAREST at its
+    // first points.
+    void prime(uint64_t start) {
+        primed_ = true;
+        cursor_ = start;
+        if (start == 0) return;
+        ++context_.requests;
+        auto before = context_.store.revRange(key_, TimeStamp{"-"},
+                                              TimeStamp{start - 1}, 1);
+        for (auto &sample : before)
+            buffer_.push_back(sample.time().value(), sample.value());
+        context_.samplesFetched += before.size();
+    }
+
+    void fetch() {
+        auto pageSize = std::max<uint64_t>(context_.options.pageSize, 1);
+        ++context_.requests;
+        auto page = context_.store.range(key_, TimeStamp{cursor_},
+                                         TimeStamp{"+"}, pageSize);
+        context_.samplesFetched += page.size();
+        for (auto &sample : page)
+            buffer_.push_back(sample.time().value(), sample.value());
+        if (page.size() < pageSize) {
+            exhausted_ = true;
+            return;
+        }
+        auto last = page.back().time().value();
+        if (last == std::numeric_limits<uint64_t>::max())
+            exhausted_ = true;
+        else
+            cursor_ = last + 1;
+    }
+
+    // Keeps the last sample at or before `emitted` as the left neighbour
+    // of the next block.
+    void trim(uint64_t emitted) {
+        auto &ts = buffer_.timestamps;
+        auto it = std::upper_bound(ts.begin(), ts.end(), emitted);
+        if (it == ts.begin()) return;
+        auto drop = static_cast<std::ptrdiff_t>(it - ts.begin()) - 1;
+        ts.erase(ts.begin(), ts.begin() + drop);
+        buffer_.values.erase(buffer_.values.begin(),
+                             buffer_.values.begin() + drop);
+    }
+
+    Context &context_;
+    std::string key_;
+    align::AlignOptions align_;
+    TimeSeriesColumns buffer_;
+    uint64_t cursor_{0};
+    bool primed_{false};
+    bool exhausted_{false};
+};
+
+class GroupNode : public Node {
+  public:
+    GroupNode(std::vector<std::unique_ptr<Node>> members, Reducer reducer)
+        : members_{std::move(members)}, reducer_{reducer} {}
+
+    void fill(const align::Grid &block, double *out) override {
+        auto rows = block.rows;
+        accumulators_.assign(rows, {});
+        scratch_.resize(rows);
+        for (auto &member : members_) {
+            member->fill(block, scratch_.data());
+            for (std::size_t i = 0; i < rows; ++i)
+                if (!std::isnan(scratch_[i])) accumulators_[i].add(scratch_[i]);
+        }
+        auto type = typeName();
+        const auto nan = std::numeric_limits<double>::quiet_NaN();
+        for (std::size_t i = 0; i < rows; ++i) {
+            out[i] = accumulators_[i].empty() && reducer_ != Reducer::COUNT
+                         ? nan
+                         : accumulators_[i].value(type);
+        }
+    }
+
+  private:
+    // The module's name for the reduction, as aggregation::Accumulator
+    // takes it.
+    std::string_view typeName() const {
+        switch (reducer_) {
+        case Reducer::SUM:
+            return "sum";
+        case Reducer::MIN:
+            return "min";
+        case Reducer::MAX:
+            return "max";
+        case Reducer::AVG:
+            return "avg";
+        case Reducer::COUNT:
+            return "count";
+        case Reducer::RANGE:
+            return "range";
+        case Reducer::STDP:
+            return "std.p";
+        }
+        return "sum";
+    }
+
+    std::vector<std::unique_ptr<Node>> members_;
+    Reducer reducer_;
+    std::vector<double> scratch_;
+    std::vector<aggregation::Accumulator> accumulators_;
+};
+
+class ConstantNode : public Node {
+  public:
+    explicit ConstantNode(double value) : value_{value} {}
+
+    void fill(const align::Grid &block, double *out) override {
+        std::fill(out, out + block.rows, value_);
+    }
+
+  private:
+    double value_;
+};
+
+// Fused chain of scalar operations: one pass over the block per step and
+// no intermediate buffers.
+class MapNode : public Node {
+  public:
+    MapNode(std::unique_ptr<Node> input, std::vector<MapStep> steps)
+        : input_{std::move(input)}, steps_{std::move(steps)} {}
+
+    void fill(const align::Grid &block, double *out) override {
+        input_->fill(block, out);
+        auto rows = block.rows;
+        for (auto [op, c] : steps_) {
+            switch (op) {
+            case MapOp::ADD:
+                for (std::size_t i = 0; i < rows; ++i)
+                    out[i] += c;
+                break;
+            case MapOp::MUL:
+                for (std::size_t i = 0; i < rows; ++i)
+                    out[i] *= c;
+                break;
+            case MapOp::SUBTRACT_FROM:
+                for (std::size_t i = 0; i < rows; ++i)
+                    out[i] = c - out[i];
+                break;
+            case MapOp::DIVIDE_INTO:
+                for (std::size_t i = 0; i < rows; ++i)
+                    out[i] = c / out[i];
+                break;
+            case MapOp::ABS:
+                for (std::size_t i = 0; i < rows; ++i)
+                    out[i] = std::fabs(out[i]);
+                break;
+            }
+        }
+    }
+
+  private:
+    std::unique_ptr<Node> input_;
+    std::vector<MapStep> steps_;
+};
+
+class BinaryNode : public Node {
+  public:
+    BinaryNode(std::unique_ptr<Node> lhs, std::unique_ptr<Node> rhs,
+               BinaryOp op)
+        : lhs_{std::move(lhs)}, rhs_{std::move(rhs)}, op_{op} {}
+
+    void fill(const align::Grid &block, double *out) override {
+        auto rows = block.rows;
+        scratch_.resize(rows);
+        lhs_->fill(block, out);
+        rhs_->fill(block, scratch_.data());
+        const auto *r = scratch_.data();
+        switch (op_) {
+        case BinaryOp::ADD:
+            for (std::size_t i = 0; i < rows; ++i)
+                out[i] += r[i];
+            break;
+        case BinaryOp::SUBTRACT:
+            for (std::size_t i = 0; i < rows; ++i)
+                out[i] -= r[i];
+            break;
+        case BinaryOp::MULTIPLY:
+            for (std::size_t i = 0; i < rows; ++i)
+                out[i] *= r[i];
+            break;
+        case BinaryOp::DIVIDE:
+            for (std::size_t i = 0; i < rows; ++i)
+                out[i] /= r[i];
+            break;
+        }
+    }
+
+  private:
+    std::unique_ptr<Node> lhs_;
+    std::unique_ptr<Node> rhs_;
+    BinaryOp op_;
+    std::vector<double> scratch_;
+};
+
+// rate() and derivative(); the previous point is carried across blocks.
+class DeltaNode : public Node {
+  public:
+    DeltaNode(std::unique_ptr<Node> input, bool counter)
+        : input_{std::move(input)}, counter_{counter} {}
+
+    void fill(const align::Grid &block, double *out) override {
+        input_->fill(block, out);
+        auto perSecond = 1000.0 / static_cast<double>(block.step);
+        for (std::size_t i = 0; i < block.rows; ++i) {
+            auto value = out[i];
+            auto delta = value - previous_;
+            if (counter_ && delta < 0) delta = value;
+            out[i] = delta * perSecond;
+            previous_ = value;
+        }
+    }
+
+  private:
+    std::unique_ptr<Node> input_;
+    bool counter_;
+    double previous_{std::numeric_limits<double>::quiet_NaN()};
+};
+
+// Moving window over the last `length` rows, carried across blocks.
+class WindowNode : public Node {
+  public:
+    WindowNode(std::unique_ptr<Node> input, Window function,
+               std::size_t length)
+        : input_{std::move(input)}, function_{function},
+          length_{std::max<std::size_t>(length, 1)} {}
+
+    void fill(const align::Grid &block, double *out) override {
+        input_->fill(block, out);
+        const auto nan = std::numeric_limits<double>::quiet_NaN();
+        for (std::size_t i = 0; i < block.rows; ++i) {
+            auto value = out[i];
+            auto row = row_++;
+            window_.push_back({row, value});
+            if (!std::isnan(value)) {
+                sum_ += value;
+                ++count_;
+                // Monotonic deques: front is the window min / max.
+                while (!mins_.empty() && mins_.back().second >= value)
+                    mins_.pop_back();
+                mins_.push_back({row, value});
+                while (!maxs_.empty() && maxs_.back().second <= value)
+                    maxs_.pop_back();
+                maxs_.push_back({row, value});
+            }
+            if (window_.size() > length_) {
+                auto old = window_.front();
+                window_.pop_front();
+                if (!std::isnan(old.second)) {
+                    sum_ -= old.second;
+                    --count_;
+                }
+                if (!mins_.empty() && mins_.front().first == old.first)
+                    mins_.pop_front();
+                if (!maxs_.empty() && maxs_.front().first == old.first)
+                    maxs_.pop_front();
+            }
+            if (count_ == 0) {
+                out[i] = nan;
+                continue;
+            }
+            switch (function_) {
+            case Window::SUM:
+                out[i] = sum_;
+                break;
+            case Window::AVG:
+                out[i] = sum_ / static_cast<double>(count_);
+                break;
+            case Window::MIN:
+                out[i] = mins_.front().second;
+                break;
+            case Window::MAX:
+                out[i] = maxs_.front().second;
+                break;
+            }
+        }
+    }
+
+  private:
+    using Entry = std::pair<uint64_t, double>;
+
+    std::unique_ptr<Node> input_;
+    Window function_;
+    std::size_t length_;
+    uint64_t row_{0};
+    std::deque<Entry> window_;
+    std::deque<Entry> mins_;
+    std::deque<Entry> maxs_;
+    double sum_{0};
+    std::size_t count_{0};
+};
+
+} // namespace detail
+
+struct EvalStats {
+    uint64_t samplesFetched{0};
+    uint64_t requests{0};
+};
+
+// Evaluates expressions against a store. Label groups are resolved with
+// `resolver`; over a RedisStore it defaults to TS.QUERYINDEX.
+class Evaluator {
+  public:
+    using BlockCallback = std::function<void(std::span<const uint64_t>,
+                                             std::span<const double>)>;
+
+    Evaluator(TimeSeriesStore &store, EvalOptions options,
+              KeyResolver resolver = {})
+        : store_{store}, options_{std::move(options)},
+          resolver_{std::move(resolver)} {
+        if (options_.grid.step == 0)
+            throw std::invalid_argument("Grid step must not be zero");
+        options_.blockRows = std::max<std::size_t>(options_.blockRows, 1);
+        if (!resolver_) {
+            if (auto *redis = dynamic_cast<RedisStore *>(&store_)) {
+                resolver_ = [db = redis->redis()](
+                                const std::vector<std::string> &filter) {
+                    return client::timeSeriesQueryIndex(db, filter);
+                };
+            }
+        }
+    }
+
+    // Streams the values of `expression` block by block.
+    EvalStats evaluate(const Expr &expression, const BlockCallback &onBlock) {
+        detail::Context context{store_, options_};
+        auto root = compile(context, expression.spec());
+        auto &grid = options_.grid;
+        std::vector<double> values;
+        std::vector<uint64_t> timestamps;
+        for (std::size_t row = 0; row < grid.rows;
+             row += options_.blockRows) {
+            align::Grid block{grid.at(row), grid.step,
+                              std::min(options_.blockRows, grid.rows - row)};
+            values.resize(block.rows);
+            timestamps.resize(block.rows);
+            for (std::size_t i = 0; i < block.rows; ++i)
+                timestamps[i] = block.at(i);
+            root->fill(block, values.data());
+            onBlock(timestamps, values);
+        }
+        return EvalStats{context.samplesFetched, context.requests};
+    }
+
+    // The whole result in memory, for short grids.
+    TimeSeriesColumns collect(const Expr &expression) {
+        TimeSeriesColumns result;
+        result.reserve(options_.grid.rows);
+        evaluate(expression, [&](std::span<const uint64_t> timestamps,
+                                 std::span<const double> values) {
+            for (std::size_t i = 0; i < timestamps.size(); ++i)
+                result.push_back(timestamps[i], values[i]);
+        });
+        return result;
+    }
+
+  private:
+    std::unique_ptr<detail::Node> compile(detail::Context &context,
+                                          const detail::Spec &spec) {
+        using namespace detail;
+        switch (spec.kind) {
+        case Kind::SERIES:
+            return std::make_unique<SeriesNode>(context, spec.key);
+        case Kind::GROUP: {
+            if (!resolver_) {
+                throw std::invalid_argument(
+                    "Label groups need a key resolver for this store");
+            }
+            std::vector<std::unique_ptr<Node>> members;
+            for (auto &key : resolver_(spec.filter))
+                members.push_back(std::make_unique<SeriesNode>(context, key));
+            return std::make_unique<GroupNode>(std::move(members),
+                                               spec.reducer);
+        }
+        case Kind::CONSTANT:
+            return std::make_unique<ConstantNode>(spec.constant);
+        case Kind::MAP: {
+            // Fuse a chain of scalar operations into one node.
+            std::vector<MapStep> steps;
+            const Spec *input = &spec;
+            while (input->kind == Kind::MAP) {
+                steps.insert(steps.begin(), input->steps.begin(),
+                             input->steps.end());
+                input = input->children.front().get();
+            }
+            return std::make_unique<MapNode>(compile(context, *input),
+                                             std::move(steps));
+        }
+        case Kind::BINARY:
+            return std::make_unique<BinaryNode>(
+                compile(context, *spec.children[0]),
+                compile(context, *spec.children[1]), spec.binary);
+        case Kind::RATE:
+        case Kind::DERIVATIVE:
+            return std::make_unique<DeltaNode>(
+                compile(context, *spec.children[0]), spec.kind == Kind::RATE);
+        case Kind::WINDOW:
+            return std::make_unique<WindowNode>(
+                compile(context, *spec.children[0]), spec.window,
+                static_cast<std::size_t>(spec.windowLength /
+                                         options_.grid.step));
+        }
+        throw std::logic_error("Unknown expression kind");
+    }
+
+    TimeSeriesStore &store_;
+    EvalOptions options_;
+    KeyResolver resolver_;
+};
+
+} // namespace expr
+
+} // namespace redis_time_series
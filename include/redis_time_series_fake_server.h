@@ -0,0 +1,1142 @@
+#pragma once
+
+#include "redis_time_series_aggregation.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <functional>
+#include <limits>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <optional>
+#include <poll.h>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <sys/socket.h>
+#include <system_error>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace redis_time_series {
+
+// In-process stand-in for a Redis server with the RedisTimeSeries module,
+// for deterministic load and fault tests without Docker. Only the commands
+// this library issues are implemented, on plain in-memory maps; replies
+// follow the module's RESP2 shapes so the client:: functions and parsers
+// work against it unchanged. Depends on the standard library and POSIX
+// sockets only.
+namespace fake {
+
+namespace detail {
+
+inline bool equalsIgnoreCase(std::string_view lhs, std::string_view rhs) {
+    return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(),
+                      [](char a, char b) {
+                          return std::tolower(static_cast<unsigned char>(a)) ==
+                                 std::tolower(static_cast<unsigned char>(b));
+                      });
+}
+
+inline std::string toLower(std::string_view text) {
+    std::string lower{text};
+    for (auto &c : lower)
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    return lower;
+}
+
+// Reply encoder; appends RESP2 to `out`.
+class Reply {
+  public:
+    explicit Reply(std::string &out) : out_{out} {}
+
+    void status(std::string_view text) { line('+', text); }
+    void error(std::string_view text) { line('-', text); }
+    void integer(int64_t value) { line(':', std::to_string(value)); }
+    void nil() { out_ += "$-1\r\n"; }
+    void array(std::size_t size) { line('*', std::to_string(size)); }
+
+    void bulk(std::string_view text) {
+        line('$', std::to_string(text.size()));
+        out_ += text;
+        out_ += "\r\n";
+    }
+
+    // The module replies sample values as status strings.
+    void value(double value) {
+        char buffer[32];
+        auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        status(std::string_view{buffer, static_cast<size_t>(end - buffer)});
+    }
+
+    void sample(uint64_t timestamp, double v) {
+        array(2);
+        integer(static_cast<int64_t>(timestamp));
+        value(v);
+    }
+
+  private:
+    void line(char type, std::string_view text) {
+        out_ += type;
+        out_ += text;
+        out_ += "\r\n";
+    }
+
+    std::string &out_;
+};
+
+// Incremental RESP request decoder. Accepts multi-bulk requests and, for
+// use from telnet or nc, space separated inline commands.
+class RequestParser {
+  public:
+    void feed(const char *data, std::size_t size) {
+        if (offset_ == buffer_.size()) {
+            buffer_.clear();
+            offset_ = 0;
+        } else if (offset_ > 65536) {
+            buffer_.erase(0, offset_);
+            offset_ = 0;
+        }
+        buffer_.append(data, size);
+    }
+
+    // Next complete request, or nullopt until more bytes arrive. Throws
+    // std::runtime_error on malformed input.
+    std::optional<std::vector<std::string>> next() {
+        if (offset_ == buffer_.size()) return std::nullopt;
+        auto pos = offset_;
+        auto request = buffer_[pos] == '*' ? parseMultiBulk(pos)
+                                           : parseInline(pos);
+        if (request.has_value()) offset_ = pos;
+        return request;
+    }
+
+  private:
+    std::optional<int64_t> readNumber(std::size_t &pos) const {
+        auto end = buffer_.find("\r\n", pos);
+        if (end == std::string::npos) return std::nullopt;
+        int64_t value{};
+        auto [ptr, ec] =
+            std::from_chars(buffer_.data() + pos, buffer_.data() + end, value);
+        if (ec != std::errc{} || ptr != buffer_.data() + end)
+            throw std::runtime_error("Protocol error: invalid length");
+        pos = end + 2;
+        return value;
+    }
+
+    std::optional<std::vector<std::string>>
+    parseMultiBulk(std::size_t &pos) const {
+        ++pos;
+        auto count = readNumber(pos);
+        if (!count.has_value()) return std::nullopt;
+        if (*count < 0 || *count > 1024 * 1024)
+            throw std::runtime_error("Protocol error: invalid multibulk");
+        std::vector<std::string> args;
+        args.reserve(static_cast<std::size_t>(*count));
+        for (int64_t i = 0; i < *count; ++i) {
+            if (pos >= buffer_.size()) return std::nullopt;
+            if (buffer_[pos] != '$')
+                throw std::runtime_error("Protocol error: expected '$'");
+            ++pos;
+            auto length = readNumber(pos);
+            if (!length.has_value()) return std::nullopt;
+            if (*length < 0)
+                throw std::runtime_error("Protocol error: invalid bulk");
+            auto size = static_cast<std::size_t>(*length);
+            if (buffer_.size() < pos + size + 2) return std::nullopt;
+            args.emplace_back(buffer_, pos, size);
+            pos += size + 2;
+        }
+        return args;
+    }
+
+    std::optional<std::vector<std::string>>
+    parseInline(std::size_t &pos) const {
+        auto end = buffer_.find('\n', pos);
+        if (end == std::string::npos) return std::nullopt;
+        std::string_view line{buffer_.data() + pos, end - pos};
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        std::vector<std::string> args;
+        while (!line.empty()) {
+            auto space = line.find(' ');
+            if (space != 0) args.emplace_back(line.substr(0, space));
+            if (space == std::string_view::npos) break;
+            line.remove_prefix(space + 1);
+        }
+        pos = end + 1;
+        return args;
+    }
+
+    std::string buffer_;
+    std::size_t offset_{0};
+};
+
+// Sequential reader over a command's arguments.
+class Arguments {
+  public:
+    Arguments(const std::vector<std::string> &args, std::size_t first)
+        : args_{args}, pos_{first} {}
+
+    bool done() const { return pos_ >= args_.size(); }
+
+    const std::string &next() {
+        if (done()) throw std::invalid_argument("wrong number of arguments");
+        return args_[pos_++];
+    }
+
+    bool nextIs(std::string_view keyword) {
+        if (done() || !equalsIgnoreCase(args_[pos_], keyword)) return false;
+        ++pos_;
+        return true;
+    }
+
+    uint64_t nextUnsigned() {
+        auto &text = next();
+        uint64_t value{};
+        auto [end, ec] =
+            std::from_chars(text.data(), text.data() + text.size(), value);
+        if (ec != std::errc{} || end != text.data() + text.size())
+            throw std::invalid_argument("TSDB: invalid number " + text);
+        return value;
+    }
+
+    double nextDouble() {
+        auto &text = next();
+        double value{};
+        auto [end, ec] =
+            std::from_chars(text.data(), text.data() + text.size(), value);
+        if (ec != std::errc{} || end != text.data() + text.size())
+            throw std::invalid_argument("TSDB: invalid value");
+        return value;
+    }
+
+  private:
+    const std::vector<std::string> &args_;
+    std::size_t pos_;
+};
+
+// Label matcher of TS.MRANGE/TS.MGET/TS.QUERYINDEX: `l=v`, `l!=v`,
+// `l=(a,b)`, `l!=(a,b)`; an empty value stands for "label absent".
+struct Matcher {
+    std::string label;
+    bool equal{true};
+    std::vector<std::string> values;
+
+    static Matcher parse(std::string_view text) {
+        auto eq = text.find('=');
+        if (eq == std::string_view::npos || eq == 0)
+            throw std::invalid_argument("TSDB: failed parsing labels");
+        Matcher matcher;
+        matcher.equal = text[eq - 1] != '!';
+        matcher.label = text.substr(0, matcher.equal ? eq : eq - 1);
+        auto value = text.substr(eq + 1);
+        if (value.size() >= 2 && value.front() == '(' && value.back() == ')') {
+            value = value.substr(1, value.size() - 2);
+            while (true) {
+                auto comma = value.find(',');
+                matcher.values.emplace_back(value.substr(0, comma));
+                if (comma == std::string_view::npos) break;
+                value.remove_prefix(comma + 1);
+            }
+        } else {
+            matcher.values.emplace_back(value);
+        }
+        return matcher;
+    }
+
+    bool positive() const {
+        return equal && std::any_of(values.begin(), values.end(),
+                                    [](auto &v) { return !v.empty(); });
+    }
+
+    bool matches(const std::optional<std::string> &value) const {
+        auto found = std::find(values.begin(), values.end(),
+                               value.value_or(std::string{})) != values.end();
+        return found == equal;
+    }
+};
+
+} // namespace detail
+
+// In-memory series and the command implementations, usable without a
+// socket through execute(). Thread-safe.
+class FakeStore {
+  public:
+    using Samples = std::vector<std::pair<uint64_t, double>>;
+
+    // Clock for `*` timestamps and TS.INCRBY without TIMESTAMP; defaults to
+    // the system clock in milliseconds.
+    explicit FakeStore(std::function<uint64_t()> clock = {})
+        : clock_{clock ? std::move(clock) : [] {
+              return static_cast<uint64_t>(
+                  std::chrono::duration_cast<std::chrono::milliseconds>(
+                      std::chrono::system_clock::now().time_since_epoch())
+                      .count());
+          }} {}
+
+    // Runs one command and appends its RESP reply to `out`.
+    void execute(const std::vector<std::string> &args, std::string &out) {
+        detail::Reply reply{out};
+        if (args.empty()) {
+            reply.error("ERR empty command");
+            return;
+        }
+        auto name = detail::toLower(args[0]);
+        std::lock_guard lock{mutex_};
+        try {
+            dispatch(name, args, reply);
+        } catch (const std::invalid_argument &error) {
+            reply.error(std::string{"ERR "} + error.what());
+        } catch (const std::out_of_range &error) {
+            reply.error(std::string{"ERR "} + error.what());
+        }
+    }
+
+    std::string execute(const std::vector<std::string> &args) {
+        std::string out;
+        execute(args, out);
+        return out;
+    }
+
+    std::size_t size() const {
+        std::lock_guard lock{mutex_};
+        return series_.size();
+    }
+
+    void clear() {
+        std::lock_guard lock{mutex_};
+        series_.clear();
+    }
+
+  private:
+    using Labels = std::vector<std::pair<std::string, std::string>>;
+
+    struct Series {
+        std::map<uint64_t, double> samples;
+        Labels labels;
+        uint64_t retention{0};
+        uint64_t chunkSize{4096};
+        bool uncompressed{false};
+        std::optional<std::string> duplicatePolicy;
+
+        std::optional<std::string> label(std::string_view name) const {
+            for (auto &[key, value] : labels)
+                if (key == name) return value;
+            return std::nullopt;
+        }
+    };
+
+    struct CreateOptions {
+        std::optional<uint64_t> retention;
+        std::optional<uint64_t> chunkSize;
+        bool uncompressed{false};
+        std::optional<std::string> duplicatePolicy;
+        std::optional<std::string> onDuplicate;
+        std::optional<uint64_t> timestamp;
+        Labels labels;
+    };
+
+    struct RangeQuery {
+        uint64_t from{0};
+        uint64_t to{std::numeric_limits<uint64_t>::max()};
+        std::vector<uint64_t> filterByTs;
+        std::optional<std::pair<double, double>> filterByValue;
+        std::optional<uint64_t> count;
+        std::optional<std::string> aggregation;
+        uint64_t bucket{0};
+        int64_t align{0};
+        bool reverse{false};
+        bool withLabels{false};
+        std::optional<std::vector<std::string>> selectedLabels;
+        std::vector<detail::Matcher> filter;
+        std::optional<std::string> groupBy;
+        std::optional<std::string> reduce;
+    };
+
+    void dispatch(const std::string &name, const std::vector<std::string> &args,
+                  detail::Reply &reply) {
+        if (name == "ping") {
+            if (args.size() > 1)
+                reply.bulk(args[1]);
+            else
+                reply.status("PONG");
+        } else if (name == "select" || name == "flushdb" ||
+                   name == "flushall") {
+            if (name != "select") series_.clear();
+            reply.status("OK");
+        } else if (name == "del") {
+            int64_t removed = 0;
+            for (size_t i = 1; i < args.size(); ++i)
+                removed += static_cast<int64_t>(series_.erase(args[i]));
+            reply.integer(removed);
+        } else if (name == "exists") {
+            int64_t found = 0;
+            for (size_t i = 1; i < args.size(); ++i)
+                found += static_cast<int64_t>(series_.count(args[i]));
+            reply.integer(found);
+        } else if (name == "ts.create") {
+            create(args, reply);
+        } else if (name == "ts.add") {
+            add(args, reply);
+        } else if (name == "ts.madd") {
+            madd(args, reply);
+        } else if (name == "ts.incrby" || name == "ts.decrby") {
+            incrBy(args, name == "ts.decrby", reply);
+        } else if (name == "ts.range" || name == "ts.revrange") {
+            range(args, name == "ts.revrange", reply);
+        } else if (name == "ts.mrange" || name == "ts.mrevrange") {
+            mrange(args, name == "ts.mrevrange", reply);
+        } else if (name == "ts.get") {
+            get(args, reply);
+        } else if (name == "ts.mget") {
+            mget(args, reply);
+        } else if (name == "ts.info") {
+            info(args, reply);
+        } else if (name == "ts.queryindex") {
+            queryIndex(args, reply);
+        } else {
+            reply.error("ERR unknown command '" + args[0] + "'");
+        }
+    }
+
+    Series &existing(const std::string &key) {
+        auto it = series_.find(key);
+        if (it == series_.end())
+            throw std::invalid_argument("TSDB: the key does not exist");
+        return it->second;
+    }
+
+    static CreateOptions parseCreateOptions(detail::Arguments &in,
+                                            bool allowTimestamp) {
+        CreateOptions options;
+        while (!in.done()) {
+            if (in.nextIs("RETENTION")) {
+                options.retention = in.nextUnsigned();
+            } else if (in.nextIs("CHUNK_SIZE")) {
+                options.chunkSize = in.nextUnsigned();
+            } else if (in.nextIs("UNCOMPRESSED")) {
+                options.uncompressed = true;
+            } else if (in.nextIs("DUPLICATE_POLICY")) {
+                options.duplicatePolicy = policy(in.next());
+            } else if (in.nextIs("ON_DUPLICATE")) {
+                options.onDuplicate = policy(in.next());
+            } else if (allowTimestamp && in.nextIs("TIMESTAMP")) {
+                options.timestamp = in.nextUnsigned();
+            } else if (in.nextIs("LABELS")) {
+                while (!in.done()) {
+                    auto &key = in.next();
+                    options.labels.emplace_back(key, in.next());
+                }
+            } else {
+                throw std::invalid_argument("TSDB: wrong parameters");
+            }
+        }
+        return options;
+    }
+
+    static std::string policy(std::string_view name) {
+        auto lower = detail::toLower(name);
+        for (auto known : {"block", "first", "last", "min", "max", "sum"})
+            if (lower == known) return lower;
+        throw std::invalid_argument("TSDB: Unknown DUPLICATE_POLICY");
+    }
+
+    static Series makeSeries(const CreateOptions &options) {
+        Series series;
+        series.retention = options.retention.value_or(0);
+        series.chunkSize = options.chunkSize.value_or(4096);
+        series.uncompressed = options.uncompressed;
+        series.duplicatePolicy = options.duplicatePolicy;
+        series.labels = options.labels;
+        return series;
+    }
+
+    uint64_t parseTimestamp(const std::string &text) {
+        if (text == "*") return clock_();
+        uint64_t value{};
+        auto [end, ec] =
+            std::from_chars(text.data(), text.data() + text.size(), value);
+        if (ec != std::errc{} || end != text.data() + text.size())
+            throw std::invalid_argument("TSDB: invalid timestamp");
+        return value;
+    }
+
+    // Inserts a sample, applying the duplicate policy and retention.
+    static void upsert(Series &series, uint64_t timestamp, double value,
+                       const std::optional<std::string> &onDuplicate) {
+        if (series.retention != 0 && !series.samples.empty()) {
+            auto last = series.samples.rbegin()->first;
+            if (timestamp + series.retention < last)
+                throw std::invalid_argument(
+                    "TSDB: Timestamp is older than retention");
+        }
+        auto [it, inserted] = series.samples.emplace(timestamp, value);
+        if (!inserted) {
+            auto policy = onDuplicate.value_or(
+                series.duplicatePolicy.value_or("block"));
+            auto &stored = it->second;
+            if (policy == "block")
+                throw std::invalid_argument(
+                    "TSDB: Error at upsert, update is not supported when "
+                    "DUPLICATE_POLICY is set to BLOCK mode");
+            if (policy == "last") stored = value;
+            if (policy == "min") stored = std::min(stored, value);
+            if (policy == "max") stored = std::max(stored, value);
+            if (policy == "sum") stored += value;
+        }
+        if (series.retention != 0) {
+            auto last = series.samples.rbegin()->first;
+            if (last > series.retention)
+                series.samples.erase(
+                    series.samples.begin(),
+                    series.samples.lower_bound(last - series.retention));
+        }
+    }
+
+    void create(const std::vector<std::string> &args, detail::Reply &reply) {
+        detail::Arguments in{args, 1};
+        auto &key = in.next();
+        auto options = parseCreateOptions(in, false);
+        if (series_.count(key) != 0)
+            throw std::invalid_argument("TSDB: key already exists");
+        series_.emplace(key, makeSeries(options));
+        reply.status("OK");
+    }
+
+    void add(const std::vector<std::string> &args, detail::Reply &reply) {
+        detail::Arguments in{args, 1};
+        auto &key = in.next();
+        auto timestamp = parseTimestamp(in.next());
+        auto value = in.nextDouble();
+        auto options = parseCreateOptions(in, false);
+        auto it = series_.find(key);
+        if (it == series_.end())
+            it = series_.emplace(key, makeSeries(options)).first;
+        upsert(it->second, timestamp, value, options.onDuplicate);
+        reply.integer(static_cast<int64_t>(timestamp));
+    }
+
+    void madd(const std::vector<std::string> &args, detail::Reply &reply) {
+        if (args.size() < 4 || (args.size() - 1) % 3 != 0)
+            throw std::invalid_argument("wrong number of arguments");
+        reply.array((args.size() - 1) / 3);
+        for (size_t i = 1; i < args.size(); i += 3) {
+            try {
+                auto &series = existing(args[i]);
+                detail::Arguments in{args, i + 1};
+                auto timestamp = parseTimestamp(in.next());
+                upsert(series, timestamp, in.nextDouble(), std::nullopt);
+                reply.integer(static_cast<int64_t>(timestamp));
+            } catch (const std::invalid_argument &error) {
+                reply.error(std::string{"ERR "} + error.what());
+            }
+        }
+    }
+
+    void incrBy(const std::vector<std::string> &args, bool decrement,
+                detail::Reply &reply) {
+        detail::Arguments in{args, 1};
+        auto &key = in.next();
+        auto by = in.nextDouble();
+        auto options = parseCreateOptions(in, true);
+        auto it = series_.find(key);
+        if (it == series_.end())
+            it = series_.emplace(key, makeSeries(options)).first;
+        auto &samples = it->second.samples;
+        auto timestamp = options.timestamp.value_or(clock_());
+        double last = 0;
+        if (!samples.empty()) {
+            if (timestamp < samples.rbegin()->first)
+                throw std::invalid_argument(
+                    "TSDB: timestamp must be equal to or higher than the "
+                    "maximum existing timestamp");
+            last = samples.rbegin()->second;
+        }
+        samples[timestamp] = decrement ? last - by : last + by;
+        reply.integer(static_cast<int64_t>(timestamp));
+    }
+
+    static uint64_t rangeBound(const std::string &text, bool upper) {
+        if (text == "-") return 0;
+        if (text == "+") return std::numeric_limits<uint64_t>::max();
+        uint64_t value{};
+        auto [end, ec] =
+            std::from_chars(text.data(), text.data() + text.size(), value);
+        if (ec != std::errc{} || end != text.data() + text.size())
+            throw std::invalid_argument(upper ? "TSDB: wrong toTimestamp"
+                                              : "TSDB: wrong fromTimestamp");
+        return value;
+    }
+
+    static RangeQuery parseRangeQuery(detail::Arguments &in, bool multi) {
+        RangeQuery query;
+        query.from = rangeBound(in.next(), false);
+        query.to = rangeBound(in.next(), true);
+        std::optional<std::string> align;
+        while (!in.done()) {
+            if (in.nextIs("FILTER_BY_TS")) {
+                do {
+                    query.filterByTs.push_back(in.nextUnsigned());
+                } while (!in.done() && isNumber(peek(in)));
+            } else if (in.nextIs("FILTER_BY_VALUE")) {
+                auto min = in.nextDouble();
+                query.filterByValue = std::pair{min, in.nextDouble()};
+            } else if (in.nextIs("COUNT")) {
+                query.count = in.nextUnsigned();
+            } else if (in.nextIs("ALIGN")) {
+                align = in.next();
+            } else if (in.nextIs("AGGREGATION")) {
+                query.aggregation = detail::toLower(in.next());
+                query.bucket = in.nextUnsigned();
+                if (query.bucket == 0)
+                    throw std::invalid_argument(
+                        "TSDB: bucketDuration must be greater than zero");
+            } else if (multi && in.nextIs("WITHLABELS")) {
+                query.withLabels = true;
+            } else if (multi && in.nextIs("SELECTED_LABELS")) {
+                query.selectedLabels.emplace();
+                while (!in.done() && !isMultiKeyword(peek(in)))
+                    query.selectedLabels->push_back(in.next());
+            } else if (multi && in.nextIs("FILTER")) {
+                while (!in.done() && !isMultiKeyword(peek(in)))
+                    query.filter.push_back(detail::Matcher::parse(in.next()));
+            } else if (multi && in.nextIs("GROUPBY")) {
+                query.groupBy = in.next();
+                if (!in.nextIs("REDUCE"))
+                    throw std::invalid_argument("TSDB: missing REDUCE");
+                query.reduce = detail::toLower(in.next());
+            } else {
+                throw std::invalid_argument("TSDB: wrong parameters");
+            }
+        }
+        if (align.has_value()) {
+            if (*align == "-" || detail::equalsIgnoreCase(*align, "start"))
+                query.align = static_cast<int64_t>(query.from);
+            else if (*align == "+" || detail::equalsIgnoreCase(*align, "end"))
+                query.align = static_cast<int64_t>(query.to);
+            else
+                query.align = std::stoll(*align);
+        }
+        if (multi) requirePositiveMatcher(query.filter);
+        return query;
+    }
+
+    static const std::string &peek(detail::Arguments &in) {
+        // Arguments has no lookahead; copy it to read the next element.
+        auto copy = in;
+        return copy.next();
+    }
+
+    static bool isNumber(std::string_view arg) {
+        return !arg.empty() && std::all_of(arg.begin(), arg.end(), [](char c) {
+            return std::isdigit(static_cast<unsigned char>(c));
+        });
+    }
+
+    static bool isMultiKeyword(std::string_view arg) {
+        for (auto keyword :
+             {"FILTER_BY_TS", "FILTER_BY_VALUE", "COUNT", "ALIGN",
+              "AGGREGATION", "WITHLABELS", "SELECTED_LABELS", "FILTER",
+              "GROUPBY"})
+            if (detail::equalsIgnoreCase(arg, keyword)) return true;
+        return false;
+    }
+
+    static void requirePositiveMatcher(const std::vector<detail::Matcher> &f) {
+        if (std::none_of(f.begin(), f.end(),
+                         [](auto &m) { return m.positive(); }))
+            throw std::invalid_argument(
+                "TSDB: please provide at least one matcher");
+    }
+
+    static Samples query(const Series &series, const RangeQuery &query) {
+        Samples raw;
+        auto first = series.samples.lower_bound(query.from);
+        auto last = series.samples.upper_bound(query.to);
+        for (auto it = first; it != last; ++it) {
+            auto [timestamp, value] = *it;
+            if (!query.filterByTs.empty() &&
+                std::find(query.filterByTs.begin(), query.filterByTs.end(),
+                          timestamp) == query.filterByTs.end())
+                continue;
+            if (query.filterByValue.has_value() &&
+                (value < query.filterByValue->first ||
+                 value > query.filterByValue->second))
+                continue;
+            raw.emplace_back(timestamp, value);
+        }
+
+        Samples result;
+        if (query.aggregation.has_value()) {
+            // A negative ALIGN only matters through its remainder.
+            auto bucket = static_cast<int64_t>(query.bucket);
+            auto alignment = (query.align % bucket + bucket) % bucket;
+            aggregation::Buckets buckets{
+                *query.aggregation, query.bucket,
+                static_cast<uint64_t>(alignment),
+                [&](uint64_t start, double value) {
+                    result.emplace_back(start, value);
+                }};
+            for (auto [timestamp, value] : raw)
+                buckets.add(timestamp, value);
+            buckets.finish();
+        } else {
+            result = std::move(raw);
+        }
+        if (query.reverse) std::reverse(result.begin(), result.end());
+        if (query.count.has_value() && result.size() > *query.count)
+            result.resize(*query.count);
+        return result;
+    }
+
+    static void replySamples(const Samples &samples, detail::Reply &reply) {
+        reply.array(samples.size());
+        for (auto [timestamp, value] : samples)
+            reply.sample(timestamp, value);
+    }
+
+    void range(const std::vector<std::string> &args, bool reverse,
+               detail::Reply &reply) {
+        detail::Arguments in{args, 1};
+        auto &series = existing(in.next());
+        auto q = parseRangeQuery(in, false);
+        q.reverse = reverse;
+        replySamples(query(series, q), reply);
+    }
+
+    std::vector<const std::pair<const std::string, Series> *>
+    select(const std::vector<detail::Matcher> &filter) const {
+        std::vector<const std::pair<const std::string, Series> *> matched;
+        for (auto &entry : series_) {
+            if (std::all_of(filter.begin(), filter.end(), [&](auto &m) {
+                    return m.matches(entry.second.label(m.label));
+                }))
+                matched.push_back(&entry);
+        }
+        return matched;
+    }
+
+    static void replyLabels(const Series &series, const RangeQuery &query,
+                            detail::Reply &reply) {
+        if (query.selectedLabels.has_value()) {
+            reply.array(query.selectedLabels->size());
+            for (auto &name : *query.selectedLabels) {
+                reply.array(2);
+                reply.bulk(name);
+                if (auto value = series.label(name))
+                    reply.bulk(*value);
+                else
+                    reply.nil();
+            }
+        } else if (query.withLabels) {
+            reply.array(series.labels.size());
+            for (auto &[key, value] : series.labels) {
+                reply.array(2);
+                reply.bulk(key);
+                reply.bulk(value);
+            }
+        } else {
+            reply.array(0);
+        }
+    }
+
+    void mrange(const std::vector<std::string> &args, bool reverse,
+                detail::Reply &reply) {
+        detail::Arguments in{args, 1};
+        auto q = parseRangeQuery(in, true);
+        auto matched = select(q.filter);
+        if (!q.groupBy.has_value()) {
+            q.reverse = reverse;
+            reply.array(matched.size());
+            for (auto *entry : matched) {
+                reply.array(3);
+                reply.bulk(entry->first);
+                replyLabels(entry->second, q, reply);
+                replySamples(query(entry->second, q), reply);
+            }
+            return;
+        }
+
+        // GROUPBY: one reduced series per distinct label value.
+        std::map<std::string, std::vector<decltype(matched)::value_type>>
+            groups;
+        for (auto *entry : matched)
+            if (auto value = entry->second.label(*q.groupBy))
+                groups[*value].push_back(entry);
+        reply.array(groups.size());
+        for (auto &[value, members] : groups) {
+            std::map<uint64_t, aggregation::Accumulator> byTime;
+            std::string sources;
+            for (auto *entry : members) {
+                for (auto [timestamp, v] : query(entry->second, q))
+                    byTime[timestamp].add(v);
+                sources += (sources.empty() ? "" : ",") + entry->first;
+            }
+            Samples reduced;
+            for (auto &[timestamp, accumulator] : byTime)
+                reduced.emplace_back(timestamp, accumulator.value(*q.reduce));
+            if (reverse) std::reverse(reduced.begin(), reduced.end());
+            if (q.count.has_value() && reduced.size() > *q.count)
+                reduced.resize(*q.count);
+
+            reply.array(3);
+            reply.bulk(*q.groupBy + "=" + value);
+            reply.array(3);
+            for (auto [name, text] :
+                 {std::pair<std::string, std::string>{*q.groupBy, value},
+                  {"__reducer__", *q.reduce},
+                  {"__source__", sources}}) {
+                reply.array(2);
+                reply.bulk(name);
+                reply.bulk(text);
+            }
+            replySamples(reduced, reply);
+        }
+    }
+
+    void get(const std::vector<std::string> &args, detail::Reply &reply) {
+        if (args.size() != 2)
+            throw std::invalid_argument("wrong number of arguments");
+        auto &series = existing(args[1]);
+        if (series.samples.empty()) {
+            reply.array(0);
+            return;
+        }
+        auto [timestamp, value] = *series.samples.rbegin();
+        reply.sample(timestamp, value);
+    }
+
+    void mget(const std::vector<std::string> &args, detail::Reply &reply) {
+        detail::Arguments in{args, 1};
+        RangeQuery q;
+        while (!in.done()) {
+            if (in.nextIs("WITHLABELS")) {
+                q.withLabels = true;
+            } else if (in.nextIs("SELECTED_LABELS")) {
+                q.selectedLabels.emplace();
+                while (!in.done() && !isMultiKeyword(peek(in)))
+                    q.selectedLabels->push_back(in.next());
+            } else if (in.nextIs("FILTER")) {
+                while (!in.done())
+                    q.filter.push_back(detail::Matcher::parse(in.next()));
+            } else {
+                throw std::invalid_argument("TSDB: wrong parameters");
+            }
+        }
+        requirePositiveMatcher(q.filter);
+        auto matched = select(q.filter);
+        reply.array(matched.size());
+        for (auto *entry : matched) {
+            reply.array(3);
+            reply.bulk(entry->first);
+            replyLabels(entry->second, q, reply);
+            auto &samples = entry->second.samples;
+            if (samples.empty()) {
+                reply.array(0);
+            } else {
+                auto [timestamp, value] = *samples.rbegin();
+                reply.sample(timestamp, value);
+            }
+        }
+    }
+
+    void info(const std::vector<std::string> &args, detail::Reply &reply) {
+        if (args.size() < 2)
+            throw std::invalid_argument("wrong number of arguments");
+        auto &series = existing(args[1]);
+        auto samples = static_cast<uint64_t>(series.samples.size());
+        // Uncompressed chunks hold 16 bytes per sample; compressed ones are
+        // estimated at 2 bytes per sample.
+        auto bytes = samples * (series.uncompressed ? 16 : 2);
+        auto chunkSize = std::max<uint64_t>(series.chunkSize, 1);
+        auto chunks =
+            std::max<uint64_t>((bytes + chunkSize - 1) / chunkSize, 1);
+        uint64_t first = samples ? series.samples.begin()->first : 0;
+        uint64_t last = samples ? series.samples.rbegin()->first : 0;
+
+        reply.array(24);
+        reply.bulk("totalSamples");
+        reply.integer(static_cast<int64_t>(samples));
+        reply.bulk("memoryUsage");
+        reply.integer(static_cast<int64_t>(chunks * chunkSize + 128));
+        reply.bulk("firstTimestamp");
+        reply.integer(static_cast<int64_t>(first));
+        reply.bulk("lastTimestamp");
+        reply.integer(static_cast<int64_t>(last));
+        reply.bulk("retentionTime");
+        reply.integer(static_cast<int64_t>(series.retention));
+        reply.bulk("chunkCount");
+        reply.integer(static_cast<int64_t>(chunks));
+        reply.bulk("chunkSize");
+        reply.integer(static_cast<int64_t>(series.chunkSize));
+        reply.bulk("chunkType");
+        reply.status(series.uncompressed ? "uncompressed" : "compressed");
+        reply.bulk("duplicatePolicy");
+        if (series.duplicatePolicy.has_value())
+            reply.bulk(*series.duplicatePolicy);
+        else
+            reply.nil();
+        reply.bulk("labels");
+        reply.array(series.labels.size());
+        for (auto &[key, value] : series.labels) {
+            reply.array(2);
+            reply.bulk(key);
+            reply.bulk(value);
+        }
+        reply.bulk("sourceKey");
+        reply.nil();
+        reply.bulk("rules");
+        reply.array(0);
+    }
+
+    void queryIndex(const std::vector<std::string> &args,
+                    detail::Reply &reply) {
+        std::vector<detail::Matcher> filter;
+        for (size_t i = 1; i < args.size(); ++i)
+            filter.push_back(detail::Matcher::parse(args[i]));
+        requirePositiveMatcher(filter);
+        auto matched = select(filter);
+        reply.array(matched.size());
+        for (auto *entry : matched)
+            reply.bulk(entry->first);
+    }
+
+    std::function<uint64_t()> clock_;
+    mutable std::mutex mutex_;
+    std::map<std::string, Series> series_;
+};
+
+struct FakeServerOptions {
+    std::string host = "127.0.0.1";
+    // 0 binds an ephemeral port; see FakeServer::port().
+    uint16_t port = 0;
+    // Delay added once per batch of requests read together, i.e. per
+    // network round trip, so pipelining is rewarded as with a real server.
+    std::chrono::microseconds latency{0};
+    // Uniformly distributed extra delay in [0, jitter] per batch.
+    std::chrono::microseconds jitter{0};
+    // Fraction of commands answered with an injected -ERR reply.
+    double errorRate = 0;
+    // Fraction of commands on which the connection is closed unanswered.
+    double disconnectRate = 0;
+    // Seed of the fault and jitter generator, for reproducible runs.
+    uint64_t seed = 0;
+};
+
+struct FakeServerStats {
+    uint64_t connections{};
+    uint64_t commands{};
+    uint64_t injectedErrors{};
+    uint64_t injectedDisconnects{};
+};
+
+// FakeStore behind a RESP2 TCP listener, one thread per connection.
+class FakeServer {
+  public:
+    explicit FakeServer(FakeServerOptions options = {},
+                        std::function<uint64_t()> clock = {})
+        : options_{std::move(options)}, store_{std::move(clock)},
+          random_{options_.seed} {}
+    FakeServer(const FakeServer &) = delete;
+    FakeServer &operator=(const FakeServer &) = delete;
+    ~FakeServer() { stop(); }
+
+    void start() {
+        if (running_) return;
+        listener_ = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (listener_ < 0) fail("socket");
+        int enable = 1;
+        ::setsockopt(listener_, SOL_SOCKET, SO_REUSEADDR, &enable,
+                     sizeof(enable));
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(options_.port);
+        if (::inet_pton(AF_INET, options_.host.c_str(), &address.sin_addr) !=
+            1)
+            throw std::invalid_argument("Invalid host " + options_.host);
+        if (::bind(listener_, reinterpret_cast<sockaddr *>(&address),
+                   sizeof(address)) != 0)
+            fail("bind");
+        if (::listen(listener_, SOMAXCONN) != 0) fail("listen");
+        socklen_t length = sizeof(address);
+        ::getsockname(listener_, reinterpret_cast<sockaddr *>(&address),
+                      &length);
+        port_ = ntohs(address.sin_port);
+        running_ = true;
+        acceptor_ = std::thread([this] { acceptLoop(); });
+    }
+
+    void stop() {
+        if (!running_.exchange(false)) return;
+        if (acceptor_.joinable()) acceptor_.join();
+        ::close(listener_);
+        std::list<Connection> connections;
+        {
+            std::lock_guard lock{connectionsMutex_};
+            for (auto &connection : connections_)
+                ::shutdown(connection.fd, SHUT_RDWR);
+            connections.swap(connections_);
+        }
+        for (auto &connection : connections) {
+            connection.thread.join();
+            ::close(connection.fd);
+        }
+    }
+
+    uint16_t port() const { return port_; }
+    std::string uri() const {
+        return "tcp://" + options_.host + ":" + std::to_string(port_);
+    }
+
+    FakeStore &store() { return store_; }
+
+    FakeServerStats stats() const {
+        return FakeServerStats{accepted_.load(), commands_.load(),
+                               injectedErrors_.load(),
+                               injectedDisconnects_.load()};
+    }
+
+  private:
+    struct Connection {
+        int fd;
+        std::thread thread;
+        std::atomic<bool> done{false};
+    };
+
+    enum class Fault { NONE, ERROR, DISCONNECT };
+
+    [[noreturn]] void fail(const char *what) {
+        auto error = errno;
+        if (listener_ >= 0) ::close(listener_);
+        throw std::system_error(error, std::generic_category(), what);
+    }
+
+    void acceptLoop() {
+        while (running_) {
+            pollfd ready{listener_, POLLIN, 0};
+            if (::poll(&ready, 1, 50) <= 0) continue;
+            auto fd = ::accept(listener_, nullptr, nullptr);
+            if (fd < 0) continue;
+            int enable = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable,
+                         sizeof(enable));
+            accepted_.fetch_add(1, std::memory_order_relaxed);
+            std::lock_guard lock{connectionsMutex_};
+            // Reap connections whose clients went away.
+            for (auto it = connections_.begin(); it != connections_.end();) {
+                if (it->done) {
+                    it->thread.join();
+                    ::close(it->fd);
+                    it = connections_.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+            auto &connection = connections_.emplace_back();
+            connection.fd = fd;
+            connection.thread =
+                std::thread([this, &connection] { serve(connection); });
+        }
+    }
+
+    Fault drawFault() {
+        if (options_.errorRate <= 0 && options_.disconnectRate <= 0)
+            return Fault::NONE;
+        std::lock_guard lock{randomMutex_};
+        auto draw = std::uniform_real_distribution<double>{0, 1}(random_);
+        if (draw < options_.disconnectRate) return Fault::DISCONNECT;
+        if (draw < options_.disconnectRate + options_.errorRate)
+            return Fault::ERROR;
+        return Fault::NONE;
+    }
+
+    std::chrono::microseconds drawDelay() {
+        auto delay = options_.latency;
+        if (options_.jitter.count() > 0) {
+            std::lock_guard lock{randomMutex_};
+            delay += std::chrono::microseconds{
+                std::uniform_int_distribution<int64_t>{
+                    0, options_.jitter.count()}(random_)};
+        }
+        return delay;
+    }
+
+    static bool sendAll(int fd, const std::string &data) {
+        std::size_t sent = 0;
+        while (sent < data.size()) {
+            auto n = ::send(fd, data.data() + sent, data.size() - sent,
+                            MSG_NOSIGNAL);
+            if (n <= 0) return false;
+            sent += static_cast<std::size_t>(n);
+        }
+        return true;
+    }
+
+    void serve(Connection &connection) {
+        detail::RequestParser parser;
+        std::string out;
+        char buffer[16384];
+        bool open = true;
+        while (open && running_) {
+            auto n = ::recv(connection.fd, buffer, sizeof(buffer), 0);
+            if (n <= 0) break;
+            parser.feed(buffer, static_cast<std::size_t>(n));
+            out.clear();
+            try {
+                while (auto request = parser.next()) {
+                    if (request->empty()) continue;
+                    commands_.fetch_add(1, std::memory_order_relaxed);
+                    auto fault = drawFault();
+                    if (fault == Fault::DISCONNECT) {
+                        injectedDisconnects_.fetch_add(1);
+                        open = false;
+                        break;
+                    }
+                    if (fault == Fault::ERROR) {
+                        injectedErrors_.fetch_add(1);
+                        detail::Reply{out}.error("ERR injected failure");
+                        continue;
+                    }
+                    store_.execute(*request, out);
+                }
+            } catch (const std::runtime_error &error) {
+                detail::Reply{out}.error(std::string{"ERR "} + error.what());
+                open = false;
+            }
+            auto delay = drawDelay();
+            if (delay.count() > 0) std::this_thread::sleep_for(delay);
+            if (!out.empty() && !sendAll(connection.fd, out)) break;
+        }
+        // The descriptor is closed by its owner after join(), so stop()
+        // never shuts down a reused descriptor number.
+        ::shutdown(connection.fd, SHUT_RDWR);
+        connection.done = true;
+    }
+
+    FakeServerOptions options_;
+    FakeStore store_;
+    std::mutex randomMutex_;
+    std::mt19937_64 random_;
+    int listener_{-1};
+    uint16_t port_{0};
+    std::atomic<bool> running_{false};
+    std::thread acceptor_;
+    std::mutex connectionsMutex_;
+    std::list<Connection> connections_;
+    std::atomic<uint64_t> accepted_{0}, commands_{0},
+        injectedErrors_{0}, injectedDisconnects_{0};
+};
+
+} // namespace fake
+
+} // namespace redis_time_series
@@ -0,0 +1,252 @@
+#pragma once
+
+#include "redis_time_series.h"
+#include "redis_time_series_routing.h"
+
+#include <condition_variable>
+#include <functional>
+#include <stop_token>
+#include <thread>
+
+namespace redis_time_series {
+
+namespace hedging {
+
+struct HedgeOptions {
+    // A duplicate is sent once the first attempt has been outstanding longer
+    // than this percentile of recent latencies.
+    double percentile = 0.95;
+    // Hedge delay used until `minSamples` latencies have been observed.
+    std::chrono::microseconds initialDelay{10000};
+    std::chrono::microseconds minDelay{500};
+    std::size_t window = 1024;
+    std::size_t minSamples = 64;
+};
+
+struct HedgeMetrics {
+    uint64_t calls{};
+    uint64_t hedged{};
+    // Calls answered by the duplicate rather than the first attempt.
+    uint64_t hedgeWins{};
+    uint64_t deadlineExceeded{};
+    uint64_t cancelled{};
+};
+
+// Sliding window of reply latencies, used to derive the hedge delay.
+class LatencyTracker {
+  public:
+    explicit LatencyTracker(std::size_t window) : samples_(window) {}
+
+    void record(std::chrono::microseconds latency) {
+        std::lock_guard lock{mutex_};
+        samples_[next_++ % samples_.size()] = latency;
+        count_ = std::min(count_ + 1, samples_.size());
+    }
+
+    std::size_t count() const {
+        std::lock_guard lock{mutex_};
+        return count_;
+    }
+
+    std::chrono::microseconds percentile(double p) const {
+        std::vector<std::chrono::microseconds> sorted;
+        {
+            std::lock_guard lock{mutex_};
+            sorted.assign(samples_.begin(), samples_.begin() + count_);
+        }
+        if (sorted.empty()) return std::chrono::microseconds{0};
+        auto rank = static_cast<std::size_t>(
+            std::clamp(p, 0.0, 1.0) * static_cast<double>(sorted.size() - 1));
+        std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+        return sorted[rank];
+    }
+
+  private:
+    mutable std::mutex mutex_;
+    std::vector<std::chrono::microseconds> samples_;
+    std::size_t next_{0};
+    std::size_t count_{0};
+};
+
+// Issues idempotent reads with an opt-in hedge: when the first attempt has
+// not answered within the adaptive delay, the same read is sent through the
+// next endpoint and whichever reply arrives first is returned. An attempt
+// that fails before the hedge point triggers the duplicate immediately.
+//
+// Each attempt runs on its own detached thread so a slow attempt can be
+// abandoned; its late reply is discarded. The endpoints must therefore
+// outlive every call, including abandoned attempts. Listing one
+// sw::redis::Redis twice hedges onto another connection of its pool.
+class HedgedReader {
+    struct Shared {
+        explicit Shared(const HedgeOptions &options)
+            : latencies{options.window} {}
+
+        LatencyTracker latencies;
+        std::atomic<uint64_t> calls{0}, hedged{0}, hedgeWins{0},
+            deadlineExceeded{0}, cancelled{0};
+    };
+
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    HedgedReader(std::vector<sw::redis::Redis *> endpoints,
+                 const HedgeOptions &options = {})
+        : endpoints_{std::move(endpoints)}, options_{options},
+          shared_{std::make_shared<Shared>(options)} {
+        if (endpoints_.empty()) {
+            throw std::invalid_argument("At least one endpoint is required");
+        }
+    }
+
+    // Current hedge delay.
+    std::chrono::microseconds hedgeDelay() const {
+        if (shared_->latencies.count() < options_.minSamples)
+            return options_.initialDelay;
+        return std::max(options_.minDelay,
+                        shared_->latencies.percentile(options_.percentile));
+    }
+
+    HedgeMetrics metrics() const {
+        return HedgeMetrics{shared_->calls.load(), shared_->hedged.load(),
+                            shared_->hedgeWins.load(),
+                            shared_->deadlineExceeded.load(),
+                            shared_->cancelled.load()};
+    }
+
+    // Runs `query` (which must only read) with hedging. Throws
+    // sw::redis::TimeoutError when `deadline` passes and std::runtime_error
+    // when `stop` is requested before a reply arrived.
+    template <typename Result>
+    Result read(std::function<Result(sw::redis::Redis *)> query,
+                std::optional<Clock::time_point> deadline = std::nullopt,
+                std::stop_token stop = {}) {
+        auto race = std::make_shared<Race<Result>>();
+        auto shared = shared_;
+        shared->calls.fetch_add(1, std::memory_order_relaxed);
+        auto first = next_.fetch_add(1, std::memory_order_relaxed);
+        auto launch = [&](std::size_t attempt) {
+            auto *db = endpoints_[(first + attempt) % endpoints_.size()];
+            std::lock_guard lock{race->mutex};
+            ++race->pending;
+            std::thread([race, shared, query, db, attempt] {
+                auto start = Clock::now();
+                try {
+                    auto result = query(db);
+                    shared->latencies.record(
+                        std::chrono::duration_cast<std::chrono::microseconds>(
+                            Clock::now() - start));
+                    std::lock_guard lock{race->mutex};
+                    if (!race->result.has_value()) {
+                        race->result.emplace(std::move(result));
+                        race->winner = attempt;
+                    }
+                    --race->pending;
+                } catch (...) {
+                    std::lock_guard lock{race->mutex};
+                    if (!race->error) race->error = std::current_exception();
+                    --race->pending;
+                }
+                race->ready.notify_all();
+            }).detach();
+        };
+
+        std::stop_callback onStop{stop, [race] {
+                                      std::lock_guard lock{race->mutex};
+                                      race->stopped = true;
+                                      race->ready.notify_all();
+                                  }};
+        auto hedgeAt = Clock::now() + hedgeDelay();
+        launch(0);
+        bool hedged = false;
+
+        std::unique_lock lock{race->mutex};
+        while (true) {
+            if (race->result.has_value()) break;
+            if (race->stopped) {
+                shared->cancelled.fetch_add(1, std::memory_order_relaxed);
+                throw std::runtime_error("Read cancelled");
+            }
+            auto now = Clock::now();
+            if (deadline.has_value() && now >= *deadline) {
+                shared->deadlineExceeded.fetch_add(1,
+                                                   std::memory_order_relaxed);
+                throw sw::redis::TimeoutError("Read deadline exceeded");
+            }
+            if (race->pending == 0) {
+                if (hedged) std::rethrow_exception(race->error);
+                now = hedgeAt;
+            }
+            if (!hedged && now >= hedgeAt) {
+                hedged = true;
+                shared->hedged.fetch_add(1, std::memory_order_relaxed);
+                lock.unlock();
+                launch(1);
+                lock.lock();
+                continue;
+            }
+            auto wakeAt = hedged ? Clock::time_point::max() : hedgeAt;
+            if (deadline.has_value()) wakeAt = std::min(wakeAt, *deadline);
+            if (wakeAt == Clock::time_point::max())
+                race->ready.wait(lock);
+            else
+                race->ready.wait_until(lock, wakeAt);
+        }
+        if (race->winner != 0)
+            shared->hedgeWins.fetch_add(1, std::memory_order_relaxed);
+        return std::move(*race->result);
+    }
+
+    // Raw command variant. Commands that are not read-only are sent once,
+    // without hedging, through the first endpoint.
+    template <typename Input>
+    sw::redis::ReplyUPtr
+    command(Input first, Input last,
+            std::optional<Clock::time_point> deadline = std::nullopt,
+            std::stop_token stop = {}) {
+        if (first == last) throw std::invalid_argument("Empty command");
+        if (!routing::isReadOnly(std::string_view{*first}))
+            return endpoints_.front()->command(first, last);
+        std::vector<std::string> args(first, last);
+        return read<sw::redis::ReplyUPtr>(
+            [args = std::move(args)](sw::redis::Redis *db) {
+                return db->command(args.begin(), args.end());
+            },
+            deadline, stop);
+    }
+
+    // Hedged client::timeSeriesRange.
+    std::vector<TimeSeriesTuple>
+    timeSeriesRange(const std::string &key, const TimeStamp &fromTimeStamp,
+                    const TimeStamp &toTimeStamp,
+                    std::optional<Clock::time_point> deadline = std::nullopt,
+                    std::stop_token stop = {}) {
+        return read<std::vector<TimeSeriesTuple>>(
+            [key, fromTimeStamp, toTimeStamp](sw::redis::Redis *db) {
+                return client::timeSeriesRange(db, key, fromTimeStamp,
+                                               toTimeStamp);
+            },
+            deadline, stop);
+    }
+
+  private:
+    template <typename Result>
+    struct Race {
+        std::mutex mutex;
+        std::condition_variable ready;
+        std::optional<Result> result;
+        std::exception_ptr error;
+        std::size_t pending{0};
+        std::size_t winner{0};
+        bool stopped{false};
+    };
+
+    std::vector<sw::redis::Redis *> endpoints_;
+    HedgeOptions options_;
+    std::shared_ptr<Shared> shared_;
+    std::atomic<std::size_t> next_{0};
+};
+
+} // namespace hedging
+
+} // namespace redis_time_series
@@ -0,0 +1,222 @@
+#pragma once
+
+#include "redis_time_series.h"
+
+#include <cstring>
+#include <span>
+
+namespace redis_time_series {
+
+// ISO-8601 / RFC 3339 timestamps in the fixed layouts historians export:
+//
+//   YYYY-MM-DD
+//   YYYY-MM-DDTHH:MM:SS[.fraction][Z|+HH:MM|-HH:MM|+HHMM|+HH]
+//
+// `T` may also be `t` or a space. Digits beyond milliseconds are truncated.
+// A timestamp without an offset is taken as UTC. Parsing touches neither
+// the locale nor the TZ environment, so it is safe from any thread.
+namespace iso8601 {
+
+namespace detail {
+
+constexpr uint64_t kOnes = 0x0101010101010101;
+
+inline uint64_t load8(const char *p) {
+    uint64_t word;
+    std::memcpy(&word, p, sizeof(word));
+    if constexpr (std::endian::native == std::endian::big) {
+        uint64_t swapped = 0;
+        for (int i = 0; i < 8; ++i)
+            swapped |= ((word >> (8 * i)) & 0xFF) << (8 * (7 - i));
+        word = swapped;
+    }
+    return word;
+}
+
+// Checks the 8 bytes of `word` in one go: bytes selected by `digits` must
+// be '0'..'9' and all other bytes must equal those of `pattern`. Returns
+// the digit values (separators zeroed) or nullopt.
+inline std::optional<uint64_t> digitsAndSeparators(uint64_t word,
+                                                   uint64_t digits,
+                                                   uint64_t pattern) {
+    constexpr uint64_t high = 0xF0 * kOnes;
+    auto nibbles = (word & high) | (((word + 0x06 * kOnes) & high) >> 4);
+    if ((nibbles & digits) != (0x33 * kOnes & digits)) return std::nullopt;
+    if ((word & ~digits) != (pattern & ~digits)) return std::nullopt;
+    return (word - (0x30 * kOnes & digits)) & digits;
+}
+
+// Byte i of the result is 10 * digit[i] + digit[i + 1].
+inline uint64_t pairs(uint64_t digits) { return digits * 10 + (digits >> 8); }
+
+inline unsigned byteAt(uint64_t word, int i) {
+    return static_cast<unsigned>((word >> (8 * i)) & 0xFF);
+}
+
+inline bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+inline unsigned twoDigits(const char *p) {
+    return static_cast<unsigned>(p[0] - '0') * 10 +
+           static_cast<unsigned>(p[1] - '0');
+}
+
+// Days since 1970-01-01 of a proleptic Gregorian date (H. Hinnant).
+constexpr int64_t daysFromCivil(int64_t y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    auto era = (y >= 0 ? y : y - 399) / 400;
+    auto yoe = static_cast<unsigned>(y - era * 400);
+    auto doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    auto doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<int64_t>(doe) - 719468;
+}
+
+constexpr unsigned daysInMonth(unsigned year, unsigned month) {
+    constexpr unsigned days[] = {31, 28, 31, 30, 31, 30,
+                                 31, 31, 30, 31, 30, 31};
+    bool leap = year % 4 == 0 && (year % 100 != 0 || year % 400 == 0);
+    return month == 2 && leap ? 29 : days[month - 1];
+}
+
+// Parses "[+-]HH[[:]MM]" or "Z" into minutes east of UTC.
+inline std::optional<int> parseOffset(std::string_view text) {
+    if (text == "Z" || text == "z") return 0;
+    if (text.size() < 3 || (text[0] != '+' && text[0] != '-'))
+        return std::nullopt;
+    auto sign = text[0] == '-' ? -1 : 1;
+    text.remove_prefix(1);
+    if (!isDigit(text[0]) || !isDigit(text[1])) return std::nullopt;
+    auto hours = twoDigits(text.data());
+    text.remove_prefix(2);
+    unsigned minutes = 0;
+    if (!text.empty()) {
+        if (text[0] == ':') text.remove_prefix(1);
+        if (text.size() != 2 || !isDigit(text[0]) || !isDigit(text[1]))
+            return std::nullopt;
+        minutes = twoDigits(text.data());
+    }
+    if (hours > 23 || minutes > 59) return std::nullopt;
+    return sign * static_cast<int>(hours * 60 + minutes);
+}
+
+} // namespace detail
+
+// Epoch milliseconds of `text`, or nullopt if it is not one of the accepted
+// layouts, names an invalid date or time, or lies before 1970.
+inline std::optional<uint64_t> tryParse(std::string_view text) {
+    using namespace detail;
+    if (text.size() < 10) return std::nullopt;
+
+    // "YYYY-MM-" as one word; the day is read on its own.
+    auto date = digitsAndSeparators(load8(text.data()), 0x00FFFF00FFFFFFFF,
+                                    0x2D00002D00000000);
+    if (!date.has_value() || !isDigit(text[8]) || !isDigit(text[9]))
+        return std::nullopt;
+    auto p = pairs(*date);
+    unsigned year = byteAt(p, 0) * 100 + byteAt(p, 2);
+    unsigned month = byteAt(p, 5);
+    unsigned day = twoDigits(text.data() + 8);
+    unsigned hour = 0, minute = 0, second = 0, millis = 0;
+    int offset = 0;
+    if (text.size() > 10) {
+        if (text.size() < 19) return std::nullopt;
+        auto separator = text[10];
+        if (separator != 'T' && separator != 't' && separator != ' ')
+            return std::nullopt;
+        auto time = digitsAndSeparators(load8(text.data() + 11),
+                                        0xFFFF00FFFF00FFFF,
+                                        0x00003A00003A0000);
+        if (!time.has_value()) return std::nullopt;
+        auto t = pairs(*time);
+        hour = byteAt(t, 0);
+        minute = byteAt(t, 3);
+        second = byteAt(t, 6);
+
+        auto rest = text.substr(19);
+        if (!rest.empty() && (rest[0] == '.' || rest[0] == ',')) {
+            std::size_t i = 1;
+            unsigned scale = 100;
+            for (; i < rest.size() && isDigit(rest[i]); ++i) {
+                millis += static_cast<unsigned>(rest[i] - '0') * scale;
+                scale /= 10;
+            }
+            if (i == 1) return std::nullopt;
+            rest.remove_prefix(i);
+        }
+        if (!rest.empty()) {
+            auto parsed = parseOffset(rest);
+            if (!parsed.has_value()) return std::nullopt;
+            offset = *parsed;
+        }
+        // 60 is a leap second; it is folded into the next minute.
+        if (hour > 23 || minute > 59 || second > 60) return std::nullopt;
+    }
+    if (month < 1 || month > 12 || day < 1 || day > daysInMonth(year, month))
+        return std::nullopt;
+
+    auto seconds = daysFromCivil(year, month, day) * 86400 +
+                   static_cast<int64_t>(hour * 3600 + minute * 60 + second) -
+                   static_cast<int64_t>(offset) * 60;
+    if (seconds < 0) return std::nullopt;
+    return static_cast<uint64_t>(seconds) * 1000 + millis;
+}
+
+inline uint64_t parse(std::string_view text) {
+    auto value = tryParse(text);
+    if (!value.has_value()) {
+        throw std::invalid_argument(
+            fmt::format("Invalid ISO-8601 timestamp: {}", text));
+    }
+    return *value;
+}
+
+inline TimeStamp parseTimeStamp(std::string_view text) {
+    return TimeStamp{parse(text)};
+}
+
+namespace detail {
+
+template <typename String>
+void parseEach(std::span<const String> input, std::span<uint64_t> output) {
+    if (output.size() < input.size()) {
+        throw std::invalid_argument("Output span is shorter than input");
+    }
+    for (size_t i = 0; i < input.size(); ++i) {
+        auto value = tryParse(input[i]);
+        if (!value.has_value()) {
+            throw std::invalid_argument(fmt::format(
+                "Invalid ISO-8601 timestamp at {}: {}", i, input[i]));
+        }
+        output[i] = *value;
+    }
+}
+
+} // namespace detail
+
+// Converts `input` into epoch milliseconds in `output`, which must be at
+// least as long. Throws std::invalid_argument naming the first bad entry.
+inline void parseBatch(std::span<const std::string_view> input,
+                       std::span<uint64_t> output) {
+    detail::parseEach(input, output);
+}
+
+inline void parseBatch(std::span<const std::string> input,
+                       std::span<uint64_t> output) {
+    detail::parseEach(input, output);
+}
+
+inline std::vector<uint64_t>
+parseBatch(std::span<const std::string_view> input) {
+    std::vector<uint64_t> output(input.size());
+    detail::parseEach(input, std::span<uint64_t>{output});
+    return output;
+}
+
+inline std::vector<uint64_t> parseBatch(std::span<const std::string> input) {
+    std::vector<uint64_t> output(input.size());
+    detail::parseEach(input, std::span<uint64_t>{output});
+    return output;
+}
+
+} // namespace iso8601
+
+} // namespace redis_time_series
@@ -0,0 +1,340 @@
+#pragma once
+
+#include "redis_time_series.h"
+
+#include <condition_variable>
+#include <thread>
+#include <utility>
+
+namespace redis_time_series {
+
+namespace cache {
+
+struct LastValue {
+    uint64_t timestamp;
+    double value;
+
+    friend bool operator==(const LastValue &lhs, const LastValue &rhs) {
+        return lhs.timestamp == rhs.timestamp && lhs.value == rhs.value;
+    }
+};
+
+// Fixed set of (timestamp, value) slots, each guarded by a sequence lock.
+// Readers never block or write shared memory; they retry while a store is
+// in progress. Stores must be serialised by the caller.
+class LastValueTable {
+  public:
+    explicit LastValueTable(std::size_t size) : slots_(size) {}
+
+    std::size_t size() const { return slots_.size(); }
+
+    void store(std::size_t slot, std::optional<LastValue> value) {
+        auto &s = slots_[slot];
+        auto seq = s.seq.load(std::memory_order_relaxed);
+        s.seq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        s.timestamp.store(value ? value->timestamp : kAbsent,
+                          std::memory_order_relaxed);
+        s.value.store(value ? std::bit_cast<uint64_t>(value->value) : 0,
+                      std::memory_order_relaxed);
+        s.seq.store(seq + 2, std::memory_order_release);
+    }
+
+    std::optional<LastValue> load(std::size_t slot) const {
+        auto &s = slots_[slot];
+        while (true) {
+            auto before = s.seq.load(std::memory_order_acquire);
+            if (before & 1) continue;
+            auto timestamp = s.timestamp.load(std::memory_order_relaxed);
+            auto bits = s.value.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (s.seq.load(std::memory_order_relaxed) != before) continue;
+            if (timestamp == kAbsent) return std::nullopt;
+            return LastValue{timestamp, std::bit_cast<double>(bits)};
+        }
+    }
+
+  private:
+    static constexpr uint64_t kAbsent = std::numeric_limits<uint64_t>::max();
+
+    // One cache line per slot so readers of different keys do not share
+    // lines with the writer.
+    struct alignas(64) Slot {
+        std::atomic<uint32_t> seq{0};
+        std::atomic<uint64_t> timestamp{kAbsent};
+        std::atomic<uint64_t> value{0};
+    };
+
+    std::vector<Slot> slots_;
+};
+
+struct LastValueCacheOptions {
+    // Database whose keyspace channel is followed.
+    int db = 0;
+    // TS.GET commands per pipeline round trip.
+    std::size_t batchSize = 512;
+    // Least time between two rounds of TS.GET. Every write to a key within
+    // one interval costs a single read, so reads are bounded by the tracked
+    // keys per interval instead of following the write rate. Zero reads
+    // after every notification.
+    std::chrono::milliseconds refreshInterval{10};
+    // Adds the `K`, `g` (generic, for DEL) and `d` (module) classes to
+    // notify-keyspace-events when they are missing. Without them the server
+    // publishes nothing.
+    bool configureNotifications = false;
+    // Pause before re-subscribing after the subscriber connection fails.
+    std::chrono::milliseconds reconnectDelay{500};
+};
+
+// Latest sample of a fixed set of keys, kept current by keyspace
+// notifications instead of polling. A notification for a tracked key marks
+// it dirty; once per refreshInterval an updater thread fetches the dirty
+// keys with pipelined TS.GET and publishes them in a LastValueTable, so
+// get() is a local memory read.
+// After the subscriber reconnects, every key is re-read, since writes made
+// while it was down were not announced.
+class LastValueCache {
+  public:
+    LastValueCache(sw::redis::Redis *db, std::vector<std::string> keys,
+                   LastValueCacheOptions options = {})
+        : db_{db}, keys_{std::move(keys)}, options_{options},
+          table_{keys_.size()}, dirty_(keys_.size()),
+          channelPrefix_{fmt::format("__keyspace@{}__:", options.db)},
+          controlChannel_{fmt::format(
+              "__last_value_cache__:{}",
+              reinterpret_cast<std::uintptr_t>(this))} {
+        for (size_t i = 0; i < keys_.size(); ++i)
+            slots_.emplace(keys_[i], i);
+    }
+    LastValueCache(const LastValueCache &) = delete;
+    LastValueCache &operator=(const LastValueCache &) = delete;
+    ~LastValueCache() { stop(); }
+
+    // Subscribes, loads every key once and starts the background threads.
+    void start() {
+        if (running_.exchange(true)) return;
+        if (options_.configureNotifications) configureNotifications();
+        subscribed_ = false;
+        subscriber_ = std::thread([this] { subscribeLoop(); });
+        {
+            // Load only after the subscription is live so no write falls
+            // between the snapshot and the first notification.
+            std::unique_lock lock{mutex_};
+            wake_.wait(lock, [this] { return subscribed_ || !running_; });
+        }
+        resync();
+        updater_ = std::thread([this] { updateLoop(); });
+    }
+
+    void stop() {
+        if (!running_.exchange(false)) return;
+        try {
+            db_->command("PUBLISH", controlChannel_, "stop");
+        } catch (const sw::redis::Error &) {
+            // The subscriber notices running_ on its next reconnect attempt.
+        }
+        {
+            // Taken so a thread between its predicate check and wait()
+            // cannot miss the wake-up.
+            std::lock_guard lock{mutex_};
+        }
+        wake_.notify_all();
+        if (subscriber_.joinable()) subscriber_.join();
+        if (updater_.joinable()) updater_.join();
+    }
+
+    std::optional<std::size_t> slotOf(std::string_view key) const {
+        auto it = slots_.find(std::string{key});
+        if (it == slots_.end()) return std::nullopt;
+        return it->second;
+    }
+
+    std::optional<LastValue> get(std::size_t slot) const {
+        return table_.load(slot);
+    }
+
+    std::optional<LastValue> get(std::string_view key) const {
+        auto slot = slotOf(key);
+        if (!slot.has_value()) return std::nullopt;
+        return table_.load(*slot);
+    }
+
+    // Re-reads every tracked key.
+    void resync() {
+        std::vector<std::size_t> all(keys_.size());
+        for (size_t i = 0; i < all.size(); ++i)
+            all[i] = i;
+        refresh(all);
+        resyncs_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    uint64_t notifications() const { return notifications_.load(); }
+    uint64_t resyncs() const { return resyncs_.load(); }
+    // TS.GET commands sent, resyncs included.
+    uint64_t reads() const { return reads_.load(); }
+
+  private:
+    static bool isWriteEvent(std::string_view event) {
+        return event == "ts.add" || event == "ts.madd" ||
+               event == "ts.incrby" || event == "ts.decrby" ||
+               event == "ts.del" || event == "del";
+    }
+
+    void configureNotifications() {
+        auto reply = db_->command("CONFIG", "GET", "notify-keyspace-events");
+        std::string flags;
+        if (reply->type == REDIS_REPLY_ARRAY && reply->elements == 2)
+            flags = parser::parseStringView(*reply->element[1]);
+        bool all = flags.find('A') != std::string::npos;
+        if (flags.find('K') == std::string::npos) flags += 'K';
+        if (flags.find('g') == std::string::npos && !all) flags += 'g';
+        if (flags.find('d') == std::string::npos && !all) flags += 'd';
+        db_->command("CONFIG", "SET", "notify-keyspace-events", flags);
+    }
+
+    void onNotification(std::string_view channel, std::string_view event) {
+        if (channel.substr(0, channelPrefix_.size()) != channelPrefix_)
+            return;
+        if (!isWriteEvent(event)) return;
+        auto slot = slotOf(channel.substr(channelPrefix_.size()));
+        if (!slot.has_value()) return;
+        notifications_.fetch_add(1, std::memory_order_relaxed);
+        if (dirty_[*slot].exchange(true)) return;
+        std::lock_guard lock{mutex_};
+        pending_.push_back(*slot);
+        wake_.notify_all();
+    }
+
+    void subscribeLoop() {
+        bool reconnected = false;
+        while (running_) {
+            try {
+                auto subscriber = db_->subscriber();
+                subscriber.on_pmessage([this](std::string, std::string channel,
+                                              std::string event) {
+                    onNotification(channel, event);
+                });
+                subscriber.on_message([](std::string, std::string) {});
+                subscriber.psubscribe(channelPrefix_ + "*");
+                subscriber.subscribe(controlChannel_);
+                // Consume the two subscribe confirmations.
+                subscriber.consume();
+                subscriber.consume();
+                {
+                    std::lock_guard lock{mutex_};
+                    subscribed_ = true;
+                }
+                wake_.notify_all();
+                if (reconnected) requestResync();
+                while (running_) {
+                    try {
+                        subscriber.consume();
+                    } catch (const sw::redis::TimeoutError &) {
+                    }
+                }
+            } catch (const sw::redis::Error &) {
+                reconnected = true;
+                std::unique_lock lock{mutex_};
+                wake_.wait_for(lock, options_.reconnectDelay,
+                               [this] { return !running_; });
+            }
+        }
+        std::lock_guard lock{mutex_};
+        subscribed_ = true;
+        wake_.notify_all();
+    }
+
+    void requestResync() {
+        std::lock_guard lock{mutex_};
+        resyncRequested_ = true;
+        wake_.notify_all();
+    }
+
+    void updateLoop() {
+        auto nextRound = std::chrono::steady_clock::now();
+        while (true) {
+            std::vector<std::size_t> batch;
+            bool resyncAll = false;
+            {
+                std::unique_lock lock{mutex_};
+                wake_.wait(lock, [this] {
+                    return !running_ || resyncRequested_ || !pending_.empty();
+                });
+                // Let further writes to the dirty keys gather until the
+                // round is due; they are read once.
+                wake_.wait_until(lock, nextRound, [this] { return !running_; });
+                if (!running_) return;
+                resyncAll = std::exchange(resyncRequested_, false);
+                batch.swap(pending_);
+            }
+            nextRound =
+                std::chrono::steady_clock::now() + options_.refreshInterval;
+            for (auto slot : batch)
+                dirty_[slot].store(false);
+            try {
+                if (resyncAll)
+                    resync();
+                else
+                    refresh(batch);
+            } catch (const sw::redis::Error &) {
+                // Retry the whole table once the connection is back.
+                requestResync();
+                std::unique_lock lock{mutex_};
+                wake_.wait_for(lock, options_.reconnectDelay,
+                               [this] { return !running_; });
+            }
+        }
+    }
+
+    // Fetches `slots` with pipelined TS.GET and publishes the results.
+    void refresh(const std::vector<std::size_t> &slots) {
+        std::lock_guard writer{writeMutex_};
+        auto batchSize = std::max<std::size_t>(options_.batchSize, 1);
+        for (size_t i = 0; i < slots.size(); i += batchSize) {
+            auto last = std::min(i + batchSize, slots.size());
+            auto pipeline = db_->pipeline(false);
+            for (auto j = i; j < last; ++j)
+                pipeline.command(command::GET, keys_[slots[j]]);
+            auto replies = pipeline.exec();
+            reads_.fetch_add(last - i, std::memory_order_relaxed);
+            for (auto j = i; j < last; ++j) {
+                std::optional<LastValue> value;
+                try {
+                    auto sample = parser::parseSample(replies.get(j - i));
+                    if (sample.time().hasValue())
+                        value = LastValue{sample.time().value(),
+                                          sample.value()};
+                } catch (const sw::redis::ReplyError &) {
+                    // Missing key: no last value.
+                }
+                table_.store(slots[j], value);
+            }
+        }
+    }
+
+    sw::redis::Redis *db_;
+    std::vector<std::string> keys_;
+    LastValueCacheOptions options_;
+    std::unordered_map<std::string, std::size_t> slots_;
+    LastValueTable table_;
+    std::vector<std::atomic<bool>> dirty_;
+    std::string channelPrefix_;
+    std::string controlChannel_;
+
+    std::atomic<bool> running_{false};
+    std::atomic<uint64_t> notifications_{0};
+    std::atomic<uint64_t> resyncs_{0};
+    std::atomic<uint64_t> reads_{0};
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::vector<std::size_t> pending_;
+    bool subscribed_{false};
+    bool resyncRequested_{false};
+    std::mutex writeMutex_;
+    std::thread subscriber_;
+    std::thread updater_;
+};
+
+} // namespace cache
+
+} // namespace redis_time_series
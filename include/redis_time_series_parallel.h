@@ -0,0 +1,145 @@
+#pragma once
+
+#include "redis_time_series.h"
+
+#include <functional>
+#include <future>
+
+namespace redis_time_series {
+
+namespace parallel {
+
+// Inclusive [from, to] time slice of a split range query.
+struct RangeSlice {
+    uint64_t from;
+    uint64_t to;
+
+    friend bool operator==(const RangeSlice &lhs, const RangeSlice &rhs) {
+        return lhs.from == rhs.from && lhs.to == rhs.to;
+    }
+};
+
+struct SplitRangeOptions {
+    // Upper bound on concurrent slices, usually the number of pooled
+    // connections across all endpoints.
+    std::size_t maxSlices = 8;
+    // Ranges expected to hold fewer samples than this per slice are split
+    // into fewer slices; a small range is fetched with one TS.RANGE.
+    uint64_t minSamplesPerSlice = 100000;
+};
+
+// Splits [from, to] into slices of roughly equal sample count. Density is
+// taken as uniform between the series' first and last timestamp, so the
+// expected count of the range is totalSamples scaled by its overlap with the
+// stored interval. The split points fall inside that interval; the outer
+// slices still reach out to `from` and `to` so samples written after TS.INFO
+// are not lost.
+inline std::vector<RangeSlice> planSlices(uint64_t from, uint64_t to,
+                                          const TimeSeriesInformation &info,
+                                          const SplitRangeOptions &options) {
+    if (from > to) return {};
+    if (info.totalSamples() == 0) return {RangeSlice{from, to}};
+    auto first = info.firstTimeStamp().value();
+    auto last = info.lastTimeStamp().value();
+    auto requestedFrom = from, requestedTo = to;
+    from = std::max(from, first);
+    to = std::min(to, last);
+    if (from > to) return {RangeSlice{requestedFrom, requestedTo}};
+
+    auto stored = static_cast<double>(last - first) + 1;
+    auto requested = static_cast<double>(to - from) + 1;
+    auto expected = static_cast<double>(info.totalSamples()) *
+                    std::min(1.0, requested / stored);
+    auto wanted = static_cast<uint64_t>(
+        expected / static_cast<double>(std::max<uint64_t>(
+                       options.minSamplesPerSlice, 1)));
+    uint64_t maxSlices = std::max<std::size_t>(options.maxSlices, 1);
+    auto count = std::clamp<uint64_t>(wanted, 1, maxSlices);
+    count = std::min<uint64_t>(count, to - from + 1);
+
+    std::vector<RangeSlice> slices;
+    slices.reserve(count);
+    auto span = to - from + 1;
+    for (uint64_t i = 0; i < count; ++i) {
+        auto begin = from + span / count * i + std::min(i, span % count);
+        auto width = span / count + (i < span % count ? 1 : 0);
+        slices.push_back(RangeSlice{begin, begin + width - 1});
+    }
+    slices.front().from = requestedFrom;
+    slices.back().to = requestedTo;
+    return slices;
+}
+
+// Fetches the slices of `key` concurrently and hands each one to `onSlice`
+// in time order, as soon as it and all earlier slices have arrived. Slice i
+// is read through endpoints[i % endpoints.size()]; an endpoint may be the
+// primary or a replica, and each sw::redis::Redis serves concurrent slices
+// from its own connection pool, so its pool size bounds the parallelism.
+// An error from any slice is rethrown after the in-flight slices finish.
+inline void
+rangeSlices(const std::vector<sw::redis::Redis *> &endpoints,
+            const std::string &key, const std::vector<RangeSlice> &slices,
+            const std::function<void(const RangeSlice &, TimeSeriesColumns &)>
+                &onSlice) {
+    if (endpoints.empty()) {
+        throw std::invalid_argument("At least one endpoint is required");
+    }
+    std::vector<std::future<TimeSeriesColumns>> pending;
+    pending.reserve(slices.size());
+    for (size_t i = 0; i < slices.size(); ++i) {
+        auto *db = endpoints[i % endpoints.size()];
+        auto slice = slices[i];
+        pending.push_back(std::async(std::launch::async, [db, &key, slice] {
+            TimeSeriesColumns columns;
+            client::timeSeriesRangeColumns(db, key, TimeStamp{slice.from},
+                                           TimeStamp{slice.to}, columns);
+            return columns;
+        }));
+    }
+    for (size_t i = 0; i < pending.size(); ++i) {
+        auto columns = pending[i].get();
+        onSlice(slices[i], columns);
+    }
+}
+
+// Streaming parallel TS.RANGE: plans slices from TS.INFO and delivers them in
+// order through `onSlice`.
+inline void timeSeriesParallelRange(
+    const std::vector<sw::redis::Redis *> &endpoints, const std::string &key,
+    uint64_t from, uint64_t to,
+    const std::function<void(const RangeSlice &, TimeSeriesColumns &)>
+        &onSlice,
+    const SplitRangeOptions &options = {}) {
+    if (endpoints.empty()) {
+        throw std::invalid_argument("At least one endpoint is required");
+    }
+    auto info = client::timeSeriesInfo(endpoints.front(), key);
+    rangeSlices(endpoints, key, planSlices(from, to, info, options), onSlice);
+}
+
+// Parallel TS.RANGE stitched into one columnar result.
+inline TimeSeriesColumns
+timeSeriesParallelRange(const std::vector<sw::redis::Redis *> &endpoints,
+                        const std::string &key, uint64_t from, uint64_t to,
+                        const SplitRangeOptions &options = {}) {
+    TimeSeriesColumns result;
+    std::vector<TimeSeriesColumns> parts;
+    timeSeriesParallelRange(
+        endpoints, key, from, to,
+        [&parts](const RangeSlice &, TimeSeriesColumns &columns) {
+            parts.push_back(std::move(columns));
+        },
+        options);
+
+    std::size_t total = 0;
+    for (auto &part : parts)
+        total += part.size();
+    result.reserve(total);
+    for (auto &part : parts)
+        result.append(part);
+    return result;
+}
+
+} // namespace parallel
+
+} // namespace redis_time_series
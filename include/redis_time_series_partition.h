@@ -0,0 +1,272 @@
+#pragma once
+
+#include "redis_time_series.h"
+
+#include <future>
+#include <map>
+#include <set>
+
+namespace redis_time_series {
+
+namespace partition {
+
+// Labels added to every physical partition so partitions can be found with
+// TS.QUERYINDEX and regrouped after TS.MRANGE.
+constexpr char LOGICAL_LABEL[] = "__logical__";
+constexpr char PARTITION_LABEL[] = "__partition__";
+
+struct PartitionOptions {
+    // Time span covered by one physical key, e.g. one day or one week.
+    std::chrono::milliseconds width{std::chrono::hours{24}};
+    // Wraps the partition start in a hash tag ("key:{start}") so the same
+    // period of every series maps to one cluster slot and multi-key
+    // commands over that period stay on one shard. Without it partitions
+    // are spread by their full key name.
+    bool hashTag = false;
+    // When set, each partition expires on its own (PEXPIREAT) once its end
+    // is older than this, so retention costs one key drop per partition.
+    // Assumes sample timestamps are epoch milliseconds.
+    std::optional<std::chrono::milliseconds> retention;
+    std::optional<uint64_t> chunkSize;
+    std::optional<command_operator::TsDuplicatePolicy> duplicatePolicy;
+    // Partitions fetched by one TS.RANGE/TS.MRANGE worker.
+    std::size_t partitionsPerRequest = 16;
+};
+
+inline uint64_t partitionStart(uint64_t timestamp,
+                               const PartitionOptions &options) {
+    auto width = static_cast<uint64_t>(options.width.count());
+    if (width == 0) throw std::invalid_argument("Partition width is zero");
+    return timestamp - timestamp % width;
+}
+
+inline std::string physicalKey(const std::string &logicalKey, uint64_t start,
+                               const PartitionOptions &options) {
+    if (options.hashTag) return fmt::format("{}:{{{}}}", logicalKey, start);
+    return fmt::format("{}:{}", logicalKey, start);
+}
+
+// Partition start encoded in a physical key name, or nullopt for a key that
+// is not a partition.
+inline std::optional<uint64_t> parsePartitionStart(std::string_view key) {
+    auto colon = key.rfind(':');
+    if (colon == std::string_view::npos) return std::nullopt;
+    auto start = key.substr(colon + 1);
+    if (start.size() > 2 && start.front() == '{' && start.back() == '}')
+        start = start.substr(1, start.size() - 2);
+    uint64_t value{};
+    auto [end, ec] =
+        std::from_chars(start.data(), start.data() + start.size(), value);
+    if (ec != std::errc{} || end != start.data() + start.size())
+        return std::nullopt;
+    return value;
+}
+
+// A logical series stored as one physical key per time partition. Writes go
+// to the partition of their timestamp, which is created on first use with
+// the series labels plus LOGICAL_LABEL/PARTITION_LABEL. Range reads fan out
+// to the overlapping partitions in parallel and are concatenated in time
+// order, since partitions never overlap.
+class PartitionedSeries {
+  public:
+    PartitionedSeries(sw::redis::Redis *db, std::string logicalKey,
+                      std::vector<TimeSeriesLabel> labels = {},
+                      PartitionOptions options = {})
+        : db_{db}, logicalKey_{std::move(logicalKey)},
+          labels_{std::move(labels)}, options_{std::move(options)} {}
+
+    const std::string &logicalKey() const { return logicalKey_; }
+    const PartitionOptions &options() const { return options_; }
+
+    std::string keyFor(uint64_t timestamp) const {
+        return physicalKey(logicalKey_, partitionStart(timestamp, options_),
+                           options_);
+    }
+
+    TimeStamp add(uint64_t timestamp, double value) {
+        auto start = ensurePartition(partitionStart(timestamp, options_));
+        return client::timeSeriesAdd(db_, physicalKey(logicalKey_, start,
+                                                      options_),
+                                     TimeStamp{timestamp}, value);
+    }
+
+    // Writes `samples` with one TS.MADD; partitions are created first.
+    std::vector<TimeStamp>
+    madd(const std::vector<std::pair<uint64_t, double>> &samples) {
+        std::vector<std::tuple<std::string, TimeStamp, double>> sequence;
+        sequence.reserve(samples.size());
+        for (auto &[timestamp, value] : samples) {
+            auto start = ensurePartition(partitionStart(timestamp, options_));
+            sequence.emplace_back(physicalKey(logicalKey_, start, options_),
+                                  TimeStamp{timestamp}, value);
+        }
+        if (sequence.empty()) return {};
+        return client::timeSeriesMAdd(db_, sequence);
+    }
+
+    // Start timestamps of the stored partitions, ascending.
+    std::vector<uint64_t> partitions() const {
+        auto keys = client::timeSeriesQueryIndex(
+            db_, {fmt::format("{}={}", LOGICAL_LABEL, logicalKey_)});
+        std::vector<uint64_t> starts;
+        for (auto &key : keys)
+            if (auto start = parsePartitionStart(key)) starts.push_back(*start);
+        std::sort(starts.begin(), starts.end());
+        return starts;
+    }
+
+    // Samples in [from, to] from every overlapping partition.
+    TimeSeriesColumns range(uint64_t from, uint64_t to) const {
+        auto width = static_cast<uint64_t>(options_.width.count());
+        std::vector<uint64_t> overlapping;
+        for (auto start : partitions())
+            if (start <= to && start + width - 1 >= from)
+                overlapping.push_back(start);
+
+        auto perRequest = std::max<std::size_t>(options_.partitionsPerRequest,
+                                                1);
+        std::vector<std::future<TimeSeriesColumns>> pending;
+        for (size_t i = 0; i < overlapping.size(); i += perRequest) {
+            auto last = std::min(i + perRequest, overlapping.size());
+            std::vector<uint64_t> group(overlapping.begin() + i,
+                                        overlapping.begin() + last);
+            pending.push_back(std::async(
+                std::launch::async, [this, group = std::move(group), from, to] {
+                    TimeSeriesColumns columns;
+                    for (auto start : group)
+                        client::timeSeriesRangeColumns(
+                            db_, physicalKey(logicalKey_, start, options_),
+                            TimeStamp{from}, TimeStamp{to}, columns);
+                    return columns;
+                }));
+        }
+
+        TimeSeriesColumns result;
+        for (auto &part : pending)
+            result.append(part.get());
+        return result;
+    }
+
+    // Deletes every partition that ends before `cutoff`; returns how many
+    // keys were dropped.
+    std::size_t dropBefore(uint64_t cutoff) {
+        auto width = static_cast<uint64_t>(options_.width.count());
+        std::vector<std::string> keys;
+        for (auto start : partitions()) {
+            if (start + width > cutoff) break;
+            keys.push_back(physicalKey(logicalKey_, start, options_));
+        }
+        if (keys.empty()) return 0;
+        {
+            std::lock_guard lock{mutex_};
+            for (auto &key : keys)
+                known_.erase(key);
+        }
+        return static_cast<std::size_t>(db_->del(keys.begin(), keys.end()));
+    }
+
+  private:
+    // Creates the partition unless this instance already did; an existing
+    // key (made by another writer) is accepted as is.
+    uint64_t ensurePartition(uint64_t start) {
+        auto key = physicalKey(logicalKey_, start, options_);
+        {
+            std::lock_guard lock{mutex_};
+            if (known_.count(key) != 0) return start;
+        }
+        auto labels = labels_;
+        labels.emplace_back(LOGICAL_LABEL, logicalKey_);
+        labels.emplace_back(PARTITION_LABEL, std::to_string(start));
+        try {
+            client::timeSeriesCreate(db_, key, std::nullopt, labels,
+                                     std::nullopt, options_.chunkSize,
+                                     options_.duplicatePolicy);
+            if (options_.retention.has_value()) {
+                auto width = static_cast<uint64_t>(options_.width.count());
+                auto retention =
+                    static_cast<uint64_t>(options_.retention->count());
+                db_->command("PEXPIREAT", key, start + width + retention);
+            }
+        } catch (const sw::redis::ReplyError &error) {
+            if (std::string_view{error.what()}.find("already exists") ==
+                std::string_view::npos)
+                throw;
+        }
+        std::lock_guard lock{mutex_};
+        known_.insert(key);
+        return start;
+    }
+
+    sw::redis::Redis *db_;
+    std::string logicalKey_;
+    std::vector<TimeSeriesLabel> labels_;
+    PartitionOptions options_;
+    std::mutex mutex_;
+    std::set<std::string> known_;
+};
+
+// TS.MRANGE over partitioned series. The partitions matching `filter` are
+// looked up with TS.QUERYINDEX, the ones overlapping [from, to] are fetched
+// in parallel groups and merged back per logical key. The result maps each
+// logical key to its samples in time order.
+inline std::map<std::string, TimeSeriesColumns>
+mrange(sw::redis::Redis *db, uint64_t from, uint64_t to,
+       const std::vector<std::string> &filter,
+       const PartitionOptions &options = {}) {
+    auto width = static_cast<uint64_t>(options.width.count());
+    auto indexFilter = filter;
+    indexFilter.push_back(fmt::format("{}!=", PARTITION_LABEL));
+    std::set<uint64_t> overlapping;
+    for (auto &key : client::timeSeriesQueryIndex(db, indexFilter)) {
+        auto start = parsePartitionStart(key);
+        if (start.has_value() && *start <= to && *start + width - 1 >= from)
+            overlapping.insert(*start);
+    }
+    std::vector<uint64_t> starts(overlapping.begin(), overlapping.end());
+
+    auto perRequest = std::max<std::size_t>(options.partitionsPerRequest, 1);
+    std::vector<std::future<std::vector<TimeSeriesMRangeEntry>>> pending;
+    for (size_t i = 0; i < starts.size(); i += perRequest) {
+        auto last = std::min(i + perRequest, starts.size());
+        std::string partitions;
+        for (auto j = i; j < last; ++j)
+            partitions += (j == i ? "" : ",") + std::to_string(starts[j]);
+        auto groupFilter = filter;
+        groupFilter.push_back(
+            fmt::format("{}=({})", PARTITION_LABEL, partitions));
+        pending.push_back(std::async(
+            std::launch::async, [db, from, to, groupFilter] {
+                return client::timeSeriesMRange(db, TimeStamp{from},
+                                                TimeStamp{to}, groupFilter,
+                                                std::nullopt, std::nullopt,
+                                                std::nullopt, true);
+            }));
+    }
+
+    // Partition start -> samples, per logical key, so out-of-order group
+    // completion still merges in time order.
+    std::map<std::string, std::map<uint64_t, std::vector<TimeSeriesTuple>>>
+        grouped;
+    for (auto &part : pending) {
+        for (auto &[key, labels, values] : part.get()) {
+            auto logical = findLabel(labels, LOGICAL_LABEL);
+            auto start = findLabel(labels, PARTITION_LABEL);
+            if (!logical.has_value() || !start.has_value()) continue;
+            grouped[std::string{*logical}][std::stoull(std::string{*start})] =
+                std::move(values);
+        }
+    }
+
+    std::map<std::string, TimeSeriesColumns> result;
+    for (auto &[logical, partitions] : grouped) {
+        auto &columns = result[logical];
+        for (auto &[start, values] : partitions)
+            for (auto &value : values)
+                columns.push_back(value.time().value(), value.value());
+    }
+    return result;
+}
+
+} // namespace partition
+
+} // namespace redis_time_series
@@ -0,0 +1,232 @@
+#pragma once
+
+#include "redis_time_series.h"
+
+#include <cstring>
+
+namespace redis_time_series {
+
+namespace prepared {
+
+enum class QueryKind { RANGE, REVRANGE, MRANGE, MREVRANGE };
+
+// A TS.RANGE/REVRANGE/MRANGE/MREVRANGE whose arguments are validated and
+// encoded once; each execution patches in the time bounds and hands the
+// cached argument table to the connection as is. The reply parser is
+// picked when the query is prepared: labels are only decoded when the
+// query asked for them or groups series, whose replies always carry them.
+//
+// Immutable after construction, so one instance may be executed from
+// several threads at once.
+class PreparedQuery {
+  public:
+    static PreparedQuery
+    range(const std::string &key, std::optional<uint64_t> count = std::nullopt,
+          std::optional<command_operator::TsAggregation> aggregation =
+              std::nullopt,
+          std::optional<uint64_t> timeBucket = std::nullopt,
+          const std::vector<TimeStamp> &filterByTs = {},
+          std::optional<std::pair<uint64_t, uint64_t>> filterByValue =
+              std::nullopt,
+          const TimeStamp &align = {}, bool reverse = false) {
+        auto args = aux::buildRangeArgs(key, TimeStamp{"-"}, TimeStamp{"+"},
+                                        count, aggregation, timeBucket,
+                                        filterByTs, filterByValue, align);
+        args.emplace(args.begin(), reverse ? command::REVRANGE
+                                           : command::RANGE);
+        return PreparedQuery{reverse ? QueryKind::REVRANGE : QueryKind::RANGE,
+                             args, 2, false, false};
+    }
+
+    static PreparedQuery multiRange(
+        const std::vector<std::string> &filter,
+        std::optional<uint64_t> count = std::nullopt,
+        std::optional<command_operator::TsAggregation> aggregation =
+            std::nullopt,
+        std::optional<uint64_t> timeBucket = std::nullopt,
+        std::optional<bool> withLabels = std::nullopt,
+        std::optional<std::string> groupby = std::nullopt,
+        std::optional<command_operator::TsReduce> reduce = std::nullopt,
+        const std::vector<TimeStamp> &filterByTs = {},
+        std::optional<std::pair<uint64_t, uint64_t>> filterByValue =
+            std::nullopt,
+        const std::vector<std::string> &selectLabels = {},
+        const TimeStamp &align = {}, bool reverse = false) {
+        auto args = aux::buildMultiRangeArgs(
+            TimeStamp{"-"}, TimeStamp{"+"}, filter, count, aggregation,
+            timeBucket, withLabels, groupby, reduce, filterByTs,
+            filterByValue, selectLabels, align);
+        args.emplace(args.begin(), reverse ? command::MREVRANGE
+                                           : command::MRANGE);
+        bool labels = withLabels.value_or(false) || !selectLabels.empty();
+        bool grouped = groupby.has_value() && reduce.has_value();
+        return PreparedQuery{reverse ? QueryKind::MREVRANGE
+                                     : QueryKind::MRANGE,
+                             args, 1, labels, grouped};
+    }
+
+    QueryKind kind() const { return kind_; }
+    bool multi() const {
+        return kind_ == QueryKind::MRANGE || kind_ == QueryKind::MREVRANGE;
+    }
+    // Whether the caller asked for labels (WITHLABELS or SELECTED_LABELS).
+    bool withLabels() const { return withLabels_; }
+    bool grouped() const { return grouped_; }
+
+    // The encoded command with `from`/`to` patched in, for logging.
+    std::vector<std::string> arguments(const TimeStamp &fromTimeStamp,
+                                       const TimeStamp &toTimeStamp) const {
+        std::vector<std::string> args(args_.begin(), args_.end());
+        args[from_] = fromTimeStamp.to_string();
+        args[from_ + 1] = toTimeStamp.to_string();
+        return args;
+    }
+
+    sw::redis::ReplyUPtr execute(sw::redis::Redis *db,
+                                 const TimeStamp &fromTimeStamp,
+                                 const TimeStamp &toTimeStamp) const {
+        Bounds bounds{fromTimeStamp, toTimeStamp};
+        return db->command([&](sw::redis::Connection &connection) {
+            send(connection, bounds);
+        });
+    }
+
+    // Queues the query on `pipe`; parse its reply with samples() or
+    // entries().
+    void queue(sw::redis::Pipeline &pipe, const TimeStamp &fromTimeStamp,
+               const TimeStamp &toTimeStamp) const {
+        Bounds bounds{fromTimeStamp, toTimeStamp};
+        pipe.command([&](sw::redis::Connection &connection) {
+            send(connection, bounds);
+        });
+    }
+
+    // TS.RANGE/REVRANGE only.
+    std::vector<TimeSeriesTuple> samples(const redisReply &reply) const {
+        expect(false);
+        return parser::parseSampleArray(reply);
+    }
+
+    std::vector<TimeSeriesTuple> samples(sw::redis::Redis *db,
+                                         const TimeStamp &fromTimeStamp,
+                                         const TimeStamp &toTimeStamp) const {
+        expect(false);
+        return samples(*execute(db, fromTimeStamp, toTimeStamp));
+    }
+
+    void columns(sw::redis::Redis *db, const TimeStamp &fromTimeStamp,
+                 const TimeStamp &toTimeStamp,
+                 TimeSeriesColumns &columns) const {
+        expect(false);
+        parser::parseSampleColumns(*execute(db, fromTimeStamp, toTimeStamp),
+                                   columns);
+    }
+
+    // TS.MRANGE/MREVRANGE only.
+    std::vector<TimeSeriesMRangeEntry> entries(const redisReply &reply) const {
+        expect(true);
+        // GROUPBY replies always carry the reducer and source labels.
+        if (withLabels_ || grouped_) return parser::parseMRangeResponse(reply);
+        if (reply.type != REDIS_REPLY_ARRAY) {
+            throw sw::redis::ProtoError("Expect ARRAY reply");
+        }
+        std::vector<TimeSeriesMRangeEntry> list;
+        list.reserve(reply.elements);
+        for (size_t i = 0; i < reply.elements; ++i) {
+            auto &entry = *reply.element[i];
+            if (entry.type != REDIS_REPLY_ARRAY || entry.elements != 3) {
+                throw sw::redis::ProtoError("Expect MRANGE entry");
+            }
+            list.emplace_back(
+                std::string{parser::parseStringView(*entry.element[0])},
+                std::vector<TimeSeriesLabel>{},
+                parser::parseSampleArray(*entry.element[2]));
+        }
+        return list;
+    }
+
+    std::vector<TimeSeriesMRangeEntry>
+    entries(sw::redis::Redis *db, const TimeStamp &fromTimeStamp,
+            const TimeStamp &toTimeStamp) const {
+        expect(true);
+        return entries(*execute(db, fromTimeStamp, toTimeStamp));
+    }
+
+  private:
+    // Room for any uint64_t in decimal.
+    static constexpr std::size_t kBoundSize = 24;
+
+    // Time bounds encoded for one execution.
+    struct Bounds {
+        Bounds(const TimeStamp &from, const TimeStamp &to) {
+            encode(from, 0);
+            encode(to, 1);
+        }
+
+        void encode(const TimeStamp &timestamp, int i) {
+            if (timestamp.value() != 0) {
+                auto [end, ec] = std::to_chars(
+                    buffers[i], buffers[i] + kBoundSize, timestamp.value());
+                lengths[i] = static_cast<std::size_t>(end - buffers[i]);
+                return;
+            }
+            // "-", "+", "*" or 0; short enough to stay in the SSO buffer.
+            auto text = timestamp.to_string();
+            std::memcpy(buffers[i], text.data(), text.size());
+            lengths[i] = text.size();
+        }
+
+        char buffers[2][kBoundSize];
+        std::size_t lengths[2];
+    };
+
+    PreparedQuery(QueryKind kind, const aux::ArgList &args, std::size_t from,
+                  bool withLabels, bool grouped)
+        : kind_{kind}, args_(args.begin(), args.end()), from_{from},
+          withLabels_{withLabels}, grouped_{grouped} {}
+
+    void expect(bool multi) const {
+        if (this->multi() != multi) {
+            throw std::logic_error(multi ? "Not an MRANGE/MREVRANGE query"
+                                         : "Not a RANGE/REVRANGE query");
+        }
+    }
+
+    void send(sw::redis::Connection &connection, const Bounds &bounds) const {
+        // Only the pointer table is built per call; the encoded arguments
+        // are shared by every execution.
+        constexpr std::size_t kInline = 32;
+        std::array<const char *, kInline> argvInline;
+        std::array<std::size_t, kInline> lengthsInline;
+        std::vector<const char *> argvHeap;
+        std::vector<std::size_t> lengthsHeap;
+        const char **argv = argvInline.data();
+        std::size_t *lengths = lengthsInline.data();
+        if (args_.size() > kInline) {
+            argvHeap.resize(args_.size());
+            lengthsHeap.resize(args_.size());
+            argv = argvHeap.data();
+            lengths = lengthsHeap.data();
+        }
+        for (size_t i = 0; i < args_.size(); ++i) {
+            argv[i] = args_[i].data();
+            lengths[i] = args_[i].size();
+        }
+        for (std::size_t i = 0; i < 2; ++i) {
+            argv[from_ + i] = bounds.buffers[i];
+            lengths[from_ + i] = bounds.lengths[i];
+        }
+        connection.send(static_cast<int>(args_.size()), argv, lengths);
+    }
+
+    QueryKind kind_;
+    std::vector<std::string> args_;
+    // Index of the `from` argument; `to` follows it.
+    std::size_t from_;
+    bool withLabels_;
+    bool grouped_;
+};
+
+} // namespace prepared
+
+} // namespace redis_time_series
@@ -0,0 +1,366 @@
+#pragma once
+
+#include "redis_time_series.h"
+
+#include <functional>
+#include <future>
+
+namespace redis_time_series {
+
+// Declarative bulk provisioning. A list of series specs is compared with
+// the existing series (pipelined TS.INFO) and only the differences are
+// applied, as pipelined TS.CREATE, TS.ALTER and TS.DELETERULE /
+// TS.CREATERULE sent from several threads at once. Re-running an
+// unchanged list costs one TS.INFO per series.
+namespace provision {
+
+// Desired state of one series. Unset optionals are left as they are on an
+// existing series; `uncompressed` and `chunkSize` only apply on creation.
+// `labels` is the complete label set and `rules` the compaction rules with
+// this series as source. Every member has a default, so a spec can be
+// written with designated initializers naming only what it sets.
+struct SeriesSpec {
+    std::string key = {};
+    std::optional<uint64_t> retentionTime = std::nullopt;
+    std::vector<TimeSeriesLabel> labels = {};
+    std::optional<command_operator::TsDuplicatePolicy> duplicatePolicy =
+        std::nullopt;
+    std::optional<bool> uncompressed = std::nullopt;
+    std::optional<uint64_t> chunkSize = std::nullopt;
+    std::vector<TimeSeriesRule> rules = {};
+};
+
+struct ProvisionOptions {
+    // Commands per pipeline.
+    std::size_t batchSize = 1000;
+    // Pipelines in flight at once. Each holds a pooled connection, so the
+    // pool (ConnectionPoolOptions::size, 1 by default) must have at least
+    // this many connections or the pipelines wait for each other.
+    std::size_t connections = 4;
+    // Deletes rules found on a series but missing from its spec.
+    bool removeUnlistedRules = false;
+};
+
+struct ProvisionOutcome {
+    std::string key;
+    bool created{false};
+    bool altered{false};
+    std::size_t rulesCreated{0};
+    std::size_t rulesDeleted{0};
+    // First error met for this series; later steps for it are skipped.
+    std::optional<std::string> error;
+
+    bool changed() const {
+        return created || altered || rulesCreated > 0 || rulesDeleted > 0;
+    }
+};
+
+// What has to change for one series.
+struct SeriesChanges {
+    bool create{false};
+    // TS.ALTER arguments after the command name, when anything differs.
+    std::optional<aux::ArgList> alter;
+    // Destination keys of rules to delete; they are deleted before the
+    // rules in createRules are created.
+    std::vector<std::string> deleteRules;
+    std::vector<TimeSeriesRule> createRules;
+
+    bool empty() const {
+        return !create && !alter.has_value() && deleteRules.empty() &&
+               createRules.empty();
+    }
+};
+
+namespace detail {
+
+// Labels are interned, so ids compare as well as the strings.
+inline bool sameLabels(std::vector<TimeSeriesLabel> lhs,
+                       std::vector<TimeSeriesLabel> rhs) {
+    if (lhs.size() != rhs.size()) return false;
+    auto less = [](const TimeSeriesLabel &a, const TimeSeriesLabel &b) {
+        return std::pair{a.keyId(), a.valueId()} <
+               std::pair{b.keyId(), b.valueId()};
+    };
+    std::sort(lhs.begin(), lhs.end(), less);
+    std::sort(rhs.begin(), rhs.end(), less);
+    return lhs == rhs;
+}
+
+inline bool sameRule(const TimeSeriesRule &lhs, const TimeSeriesRule &rhs) {
+    return lhs.destKey() == rhs.destKey() &&
+           lhs.timeBucket() == rhs.timeBucket() &&
+           lhs.aggregation() == rhs.aggregation();
+}
+
+} // namespace detail
+
+// Diff of `spec` against the series as TS.INFO reported it, or against
+// nothing when the key does not exist.
+inline SeriesChanges
+planSeries(const SeriesSpec &spec,
+           const std::optional<TimeSeriesInformation> &existing,
+           bool removeUnlistedRules = false) {
+    SeriesChanges changes;
+    if (!existing.has_value()) {
+        changes.create = true;
+        changes.createRules = spec.rules;
+        return changes;
+    }
+
+    // Only what the spec sets is compared; the rest is left as it is.
+    std::optional<uint64_t> retention;
+    if (spec.retentionTime.has_value() &&
+        *spec.retentionTime != existing->retentionTime())
+        retention = spec.retentionTime;
+    std::optional<command_operator::TsDuplicatePolicy> policy;
+    if (spec.duplicatePolicy.has_value() &&
+        spec.duplicatePolicy != existing->duplicatePolicy())
+        policy = spec.duplicatePolicy;
+    auto relabel = !detail::sameLabels(spec.labels, existing->labels());
+    if (retention || policy || relabel) {
+        static const std::vector<TimeSeriesLabel> unchanged;
+        changes.alter = aux::buildTsAlterArgs(
+            spec.key, retention, relabel ? spec.labels : unchanged, policy);
+        // An empty LABELS clears the labels.
+        if (relabel && spec.labels.empty())
+            changes.alter->emplace_back(command_args::LABELS);
+    }
+
+    auto rules = existing->rules();
+    for (auto &rule : spec.rules) {
+        auto found = std::find_if(rules.begin(), rules.end(),
+                                  [&](const TimeSeriesRule &current) {
+                                      return current.destKey() ==
+                                             rule.destKey();
+                                  });
+        if (found != rules.end() && detail::sameRule(*found, rule)) continue;
+        if (found != rules.end())
+            changes.deleteRules.push_back(rule.destKey());
+        changes.createRules.push_back(rule);
+    }
+    if (removeUnlistedRules) {
+        for (auto &current : rules) {
+            auto listed = std::any_of(spec.rules.begin(), spec.rules.end(),
+                                      [&](const TimeSeriesRule &rule) {
+                                          return rule.destKey() ==
+                                                 current.destKey();
+                                      });
+            if (!listed) changes.deleteRules.push_back(current.destKey());
+        }
+    }
+    return changes;
+}
+
+namespace detail {
+
+// Commands of one series in one phase. They stay in one pipeline, in
+// order, so each series is only ever touched by one thread at a time.
+struct Work {
+    std::size_t series;
+    std::vector<aux::ArgList> commands;
+};
+
+// Called with the reply of each command, or with the error it failed with.
+using ReplyHandler = std::function<void(
+    std::size_t series, std::size_t command, redisReply *reply,
+    const std::string &error)>;
+
+inline void runBatch(sw::redis::Redis *db, const std::vector<Work> &work,
+                     std::size_t begin, std::size_t end,
+                     const ReplyHandler &onReply) {
+    std::optional<sw::redis::QueuedReplies> replies;
+    std::string failed;
+    try {
+        auto pipeline = db->pipeline(false);
+        for (auto i = begin; i < end; ++i)
+            for (auto &command : work[i].commands)
+                pipeline.command(command.begin(), command.end());
+        replies.emplace(pipeline.exec());
+    } catch (const sw::redis::Error &error) {
+        failed = error.what();
+    }
+    std::size_t k = 0;
+    for (auto i = begin; i < end; ++i) {
+        for (std::size_t c = 0; c < work[i].commands.size(); ++c, ++k) {
+            redisReply *reply = nullptr;
+            std::string error = failed;
+            if (replies.has_value()) {
+                try {
+                    reply = &replies->get(k);
+                } catch (const sw::redis::Error &e) {
+                    error = e.what();
+                }
+            }
+            onReply(work[i].series, c, reply, error);
+        }
+    }
+}
+
+// Cuts `work` into pipelines of about options.batchSize commands and runs
+// them on options.connections threads.
+inline void execute(sw::redis::Redis *db, const std::vector<Work> &work,
+                    const ProvisionOptions &options,
+                    const ReplyHandler &onReply) {
+    auto batchSize = std::max<std::size_t>(options.batchSize, 1);
+    std::vector<std::pair<std::size_t, std::size_t>> batches;
+    std::size_t begin = 0, queued = 0;
+    for (std::size_t i = 0; i < work.size(); ++i) {
+        queued += work[i].commands.size();
+        if (queued >= batchSize) {
+            batches.emplace_back(begin, i + 1);
+            begin = i + 1;
+            queued = 0;
+        }
+    }
+    if (begin < work.size()) batches.emplace_back(begin, work.size());
+    if (batches.empty()) return;
+
+    std::atomic<std::size_t> next{0};
+    auto run = [&] {
+        for (auto b = next++; b < batches.size(); b = next++)
+            runBatch(db, work, batches[b].first, batches[b].second, onReply);
+    };
+    auto threads =
+        std::clamp<std::size_t>(options.connections, 1, batches.size());
+    std::vector<std::future<void>> pending;
+    pending.reserve(threads);
+    for (std::size_t t = 0; t < threads; ++t)
+        pending.push_back(std::async(std::launch::async, run));
+    for (auto &future : pending)
+        future.get();
+}
+
+inline aux::ArgList command(const char *name, aux::ArgList args) {
+    args.emplace(args.begin(), name);
+    return args;
+}
+
+inline aux::ArgList command(std::initializer_list<std::string_view> words) {
+    aux::ArgList args;
+    args.reserve(words.size());
+    for (auto word : words)
+        args.emplace_back(word);
+    return args;
+}
+
+inline aux::ArgList createRuleCommand(const std::string &sourceKey,
+                                      const TimeSeriesRule &rule) {
+    auto args = command({"TS.CREATERULE", sourceKey, rule.destKey()});
+    if (rule.aggregation().has_value()) {
+        args.emplace_back("AGGREGATION");
+        args.emplace_back(command_operator::to_string(*rule.aggregation()));
+    }
+    args.emplace_back(std::to_string(rule.timeBucket()));
+    return args;
+}
+
+} // namespace detail
+
+// Brings every series of `specs` to its spec and reports, in spec order,
+// what was done. Phases run one after the other (inspect, create, alter,
+// rules) so rule destinations created by the same call exist before any
+// rule points at them.
+inline std::vector<ProvisionOutcome>
+provisionSeries(sw::redis::Redis *db, const std::vector<SeriesSpec> &specs,
+                const ProvisionOptions &options = {}) {
+    std::vector<ProvisionOutcome> outcomes(specs.size());
+    std::vector<std::optional<TimeSeriesInformation>> existing(specs.size());
+    std::vector<detail::Work> work;
+    work.reserve(specs.size());
+    for (std::size_t i = 0; i < specs.size(); ++i) {
+        outcomes[i].key = specs[i].key;
+        work.push_back({i, {detail::command({command::INFO, specs[i].key})}});
+    }
+    detail::execute(db, work, options,
+                    [&](std::size_t series, std::size_t, redisReply *reply,
+                        const std::string &error) {
+                        if (reply == nullptr) {
+                            if (error.find("does not exist") ==
+                                std::string::npos)
+                                outcomes[series].error = error;
+                            return;
+                        }
+                        try {
+                            existing[series] = parser::parseInfo(reply);
+                        } catch (const std::exception &e) {
+                            outcomes[series].error = e.what();
+                        }
+                    });
+
+    std::vector<SeriesChanges> changes(specs.size());
+    for (std::size_t i = 0; i < specs.size(); ++i)
+        if (!outcomes[i].error.has_value())
+            changes[i] = planSeries(specs[i], existing[i],
+                                    options.removeUnlistedRules);
+
+    auto failed = [&](std::size_t series, const std::string &error) {
+        if (!outcomes[series].error.has_value())
+            outcomes[series].error = error;
+    };
+    auto runPhase = [&](auto &&commandsOf, auto &&onSuccess) {
+        work.clear();
+        for (std::size_t i = 0; i < specs.size(); ++i) {
+            if (outcomes[i].error.has_value()) continue;
+            auto commands = commandsOf(i);
+            if (!commands.empty()) work.push_back({i, std::move(commands)});
+        }
+        detail::execute(db, work, options,
+                        [&](std::size_t series, std::size_t command,
+                            redisReply *reply, const std::string &error) {
+                            if (reply == nullptr)
+                                failed(series, error);
+                            else
+                                onSuccess(series, command);
+                        });
+    };
+
+    runPhase(
+        [&](std::size_t i) {
+            std::vector<aux::ArgList> commands;
+            auto &spec = specs[i];
+            if (changes[i].create)
+                commands.push_back(detail::command(
+                    command::CREATE,
+                    aux::buildTsCreateArgs(spec.key, spec.retentionTime,
+                                           spec.labels, spec.uncompressed,
+                                           spec.chunkSize,
+                                           spec.duplicatePolicy)));
+            return commands;
+        },
+        [&](std::size_t series, std::size_t) {
+            outcomes[series].created = true;
+        });
+    runPhase(
+        [&](std::size_t i) {
+            std::vector<aux::ArgList> commands;
+            if (changes[i].alter.has_value())
+                commands.push_back(
+                    detail::command(command::ALTER, *changes[i].alter));
+            return commands;
+        },
+        [&](std::size_t series, std::size_t) {
+            outcomes[series].altered = true;
+        });
+    runPhase(
+        [&](std::size_t i) {
+            std::vector<aux::ArgList> commands;
+            for (auto &dest : changes[i].deleteRules)
+                commands.push_back(detail::command(
+                    {"TS.DELETERULE", specs[i].key, dest}));
+            for (auto &rule : changes[i].createRules)
+                commands.push_back(
+                    detail::createRuleCommand(specs[i].key, rule));
+            return commands;
+        },
+        [&](std::size_t series, std::size_t command) {
+            if (command < changes[series].deleteRules.size())
+                ++outcomes[series].rulesDeleted;
+            else
+                ++outcomes[series].rulesCreated;
+        });
+    return outcomes;
+}
+
+} // namespace provision
+
+} // namespace redis_time_series
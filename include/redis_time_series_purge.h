@@ -0,0 +1,220 @@
+#pragma once
+
+#include "redis_time_series.h"
+
+#include <functional>
+#include <future>
+#include <thread>
+
+namespace redis_time_series {
+
+// Bulk deletion of samples from every series matching a label filter, for
+// purging decommissioned units and enforcing retention cuts. Each series'
+// range is split into slices of bounded size, and the slices are deleted
+// with TS.DEL in waves of pipelines sent from several threads at once.
+// The wave size adapts to a latency budget and waves can be spaced out, so
+// a large purge does not monopolise the server while ingest goes on.
+// TS.DEL, and so purging, needs RedisTimeSeries 1.6 or later.
+namespace purge {
+
+struct PurgeOptions {
+    // Samples in [from, to] are deleted.
+    uint64_t from = 0;
+    uint64_t to = std::numeric_limits<int64_t>::max();
+    // Estimated samples per TS.DEL, from the series' average density.
+    uint64_t samplesPerSlice = 50000;
+    // Pipelines per wave, each sent from its own thread. A pipeline holds
+    // a connection of the sw::redis::Redis pool until it has run, so the
+    // pool (ConnectionPoolOptions::size, 1 by default) must have at least
+    // this many connections or the pipelines wait for each other.
+    std::size_t connections = 4;
+    // TS.DEL commands per pipeline, to begin with and at most. The count is
+    // halved after a wave slower than waveBudget and doubled after one
+    // faster than half of it.
+    std::size_t slicesPerPipeline = 8;
+    std::size_t maxSlicesPerPipeline = 256;
+    std::chrono::milliseconds waveBudget{50};
+    // Idle time left to other clients after every wave.
+    std::chrono::milliseconds pause{0};
+    // TS.INFO commands per pipeline while planning.
+    std::size_t batchSize = 500;
+};
+
+struct PurgeProgress {
+    std::size_t keys{0};
+    std::size_t slices{0};
+    std::size_t slicesDone{0};
+    uint64_t samplesRemoved{0};
+    std::size_t waves{0};
+    std::chrono::milliseconds elapsed{0};
+};
+
+struct PurgeResult {
+    PurgeProgress progress;
+    // Series whose deletion failed, with the first error met; their other
+    // slices are still attempted.
+    std::vector<std::pair<std::string, std::string>> errors;
+};
+
+// One TS.DEL range, inclusive on both ends.
+struct Slice {
+    std::size_t key;
+    uint64_t from;
+    uint64_t to;
+
+    friend bool operator==(const Slice &lhs, const Slice &rhs) {
+        return lhs.key == rhs.key && lhs.from == rhs.from && lhs.to == rhs.to;
+    }
+};
+
+// Slices of [from, to] clipped to the series' own time span. The span of a
+// slice is chosen so it holds about samplesPerSlice samples at the series'
+// average density.
+inline void planSlices(std::size_t key, const TimeSeriesInformation &info,
+                       uint64_t from, uint64_t to, uint64_t samplesPerSlice,
+                       std::vector<Slice> &slices) {
+    if (info.totalSamples() == 0) return;
+    auto first = std::max(from, info.firstTimeStamp().value());
+    auto last = std::min(to, info.lastTimeStamp().value());
+    if (first > last) return;
+    auto span = info.lastTimeStamp().value() -
+                info.firstTimeStamp().value() + 1;
+    auto width = std::max<uint64_t>(
+        1, static_cast<uint64_t>(static_cast<double>(span) *
+                                 static_cast<double>(samplesPerSlice) /
+                                 static_cast<double>(info.totalSamples())));
+    for (auto start = first;; start += width) {
+        auto end = last - start < width ? last : start + width - 1;
+        slices.push_back({key, start, end});
+        if (end == last) break;
+    }
+}
+
+// Pipeline size for the next wave, given how long the last one took.
+inline std::size_t nextSlicesPerPipeline(std::size_t current,
+                                         std::chrono::milliseconds elapsed,
+                                         const PurgeOptions &options) {
+    auto most = std::max<std::size_t>(options.maxSlicesPerPipeline, 1);
+    if (elapsed > options.waveBudget)
+        return std::max<std::size_t>(current / 2, 1);
+    if (elapsed * 2 < options.waveBudget) return std::min(current * 2, most);
+    return current;
+}
+
+// Deletes [options.from, options.to] from every series matching `filter`
+// (TS.QUERYINDEX syntax). `onProgress`, when given, is called after every
+// wave. Keys are kept, even when left empty.
+inline PurgeResult
+purgeSeries(sw::redis::Redis *db, const std::vector<std::string> &filter,
+            const PurgeOptions &options = {},
+            const std::function<void(const PurgeProgress &)> &onProgress = {}) {
+    using Clock = std::chrono::steady_clock;
+    auto started = Clock::now();
+    PurgeResult result;
+    auto keys = client::timeSeriesQueryIndex(db, filter);
+    result.progress.keys = keys.size();
+    std::vector<std::optional<std::string>> errors(keys.size());
+
+    std::vector<Slice> slices;
+    auto batchSize = std::max<std::size_t>(options.batchSize, 1);
+    auto samplesPerSlice = std::max<uint64_t>(options.samplesPerSlice, 1);
+    for (std::size_t i = 0; i < keys.size(); i += batchSize) {
+        auto last = std::min(i + batchSize, keys.size());
+        auto pipeline = db->pipeline(false);
+        for (auto k = i; k < last; ++k)
+            pipeline.command(command::INFO, keys[k]);
+        auto replies = pipeline.exec();
+        for (auto k = i; k < last; ++k) {
+            try {
+                planSlices(k, parser::parseInfo(&replies.get(k - i)),
+                           options.from, options.to, samplesPerSlice, slices);
+            } catch (const sw::redis::ReplyError &) {
+                // Deleted since the query.
+            }
+        }
+    }
+    result.progress.slices = slices.size();
+
+    std::mutex mutex;
+    auto runPipeline = [&](std::size_t begin, std::size_t end) {
+        uint64_t removed = 0;
+        std::optional<sw::redis::QueuedReplies> replies;
+        std::string failed;
+        try {
+            auto pipeline = db->pipeline(false);
+            for (auto s = begin; s < end; ++s)
+                pipeline.command(command::DEL, keys[slices[s].key],
+                                 std::to_string(slices[s].from),
+                                 std::to_string(slices[s].to));
+            replies.emplace(pipeline.exec());
+        } catch (const sw::redis::Error &error) {
+            failed = error.what();
+        }
+        std::lock_guard lock{mutex};
+        for (auto s = begin; s < end; ++s) {
+            auto error = failed;
+            if (replies.has_value()) {
+                try {
+                    removed += static_cast<uint64_t>(
+                        replies->get<long long>(s - begin));
+                } catch (const sw::redis::Error &e) {
+                    error = e.what();
+                }
+            }
+            auto &slot = errors[slices[s].key];
+            if (!error.empty() && !slot.has_value()) slot = error;
+        }
+        result.progress.samplesRemoved += removed;
+    };
+
+    auto perPipeline = std::clamp<std::size_t>(
+        options.slicesPerPipeline, 1,
+        std::max<std::size_t>(options.maxSlicesPerPipeline, 1));
+    auto connections = std::max<std::size_t>(options.connections, 1);
+    std::size_t next = 0;
+    while (next < slices.size()) {
+        auto waveStarted = Clock::now();
+        std::vector<std::future<void>> pending;
+        for (std::size_t c = 0; c < connections && next < slices.size(); ++c) {
+            auto end = std::min(next + perPipeline, slices.size());
+            pending.push_back(
+                std::async(std::launch::async, runPipeline, next, end));
+            next = end;
+        }
+        for (auto &future : pending)
+            future.get();
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            Clock::now() - waveStarted);
+        perPipeline = nextSlicesPerPipeline(perPipeline, elapsed, options);
+
+        result.progress.slicesDone = next;
+        ++result.progress.waves;
+        result.progress.elapsed =
+            std::chrono::duration_cast<std::chrono::milliseconds>(
+                Clock::now() - started);
+        if (onProgress) onProgress(result.progress);
+        if (next < slices.size() && options.pause.count() > 0)
+            std::this_thread::sleep_for(options.pause);
+    }
+
+    for (std::size_t k = 0; k < keys.size(); ++k)
+        if (errors[k].has_value())
+            result.errors.emplace_back(keys[k], *errors[k]);
+    return result;
+}
+
+// Retention cut: deletes every sample older than `cutoff` from the series
+// matching `filter`.
+inline PurgeResult
+purgeBefore(sw::redis::Redis *db, const std::vector<std::string> &filter,
+            uint64_t cutoff, PurgeOptions options = {},
+            const std::function<void(const PurgeProgress &)> &onProgress = {}) {
+    if (cutoff == 0) return {};
+    options.from = 0;
+    options.to = cutoff - 1;
+    return purgeSeries(db, filter, options, onProgress);
+}
+
+} // namespace purge
+
+} // namespace redis_time_series
@@ -0,0 +1,299 @@
+#pragma once
+
+#include "redis_time_series.h"
+#include "redis_time_series_store.h"
+
+#include <functional>
+#include <map>
+
+namespace redis_time_series {
+
+namespace reorder {
+
+struct ReorderOptions {
+    // How far a sample may lag the newest timestamp seen on its key and
+    // still be written in order. Measured in sample time, not wall time.
+    uint64_t lateness = 5000;
+    // Policy for keys without setPolicy(), applied to samples that share a
+    // timestamp inside the window. Should match the series on the server.
+    command_operator::TsDuplicatePolicy duplicatePolicy =
+        command_operator::TsDuplicatePolicy::BLOCK;
+    // Released samples are written with one TS.MADD per this many.
+    std::size_t batchSize = 1000;
+    // Held samples per key; beyond it the oldest are released early.
+    std::size_t maxPending = 10000;
+    // Stamps `*` timestamps on arrival, in milliseconds. The system clock
+    // when unset.
+    std::function<uint64_t()> clock = {};
+};
+
+struct ReorderStats {
+    // Samples written through TS.MADD in timestamp order.
+    uint64_t inOrder{0};
+    // Samples older than what was already written for their key, sent one
+    // by one with ON_DUPLICATE set to the key's policy.
+    uint64_t late{0};
+    // Samples merged into another with the same timestamp.
+    uint64_t merged{0};
+    // Duplicates dropped under BLOCK and writes the server refused.
+    uint64_t rejected{0};
+};
+
+// Client-side reorder window in front of a TimeSeriesStore. Each key keeps
+// a min-heap of recent samples; a sample is released once it is more than
+// `lateness` behind the newest timestamp pushed for that key, so the
+// server receives appends in order instead of rewriting compressed chunks.
+// Samples sharing a timestamp are merged with the key's duplicate policy
+// before they are sent; under BLOCK the first one wins and the rest are
+// counted as rejected rather than failing on the server. A sample that
+// arrives after its key has moved past it is written on its own as an
+// explicit out-of-order TS.ADD.
+//
+// A `*` timestamp is stamped with options.clock when it is pushed, so it
+// takes its place in the window like any other; `-` and `+` are refused.
+// A window keeps its newest sample until drain(), which empties every
+// window and forgets its key, so memory follows the keys pushed since the
+// last drain rather than every key ever pushed. A sample that arrives for
+// a forgotten key behind what was written for it is then sent through
+// TS.MADD, and the series' own duplicate policy applies.
+//
+// Thread-safe; all calls are serialized. Call flush() periodically (or
+// drain() at shutdown) to write what was released but not yet batched.
+class ReorderBuffer {
+  public:
+    explicit ReorderBuffer(TimeSeriesStore &store, ReorderOptions options = {})
+        : store_{store}, options_{options} {
+        options_.batchSize = std::max<std::size_t>(options_.batchSize, 1);
+        options_.maxPending = std::max<std::size_t>(options_.maxPending, 1);
+        if (!options_.clock) {
+            options_.clock = [] {
+                return static_cast<uint64_t>(
+                    std::chrono::duration_cast<std::chrono::milliseconds>(
+                        std::chrono::system_clock::now().time_since_epoch())
+                        .count());
+            };
+        }
+    }
+
+    ~ReorderBuffer() {
+        try {
+            drain();
+        } catch (...) {
+        }
+    }
+
+    ReorderBuffer(const ReorderBuffer &) = delete;
+    ReorderBuffer &operator=(const ReorderBuffer &) = delete;
+
+    void setPolicy(const std::string &key,
+                   command_operator::TsDuplicatePolicy policy) {
+        std::lock_guard lock{mutex_};
+        policies_[key] = policy;
+    }
+
+    void push(const std::string &key, uint64_t timestamp, double value) {
+        std::lock_guard lock{mutex_};
+        pushLocked(key, timestamp, value);
+        if (batch_.size() >= options_.batchSize) flushLocked();
+    }
+
+    void push(const std::vector<std::tuple<std::string, TimeStamp, double>>
+                  &sequence) {
+        // Checked up front so that a refused entry leaves nothing pushed.
+        for (auto &entry : sequence) {
+            auto &timestamp = std::get<TimeStamp>(entry);
+            if (isConstant(timestamp) && timestamp.to_string() != "*")
+                throw std::invalid_argument(
+                    "Reorder timestamps must be a time or '*'");
+        }
+        std::lock_guard lock{mutex_};
+        auto now = options_.clock();
+        for (auto &[key, timestamp, value] : sequence) {
+            pushLocked(key, isConstant(timestamp) ? now : timestamp.value(),
+                       value);
+            if (batch_.size() >= options_.batchSize) flushLocked();
+        }
+    }
+
+    // Writes the released samples.
+    void flush() {
+        std::lock_guard lock{mutex_};
+        flushLocked();
+    }
+
+    // Releases and writes everything still held in the windows, then
+    // forgets their keys.
+    void drain() {
+        std::lock_guard lock{mutex_};
+        for (auto &[key, window] : keys_) {
+            while (!window.heap.empty())
+                release(key, window);
+        }
+        flushLocked();
+        keys_.clear();
+    }
+
+    // Samples held in windows plus those released but not yet written.
+    std::size_t pending() const {
+        std::lock_guard lock{mutex_};
+        std::size_t count = batch_.size();
+        for (auto &[key, window] : keys_)
+            count += window.heap.size();
+        return count;
+    }
+
+    // Keys with a window.
+    std::size_t windows() const {
+        std::lock_guard lock{mutex_};
+        return keys_.size();
+    }
+
+    ReorderStats stats() const {
+        std::lock_guard lock{mutex_};
+        return stats_;
+    }
+
+  private:
+    struct Entry {
+        uint64_t timestamp;
+        uint64_t sequence;
+        double value;
+
+        // Inverted for std::push_heap's max-heap: earliest timestamp, then
+        // earliest arrival, on top.
+        friend bool operator<(const Entry &lhs, const Entry &rhs) {
+            if (lhs.timestamp != rhs.timestamp)
+                return lhs.timestamp > rhs.timestamp;
+            return lhs.sequence > rhs.sequence;
+        }
+    };
+
+    struct Window {
+        std::vector<Entry> heap;
+        uint64_t newest{0};
+        // Timestamp of the last sample released for this key.
+        std::optional<uint64_t> released;
+    };
+
+    // TimeStamp keeps no flag for constants; only they have a value of 0
+    // and still report hasValue().
+    static bool isConstant(const TimeStamp &timestamp) {
+        return timestamp.value() == 0 && timestamp.hasValue();
+    }
+
+    command_operator::TsDuplicatePolicy
+    policyOf(const std::string &key) const {
+        auto found = policies_.find(key);
+        return found == policies_.end() ? options_.duplicatePolicy
+                                        : found->second;
+    }
+
+    void pushLocked(const std::string &key, uint64_t timestamp, double value) {
+        auto &window = keys_[key];
+        if (window.released.has_value() && timestamp <= *window.released) {
+            writeLate(key, timestamp, value);
+            return;
+        }
+        window.heap.push_back(Entry{timestamp, sequence_++, value});
+        std::push_heap(window.heap.begin(), window.heap.end());
+        window.newest = std::max(window.newest, timestamp);
+        while (!window.heap.empty() &&
+               (window.heap.front().timestamp + options_.lateness <
+                    window.newest ||
+                window.heap.size() > options_.maxPending))
+            release(key, window);
+    }
+
+    // Pops the oldest timestamp of `window`, merging every entry that
+    // shares it, and appends the result to the batch.
+    void release(const std::string &key, Window &window) {
+        auto &heap = window.heap;
+        std::pop_heap(heap.begin(), heap.end());
+        auto sample = heap.back();
+        heap.pop_back();
+        while (!heap.empty() && heap.front().timestamp == sample.timestamp) {
+            std::pop_heap(heap.begin(), heap.end());
+            sample.value = merge(policyOf(key), sample.value,
+                                 heap.back().value);
+            heap.pop_back();
+        }
+        window.released = sample.timestamp;
+        batch_.emplace_back(key, TimeStamp{sample.timestamp}, sample.value);
+    }
+
+    double merge(command_operator::TsDuplicatePolicy policy, double stored,
+                 double incoming) {
+        using command_operator::TsDuplicatePolicy;
+        switch (policy) {
+        case TsDuplicatePolicy::BLOCK:
+            ++stats_.rejected;
+            return stored;
+        case TsDuplicatePolicy::FIRST:
+            break;
+        case TsDuplicatePolicy::LAST:
+            stored = incoming;
+            break;
+        case TsDuplicatePolicy::MIN:
+            stored = std::min(stored, incoming);
+            break;
+        case TsDuplicatePolicy::MAX:
+            stored = std::max(stored, incoming);
+            break;
+        case TsDuplicatePolicy::SUM:
+            stored += incoming;
+            break;
+        default:
+            throw std::out_of_range("Invalid policy type.");
+        }
+        ++stats_.merged;
+        return stored;
+    }
+
+    void writeLate(const std::string &key, uint64_t timestamp, double value) {
+        // Keep the order of writes per key: what was released goes first.
+        flushLocked();
+        try {
+            store_.add(key, TimeStamp{timestamp}, value, std::nullopt, {},
+                       std::nullopt, std::nullopt, policyOf(key));
+            ++stats_.late;
+        } catch (const sw::redis::ReplyError &) {
+            // Older than the retention or a duplicate under BLOCK; sending
+            // it again would fail the same way.
+            ++stats_.rejected;
+        }
+    }
+
+    // Entries the server refuses, e.g. older than the retention, are
+    // counted as rejected. A ReplyError for the whole command drops the
+    // batch; on connection errors it is kept for the next flush.
+    void flushLocked() {
+        if (batch_.empty()) return;
+        std::vector<MAddResult> results;
+        try {
+            results = store_.madd(batch_);
+        } catch (const sw::redis::ReplyError &) {
+            batch_.clear();
+            throw;
+        }
+        for (auto &result : results) {
+            if (result.error.has_value())
+                ++stats_.rejected;
+            else
+                ++stats_.inOrder;
+        }
+        batch_.clear();
+    }
+
+    TimeSeriesStore &store_;
+    ReorderOptions options_;
+    mutable std::mutex mutex_;
+    std::map<std::string, Window> keys_;
+    std::map<std::string, command_operator::TsDuplicatePolicy> policies_;
+    std::vector<std::tuple<std::string, TimeStamp, double>> batch_;
+    uint64_t sequence_{0};
+    ReorderStats stats_;
+};
+
+} // namespace reorder
+
+} // namespace redis_time_series
@@ -0,0 +1,263 @@
+#pragma once
+
+#include "redis_time_series.h"
+
+#include <cctype>
+#include <utility>
+
+namespace redis_time_series {
+
+namespace routing {
+
+// Commands the module registers as `readonly` (see redis/module.json), plus
+// TS.MRANGE, TS.MGET and TS.QUERYINDEX: they never write either, but the
+// vendored module manifest does not list them. Everything else is sent to
+// the primary.
+inline bool isReadOnly(std::string_view command) {
+    constexpr std::array<std::string_view, 8> readOnly{
+        command::GET,    command::RANGE, command::REVRANGE,
+        command::MRANGE, command::MREVRANGE, command::MGET,
+        command::INFO,   command::QUERYINDEX};
+    auto sameName = [](char upper, char c) {
+        return upper == std::toupper(static_cast<unsigned char>(c));
+    };
+    return std::any_of(readOnly.begin(), readOnly.end(), [&](auto name) {
+        return std::equal(name.begin(), name.end(), command.begin(),
+                          command.end(), sameName);
+    });
+}
+
+// Fields of `INFO replication`, e.g. {"role", "slave"}.
+inline std::unordered_map<std::string, std::string>
+parseInfoSection(std::string_view info) {
+    std::unordered_map<std::string, std::string> fields;
+    while (!info.empty()) {
+        auto end = info.find('\n');
+        auto line = info.substr(0, end);
+        info = end == std::string_view::npos ? std::string_view{}
+                                             : info.substr(end + 1);
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        if (line.empty() || line.front() == '#') continue;
+        auto colon = line.find(':');
+        if (colon == std::string_view::npos) continue;
+        fields.emplace(line.substr(0, colon), line.substr(colon + 1));
+    }
+    return fields;
+}
+
+enum class BalancePolicy { ROUND_ROBIN, LEAST_OUTSTANDING };
+
+struct RouterOptions {
+    BalancePolicy policy = BalancePolicy::ROUND_ROBIN;
+    // Replication state older than this is refreshed on the next read.
+    std::chrono::milliseconds probeInterval{1000};
+};
+
+// Per-read freshness bound. A replica qualifies when it held everything the
+// primary had at most `maxStaleness` ago and, if set, lags the primary's
+// replication offset by at most `maxLagBytes`. With neither set any replica
+// whose link is up is used.
+struct ReadOptions {
+    std::optional<std::chrono::milliseconds> maxStaleness;
+    std::optional<uint64_t> maxLagBytes;
+};
+
+// Routes read-only TS commands to replicas and everything else to the
+// primary. Replica freshness is taken from `INFO replication` offsets,
+// sampled at most once per probeInterval; a read whose bound no replica
+// meets goes to the primary. The router does not own the connections.
+class ReadRouter {
+    struct Endpoint {
+        explicit Endpoint(sw::redis::Redis *redis) : db{redis} {}
+
+        sw::redis::Redis *db;
+        std::atomic<int64_t> outstanding{0};
+        // Replication state, guarded by ReadRouter::probeMutex_.
+        bool linkUp{false};
+        uint64_t lagBytes{std::numeric_limits<uint64_t>::max()};
+        std::optional<std::chrono::steady_clock::time_point> caughtUpAt;
+    };
+
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    // Keeps a replica's outstanding count raised while a caller uses it.
+    class Lease {
+      public:
+        Lease(Endpoint *endpoint, bool replica)
+            : endpoint_{endpoint}, replica_{replica} {
+            endpoint_->outstanding.fetch_add(1, std::memory_order_relaxed);
+        }
+        Lease(Lease &&other) noexcept
+            : endpoint_{std::exchange(other.endpoint_, nullptr)},
+              replica_{other.replica_} {}
+        Lease(const Lease &) = delete;
+        Lease &operator=(const Lease &) = delete;
+        Lease &operator=(Lease &&) = delete;
+        ~Lease() {
+            if (endpoint_ != nullptr)
+                endpoint_->outstanding.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        sw::redis::Redis *get() const { return endpoint_->db; }
+        sw::redis::Redis *operator->() const { return endpoint_->db; }
+        bool isReplica() const { return replica_; }
+
+      private:
+        Endpoint *endpoint_;
+        bool replica_;
+    };
+
+    ReadRouter(sw::redis::Redis *primary,
+               const std::vector<sw::redis::Redis *> &replicas,
+               const RouterOptions &options = {})
+        : primary_{std::make_unique<Endpoint>(primary)}, options_{options} {
+        for (auto *replica : replicas)
+            replicas_.push_back(std::make_unique<Endpoint>(replica));
+    }
+
+    sw::redis::Redis *primary() const { return primary_->db; }
+
+    // Endpoint for `command`: the primary for writes and for reads no
+    // replica can serve within `options`.
+    Lease route(std::string_view command, const ReadOptions &options = {}) {
+        if (!isReadOnly(command) || replicas_.empty()) return primaryLease();
+        return read(options);
+    }
+
+    // Endpoint for a read of any client:: query function.
+    Lease read(const ReadOptions &options = {}) {
+        probeIfDue();
+        auto now = Clock::now();
+        std::vector<Endpoint *> eligible;
+        {
+            std::lock_guard lock{probeMutex_};
+            for (auto &replica : replicas_)
+                if (isFreshEnough(*replica, options, now))
+                    eligible.push_back(replica.get());
+        }
+        if (eligible.empty()) return primaryLease();
+
+        if (options_.policy == BalancePolicy::LEAST_OUTSTANDING) {
+            auto *best = *std::min_element(
+                eligible.begin(), eligible.end(), [](auto *lhs, auto *rhs) {
+                    return lhs->outstanding.load(std::memory_order_relaxed) <
+                           rhs->outstanding.load(std::memory_order_relaxed);
+                });
+            return Lease{best, true};
+        }
+        auto next = next_.fetch_add(1, std::memory_order_relaxed);
+        return Lease{eligible[next % eligible.size()], true};
+    }
+
+    // Runs a raw command on the routed endpoint. A replica that fails with
+    // an I/O error is marked down until the next probe and the command is
+    // retried on the primary.
+    template <typename Input>
+    sw::redis::ReplyUPtr command(Input first, Input last,
+                                 const ReadOptions &options = {}) {
+        if (first == last) throw std::invalid_argument("Empty command");
+        auto lease = route(std::string_view{*first}, options);
+        if (!lease.isReplica()) return lease->command(first, last);
+        try {
+            return lease->command(first, last);
+        } catch (const sw::redis::IoError &) {
+            markDown(lease.get());
+        } catch (const sw::redis::ClosedError &) {
+            markDown(lease.get());
+        }
+        return primaryLease()->command(first, last);
+    }
+
+    // Samples `INFO replication` on the primary and on every replica.
+    void probe() {
+        auto now = Clock::now();
+        uint64_t primaryOffset = 0;
+        auto primaryInfo = parseInfoSection(primary_->db->info("replication"));
+        auto offset = primaryInfo.find("master_repl_offset");
+        if (offset != primaryInfo.end())
+            primaryOffset = std::stoull(offset->second);
+
+        for (auto &replica : replicas_) {
+            bool linkUp = false;
+            uint64_t replicaOffset = 0;
+            try {
+                auto info =
+                    parseInfoSection(replica->db->info("replication"));
+                auto link = info.find("master_link_status");
+                auto replOffset = info.find("slave_repl_offset");
+                linkUp = link != info.end() && link->second == "up" &&
+                         replOffset != info.end();
+                if (linkUp) replicaOffset = std::stoull(replOffset->second);
+            } catch (const sw::redis::Error &) {
+                linkUp = false;
+            }
+
+            std::lock_guard lock{probeMutex_};
+            replica->linkUp = linkUp;
+            replica->lagBytes = !linkUp ? std::numeric_limits<uint64_t>::max()
+                                : replicaOffset >= primaryOffset
+                                    ? 0
+                                    : primaryOffset - replicaOffset;
+            // The primary was read first, so a replica at or past its
+            // offset held everything written up to `now`.
+            if (linkUp && replicaOffset >= primaryOffset)
+                replica->caughtUpAt = now;
+        }
+        std::lock_guard lock{probeMutex_};
+        lastProbe_ = now;
+    }
+
+  private:
+    Lease primaryLease() { return Lease{primary_.get(), false}; }
+
+    void probeIfDue() {
+        {
+            std::lock_guard lock{probeMutex_};
+            if (lastProbe_.has_value() &&
+                Clock::now() - *lastProbe_ < options_.probeInterval)
+                return;
+        }
+        // One caller probes while concurrent reads use the previous state.
+        std::unique_lock guard{probing_, std::try_to_lock};
+        if (!guard.owns_lock()) return;
+        try {
+            probe();
+        } catch (const sw::redis::Error &) {
+            // Primary unreachable: keep routing on the last known state.
+            std::lock_guard lock{probeMutex_};
+            lastProbe_ = Clock::now();
+        }
+    }
+
+    bool isFreshEnough(const Endpoint &replica, const ReadOptions &options,
+                       Clock::time_point now) const {
+        if (!replica.linkUp) return false;
+        if (options.maxLagBytes.has_value() &&
+            replica.lagBytes > *options.maxLagBytes)
+            return false;
+        if (options.maxStaleness.has_value()) {
+            if (!replica.caughtUpAt.has_value()) return false;
+            return now - *replica.caughtUpAt <= *options.maxStaleness;
+        }
+        return true;
+    }
+
+    void markDown(sw::redis::Redis *db) {
+        std::lock_guard lock{probeMutex_};
+        for (auto &replica : replicas_)
+            if (replica->db == db) replica->linkUp = false;
+    }
+
+    std::unique_ptr<Endpoint> primary_;
+    std::vector<std::unique_ptr<Endpoint>> replicas_;
+    RouterOptions options_;
+    std::atomic<std::size_t> next_{0};
+    std::mutex probing_;
+    mutable std::mutex probeMutex_;
+    std::optional<Clock::time_point> lastProbe_;
+};
+
+} // namespace routing
+
+} // namespace redis_time_series
@@ -0,0 +1,378 @@
+#pragma once
+
+#include "redis_time_series.h"
+#include "redis_time_series_aggregation.h"
+
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <map>
+
+namespace redis_time_series {
+
+// Client-side quantiles over ranges too large to pull into memory at once.
+// Samples are streamed page by page into one DDSketch per time bucket; the
+// sketches are mergeable across buckets and series, serializable, and can
+// be kept in a companion hash so later queries reuse them instead of
+// reading the raw samples again.
+namespace sketch {
+
+struct SketchOptions {
+    // Every quantile is within this relative error of the true value.
+    double relativeAccuracy = 0.01;
+    // Bound on the bins of one sketch; past it the bins closest to zero
+    // are merged, which only affects the accuracy of the lowest quantiles.
+    std::size_t maxBins = 2048;
+};
+
+// DDSketch (Masson, Rim, Lee; VLDB 2019) with a sparse, collapsing store.
+class DDSketch {
+  public:
+    explicit DDSketch(SketchOptions options = {}) : options_{options} {
+        if (!(options_.relativeAccuracy > 0 && options_.relativeAccuracy < 1))
+            throw std::invalid_argument("Relative accuracy must be in (0, 1)");
+        options_.maxBins = std::max<std::size_t>(options_.maxBins, 2);
+        gamma_ = (1 + options_.relativeAccuracy) /
+                 (1 - options_.relativeAccuracy);
+        logGamma_ = std::log(gamma_);
+    }
+
+    const SketchOptions &options() const { return options_; }
+    uint64_t count() const { return count_; }
+    bool empty() const { return count_ == 0; }
+    double sum() const { return sum_; }
+    double min() const { return min_; }
+    double max() const { return max_; }
+    double average() const {
+        return count_ == 0 ? std::nan("") : sum_ / static_cast<double>(count_);
+    }
+    std::size_t bins() const { return positive_.size() + negative_.size(); }
+
+    // NaN is ignored.
+    void add(double value, uint64_t count = 1) {
+        if (std::isnan(value) || count == 0) return;
+        if (std::abs(value) < kMinIndexable)
+            zero_ += count;
+        else if (value > 0)
+            positive_[index(value)] += count;
+        else
+            negative_[index(-value)] += count;
+        min_ = count_ == 0 ? value : std::min(min_, value);
+        max_ = count_ == 0 ? value : std::max(max_, value);
+        count_ += count;
+        sum_ += value * static_cast<double>(count);
+        collapse();
+    }
+
+    void merge(const DDSketch &other) {
+        if (other.gamma_ != gamma_) {
+            throw std::invalid_argument(
+                "Sketches with different accuracy cannot be merged");
+        }
+        if (other.empty()) return;
+        for (auto [index, count] : other.positive_)
+            positive_[index] += count;
+        for (auto [index, count] : other.negative_)
+            negative_[index] += count;
+        zero_ += other.zero_;
+        min_ = empty() ? other.min_ : std::min(min_, other.min_);
+        max_ = empty() ? other.max_ : std::max(max_, other.max_);
+        count_ += other.count_;
+        sum_ += other.sum_;
+        collapse();
+    }
+
+    // Value at quantile `q` in [0, 1]; NaN for an empty sketch.
+    double quantile(double q) const {
+        if (q < 0 || q > 1)
+            throw std::invalid_argument("Quantile must be in [0, 1]");
+        if (count_ == 0) return std::nan("");
+        if (q == 0) return min_;
+        if (q == 1) return max_;
+        auto rank = q * static_cast<double>(count_ - 1);
+        double seen = 0;
+        for (auto it = negative_.rbegin(); it != negative_.rend(); ++it) {
+            seen += static_cast<double>(it->second);
+            if (seen > rank) return clamp(-value(it->first));
+        }
+        seen += static_cast<double>(zero_);
+        if (seen > rank) return clamp(0);
+        for (auto [index, count] : positive_) {
+            seen += static_cast<double>(count);
+            if (seen > rank) return clamp(value(index));
+        }
+        return max_;
+    }
+
+    // Portable binary encoding (little-endian), for storage in Redis.
+    std::string serialize() const {
+        std::string out;
+        out.reserve(64 + bins() * 12);
+        out.append(kMagic, sizeof(kMagic));
+        put(out, options_.relativeAccuracy);
+        put(out, static_cast<uint64_t>(options_.maxBins));
+        put(out, count_);
+        put(out, zero_);
+        put(out, sum_);
+        put(out, min_);
+        put(out, max_);
+        for (auto *store : {&negative_, &positive_}) {
+            put(out, static_cast<uint64_t>(store->size()));
+            for (auto [index, count] : *store) {
+                put(out, static_cast<int64_t>(index));
+                put(out, count);
+            }
+        }
+        return out;
+    }
+
+    static DDSketch deserialize(std::string_view data) {
+        if (data.size() < sizeof(kMagic) ||
+            std::memcmp(data.data(), kMagic, sizeof(kMagic)) != 0) {
+            throw std::invalid_argument("Not a serialized DDSketch");
+        }
+        data.remove_prefix(sizeof(kMagic));
+        SketchOptions options;
+        options.relativeAccuracy = take<double>(data);
+        options.maxBins = static_cast<std::size_t>(take<uint64_t>(data));
+        DDSketch sketch{options};
+        sketch.count_ = take<uint64_t>(data);
+        sketch.zero_ = take<uint64_t>(data);
+        sketch.sum_ = take<double>(data);
+        sketch.min_ = take<double>(data);
+        sketch.max_ = take<double>(data);
+        for (auto *store : {&sketch.negative_, &sketch.positive_}) {
+            auto size = take<uint64_t>(data);
+            for (uint64_t i = 0; i < size; ++i) {
+                auto index = static_cast<int>(take<int64_t>(data));
+                (*store)[index] = take<uint64_t>(data);
+            }
+        }
+        if (!data.empty())
+            throw std::invalid_argument("Trailing bytes after DDSketch");
+        return sketch;
+    }
+
+  private:
+    static constexpr char kMagic[4] = {'D', 'D', 'S', '1'};
+    static constexpr double kMinIndexable = 1e-12;
+
+    int index(double value) const {
+        return static_cast<int>(std::ceil(std::log(value) / logGamma_));
+    }
+
+    // Midpoint of bin `index`, within the relative accuracy of every value
+    // that maps to it.
+    double value(int index) const {
+        return 2 * std::pow(gamma_, index) / (gamma_ + 1);
+    }
+
+    double clamp(double value) const { return std::clamp(value, min_, max_); }
+
+    // Folds the bins closest to zero of the larger store into their
+    // neighbour until the sketch fits in maxBins.
+    void collapse() {
+        while (bins() > options_.maxBins) {
+            auto &store = positive_.size() >= negative_.size() ? positive_
+                                                               : negative_;
+            auto lowest = store.begin();
+            auto next = std::next(lowest);
+            next->second += lowest->second;
+            store.erase(lowest);
+        }
+    }
+
+    template <typename T>
+    static void put(std::string &out, T value) {
+        static_assert(sizeof(T) == 8);
+        auto bits = std::bit_cast<uint64_t>(value);
+        for (int i = 0; i < 8; ++i)
+            out.push_back(static_cast<char>((bits >> (8 * i)) & 0xFF));
+    }
+
+    template <typename T>
+    static T take(std::string_view &data) {
+        static_assert(sizeof(T) == 8);
+        if (data.size() < 8)
+            throw std::invalid_argument("Truncated DDSketch");
+        uint64_t bits = 0;
+        for (int i = 0; i < 8; ++i)
+            bits |= static_cast<uint64_t>(static_cast<unsigned char>(data[i]))
+                    << (8 * i);
+        data.remove_prefix(8);
+        return std::bit_cast<T>(bits);
+    }
+
+    SketchOptions options_;
+    double gamma_;
+    double logGamma_;
+    std::map<int, uint64_t> positive_;
+    std::map<int, uint64_t> negative_;
+    uint64_t zero_{0};
+    uint64_t count_{0};
+    double sum_{0};
+    double min_{0};
+    double max_{0};
+};
+
+// Sketch per bucket start, in time order.
+using BucketSketches = std::map<uint64_t, DDSketch>;
+
+struct BucketOptions {
+    // Bucket width in milliseconds, as the timeBucket of an aggregation.
+    uint64_t timeBucket = 60000;
+    // ALIGN of the buckets: "-" for the range start, "+" for its end, a
+    // timestamp, or none for epoch-aligned buckets like the server.
+    TimeStamp align{};
+    // Samples per TS.RANGE/TS.MRANGE page (COUNT).
+    uint64_t pageSize = 10000;
+    SketchOptions sketch{};
+};
+
+inline uint64_t alignmentOf(const TimeStamp &align, uint64_t from,
+                            uint64_t to) {
+    auto text = align.to_string();
+    if (text == "-") return from;
+    if (text == "+") return to;
+    return align.value();
+}
+
+// Adds the samples of `columns` to the sketches of their buckets.
+inline void addSamples(BucketSketches &buckets,
+                       const TimeSeriesColumns &columns, uint64_t timeBucket,
+                       uint64_t alignment, const SketchOptions &options = {}) {
+    auto current = buckets.end();
+    for (size_t i = 0; i < columns.size(); ++i) {
+        auto start = aggregation::bucketStart(columns.timestamps[i], timeBucket,
+                                              alignment);
+        if (current == buckets.end() || current->first != start)
+            current = buckets.try_emplace(start, options).first;
+        current->second.add(columns.values[i]);
+    }
+}
+
+// Streams [from, to] of `key` in TS.RANGE pages of `pageSize` samples, so
+// memory stays bounded by one page however long the range is.
+inline void
+forEachPage(sw::redis::Redis *db, const std::string &key, uint64_t from,
+            uint64_t to, uint64_t pageSize,
+            const std::function<void(const TimeSeriesColumns &)> &onPage) {
+    pageSize = std::max<uint64_t>(pageSize, 1);
+    TimeSeriesColumns page;
+    while (from <= to) {
+        page.clear();
+        client::timeSeriesRangeColumns(db, key, TimeStamp{from}, TimeStamp{to},
+                                       page, pageSize);
+        if (!page.empty()) onPage(page);
+        if (page.size() < pageSize || page.timestamps.back() == to) break;
+        from = page.timestamps.back() + 1;
+    }
+}
+
+inline BucketSketches rangeSketches(sw::redis::Redis *db,
+                                    const std::string &key, uint64_t from,
+                                    uint64_t to,
+                                    const BucketOptions &options = {}) {
+    BucketSketches buckets;
+    auto alignment = alignmentOf(options.align, from, to);
+    forEachPage(db, key, from, to, options.pageSize,
+                [&](const TimeSeriesColumns &page) {
+                    addSamples(buckets, page, options.timeBucket, alignment,
+                               options.sketch);
+                });
+    return buckets;
+}
+
+// Bucket sketches of every series matching `filter`. TS.MRANGE is paged
+// with COUNT per series: series that filled their page continue from their
+// own last timestamp, and samples a series already delivered are skipped
+// when a later page re-reads it.
+inline std::map<std::string, BucketSketches>
+multiRangeSketches(sw::redis::Redis *db, const std::vector<std::string> &filter,
+                   uint64_t from, uint64_t to,
+                   const BucketOptions &options = {}) {
+    std::map<std::string, BucketSketches> result;
+    std::map<std::string, uint64_t> cursors;
+    auto alignment = alignmentOf(options.align, from, to);
+    auto pageSize = std::max<uint64_t>(options.pageSize, 1);
+    auto pageFrom = from;
+    TimeSeriesColumns columns;
+    while (pageFrom <= to) {
+        auto entries = client::timeSeriesMRange(
+            db, TimeStamp{pageFrom}, TimeStamp{to}, filter, pageSize);
+        std::optional<uint64_t> next;
+        for (auto &[key, labels, samples] : entries) {
+            auto cursor = cursors.try_emplace(key, from).first;
+            columns.clear();
+            for (auto &sample : samples) {
+                auto timestamp = sample.time().value();
+                if (timestamp >= cursor->second)
+                    columns.push_back(timestamp, sample.value());
+            }
+            addSamples(result[key], columns, options.timeBucket, alignment,
+                       options.sketch);
+            if (samples.empty()) continue;
+            auto last = samples.back().time().value();
+            cursor->second = std::max(cursor->second, last + 1);
+            if (samples.size() == pageSize && last < to)
+                next = std::min(next.value_or(last + 1), last + 1);
+        }
+        if (!next.has_value()) break;
+        pageFrom = *next;
+    }
+    return result;
+}
+
+// Merges the same buckets of several series, e.g. the p99 of a fleet.
+inline BucketSketches
+mergeSeries(const std::map<std::string, BucketSketches> &series) {
+    BucketSketches merged;
+    for (auto &[key, buckets] : series) {
+        for (auto &[start, sketch] : buckets) {
+            auto it = merged.try_emplace(start, sketch.options()).first;
+            it->second.merge(sketch);
+        }
+    }
+    return merged;
+}
+
+// Merges buckets into one sketch for their whole time span.
+inline DDSketch mergeBuckets(const BucketSketches &buckets,
+                             const SketchOptions &options = {}) {
+    DDSketch merged{buckets.empty() ? options
+                                    : buckets.begin()->second.options()};
+    for (auto &[start, sketch] : buckets)
+        merged.merge(sketch);
+    return merged;
+}
+
+// Stores the sketches in the hash `companionKey`, one field per bucket
+// start, so later queries can load them instead of the raw samples.
+inline void storeSketches(sw::redis::Redis *db, const std::string &companionKey,
+                          const BucketSketches &buckets) {
+    for (auto &[start, sketch] : buckets)
+        db->hset(companionKey, std::to_string(start), sketch.serialize());
+}
+
+// Sketches of the buckets in [from, to] stored by storeSketches().
+inline BucketSketches loadSketches(sw::redis::Redis *db,
+                                   const std::string &companionKey,
+                                   uint64_t from, uint64_t to) {
+    std::unordered_map<std::string, std::string> fields;
+    db->hgetall(companionKey, std::inserter(fields, fields.begin()));
+    BucketSketches buckets;
+    for (auto &[field, value] : fields) {
+        uint64_t start{};
+        auto [end, ec] = std::from_chars(field.data(),
+                                         field.data() + field.size(), start);
+        if (ec != std::errc{} || end != field.data() + field.size()) continue;
+        if (start < from || start > to) continue;
+        buckets.emplace(start, DDSketch::deserialize(value));
+    }
+    return buckets;
+}
+
+} // namespace sketch
+
+} // namespace redis_time_series
@@ -0,0 +1,208 @@
+#pragma once
+
+#include "redis_time_series.h"
+
+#include <cmath>
+
+namespace redis_time_series {
+
+// Current value of every series under a filter, taken with TS.MGET into
+// reusable columns, and the series that changed between two snapshots.
+// Keys and labels are interned in the global StringPool, so once every key
+// has been seen and the buffers have grown to size, polling allocates
+// nothing beyond the reply hiredis builds.
+namespace snapshot {
+
+// Columns of one MGET reply, row i being the i-th series of the reply.
+// A series without samples has timestamp 0 and a NaN value.
+struct Snapshot {
+    std::vector<StringPool::Id> keys;
+    std::vector<uint64_t> timestamps;
+    std::vector<double> values;
+    // Labels of row i are labels[labelOffsets[i], labelOffsets[i + 1]);
+    // both are empty unless labels were requested.
+    std::vector<TimeSeriesLabel> labels;
+    std::vector<uint32_t> labelOffsets;
+
+    std::size_t size() const { return keys.size(); }
+    bool empty() const { return keys.empty(); }
+    void clear() {
+        keys.clear();
+        timestamps.clear();
+        values.clear();
+        labels.clear();
+        labelOffsets.clear();
+    }
+
+    std::string_view key(std::size_t row) const {
+        return TimeSeriesLabel::pool().view(keys[row]);
+    }
+    bool hasSample(std::size_t row) const { return timestamps[row] != 0; }
+    LabelSpan labelsOf(std::size_t row) const {
+        if (labelOffsets.empty()) return {};
+        return LabelSpan(labels.data() + labelOffsets[row],
+                         labelOffsets[row + 1] - labelOffsets[row]);
+    }
+};
+
+// Fills `snapshot` from an MGET reply, reusing its capacity.
+inline void parseMGet(const redisReply &reply, Snapshot &snapshot) {
+    if (reply.type != REDIS_REPLY_ARRAY) {
+        throw sw::redis::ProtoError("Expect ARRAY reply");
+    }
+    snapshot.clear();
+    auto &pool = TimeSeriesLabel::pool();
+    for (std::size_t i = 0; i < reply.elements; ++i) {
+        auto &entry = parser::checkMGetEntry(*reply.element[i]);
+        snapshot.keys.push_back(
+            pool.intern(parser::parseStringView(*entry.element[0])));
+
+        auto &sample = *entry.element[2];
+        if (sample.type != REDIS_REPLY_ARRAY ||
+            (sample.elements != 0 && sample.elements != 2)) {
+            throw sw::redis::ProtoError("Expect sample");
+        }
+        if (sample.elements == 0) {
+            snapshot.timestamps.push_back(0);
+            snapshot.values.push_back(std::nan(""));
+        } else {
+            snapshot.timestamps.push_back(
+                parser::parseSampleTimeStamp(*sample.element[0]));
+            snapshot.values.push_back(parser::parseDouble(*sample.element[1]));
+        }
+
+        auto &labels = *entry.element[1];
+        if (!sw::redis::reply::is_array(labels)) {
+            throw sw::redis::ProtoError("Expect ARRAY reply");
+        }
+        if (labels.elements == 0 && snapshot.labelOffsets.empty()) continue;
+        if (snapshot.labelOffsets.empty())
+            snapshot.labelOffsets.assign(i + 1, 0);
+        for (std::size_t j = 0; j < labels.elements; ++j) {
+            auto &pair = *labels.element[j];
+            if (!sw::redis::reply::is_array(pair) || pair.elements != 2) {
+                throw sw::redis::ProtoError("Expect label pair");
+            }
+            // SELECTED_LABELS reports a label the series lacks as nil.
+            auto &value = *pair.element[1];
+            snapshot.labels.emplace_back(
+                parser::parseStringView(*pair.element[0]),
+                value.type == REDIS_REPLY_NIL
+                    ? std::string_view{}
+                    : parser::parseStringView(value));
+        }
+        snapshot.labelOffsets.push_back(
+            static_cast<uint32_t>(snapshot.labels.size()));
+    }
+}
+
+enum class ChangeKind { ADDED, UPDATED, REMOVED };
+
+struct SeriesChange {
+    ChangeKind kind;
+    StringPool::Id key;
+    // The new sample; for REMOVED, the last one seen.
+    uint64_t timestamp;
+    double value;
+
+    std::string_view keyName() const {
+        return TimeSeriesLabel::pool().view(key);
+    }
+};
+
+// Compares snapshots by key and collects into `changes` (cleared first) the
+// series that appeared, disappeared, or whose timestamp or value differ.
+// Values are compared bitwise, so a NaN that stays NaN is not a change.
+// MGET returns series in a stable order, so rows are matched by position
+// first; `index` is only filled when the membership changed, and is kept
+// by the caller to reuse its buckets.
+inline void
+diff(const Snapshot &previous, const Snapshot &current,
+     std::vector<SeriesChange> &changes,
+     std::unordered_map<StringPool::Id, std::size_t> &index) {
+    changes.clear();
+    auto changed = [&](std::size_t from, std::size_t to) {
+        return previous.timestamps[from] != current.timestamps[to] ||
+               std::bit_cast<uint64_t>(previous.values[from]) !=
+                   std::bit_cast<uint64_t>(current.values[to]);
+    };
+    auto report = [&](ChangeKind kind, const Snapshot &from, std::size_t row) {
+        changes.push_back(
+            {kind, from.keys[row], from.timestamps[row], from.values[row]});
+    };
+
+    if (previous.keys == current.keys) {
+        for (std::size_t row = 0; row < current.size(); ++row)
+            if (changed(row, row)) report(ChangeKind::UPDATED, current, row);
+        return;
+    }
+
+    index.clear();
+    for (std::size_t row = 0; row < previous.size(); ++row)
+        index.emplace(previous.keys[row], row);
+    for (std::size_t row = 0; row < current.size(); ++row) {
+        auto found = index.find(current.keys[row]);
+        if (found == index.end()) {
+            report(ChangeKind::ADDED, current, row);
+            continue;
+        }
+        if (changed(found->second, row))
+            report(ChangeKind::UPDATED, current, row);
+        index.erase(found);
+    }
+    for (std::size_t row = 0; row < previous.size(); ++row)
+        if (index.count(previous.keys[row]) != 0)
+            report(ChangeKind::REMOVED, previous, row);
+}
+
+struct PollOptions {
+    // Requests every label (WITHLABELS) ...
+    bool withLabels = false;
+    // ... or only these (SELECTED_LABELS).
+    std::vector<std::string> selectLabels;
+};
+
+// Polls TS.MGET for `filter`, keeping the previous snapshot so that each
+// poll returns only the deltas. The first poll reports every series as
+// ADDED. Not thread-safe; use one per polling loop.
+class SnapshotPoller {
+  public:
+    SnapshotPoller(sw::redis::Redis *db,
+                   const std::vector<std::string> &filter,
+                   const PollOptions &options = {})
+        : db_{db} {
+        auto args = aux::buildTsMgetArgs(
+            filter,
+            options.withLabels ? std::optional<bool>{true} : std::nullopt,
+            options.selectLabels);
+        args_.reserve(args.size() + 1);
+        args_.emplace_back(command::MGET);
+        args_.insert(args_.end(), args.begin(), args.end());
+    }
+
+    // Takes a snapshot and returns the changes since the previous one. The
+    // result stays valid until the next poll.
+    const std::vector<SeriesChange> &poll() {
+        auto reply = db_->command(args_.begin(), args_.end());
+        // Parse over the older buffers, so a bad reply leaves current()
+        // and the next diff's baseline untouched.
+        parseMGet(*reply, previous_);
+        std::swap(previous_, current_);
+        diff(previous_, current_, changes_, index_);
+        return changes_;
+    }
+
+    const Snapshot &current() const { return current_; }
+
+  private:
+    sw::redis::Redis *db_;
+    std::vector<std::string> args_;
+    Snapshot previous_;
+    Snapshot current_;
+    std::vector<SeriesChange> changes_;
+    std::unordered_map<StringPool::Id, std::size_t> index_;
+};
+
+} // namespace snapshot
+
+} // namespace redis_time_series
@@ -0,0 +1,389 @@
+#pragma once
+
+#include "redis_time_series.h"
+
+namespace redis_time_series {
+
+// Outcome of one TS.MADD entry. Like the module, madd applies every entry
+// it can and reports the others one by one.
+struct MAddResult {
+    // Timestamp the sample was stored at.
+    TimeStamp timeStamp;
+    // Set when the entry failed, to the module's "TSDB: ..." message.
+    std::optional<std::string> error;
+};
+
+// The single-key operations of namespace client behind a virtual interface,
+// so collectors can be pointed at a Redis server or at the in-process
+// engine (embedded::EmbeddedStore) at runtime. Errors are reported the same
+// way by every implementation: as sw::redis::ReplyError carrying the
+// module's "TSDB: ..." message, except for the per-entry results of madd.
+//
+// The public functions hold the default arguments and forward to private
+// virtual ones, which implementations override, so the defaults are the
+// same whatever type a store is called through.
+class TimeSeriesStore {
+  public:
+    virtual ~TimeSeriesStore() = default;
+
+    bool create(const std::string &key,
+                std::optional<uint64_t> retentionTime = std::nullopt,
+                LabelSpan labels = {},
+                std::optional<bool> uncompressed = std::nullopt,
+                std::optional<long> chunkSizeBytes = std::nullopt,
+                std::optional<command_operator::TsDuplicatePolicy>
+                    duplicatePolicy = std::nullopt) {
+        return doCreate(key, retentionTime, labels, uncompressed,
+                        chunkSizeBytes, duplicatePolicy);
+    }
+
+    bool alter(const std::string &key,
+               std::optional<uint64_t> retentionTime = std::nullopt,
+               LabelSpan labels = {},
+               std::optional<command_operator::TsDuplicatePolicy>
+                   duplicatePolicy = std::nullopt) {
+        return doAlter(key, retentionTime, labels, duplicatePolicy);
+    }
+
+    // `duplicatePolicy` overrides the series policy for this sample
+    // (ON_DUPLICATE).
+    TimeStamp
+    add(const std::string &key, const TimeStamp &timestamp, double value,
+        std::optional<uint64_t> retentionTime = std::nullopt,
+        LabelSpan labels = {},
+        std::optional<bool> uncompressed = std::nullopt,
+        std::optional<long> chunkSizeBytes = std::nullopt,
+        std::optional<command_operator::TsDuplicatePolicy> duplicatePolicy =
+            std::nullopt) {
+        return doAdd(key, timestamp, value, retentionTime, labels,
+                     uncompressed, chunkSizeBytes, duplicatePolicy);
+    }
+
+    // One result per entry, in order.
+    std::vector<MAddResult>
+    madd(const std::vector<std::tuple<std::string, TimeStamp, double>>
+             &sequence) {
+        return doMAdd(sequence);
+    }
+
+    TimeStamp incrBy(const std::string &key, double value,
+                     const TimeStamp &timestamp = {},
+                     std::optional<uint64_t> retentionTime = std::nullopt,
+                     LabelSpan labels = {},
+                     std::optional<bool> uncompressed = std::nullopt,
+                     std::optional<long> chunkSizeBytes = std::nullopt) {
+        return doIncrBy(key, value, timestamp, retentionTime, labels,
+                        uncompressed, chunkSizeBytes);
+    }
+
+    TimeStamp decrBy(const std::string &key, double value,
+                     const TimeStamp &timestamp = {},
+                     std::optional<uint64_t> retentionTime = std::nullopt,
+                     LabelSpan labels = {},
+                     std::optional<bool> uncompressed = std::nullopt,
+                     std::optional<long> chunkSizeBytes = std::nullopt) {
+        return doDecrBy(key, value, timestamp, retentionTime, labels,
+                        uncompressed, chunkSizeBytes);
+    }
+
+    uint64_t del(const std::string &key, const TimeStamp &fromTimeStamp,
+                 const TimeStamp &toTimeStamp) {
+        return doDel(key, fromTimeStamp, toTimeStamp);
+    }
+
+    bool createRule(const std::string &sourceKey, const TimeSeriesRule &rule) {
+        return doCreateRule(sourceKey, rule);
+    }
+
+    bool deleteRule(const std::string &sourceKey, const std::string &destKey) {
+        return doDeleteRule(sourceKey, destKey);
+    }
+
+    // Latest sample; time() has no value for an empty series.
+    TimeSeriesTuple get(const std::string &key) { return doGet(key); }
+
+    std::vector<TimeSeriesTuple>
+    range(const std::string &key, const TimeStamp &fromTimeStamp,
+          const TimeStamp &toTimeStamp,
+          std::optional<uint64_t> count = std::nullopt,
+          std::optional<command_operator::TsAggregation> aggregation =
+              std::nullopt,
+          std::optional<uint64_t> timeBucket = std::nullopt,
+          const std::vector<TimeStamp> &filterByTs = {},
+          std::optional<std::pair<uint64_t, uint64_t>> filterByValue =
+              std::nullopt,
+          const TimeStamp &align = {}) {
+        return doRange(key, fromTimeStamp, toTimeStamp, count, aggregation,
+                       timeBucket, filterByTs, filterByValue, align);
+    }
+
+    std::vector<TimeSeriesTuple>
+    revRange(const std::string &key, const TimeStamp &fromTimeStamp,
+             const TimeStamp &toTimeStamp,
+             std::optional<uint64_t> count = std::nullopt,
+             std::optional<command_operator::TsAggregation> aggregation =
+                 std::nullopt,
+             std::optional<uint64_t> timeBucket = std::nullopt,
+             const std::vector<TimeStamp> &filterByTs = {},
+             std::optional<std::pair<uint64_t, uint64_t>> filterByValue =
+                 std::nullopt,
+             const TimeStamp &align = {}) {
+        return doRevRange(key, fromTimeStamp, toTimeStamp, count, aggregation,
+                          timeBucket, filterByTs, filterByValue, align);
+    }
+
+    TimeSeriesInformation info(const std::string &key) { return doInfo(key); }
+
+  private:
+    virtual bool
+    doCreate(const std::string &key, std::optional<uint64_t> retentionTime,
+             LabelSpan labels, std::optional<bool> uncompressed,
+             std::optional<long> chunkSizeBytes,
+             std::optional<command_operator::TsDuplicatePolicy>
+                 duplicatePolicy) = 0;
+
+    virtual bool doAlter(const std::string &key,
+                         std::optional<uint64_t> retentionTime,
+                         LabelSpan labels,
+                         std::optional<command_operator::TsDuplicatePolicy>
+                             duplicatePolicy) = 0;
+
+    virtual TimeStamp
+    doAdd(const std::string &key, const TimeStamp &timestamp, double value,
+          std::optional<uint64_t> retentionTime, LabelSpan labels,
+          std::optional<bool> uncompressed,
+          std::optional<long> chunkSizeBytes,
+          std::optional<command_operator::TsDuplicatePolicy>
+              duplicatePolicy) = 0;
+
+    virtual std::vector<MAddResult>
+    doMAdd(const std::vector<std::tuple<std::string, TimeStamp, double>>
+               &sequence) = 0;
+
+    virtual TimeStamp doIncrBy(const std::string &key, double value,
+                               const TimeStamp &timestamp,
+                               std::optional<uint64_t> retentionTime,
+                               LabelSpan labels,
+                               std::optional<bool> uncompressed,
+                               std::optional<long> chunkSizeBytes) = 0;
+
+    virtual TimeStamp doDecrBy(const std::string &key, double value,
+                               const TimeStamp &timestamp,
+                               std::optional<uint64_t> retentionTime,
+                               LabelSpan labels,
+                               std::optional<bool> uncompressed,
+                               std::optional<long> chunkSizeBytes) = 0;
+
+    virtual uint64_t doDel(const std::string &key,
+                           const TimeStamp &fromTimeStamp,
+                           const TimeStamp &toTimeStamp) = 0;
+
+    virtual bool doCreateRule(const std::string &sourceKey,
+                              const TimeSeriesRule &rule) = 0;
+
+    virtual bool doDeleteRule(const std::string &sourceKey,
+                              const std::string &destKey) = 0;
+
+    virtual TimeSeriesTuple doGet(const std::string &key) = 0;
+
+    virtual std::vector<TimeSeriesTuple>
+    doRange(const std::string &key, const TimeStamp &fromTimeStamp,
+            const TimeStamp &toTimeStamp, std::optional<uint64_t> count,
+            std::optional<command_operator::TsAggregation> aggregation,
+            std::optional<uint64_t> timeBucket,
+            const std::vector<TimeStamp> &filterByTs,
+            std::optional<std::pair<uint64_t, uint64_t>> filterByValue,
+            const TimeStamp &align) = 0;
+
+    virtual std::vector<TimeSeriesTuple>
+    doRevRange(const std::string &key, const TimeStamp &fromTimeStamp,
+               const TimeStamp &toTimeStamp, std::optional<uint64_t> count,
+               std::optional<command_operator::TsAggregation> aggregation,
+               std::optional<uint64_t> timeBucket,
+               const std::vector<TimeStamp> &filterByTs,
+               std::optional<std::pair<uint64_t, uint64_t>> filterByValue,
+               const TimeStamp &align) = 0;
+
+    virtual TimeSeriesInformation doInfo(const std::string &key) = 0;
+};
+
+namespace detail {
+
+// TS.MADD reply: per entry, the timestamp or the error it failed with.
+inline std::vector<MAddResult> parseMAddReply(const redisReply &reply,
+                                              std::size_t expected) {
+    if (reply.type != REDIS_REPLY_ARRAY || reply.elements != expected) {
+        throw sw::redis::ProtoError("Expect one result per entry");
+    }
+    std::vector<MAddResult> results;
+    results.reserve(expected);
+    for (std::size_t i = 0; i < reply.elements; ++i) {
+        auto &entry = *reply.element[i];
+        if (entry.type == REDIS_REPLY_ERROR) {
+            results.push_back({TimeStamp{}, std::string{entry.str, entry.len}});
+            continue;
+        }
+        if (entry.type != REDIS_REPLY_INTEGER) {
+            throw sw::redis::ProtoError("Expect a timestamp or an error");
+        }
+        results.push_back(
+            {parser::parseTimeStamp(static_cast<uint64_t>(entry.integer)),
+             std::nullopt});
+    }
+    return results;
+}
+
+} // namespace detail
+
+// TimeSeriesStore over a Redis server, forwarding to namespace client.
+class RedisStore : public TimeSeriesStore {
+  public:
+    explicit RedisStore(sw::redis::Redis *db) : db_{db} {}
+
+    sw::redis::Redis *redis() const { return db_; }
+
+  private:
+    bool doCreate(const std::string &key,
+                  std::optional<uint64_t> retentionTime, LabelSpan labels,
+                  std::optional<bool> uncompressed,
+                  std::optional<long> chunkSizeBytes,
+                  std::optional<command_operator::TsDuplicatePolicy>
+                      duplicatePolicy) override {
+        return client::timeSeriesCreate(db_, key, retentionTime, labels,
+                                        uncompressed, chunkSizeBytes,
+                                        duplicatePolicy);
+    }
+
+    bool doAlter(const std::string &key, std::optional<uint64_t> retentionTime,
+                 LabelSpan labels,
+                 std::optional<command_operator::TsDuplicatePolicy>
+                     duplicatePolicy) override {
+        return client::timeSeriesAlter(db_, key, retentionTime, labels,
+                                       duplicatePolicy);
+    }
+
+    TimeStamp doAdd(const std::string &key, const TimeStamp &timestamp,
+                    double value, std::optional<uint64_t> retentionTime,
+                    LabelSpan labels, std::optional<bool> uncompressed,
+                    std::optional<long> chunkSizeBytes,
+                    std::optional<command_operator::TsDuplicatePolicy>
+                        duplicatePolicy) override {
+        return client::timeSeriesAdd(db_, key, timestamp, value, retentionTime,
+                                     labels, uncompressed, chunkSizeBytes,
+                                     duplicatePolicy);
+    }
+
+    // client::timeSeriesMAdd parses the reply as integers only, so a
+    // failed entry would fail the whole call; the raw reply keeps them
+    // apart.
+    std::vector<MAddResult>
+    doMAdd(const std::vector<std::tuple<std::string, TimeStamp, double>>
+               &sequence) override {
+        auto args = aux::buildTsMaddArgs(sequence);
+        args.emplace(args.begin(), command::MADD);
+        auto reply = db_->command(args.begin(), args.end());
+        return detail::parseMAddReply(*reply, sequence.size());
+    }
+
+    TimeStamp doIncrBy(const std::string &key, double value,
+                       const TimeStamp &timestamp,
+                       std::optional<uint64_t> retentionTime,
+                       LabelSpan labels, std::optional<bool> uncompressed,
+                       std::optional<long> chunkSizeBytes) override {
+        return client::timeSeriesIncrBy(db_, key, value, timestamp,
+                                        retentionTime, labels, uncompressed,
+                                        chunkSizeBytes);
+    }
+
+    TimeStamp doDecrBy(const std::string &key, double value,
+                       const TimeStamp &timestamp,
+                       std::optional<uint64_t> retentionTime,
+                       LabelSpan labels, std::optional<bool> uncompressed,
+                       std::optional<long> chunkSizeBytes) override {
+        return client::timeSeriesDecrBy(db_, key, value, timestamp,
+                                        retentionTime, labels, uncompressed,
+                                        chunkSizeBytes);
+    }
+
+    uint64_t doDel(const std::string &key, const TimeStamp &fromTimeStamp,
+                   const TimeStamp &toTimeStamp) override {
+        return client::timeSeriesDel(db_, key, fromTimeStamp, toTimeStamp);
+    }
+
+    bool doCreateRule(const std::string &sourceKey,
+                      const TimeSeriesRule &rule) override {
+        return client::timeSeriesCreateRule(db_, sourceKey, rule);
+    }
+
+    bool doDeleteRule(const std::string &sourceKey,
+                      const std::string &destKey) override {
+        return client::timeSeriesDeleteRule(db_, sourceKey, destKey);
+    }
+
+    TimeSeriesTuple doGet(const std::string &key) override {
+        auto reply = db_->command(command::GET, key);
+        return parser::parseSample(*reply);
+    }
+
+    std::vector<TimeSeriesTuple>
+    doRange(const std::string &key, const TimeStamp &fromTimeStamp,
+            const TimeStamp &toTimeStamp, std::optional<uint64_t> count,
+            std::optional<command_operator::TsAggregation> aggregation,
+            std::optional<uint64_t> timeBucket,
+            const std::vector<TimeStamp> &filterByTs,
+            std::optional<std::pair<uint64_t, uint64_t>> filterByValue,
+            const TimeStamp &align) override {
+        return client::timeSeriesRange(db_, key, fromTimeStamp, toTimeStamp,
+                                       count, aggregation, timeBucket,
+                                       filterByTs, filterByValue, align);
+    }
+
+    std::vector<TimeSeriesTuple>
+    doRevRange(const std::string &key, const TimeStamp &fromTimeStamp,
+               const TimeStamp &toTimeStamp, std::optional<uint64_t> count,
+               std::optional<command_operator::TsAggregation> aggregation,
+               std::optional<uint64_t> timeBucket,
+               const std::vector<TimeStamp> &filterByTs,
+               std::optional<std::pair<uint64_t, uint64_t>> filterByValue,
+               const TimeStamp &align) override {
+        return client::timeSeriesRevRange(db_, key, fromTimeStamp, toTimeStamp,
+                                          count, aggregation, timeBucket,
+                                          filterByTs, filterByValue, align);
+    }
+
+    TimeSeriesInformation doInfo(const std::string &key) override {
+        return client::timeSeriesInfo(db_, key);
+    }
+
+    sw::redis::Redis *db_;
+};
+
+// Copies the samples of `key` in [from, to] from `source` to `target` with
+// TS.MADD batches of `batchSize`, e.g. to push what an edge node stored
+// locally to the central server once it is reachable. The target series
+// must exist. Samples the target refuses, e.g. duplicates under BLOCK, are
+// skipped. Returns the number of samples copied.
+inline std::size_t replicate(TimeSeriesStore &source, TimeSeriesStore &target,
+                             const std::string &key,
+                             const TimeStamp &fromTimeStamp,
+                             const TimeStamp &toTimeStamp,
+                             std::size_t batchSize = 1000) {
+    auto samples = source.range(key, fromTimeStamp, toTimeStamp);
+    batchSize = std::max<std::size_t>(batchSize, 1);
+    std::vector<std::tuple<std::string, TimeStamp, double>> batch;
+    batch.reserve(std::min(batchSize, samples.size()));
+    std::size_t copied = 0;
+    auto send = [&] {
+        for (auto &result : target.madd(batch))
+            if (!result.error.has_value()) ++copied;
+        batch.clear();
+    };
+    for (auto &sample : samples) {
+        batch.emplace_back(key, sample.time(), sample.value());
+        if (batch.size() == batchSize) send();
+    }
+    if (!batch.empty()) send();
+    return copied;
+}
+
+} // namespace redis_time_series
@@ -0,0 +1,265 @@
+#pragma once
+
+#include "redis_time_series.h"
+
+namespace redis_time_series {
+
+// Batched "create with labels if missing, then add" done server-side. A Lua
+// script, loaded once and called by its SHA, takes many entries per EVALSHA
+// and for each one creates the series when the key does not exist, then
+// adds the sample, so a sample for a new series costs no extra round trip.
+// Entries refer to label sets by index, and each set is sent once per call
+// however many entries use it. The keys of one call must live on the same
+// node; on a cluster, give them a common hash tag.
+namespace upsert {
+
+// KEYS are the entries' keys. ARGV holds the retention and ON_DUPLICATE
+// policy ("" when unset), the number of label sets, each set as a pair
+// count followed by its names and values, then per entry its timestamp,
+// value and 1-based label set (0 for none). Returns per entry
+// [timestamp, created] or the error met.
+constexpr char SCRIPT[] = R"lua(
+local retention, policy = ARGV[1], ARGV[2]
+local sets, at = {}, 4
+for s = 1, tonumber(ARGV[3]) do
+    local count, set = tonumber(ARGV[at]), {}
+    for i = 1, 2 * count do set[i] = ARGV[at + i] end
+    sets[s], at = set, at + 2 * count + 1
+end
+local results = {}
+for k = 1, #KEYS do
+    local key, created, failed = KEYS[k], 0, nil
+    if redis.call('EXISTS', key) == 0 then
+        local create = {'TS.CREATE', key}
+        if retention ~= '' then
+            create[#create + 1] = 'RETENTION'
+            create[#create + 1] = retention
+        end
+        local set = sets[tonumber(ARGV[at + 2])]
+        if set and #set > 0 then
+            create[#create + 1] = 'LABELS'
+            for i = 1, #set do create[#create + 1] = set[i] end
+        end
+        local reply = redis.pcall(unpack(create))
+        if type(reply) == 'table' and reply.err then
+            failed = reply
+        else
+            created = 1
+        end
+    end
+    if failed then
+        results[k] = failed
+    else
+        local add = {'TS.ADD', key, ARGV[at], ARGV[at + 1]}
+        if policy ~= '' then
+            add[#add + 1] = 'ON_DUPLICATE'
+            add[#add + 1] = policy
+        end
+        local reply = redis.pcall(unpack(add))
+        if type(reply) == 'table' and reply.err then
+            results[k] = reply
+        else
+            results[k] = {reply, created}
+        end
+    end
+    at = at + 3
+end
+return results
+)lua";
+
+struct UpsertOptions {
+    // Applied to series the script creates.
+    std::optional<uint64_t> retentionTime;
+    // ON_DUPLICATE for every TS.ADD; LAST makes the call a true upsert.
+    std::optional<command_operator::TsDuplicatePolicy> duplicatePolicy;
+    // Entries per EVALSHA. The script blocks the server while it runs, so
+    // this bounds the pause other clients see.
+    std::size_t batchSize = 500;
+};
+
+struct UpsertResult {
+    // Timestamp the sample was stored at.
+    TimeStamp timeStamp;
+    // Whether the series was created for this entry.
+    bool created{false};
+    // Set when the entry failed; the other entries are still applied.
+    std::optional<std::string> error;
+};
+
+// Entries for BatchUpserter::upsert. Label sets are registered once and
+// referred to by the index addLabels returns.
+class UpsertBatch {
+  public:
+    struct Entry {
+        std::string key;
+        TimeStamp timeStamp;
+        double value;
+        // 1 + index of the label set, 0 for none.
+        std::size_t labels;
+    };
+
+    std::size_t addLabels(std::vector<TimeSeriesLabel> labels) {
+        labelSets_.push_back(std::move(labels));
+        return labelSets_.size() - 1;
+    }
+
+    // `labels` only matters when the series has to be created.
+    void add(std::string key, TimeStamp timeStamp, double value,
+             std::optional<std::size_t> labels = std::nullopt) {
+        if (labels.has_value() && *labels >= labelSets_.size())
+            throw std::out_of_range("unknown label set");
+        entries_.push_back({std::move(key), std::move(timeStamp), value,
+                            labels.has_value() ? *labels + 1 : 0});
+    }
+
+    const std::vector<Entry> &entries() const { return entries_; }
+    const std::vector<std::vector<TimeSeriesLabel>> &labelSets() const {
+        return labelSets_;
+    }
+    std::size_t size() const { return entries_.size(); }
+    bool empty() const { return entries_.empty(); }
+    void clear() {
+        entries_.clear();
+        labelSets_.clear();
+    }
+
+  private:
+    std::vector<Entry> entries_;
+    std::vector<std::vector<TimeSeriesLabel>> labelSets_;
+};
+
+namespace detail {
+
+// EVALSHA arguments for entries [begin, end) of `batch`, after the command
+// name and the SHA. Only the label sets these entries use are sent,
+// renumbered in order of first use.
+inline aux::ArgList buildUpsertArgs(const UpsertBatch &batch,
+                                    std::size_t begin, std::size_t end,
+                                    const UpsertOptions &options) {
+    auto &entries = batch.entries();
+    auto &labelSets = batch.labelSets();
+    std::vector<std::size_t> sent(labelSets.size(), 0);
+    std::vector<std::size_t> order;
+    std::size_t labelArgs = 0;
+    for (auto i = begin; i < end; ++i) {
+        auto labels = entries[i].labels;
+        if (labels == 0 || sent[labels - 1] != 0) continue;
+        order.push_back(labels - 1);
+        sent[labels - 1] = order.size();
+        labelArgs += 1 + 2 * labelSets[labels - 1].size();
+    }
+
+    auto args = aux::makeArgs(std::pmr::get_default_resource(),
+                              4 + 4 * (end - begin) + labelArgs);
+    args.emplace_back(std::to_string(end - begin));
+    for (auto i = begin; i < end; ++i)
+        args.emplace_back(entries[i].key);
+    args.emplace_back(options.retentionTime.has_value()
+                          ? std::to_string(*options.retentionTime)
+                          : std::string{});
+    args.emplace_back(options.duplicatePolicy.has_value()
+                          ? command_operator::to_string(
+                                *options.duplicatePolicy)
+                          : std::string{});
+    args.emplace_back(std::to_string(order.size()));
+    for (auto set : order) {
+        args.emplace_back(std::to_string(labelSets[set].size()));
+        for (auto &label : labelSets[set]) {
+            args.emplace_back(label.key());
+            args.emplace_back(label.value());
+        }
+    }
+    for (auto i = begin; i < end; ++i) {
+        auto &entry = entries[i];
+        args.emplace_back(entry.timeStamp.to_string());
+        args.emplace_back(fmt::format("{}", entry.value));
+        args.emplace_back(std::to_string(
+            entry.labels == 0 ? 0 : sent[entry.labels - 1]));
+    }
+    return args;
+}
+
+// Appends the script's per-entry results to `results`.
+inline void parseUpsertReply(const redisReply &reply, std::size_t expected,
+                             std::vector<UpsertResult> &results) {
+    if (reply.type != REDIS_REPLY_ARRAY || reply.elements != expected) {
+        throw sw::redis::ProtoError("Expect one result per entry");
+    }
+    for (std::size_t i = 0; i < reply.elements; ++i) {
+        auto &entry = *reply.element[i];
+        if (entry.type == REDIS_REPLY_ERROR) {
+            results.push_back(
+                {TimeStamp{}, false, std::string{entry.str, entry.len}});
+            continue;
+        }
+        if (entry.type != REDIS_REPLY_ARRAY || entry.elements != 2 ||
+            entry.element[0]->type != REDIS_REPLY_INTEGER ||
+            entry.element[1]->type != REDIS_REPLY_INTEGER) {
+            throw sw::redis::ProtoError("Expect [timestamp, created]");
+        }
+        results.push_back(
+            {parser::parseTimeStamp(
+                 static_cast<uint64_t>(entry.element[0]->integer)),
+             entry.element[1]->integer != 0, std::nullopt});
+    }
+}
+
+inline bool isNoScript(const sw::redis::ReplyError &error) {
+    return std::string_view{error.what()}.starts_with("NOSCRIPT");
+}
+
+} // namespace detail
+
+// Runs UpsertBatch entries through the script, one EVALSHA per
+// options.batchSize entries. The script is loaded on first use and its SHA
+// kept; when the server has lost it (SCRIPT FLUSH, restart, failover) it is
+// loaded again and the call retried once. Not thread-safe; use one per
+// writer.
+class BatchUpserter {
+  public:
+    explicit BatchUpserter(sw::redis::Redis *db, UpsertOptions options = {})
+        : db_{db}, options_{std::move(options)} {}
+
+    // Results in entry order. Errors of single entries are reported in
+    // their results; a connection error is thrown, with the earlier calls
+    // of the batch already applied.
+    std::vector<UpsertResult> upsert(const UpsertBatch &batch) {
+        std::vector<UpsertResult> results;
+        results.reserve(batch.size());
+        auto batchSize = std::max<std::size_t>(options_.batchSize, 1);
+        for (std::size_t i = 0; i < batch.size(); i += batchSize) {
+            auto last = std::min(i + batchSize, batch.size());
+            auto args = detail::buildUpsertArgs(batch, i, last, options_);
+            args.emplace(args.begin(), sha());
+            args.emplace(args.begin(), "EVALSHA");
+            detail::parseUpsertReply(*evalsha(args), last - i, results);
+        }
+        return results;
+    }
+
+    // SHA1 of SCRIPT, loading it when not known yet.
+    const std::string &sha() {
+        if (sha_.empty()) sha_ = db_->script_load(SCRIPT);
+        return sha_;
+    }
+
+  private:
+    sw::redis::ReplyUPtr evalsha(aux::ArgList &args) {
+        try {
+            return db_->command(args.begin(), args.end());
+        } catch (const sw::redis::ReplyError &error) {
+            if (!detail::isNoScript(error)) throw;
+        }
+        sha_.clear();
+        args[1].assign(sha());
+        return db_->command(args.begin(), args.end());
+    }
+
+    sw::redis::Redis *db_;
+    UpsertOptions options_;
+    std::string sha_;
+};
+
+} // namespace upsert
+
+} // namespace redis_time_series
@@ -0,0 +1,114 @@
+#include "allocation_counter.h"
+
+#include <cstdlib>
+#include <new>
+
+// Every replaceable form of the global operator new and delete, so that
+// nothing in the executable reaches the library's own allocator. They are
+// defined in their own translation unit: the compiler does not see them
+// call malloc and free when it inlines the code under test.
+
+namespace {
+
+thread_local std::size_t allocations = 0;
+
+void *allocate(std::size_t size) {
+    ++allocations;
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+void *allocate(std::size_t size, std::align_val_t alignment) {
+    ++allocations;
+    auto align = static_cast<std::size_t>(alignment);
+    // aligned_alloc wants a size that is a multiple of the alignment.
+    if (size == 0) size = 1;
+    return std::aligned_alloc(align, (size + align - 1) / align * align);
+}
+
+template <typename... Alignment>
+void *allocateOrThrow(std::size_t size, Alignment... alignment) {
+    if (auto *memory = allocate(size, alignment...)) return memory;
+    throw std::bad_alloc();
+}
+
+} // namespace
+
+namespace test_support {
+
+std::size_t heapAllocations() { return allocations; }
+
+} // namespace test_support
+
+void *operator new(std::size_t size) { return allocateOrThrow(size); }
+
+void *operator new[](std::size_t size) { return allocateOrThrow(size); }
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+    return allocate(size);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+    return allocate(size);
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment) {
+    return allocateOrThrow(size, alignment);
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment) {
+    return allocateOrThrow(size, alignment);
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment,
+                   const std::nothrow_t &) noexcept {
+    return allocate(size, alignment);
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment,
+                     const std::nothrow_t &) noexcept {
+    return allocate(size, alignment);
+}
+
+void operator delete(void *memory) noexcept { std::free(memory); }
+
+void operator delete[](void *memory) noexcept { std::free(memory); }
+
+void operator delete(void *memory, std::size_t) noexcept { std::free(memory); }
+
+void operator delete[](void *memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void *memory, const std::nothrow_t &) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void *memory, const std::nothrow_t &) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void *memory, std::align_val_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void *memory, std::align_val_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void *memory, std::size_t, std::align_val_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void *memory, std::size_t, std::align_val_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void *memory, std::align_val_t,
+                     const std::nothrow_t &) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void *memory, std::align_val_t,
+                       const std::nothrow_t &) noexcept {
+    std::free(memory);
+}
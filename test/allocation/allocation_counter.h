@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+
+namespace test_support {
+
+// Heap allocations made by the current thread so far, counted by the global
+// operator new forms replaced in allocation_counter.cpp. Only available in
+// the allocation test executable, which links that file.
+std::size_t heapAllocations();
+
+// Heap allocations made while running `work`.
+template <typename Work>
+std::size_t countAllocations(Work &&work) {
+    auto before = heapAllocations();
+    work();
+    return heapAllocations() - before;
+}
+
+} // namespace test_support
@@ -0,0 +1,9 @@
+#include "redis_time_series_arena_allocation_test.h"
+#include "redis_time_series_snapshot_allocation_test.h"
+#include "redis_time_series_view_test.h"
+#include "gtest/gtest.h"
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,131 @@
+#include "allocation_counter.h"
+#include "redis_time_series.h"
+#include "redis_time_series_test_support.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+using namespace redis_time_series;
+using command_operator::TsAggregation;
+using command_operator::TsDuplicatePolicy;
+using test_support::countAllocations;
+using test_support::ReplyBuilder;
+
+TEST(TestArenaAllocations, TestWriteArgsStayOnArena) {
+    std::vector<TimeSeriesLabel> labels{{"site", "plant-1"}, {"unit", "kW"}};
+    std::vector<std::tuple<std::string, TimeStamp, double>> sequence{
+        {"ARENA_TESTS:a", TimeStamp{1000}, 1.5},
+        {"ARENA_TESTS:b", TimeStamp{1000}, 2.5}};
+    TimeSeriesRule rule{"ARENA_TESTS:avg", 60000, TsAggregation::AVG};
+    // A null upstream makes any allocation outside the inline buffer throw.
+    RequestArena arena{std::pmr::null_memory_resource()};
+    auto *resource = arena.resource();
+    std::size_t size = 0;
+    ASSERT_EQ(0u, countAllocations([&] {
+                  size += aux::buildTsCreateArgs(
+                              "ARENA_TESTS", 5000, labels, true, 4096,
+                              TsDuplicatePolicy::LAST, resource)
+                              .size();
+                  size += aux::buildTsAlterArgs("ARENA_TESTS", 5000, labels,
+                                                TsDuplicatePolicy::MAX,
+                                                resource)
+                              .size();
+                  size += aux::buildTsAddArgs("ARENA_TESTS", TimeStamp{1000},
+                                              1.5, 5000, labels, true, 4096,
+                                              TsDuplicatePolicy::SUM, resource)
+                              .size();
+                  size += aux::buildTsIncrDecrByArgs(
+                              "ARENA_TESTS", 2.5, TimeStamp{1000}, 5000,
+                              labels, true, 4096, resource)
+                              .size();
+                  size += aux::buildTsMaddArgs(sequence, resource).size();
+                  size += aux::buildTsDelArgs("ARENA_TESTS", TimeStamp{1},
+                                              TimeStamp{2}, resource)
+                              .size();
+                  size += aux::buildTsCreateRuleArgs("ARENA_TESTS", rule,
+                                                     resource)
+                              .size();
+                  size += aux::buildTsDeleteRuleArgs(
+                              "ARENA_TESTS", rule.destKey(), resource)
+                              .size();
+              }));
+    ASSERT_EQ(14u + 10u + 15u + 13u + 6u + 3u + 5u + 2u, size);
+
+    auto args = aux::buildTsCreateRuleArgs("ARENA_TESTS", rule, resource);
+    ASSERT_EQ((std::vector<std::string_view>{"ARENA_TESTS", "ARENA_TESTS:avg",
+                                             "AGGREGATION", "AVG", "60000"}),
+              std::vector<std::string_view>(args.begin(), args.end()));
+}
+
+TEST(TestArenaAllocations, TestParseOnArena) {
+    ReplyBuilder build;
+    auto *samples =
+        build.array({build.array({build.integer(1000), build.string("1.5")}),
+                     build.array({build.integer(2000), build.string("-2")})});
+    auto *timestamps = build.array({build.integer(1000), build.integer(2000)});
+    auto *labels = build.array(
+        {build.array({build.string("site"), build.string("plant-1")}),
+         build.array({build.string("unit"), build.string("kW")})});
+    auto *rules = build.array(
+        {build.array({build.string("ARENA_TESTS:avg"), build.integer(60000),
+                      build.string("AVG")}),
+         build.array({build.string("ARENA_TESTS:old"), build.string("1000"),
+                      build.nil()})});
+    auto *info = build.array(
+        {build.string("totalSamples"), build.integer(2),
+         build.string("memoryUsage"), build.integer(4184),
+         build.string("firstTimestamp"), build.integer(1000),
+         build.string("lastTimestamp"), build.integer(2000),
+         build.string("retentionTime"), build.integer(5000),
+         build.string("chunkCount"), build.integer(1),
+         build.string("chunkSize"), build.integer(4096),
+         build.string("chunkType"), build.string("compressed"),
+         build.string("duplicatePolicy"), build.string("LAST"),
+         build.string("labels"), labels,
+         build.string("sourceKey"), build.string("ARENA_TESTS:raw"),
+         build.string("rules"), rules});
+    // The label strings are interned on first use, which allocates once.
+    parser::parseLabelArray(labels);
+
+    RequestArena arena{std::pmr::null_memory_resource()};
+    auto *resource = arena.resource();
+    std::optional<std::pmr::vector<TimeSeriesTuple>> tuples;
+    std::optional<std::pmr::vector<TimeStamp>> stamps;
+    std::optional<std::pmr::vector<TimeSeriesLabel>> labelList;
+    std::optional<std::pmr::vector<TimeSeriesRule>> ruleList;
+    std::optional<TimeSeriesPmrInformation> parsed;
+    ASSERT_EQ(0u, countAllocations([&] {
+                  tuples = parser::parseTimeSeriesTupleArray(*samples,
+                                                             resource);
+                  stamps = parser::parseTimeStampArray(*timestamps, resource);
+                  labelList = parser::parseLabelArray(labels, resource);
+                  ruleList = parser::parseRuleArray(*rules, resource);
+                  parsed = parser::parseInfo(info, resource);
+              }));
+
+    ASSERT_EQ(-2.0, (*tuples)[1].value());
+    ASSERT_EQ(2000u, (*stamps)[1].value());
+    ASSERT_EQ("kW", findLabel(*labelList, "unit"));
+    ASSERT_EQ(2u, ruleList->size());
+    ASSERT_EQ(1000u, (*ruleList)[1].timeBucket());
+    ASSERT_FALSE((*ruleList)[1].aggregation().has_value());
+
+    ASSERT_EQ(2u, parsed->totalSamples());
+    ASSERT_EQ(2000u, parsed->lastTimeStamp().value());
+    ASSERT_EQ(4096u, parsed->chunkSize());
+    ASSERT_EQ(TsDuplicatePolicy::LAST, parsed->duplicatePolicy());
+    ASSERT_EQ("plant-1", findLabel(parsed->labels(), "site"));
+    ASSERT_EQ("ARENA_TESTS:raw", parsed->sourceKey());
+    ASSERT_EQ("ARENA_TESTS:avg", parsed->rules()[0].destKey());
+    ASSERT_EQ(TsAggregation::AVG, parsed->rules()[0].aggregation());
+    ASSERT_EQ(resource, parsed->labels().get_allocator().resource());
+    ASSERT_EQ(resource, parsed->sourceKey().get_allocator().resource());
+    ASSERT_EQ(resource, parsed->rules().get_allocator().resource());
+
+    // The default-heap overload reads the same reply.
+    auto heap = parser::parseInfo(info);
+    ASSERT_EQ(parsed->retentionTime(), heap.retentionTime());
+    ASSERT_EQ(parsed->rules().size(), heap.rules().size());
+}
+
+} // namespace
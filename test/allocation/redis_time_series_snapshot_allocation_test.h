@@ -0,0 +1,38 @@
+#include "allocation_counter.h"
+#include "redis_time_series_snapshot.h"
+#include "redis_time_series_test_support.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+using namespace redis_time_series;
+using test_support::countAllocations;
+using test_support::ReplyBuilder;
+
+TEST(TestSnapshot, TestSteadyStateDoesNotAllocate) {
+    ReplyBuilder build;
+    std::vector<redisReply *> entries;
+    for (int i = 0; i < 100; ++i)
+        entries.push_back(
+            build.mgetEntry("SNAPSHOT_TESTS:" + std::to_string(i),
+                            {{"site", "a"}}, 1000 + i, "42.5"));
+    auto *reply = build.array(entries);
+
+    snapshot::Snapshot previous, current;
+    std::vector<snapshot::SeriesChange> changes;
+    std::unordered_map<StringPool::Id, std::size_t> index;
+    snapshot::parseMGet(*reply, current);
+    snapshot::diff(previous, current, changes, index);
+    snapshot::parseMGet(*reply, previous);
+
+    ASSERT_EQ(0u, countAllocations([&] {
+                  for (int poll = 0; poll < 10; ++poll) {
+                      snapshot::parseMGet(*reply, previous);
+                      std::swap(previous, current);
+                      snapshot::diff(previous, current, changes, index);
+                  }
+              }));
+    ASSERT_TRUE(changes.empty());
+}
+
+} // namespace
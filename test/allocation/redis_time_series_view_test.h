@@ -0,0 +1,87 @@
+#include "allocation_counter.h"
+#include "redis_time_series_store.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+using namespace redis_time_series;
+using test_support::countAllocations;
+
+TEST(TestViews, TestBuildArgsDoesNotCopyLabels) {
+    std::vector<TimeSeriesLabel> labels{{"site", "plant-1"}, {"unit", "kW"}};
+    RequestArena arena{std::pmr::null_memory_resource()};
+    std::size_t size = 0;
+    ASSERT_EQ(0u, countAllocations([&] {
+                  auto args = aux::buildTsAddArgs(
+                      "VIEW_TESTS", TimeStamp{1000}, 1.5, 5000, labels,
+                      std::nullopt, std::nullopt, std::nullopt,
+                      arena.resource());
+                  size = args.size();
+              }));
+    ASSERT_EQ(10u, size);
+
+    // A braced list binds to the span directly; the strings are already
+    // interned, so building the labels does not allocate either.
+    ASSERT_EQ(0u, countAllocations([&] {
+                  auto args = aux::buildTsCreateArgs(
+                      "VIEW_TESTS", std::nullopt, {{"site", "plant-1"}},
+                      std::nullopt, std::nullopt, std::nullopt,
+                      arena.resource());
+                  size = args.size();
+              }));
+    ASSERT_EQ(4u, size);
+}
+
+// Long enough to be heap-allocated when copied.
+constexpr std::string_view viewSource = "VIEW_TESTS:source with a long name";
+constexpr std::string_view viewDestination =
+    "VIEW_TESTS:destination with a long name";
+
+TEST(TestViews, TestGettersReturnReferences) {
+    TimeSeriesInformation info{
+        10, 4096, TimeStamp{1}, TimeStamp{10}, 0, 1, 4096,
+        {{"site", "plant-1"}}, std::string{viewSource},
+        {{std::string{viewDestination}, 60000,
+          command_operator::TsAggregation::AVG}},
+        std::nullopt};
+    TimeSeriesTuple sample{TimeStamp{"+"}, 1.5};
+    std::size_t read = 0;
+    ASSERT_EQ(0u, countAllocations([&] {
+                  read += info.labels().size();
+                  read += info.rules().size();
+                  read += info.rules()[0].destKey().size();
+                  read += info.sourceKey().size();
+                  read += info.firstTimeStamp().value();
+                  read += sample.time().to_string().size();
+              }));
+    ASSERT_EQ(3 + viewDestination.size() + viewSource.size() + 1, read);
+
+    // Called on a temporary, containers are moved out rather than copied.
+    std::vector<TimeSeriesRule> rules;
+    ASSERT_EQ(0u, countAllocations([&] { rules = std::move(info).rules(); }));
+    ASSERT_EQ(1u, rules.size());
+}
+
+TEST(TestViews, TestMoveAwareConstructors) {
+    std::vector<TimeSeriesLabel> labels{{"site", "plant-1"}};
+    std::vector<TimeSeriesRule> rules{
+        {std::string{viewDestination}, 60000, std::nullopt}};
+    std::string source{viewSource};
+    auto allocations = countAllocations([&] {
+        TimeSeriesInformation info{10,
+                                   4096,
+                                   TimeStamp{1},
+                                   TimeStamp{10},
+                                   0,
+                                   1,
+                                   4096,
+                                   std::move(labels),
+                                   std::move(source),
+                                   std::move(rules),
+                                   std::nullopt};
+        TimeSeriesRule rule{std::move(info).sourceKey(), 1000, std::nullopt};
+    });
+    ASSERT_EQ(0u, allocations);
+}
+
+} // namespace
@@ -1,5 +1,28 @@
 #include "redis_time_series_add_test.h"
 #include "redis_time_series_create_test.h"
+#include "redis_time_series_label_test.h"
+#include "redis_time_series_arena_test.h"
+#include "redis_time_series_parallel_test.h"
+#include "redis_time_series_routing_test.h"
+#include "redis_time_series_hedging_test.h"
+#include "redis_time_series_partition_test.h"
+#include "redis_time_series_last_value_test.h"
+#include "redis_time_series_iso8601_test.h"
+#include "redis_time_series_aggregation_test.h"
+#include "redis_time_series_fake_server_test.h"
+#include "redis_time_series_embedded_test.h"
+#include "redis_time_series_reorder_test.h"
+#include "redis_time_series_prepared_test.h"
+#include "redis_time_series_sketch_test.h"
+#include "redis_time_series_align_test.h"
+#include "redis_time_series_expr_test.h"
+#include "redis_time_series_block_cache_test.h"
+#include "redis_time_series_backfill_test.h"
+#include "redis_time_series_provision_test.h"
+#include "redis_time_series_analyze_test.h"
+#include "redis_time_series_snapshot_test.h"
+#include "redis_time_series_purge_test.h"
+#include "redis_time_series_upsert_test.h"
 #include "gtest/gtest.h"
 
 int main(int argc, char **argv) {
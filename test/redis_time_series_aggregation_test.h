@@ -0,0 +1,50 @@
+#include "redis_time_series_aggregation.h"
+#include "gtest/gtest.h"
+
+#include <vector>
+
+namespace {
+
+using namespace redis_time_series;
+
+TEST(TestAggregation, TestBucketStart) {
+    ASSERT_EQ(60000u, aggregation::bucketStart(119999, 60000));
+    ASSERT_EQ(61000u, aggregation::bucketStart(119999, 60000, 1000));
+    // The first bucket would start before 0.
+    ASSERT_EQ(0u, aggregation::bucketStart(500, 60000, 1000));
+    ASSERT_THROW(aggregation::bucketStart(1, 0), std::invalid_argument);
+}
+
+TEST(TestAggregation, TestAccumulator) {
+    aggregation::Accumulator accumulator;
+    ASSERT_TRUE(accumulator.empty());
+    for (double value : {4.0, 1.0, 3.0})
+        accumulator.add(value);
+    ASSERT_EQ(8.0 / 3, accumulator.value("avg"));
+    ASSERT_EQ(8.0, accumulator.value("SUM"));
+    ASSERT_EQ(3.0, accumulator.value("range"));
+    ASSERT_EQ(4.0, accumulator.value("first"));
+    ASSERT_EQ(3.0, accumulator.value("LAST"));
+    ASSERT_NEAR(7.0 / 3, accumulator.value("var.s"), 1e-12);
+    ASSERT_THROW(accumulator.value("median"), std::invalid_argument);
+
+    accumulator.reset();
+    accumulator.add(5);
+    ASSERT_EQ(0.0, accumulator.value("std.s"));
+}
+
+TEST(TestAggregation, TestBuckets) {
+    std::vector<std::pair<uint64_t, double>> result;
+    aggregation::Buckets buckets{"max", 100, 50,
+                                 [&](uint64_t start, double value) {
+                                     result.emplace_back(start, value);
+                                 }};
+    for (uint64_t t : {10, 40, 60, 149, 150, 400})
+        buckets.add(t, static_cast<double>(t));
+    buckets.finish();
+    ASSERT_EQ((std::vector<std::pair<uint64_t, double>>{
+                  {0, 40}, {50, 149}, {150, 150}, {350, 400}}),
+              result);
+}
+
+} // namespace
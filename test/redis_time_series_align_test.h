@@ -0,0 +1,144 @@
+#include "redis_time_series_align.h"
+#include "gtest/gtest.h"
+
+#include <random>
+
+namespace {
+
+using namespace redis_time_series;
+
+TimeSeriesColumns makeColumns(
+    std::initializer_list<std::pair<uint64_t, double>> samples) {
+    TimeSeriesColumns columns;
+    for (auto [timestamp, value] : samples)
+        columns.push_back(timestamp, value);
+    return columns;
+}
+
+std::vector<double> alignOne(const TimeSeriesColumns &series,
+                             align::Fill fill,
+                             std::optional<uint64_t> maxGap = std::nullopt) {
+    align::AlignOptions options;
+    options.fill = fill;
+    options.maxGap = maxGap;
+    auto matrix = align::alignSeries({series}, align::makeGrid(0, 60, 10),
+                                     options);
+    return matrix.values;
+}
+
+void expectValues(const std::vector<double> &expected,
+                  const std::vector<double> &actual) {
+    ASSERT_EQ(expected.size(), actual.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        if (std::isnan(expected[i]))
+            ASSERT_TRUE(std::isnan(actual[i])) << i;
+        else
+            ASSERT_DOUBLE_EQ(expected[i], actual[i]) << i;
+    }
+}
+
+TEST(TestAlign, TestFillModes) {
+    auto nan = std::numeric_limits<double>::quiet_NaN();
+    auto series = makeColumns({{5, 1}, {20, 4}, {24, 8}, {50, 2}});
+    // Grid 0, 10, ..., 60.
+    expectValues({nan, 1, 4, 8, nan, 2, nan},
+                 alignOne(series, align::Fill::NONE));
+    expectValues({nan, 1, 4, 8, 8, 2, 2},
+                 alignOne(series, align::Fill::LOCF));
+    expectValues({nan, 2, 4, 8 - 6.0 * 6 / 26, 8 - 6.0 * 16 / 26, 2, nan},
+                 alignOne(series, align::Fill::LINEAR));
+    expectValues({1, 1, 4, 8, 2, 2, 2},
+                 alignOne(series, align::Fill::NEAREST));
+    expectValues({nan, 1, 4, 8, nan, 2, 2},
+                 alignOne(series, align::Fill::LOCF, 10));
+    expectValues({nan, nan, nan, nan, nan, nan, nan},
+                 alignOne(TimeSeriesColumns{}, align::Fill::LOCF));
+}
+
+TEST(TestAlign, TestLayoutsAndThreads) {
+    std::mt19937_64 random{5};
+    std::vector<TimeSeriesColumns> series(7);
+    for (auto &columns : series) {
+        uint64_t t = random() % 50;
+        for (int i = 0; i < 500; ++i) {
+            columns.push_back(t, static_cast<double>(random() % 1000));
+            t += 1 + random() % 40;
+        }
+    }
+    auto grid = align::makeGrid(0, 10000, 7);
+    align::AlignOptions options;
+    options.fill = align::Fill::LINEAR;
+    auto columnMajor = align::alignSeries(series, grid, options);
+    options.layout = align::Layout::ROW_MAJOR;
+    options.threads = 3;
+    auto rowMajor = align::alignSeries(series, grid, options);
+    ASSERT_EQ(grid.rows, rowMajor.rows);
+    ASSERT_EQ(7u, rowMajor.cols);
+    for (size_t row = 0; row < grid.rows; ++row) {
+        for (size_t col = 0; col < 7; ++col) {
+            auto a = columnMajor.at(row, col), b = rowMajor.at(row, col);
+            ASSERT_TRUE((std::isnan(a) && std::isnan(b)) || a == b);
+        }
+    }
+}
+
+TEST(TestAlign, TestStreamingMatchesBatch) {
+    std::vector<TimeSeriesColumns> series(3);
+    for (uint64_t t = 0; t < 3000; ++t) {
+        series[0].push_back(t * 3 + 1, static_cast<double>(t));
+        if (t % 2 == 0) series[1].push_back(t * 5, static_cast<double>(-t));
+        if (t < 1000) series[2].push_back(t * 2, 1);
+    }
+    auto grid = align::makeGrid(0, 9000, 4);
+    for (auto fill : {align::Fill::NONE, align::Fill::LOCF,
+                      align::Fill::LINEAR, align::Fill::NEAREST}) {
+        align::AlignOptions options;
+        options.fill = fill;
+        auto expected = align::alignSeries(series, grid, options);
+
+        std::vector<double> streamed;
+        std::size_t blocks = 0;
+        align::StreamingAligner aligner{
+            series.size(), grid, options, [&](const align::Matrix &block) {
+                ++blocks;
+                for (size_t row = 0; row < block.rows; ++row)
+                    for (size_t col = 0; col < block.cols; ++col)
+                        streamed.push_back(block.at(row, col));
+            }};
+        // Interleaved pages of 256 samples per series.
+        std::vector<std::size_t> offsets(series.size(), 0);
+        bool more = true;
+        while (more) {
+            more = false;
+            for (size_t s = 0; s < series.size(); ++s) {
+                auto &source = series[s];
+                auto begin = offsets[s];
+                auto end = std::min(begin + 256, source.size());
+                if (begin == end) continue;
+                TimeSeriesColumns page;
+                for (auto i = begin; i < end; ++i)
+                    page.push_back(source.timestamps[i], source.values[i]);
+                aligner.push(s, page);
+                offsets[s] = end;
+                if (end == source.size())
+                    aligner.finish(s);
+                else
+                    more = true;
+            }
+        }
+        aligner.finish();
+        ASSERT_GT(blocks, 1u);
+        ASSERT_EQ(grid.rows, aligner.emittedRows());
+        ASSERT_EQ(grid.rows * series.size(), streamed.size());
+        for (size_t row = 0; row < grid.rows; ++row) {
+            for (size_t col = 0; col < series.size(); ++col) {
+                auto a = expected.at(row, col);
+                auto b = streamed[row * series.size() + col];
+                ASSERT_TRUE((std::isnan(a) && std::isnan(b)) || a == b)
+                    << row << "," << col;
+            }
+        }
+    }
+}
+
+} // namespace
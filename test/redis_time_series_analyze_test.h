@@ -0,0 +1,200 @@
+#include "redis_time_series_analyze.h"
+#include "redis_time_series_test_support.h"
+#include "gtest/gtest.h"
+#include <sw/redis++/redis++.h>
+
+namespace {
+
+using namespace redis_time_series;
+using test_support::makeInfo;
+
+TEST(TestFootprint, TestChunkModel) {
+    // sqrt(2 * 1000000 * 64) = 11313.7, rounded up to a multiple of 8.
+    ASSERT_EQ(11320u, analyze::bestChunkSize(1000000, 64));
+    ASSERT_EQ(128u, analyze::bestChunkSize(10, 64));
+    ASSERT_EQ(1048576u, analyze::bestChunkSize(1e13, 64));
+    ASSERT_LT(analyze::estimateMemory(1000000, 11320, 64),
+              analyze::estimateMemory(1000000, 128, 64));
+    ASSERT_LT(analyze::estimateMemory(1000000, 11320, 64),
+              analyze::estimateMemory(1000000, 1048576, 64));
+}
+
+TEST(TestFootprint, TestFindings) {
+    // 16 bytes per sample in 4 KiB chunks: raw samples.
+    auto raw = analyze::assess("raw",
+                               makeInfo(100000, 0, 0,
+                                        {.memoryUsage = 1616000,
+                                         .chunkCount = 400,
+                                         .chunkSize = 4096}),
+                               std::nullopt, 1.5);
+    ASSERT_FALSE(raw.compressed);
+    ASSERT_EQ(std::vector<analyze::Finding>{analyze::Finding::UNCOMPRESSED},
+              raw.findings);
+    ASSERT_LT(raw.estimatedMemory, 200000u);
+    ASSERT_GT(raw.savings(), 1400000u);
+
+    // Compressed, but 1.5 MB of data in 128 byte chunks.
+    auto small = analyze::assess(
+        "small",
+        makeInfo(1000000, 0, 0,
+                 {.memoryUsage = 1500000 + 12000 * 64,
+                  .chunkCount = 12000,
+                  .chunkSize = 128}),
+        true, std::nullopt);
+    ASSERT_EQ(std::vector<analyze::Finding>{analyze::Finding::CHUNK_TOO_SMALL},
+              small.findings);
+    ASSERT_GT(small.recommendedChunkSize, 128u);
+
+    // A few samples in one huge chunk.
+    auto large = analyze::assess(
+        "large",
+        makeInfo(100, 0, 0,
+                 {.memoryUsage = 1048576 + 64,
+                  .chunkCount = 1,
+                  .chunkSize = 1048576}),
+        true, std::nullopt);
+    ASSERT_EQ(std::vector<analyze::Finding>{analyze::Finding::CHUNK_TOO_LARGE},
+              large.findings);
+    // sqrt(2 * 100 * 2 * 64) = 160.
+    ASSERT_EQ(160u, large.recommendedChunkSize);
+
+    // Well sized: nothing to report and no savings claimed.
+    auto fine = analyze::assess(
+        "fine",
+        makeInfo(1000000, 0, 0,
+                 {.memoryUsage = 1500000 + 110 * 64,
+                  .chunkCount = 110,
+                  .chunkSize = 13856}),
+        true, std::nullopt);
+    ASSERT_TRUE(fine.findings.empty());
+    ASSERT_EQ(0u, fine.savings());
+
+    auto empty = analyze::assess(
+        "empty",
+        makeInfo(0, 0, 0,
+                 {.memoryUsage = 4160, .chunkCount = 1, .chunkSize = 4096}),
+        std::nullopt, std::nullopt);
+    ASSERT_TRUE(empty.findings.empty());
+}
+
+TEST(TestFootprint, TestGroupBy) {
+    std::vector<analyze::SeriesFootprint> footprints(3);
+    footprints[0].labels = {{"site", "a"}};
+    footprints[0].totalSamples = 10;
+    footprints[0].memoryUsage = 100;
+    footprints[0].estimatedMemory = 100;
+    footprints[1].labels = {{"site", "a"}, {"unit", "kW"}};
+    footprints[1].totalSamples = 30;
+    footprints[1].memoryUsage = 300;
+    footprints[1].estimatedMemory = 200;
+    footprints[2].totalSamples = 5;
+    footprints[2].memoryUsage = 80;
+    auto groups = analyze::groupBy(footprints, "site");
+    ASSERT_EQ(2u, groups.size());
+    ASSERT_EQ(2u, groups["a"].series);
+    ASSERT_EQ(40u, groups["a"].totalSamples);
+    ASSERT_EQ(100u, groups["a"].savings);
+    ASSERT_DOUBLE_EQ(10.0, groups["a"].bytesPerSample());
+    ASSERT_EQ(1u, groups[""].series);
+}
+
+TEST(TestFootprint, TestEncodedBytesPerSample) {
+    TimeSeriesColumns regular;
+    for (uint64_t i = 0; i < 1000; ++i)
+        regular.push_back(1000 * i, 42);
+    // Constant deltas and values cost about two bits per sample.
+    ASSERT_LT(analyze::encodedBytesPerSample(regular), 0.5);
+
+    TimeSeriesColumns noisy;
+    for (uint64_t i = 0; i < 1000; ++i)
+        noisy.push_back(1000 * i + i * i % 7, static_cast<double>(i) / 3);
+    ASSERT_GT(analyze::encodedBytesPerSample(noisy),
+              analyze::encodedBytesPerSample(regular));
+    ASSERT_EQ(0, analyze::encodedBytesPerSample({}));
+}
+
+TEST(TestFootprint, TestEncodedBytesPerSampleSpansChunks) {
+    // Irregular deltas and unrelated values cost more than the 16 bytes of
+    // a raw sample, so the samples fill several chunks.
+    TimeSeriesColumns worst;
+    uint64_t timestamp = 0;
+    for (uint64_t i = 0; i < 1000; ++i) {
+        timestamp += i % 2 == 0 ? 1 : 1000000;
+        worst.push_back(timestamp,
+                        std::bit_cast<double>(i * 0x9E3779B97F4A7C15));
+    }
+    auto perSample = analyze::encodedBytesPerSample(worst);
+    ASSERT_GT(perSample, 16.0);
+    ASSERT_LT(perSample, 20.0);
+
+    // A chunk per sample costs 16 bytes each, the raw first sample.
+    ASSERT_DOUBLE_EQ(16.0, analyze::encodedBytesPerSample(worst, 16));
+}
+
+class TestAnalyze : public testing::Test {
+  public:
+    TestAnalyze()
+        : inMemory_{
+              std::make_unique<sw::redis::Redis>("tcp://localhost:6379")} {}
+
+    std::unique_ptr<sw::redis::Redis> inMemory_;
+    const std::string key = "ANALYZE_TESTS";
+
+  protected:
+    void SetUp() override {
+        client::timeSeriesCreate(inMemory_.get(), key + ":raw", 0,
+                                 {{"analyze", "raw"}}, true);
+        client::timeSeriesCreate(inMemory_.get(), key + ":packed", 0,
+                                 {{"analyze", "packed"}});
+        std::vector<std::tuple<std::string, TimeStamp, double>> samples;
+        for (uint64_t ts = 1; ts <= 5000; ++ts) {
+            samples.emplace_back(key + ":raw", TimeStamp{ts},
+                                 static_cast<double>(ts % 10));
+            samples.emplace_back(key + ":packed", TimeStamp{ts},
+                                 static_cast<double>(ts % 10));
+        }
+        client::timeSeriesMAdd(inMemory_.get(), samples);
+    }
+    void TearDown() override {
+        inMemory_->del(key + ":raw");
+        inMemory_->del(key + ":packed");
+        inMemory_->del(key + ":raw:migrating");
+    }
+};
+
+TEST_F(TestAnalyze, TestScanAndAnalyze) {
+    auto keys = analyze::scanSeries(inMemory_.get(), key + ":*", 1);
+    std::sort(keys.begin(), keys.end());
+    ASSERT_EQ((std::vector<std::string>{key + ":packed", key + ":raw"}), keys);
+
+    analyze::AnalyzeOptions options;
+    options.batchSize = 1;
+    auto footprints = analyze::analyzeSeries(inMemory_.get(), keys, options);
+    ASSERT_EQ(2u, footprints.size());
+    ASSERT_TRUE(footprints[0].compressed);
+    ASSERT_FALSE(footprints[1].compressed);
+    ASSERT_TRUE(footprints[1].encodedBytesPerSample.has_value());
+    ASSERT_EQ(analyze::Finding::UNCOMPRESSED, footprints[1].findings.at(0));
+    ASSERT_GT(footprints[1].savings(), footprints[0].savings());
+}
+
+TEST_F(TestAnalyze, TestMigrate) {
+    analyze::MigrateOptions options;
+    options.chunkSize = 1024;
+    options.pageSize = 700;
+    ASSERT_EQ(5000u, analyze::migrateSeries(inMemory_.get(), key + ":raw",
+                                            options));
+    ASSERT_FALSE(inMemory_->exists(key + ":raw:migrating"));
+    auto info = client::timeSeriesInfo(inMemory_.get(), key + ":raw");
+    ASSERT_EQ(5000u, info.totalSamples());
+    ASSERT_EQ(1024u, info.chunkSize());
+    ASSERT_EQ(1u, info.labels().size());
+    auto reply = inMemory_->command(command::INFO, key + ":raw");
+    ASSERT_EQ(true, analyze::detail::parseCompressed(*reply));
+    auto samples = client::timeSeriesRange(inMemory_.get(), key + ":raw",
+                                           TimeStamp{"-"}, TimeStamp{"+"});
+    ASSERT_EQ(5000u, samples.size());
+    ASSERT_EQ(9.0, samples[4998].value());
+}
+
+} // namespace
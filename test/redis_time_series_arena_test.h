@@ -0,0 +1,106 @@
+#include "redis_time_series.h"
+#include "redis_time_series_test_support.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+using namespace redis_time_series;
+using test_support::ReplyBuilder;
+
+TEST(TestArena, TestBuildArgsOnArena) {
+    // A null upstream makes any allocation outside the inline buffer throw.
+    RequestArena arena{std::pmr::null_memory_resource()};
+    std::vector<TimeSeriesLabel> labels{{"site", "plant-1"}, {"unit", "kW"}};
+    auto args = aux::buildTsAddArgs("ARENA_TESTS", TimeStamp{1000}, 1.5, 5000,
+                                    labels, std::nullopt, std::nullopt,
+                                    std::nullopt, arena.resource());
+    std::vector<std::string_view> expected{
+        "ARENA_TESTS", "1000", "1.500000", "RETENTION", "5000",
+        "LABELS",      "site", "plant-1",  "unit",      "kW"};
+    ASSERT_EQ(expected.size(), args.size());
+    for (size_t i = 0; i < expected.size(); ++i)
+        ASSERT_EQ(expected[i], std::string_view{args[i]});
+    ASSERT_EQ(arena.resource(), args.get_allocator().resource());
+    ASSERT_EQ(arena.resource(), args[0].get_allocator().resource());
+}
+
+TEST(TestArena, TestParseOnArena) {
+    ReplyBuilder build;
+    auto *samples =
+        build.array({build.array({build.integer(1000), build.string("1.5")}),
+                     build.array({build.integer(2000), build.string("-2")})});
+    auto *mrange = build.array(
+        {build.array({build.string("ARENA_TESTS:a"),
+                      build.array({build.array(
+                          {build.string("site"), build.string("plant-1")})}),
+                      samples}),
+         build.array({build.string("ARENA_TESTS:b"), build.array({}),
+                      build.array({})})});
+
+    // A null upstream makes any allocation outside the inline buffer throw.
+    RequestArena arena{std::pmr::null_memory_resource()};
+    auto tuples = parser::parseSampleArray(*samples, arena.resource());
+    ASSERT_EQ(2u, tuples.size());
+    ASSERT_EQ(-2.0, tuples[1].value());
+    ASSERT_EQ(arena.resource(), tuples.get_allocator().resource());
+
+    auto entries = parser::parseMRangeResponse(*mrange, arena.resource());
+    ASSERT_EQ(2u, entries.size());
+    auto &[key, labels, series] = entries[0];
+    ASSERT_EQ("ARENA_TESTS:a", key);
+    ASSERT_EQ("plant-1", findLabel(labels, "site"));
+    ASSERT_EQ(1000u, series[0].time().value());
+    ASSERT_TRUE(std::get<2>(entries[1]).empty());
+    ASSERT_EQ(arena.resource(), key.get_allocator().resource());
+    ASSERT_EQ(arena.resource(), labels.get_allocator().resource());
+    ASSERT_EQ(arena.resource(), series.get_allocator().resource());
+}
+
+TEST(TestArena, TestReleaseReusesBuffer) {
+    RequestArena arena{std::pmr::null_memory_resource()};
+    for (int i = 0; i < 100; ++i) {
+        {
+            auto args = aux::buildTsDelArgs("ARENA_TESTS", TimeStamp{1},
+                                            TimeStamp{2}, arena.resource());
+            ASSERT_EQ(3u, args.size());
+        }
+        arena.release();
+    }
+}
+
+class TestArenaRange : public testing::Test {
+  public:
+    TestArenaRange()
+        : inMemory_{
+              std::make_unique<sw::redis::Redis>("tcp://localhost:6379")} {}
+
+    std::unique_ptr<sw::redis::Redis> inMemory_;
+    const std::string key = "ARENA_TESTS";
+
+  protected:
+    void SetUp() override {
+        client::timeSeriesCreate(inMemory_.get(), key, 0, {{"arena", "tests"}});
+        client::timeSeriesMAdd(inMemory_.get(), {{key, TimeStamp{1000}, 1},
+                                                 {key, TimeStamp{2000}, 2}});
+    }
+    void TearDown() override { inMemory_->del(key); }
+};
+
+TEST_F(TestArenaRange, TestRangeOnArena) {
+    RequestArena arena;
+    auto samples = client::timeSeriesRevRange(
+        inMemory_.get(), arena.resource(), key, TimeStamp{"-"}, TimeStamp{"+"});
+    ASSERT_EQ(2u, samples.size());
+    ASSERT_EQ(2000u, samples[0].time().value());
+    ASSERT_EQ(arena.resource(), samples.get_allocator().resource());
+
+    auto entries = client::timeSeriesMRange(
+        inMemory_.get(), arena.resource(), TimeStamp{"-"}, TimeStamp{"+"},
+        {"arena=tests"}, std::nullopt, std::nullopt, std::nullopt, true);
+    ASSERT_EQ(1u, entries.size());
+    ASSERT_EQ(key, std::string_view{std::get<0>(entries[0])});
+    ASSERT_EQ("tests", findLabel(std::get<1>(entries[0]), "arena"));
+    ASSERT_EQ(2u, std::get<2>(entries[0]).size());
+}
+
+} // namespace
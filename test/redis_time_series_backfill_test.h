@@ -0,0 +1,154 @@
+#include "redis_time_series_backfill.h"
+#include "redis_time_series_test_support.h"
+#include "gtest/gtest.h"
+#include <sw/redis++/redis++.h>
+
+namespace {
+
+using namespace redis_time_series;
+using test_support::makeInfo;
+
+TEST(TestPlanBackfill, TestClosedBucketsOnly) {
+    auto source = makeInfo(100, 1500, 9800);
+    auto empty = makeInfo(0, 0, 0);
+    ASSERT_EQ((backfill::BackfillPlan{1000, 9000}),
+              backfill::planBackfill(source, empty, 1000));
+    // The rule already wrote from 7000; its first bucket is left alone.
+    ASSERT_EQ((backfill::BackfillPlan{1000, 7000}),
+              backfill::planBackfill(source, makeInfo(2, 7000, 8000), 1000));
+    // A checkpoint keeps its planned end, even though the destination now
+    // begins with the buckets the backfill wrote itself.
+    ASSERT_EQ((backfill::BackfillPlan{4000, 9000}),
+              backfill::planBackfill(source, makeInfo(3, 1000, 3000), 1000,
+                                     backfill::BackfillPlan{4000, 9000}));
+    ASSERT_FALSE(backfill::planBackfill(source, makeInfo(8, 1000, 8000),
+                                        1000,
+                                        backfill::BackfillPlan{9000, 9000}));
+    ASSERT_FALSE(backfill::planBackfill(empty, empty, 1000));
+    ASSERT_FALSE(
+        backfill::planBackfill(makeInfo(3, 9100, 9800), empty, 1000));
+    ASSERT_THROW(backfill::planBackfill(source, empty, 0),
+                 std::invalid_argument);
+}
+
+TEST(TestPlanBackfill, TestMaddArgsKeepFullPrecision) {
+    std::vector<TimeSeriesTuple> buckets{{TimeStamp{0}, 0.1 + 0.2},
+                                         {TimeStamp{1000}, 1e-9}};
+    auto args = backfill::detail::buildMaddArgs("dest", buckets, 0, 2);
+    ASSERT_EQ((std::vector<std::string>{"TS.MADD", "dest", "0",
+                                        "0.30000000000000004", "dest", "1000",
+                                        "1e-09"}),
+              args);
+}
+
+class TestBackfill : public testing::Test {
+  public:
+    TestBackfill()
+        : inMemory_{
+              std::make_unique<sw::redis::Redis>("tcp://localhost:6379")} {}
+
+    std::unique_ptr<sw::redis::Redis> inMemory_;
+    const std::string key = "BACKFILL_TESTS";
+    const TimeSeriesRule avg{key + ":avg", 1000,
+                             command_operator::TsAggregation::AVG};
+    const TimeSeriesRule stds{key + ":stds", 700,
+                              command_operator::TsAggregation::STDS};
+
+  protected:
+    void SetUp() override {
+        client::timeSeriesCreate(inMemory_.get(), key);
+        client::timeSeriesCreate(inMemory_.get(), avg.destKey());
+        client::timeSeriesCreate(inMemory_.get(), stds.destKey());
+        std::vector<std::tuple<std::string, TimeStamp, double>> samples;
+        for (uint64_t ts = 1; ts <= 10000; ts += 7)
+            samples.emplace_back(key, TimeStamp{ts},
+                                 static_cast<double>(ts % 97) / 3);
+        client::timeSeriesMAdd(inMemory_.get(), samples);
+        client::timeSeriesCreateRule(inMemory_.get(), key, avg);
+        client::timeSeriesCreateRule(inMemory_.get(), key, stds);
+    }
+    void TearDown() override {
+        inMemory_->del(key);
+        inMemory_->del(avg.destKey());
+        inMemory_->del(stds.destKey());
+        inMemory_->del(key + ":checkpoint");
+    }
+
+    void expectBackfilled(const TimeSeriesRule &rule, uint64_t until) {
+        auto expected = client::timeSeriesRange(
+            inMemory_.get(), key, TimeStamp{0}, TimeStamp{until - 1},
+            std::nullopt, rule.aggregation(), rule.timeBucket());
+        auto actual = client::timeSeriesRange(inMemory_.get(), rule.destKey(),
+                                              TimeStamp{"-"}, TimeStamp{"+"});
+        ASSERT_EQ(expected.size(), actual.size());
+        for (size_t i = 0; i < expected.size(); ++i) {
+            ASSERT_EQ(expected[i].time().value(), actual[i].time().value());
+            ASSERT_EQ(expected[i].value(), actual[i].value());
+        }
+    }
+};
+
+TEST_F(TestBackfill, TestSourceRules) {
+    backfill::BackfillOptions options;
+    options.pageSize = 3;
+    options.batchSize = 2;
+    auto results = backfill::backfillSource(inMemory_.get(), key, options);
+    ASSERT_EQ(2u, results.size());
+    for (auto &result : results) {
+        ASSERT_FALSE(result.error.has_value()) << *result.error;
+        ASSERT_EQ(0u, result.rejected);
+    }
+    expectBackfilled(avg, 9000);
+    expectBackfilled(stds, 9800);
+}
+
+TEST_F(TestBackfill, TestCheckpointResumes) {
+    backfill::BackfillOptions options;
+    options.pageSize = 4;
+    options.workers = 2;
+    options.checkpointKey = key + ":checkpoint";
+    std::vector<backfill::BackfillTask> tasks{{key, avg},
+                                              {key + ":missing", stds}};
+    std::size_t reported = 0;
+    auto results = backfill::backfillRules(
+        inMemory_.get(), tasks, options,
+        [&](const backfill::BackfillResult &) { ++reported; });
+    ASSERT_EQ(2u, reported);
+    ASSERT_EQ(9u, results[0].buckets);
+    ASSERT_TRUE(results[1].error.has_value());
+    ASSERT_EQ("9000 9000",
+              inMemory_->command<sw::redis::OptionalString>(
+                  "HGET", options.checkpointKey,
+                  backfill::checkpointField(tasks[0])));
+
+    auto again = backfill::backfillRules(inMemory_.get(), tasks, options);
+    ASSERT_EQ(0u, again[0].buckets);
+    expectBackfilled(avg, 9000);
+}
+
+TEST_F(TestBackfill, TestInterruptedRunResumes) {
+    backfill::BackfillOptions options;
+    options.pageSize = 4;
+    options.checkpointKey = key + ":checkpoint";
+    options.onPage = [](const backfill::BackfillResult &) {
+        throw std::runtime_error("interrupted");
+    };
+    std::vector<backfill::BackfillTask> tasks{{key, avg}};
+    auto stopped = backfill::backfillRules(inMemory_.get(), tasks, options);
+    ASSERT_EQ("interrupted", stopped[0].error);
+    ASSERT_EQ(4u, stopped[0].buckets);
+    ASSERT_EQ("4000 9000",
+              inMemory_->command<sw::redis::OptionalString>(
+                  "HGET", options.checkpointKey,
+                  backfill::checkpointField(tasks[0])));
+
+    // The destination now starts at bucket 0, written above; the resumed
+    // run still fills the rest of the hole.
+    options.onPage = {};
+    auto resumed = backfill::backfillRules(inMemory_.get(), tasks, options);
+    ASSERT_FALSE(resumed[0].error.has_value()) << *resumed[0].error;
+    ASSERT_EQ(5u, resumed[0].buckets);
+    expectBackfilled(avg, 9000);
+}
+
+} // namespace
@@ -0,0 +1,147 @@
+#include "redis_time_series_block_cache.h"
+#include "redis_time_series_embedded.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+using namespace redis_time_series;
+
+class TestBlockCache : public testing::Test {
+  public:
+    embedded::EmbeddedStore store_;
+    TimeSeriesStore &db_{store_};
+    const std::string key = "BLOCK_CACHE_TESTS";
+    const std::filesystem::path directory =
+        std::filesystem::path{testing::TempDir()} / "block_cache_tests";
+
+  protected:
+    void SetUp() override {
+        std::filesystem::remove_all(directory);
+        db_.create(key);
+        // Ten closed blocks of 1000 ms and one sample in the open tail.
+        for (uint64_t t = 100; t <= 10000; t += 100)
+            db_.add(key, t, static_cast<double>(t) / 100);
+    }
+    void TearDown() override { std::filesystem::remove_all(directory); }
+
+    cache::BlockCacheOptions options() const {
+        cache::BlockCacheOptions options;
+        options.directory = directory;
+        options.blockSpan = 1000;
+        return options;
+    }
+
+    void expectSame(const std::vector<TimeSeriesTuple> &expected,
+                    const cache::CachedRange &actual) {
+        auto columns = actual.columns();
+        ASSERT_EQ(expected.size(), columns.size());
+        for (size_t i = 0; i < expected.size(); ++i) {
+            ASSERT_EQ(expected[i].time().value(), columns.timestamps[i]);
+            ASSERT_DOUBLE_EQ(expected[i].value(), columns.values[i]);
+        }
+    }
+};
+
+TEST_F(TestBlockCache, TestHitsAcrossRestarts) {
+    auto expected = db_.range(key, TimeStamp{"-"}, TimeStamp{"+"});
+    {
+        cache::BlockCache blockCache{db_, options()};
+        expectSame(expected, blockCache.range(key, 0, 20000));
+        ASSERT_EQ(10u, blockCache.stats().misses);
+        ASSERT_EQ(10u, blockCache.blocks());
+        auto again = blockCache.range(key, 0, 20000);
+        expectSame(expected, again);
+        ASSERT_EQ(10u, blockCache.stats().hits);
+        // Ten mapped blocks and the live tail.
+        ASSERT_EQ(11u, again.segments().size());
+    }
+    cache::BlockCache reopened{db_, options()};
+    ASSERT_EQ(10u, reopened.blocks());
+    expectSame(expected, reopened.range(key, 0, 20000));
+    ASSERT_EQ(10u, reopened.stats().hits);
+    ASSERT_EQ(0u, reopened.stats().misses);
+
+    expectSame(db_.range(key, TimeStamp{250}, TimeStamp{4321}),
+               reopened.range(key, 250, 4321));
+}
+
+TEST_F(TestBlockCache, TestDeleteInvalidates) {
+    cache::BlockCache blockCache{db_, options()};
+    blockCache.range(key, 0, 20000);
+    db_.del(key, TimeStamp{2000}, TimeStamp{2500});
+    expectSame(db_.range(key, TimeStamp{"-"}, TimeStamp{"+"}),
+               blockCache.range(key, 0, 20000));
+    ASSERT_EQ(1u, blockCache.stats().invalidated);
+    ASSERT_EQ(11u, blockCache.stats().misses);
+    ASSERT_EQ(9u, blockCache.stats().hits);
+
+    blockCache.invalidate(key);
+    ASSERT_EQ(0u, blockCache.blocks());
+    ASSERT_EQ(0u, blockCache.bytes());
+}
+
+TEST_F(TestBlockCache, TestAggregations) {
+    using command_operator::TsAggregation;
+    cache::BlockCache blockCache{db_, options()};
+    for (int pass = 0; pass < 2; ++pass) {
+        expectSame(db_.range(key, TimeStamp{0}, TimeStamp{20000},
+                             std::nullopt, TsAggregation::AVG, 500),
+                   blockCache.range(key, 0, 20000, TsAggregation::AVG, 500));
+    }
+    ASSERT_EQ(10u, blockCache.stats().hits);
+    ASSERT_EQ(10u, blockCache.blocks());
+    // Buckets that do not divide the block span are read live.
+    expectSame(db_.range(key, TimeStamp{0}, TimeStamp{20000}, std::nullopt,
+                         TsAggregation::MAX, 300),
+               blockCache.range(key, 0, 20000, TsAggregation::MAX, 300));
+    ASSERT_EQ(10u, blockCache.blocks());
+
+    // Buckets starting in [250, 4321], each over all of its samples.
+    expectSame(db_.range(key, TimeStamp{500}, TimeStamp{4499}, std::nullopt,
+                         TsAggregation::SUM, 500),
+               blockCache.range(key, 250, 4321, TsAggregation::SUM, 500));
+    expectSame(db_.range(key, TimeStamp{300}, TimeStamp{4499}, std::nullopt,
+                         TsAggregation::SUM, 300),
+               blockCache.range(key, 250, 4321, TsAggregation::SUM, 300));
+}
+
+TEST_F(TestBlockCache, TestOpenBlocksAndEviction) {
+    auto late = options();
+    late.lateness = 2500;
+    {
+        cache::BlockCache blockCache{db_, late};
+        expectSame(db_.range(key, TimeStamp{"-"}, TimeStamp{"+"}),
+                   blockCache.range(key, 0, 20000));
+        ASSERT_EQ(7u, blockCache.blocks());
+    }
+    std::filesystem::remove_all(directory);
+
+    auto small = options();
+    small.maxBytes = 700;
+    cache::BlockCache blockCache{db_, small};
+    auto result = blockCache.range(key, 0, 20000);
+    ASSERT_LE(blockCache.bytes(), 700u);
+    ASSERT_GE(blockCache.stats().evicted, 7u);
+    // Evicted files stay readable through the result's mappings.
+    expectSame(db_.range(key, TimeStamp{"-"}, TimeStamp{"+"}), result);
+}
+
+TEST(TestBlockFile, TestRejectsForeignFiles) {
+    auto path =
+        std::filesystem::path{testing::TempDir()} / "block_file_test.blk";
+    TimeSeriesColumns block;
+    block.push_back(1, 1.5);
+    block.push_back(2, 2.5);
+    ASSERT_TRUE(cache::detail::writeBlock(path, "a\nraw", 0, 10, 2, block));
+    auto mapped = cache::detail::mapBlock(path, "a\nraw", 0, 10);
+    ASSERT_TRUE(mapped.has_value());
+    ASSERT_EQ(2u, mapped->sourceCount);
+    ASSERT_EQ(2.5, mapped->segment.values[1]);
+    ASSERT_FALSE(cache::detail::mapBlock(path, "b\nraw", 0, 10));
+    ASSERT_FALSE(cache::detail::mapBlock(path, "a\nraw", 10, 10));
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+    ASSERT_FALSE(cache::detail::mapBlock(path, "a\nraw", 0, 10));
+    std::filesystem::remove(path);
+}
+
+} // namespace
@@ -0,0 +1,270 @@
+#include "redis_time_series_embedded.h"
+#include "gtest/gtest.h"
+
+#include <random>
+
+namespace {
+
+using namespace redis_time_series;
+using command_operator::TsAggregation;
+using command_operator::TsDuplicatePolicy;
+
+std::vector<std::pair<uint64_t, double>> decode(const embedded::Chunk &chunk) {
+    std::vector<std::pair<uint64_t, double>> samples;
+    chunk.forEach([&](uint64_t timestamp, double value) {
+        samples.emplace_back(timestamp, value);
+    });
+    return samples;
+}
+
+TEST(TestEmbedded, TestChunkRoundTrip) {
+    std::mt19937_64 random{7};
+    std::vector<std::pair<uint64_t, double>> samples;
+    uint64_t timestamp = 1609459200000;
+    double value = 20.5;
+    for (int i = 0; i < 2000; ++i) {
+        // Mostly regular intervals with jitter, occasional large gaps.
+        auto step = random() % 10 == 0 ? random() % 5000000 : 1000;
+        timestamp += step + random() % 3;
+        if (random() % 4 != 0)
+            value += static_cast<double>(random() % 200) / 8 - 12.5;
+        samples.emplace_back(timestamp, value);
+    }
+    samples.emplace_back(timestamp + 1, 0.0);
+    samples.emplace_back(timestamp + 2, -0.0);
+    samples.emplace_back(timestamp + 3, std::numeric_limits<double>::max());
+    samples.emplace_back(timestamp + 4, std::numeric_limits<double>::lowest());
+    samples.emplace_back(timestamp + 5, std::numeric_limits<double>::min());
+    samples.emplace_back(std::numeric_limits<uint64_t>::max() / 2, 1.0);
+
+    embedded::Chunk chunk{true, 1 << 20};
+    for (auto [t, v] : samples)
+        ASSERT_TRUE(chunk.append(t, v));
+    ASSERT_EQ(samples.size(), chunk.size());
+    ASSERT_LT(chunk.bytes(), samples.size() * 16 / 2);
+
+    auto decoded = decode(chunk);
+    ASSERT_EQ(samples.size(), decoded.size());
+    for (size_t i = 0; i < samples.size(); ++i) {
+        ASSERT_EQ(samples[i].first, decoded[i].first) << i;
+        ASSERT_EQ(std::bit_cast<uint64_t>(samples[i].second),
+                  std::bit_cast<uint64_t>(decoded[i].second))
+            << i;
+    }
+}
+
+TEST(TestEmbedded, TestChunkCapacity) {
+    embedded::Chunk compressed{true, 128};
+    embedded::Chunk uncompressed{false, 128};
+    uint64_t timestamp = 0;
+    std::mt19937_64 random{1};
+    while (compressed.append(++timestamp * 1000, static_cast<double>(random())))
+        ;
+    ASSERT_LE(compressed.bytes(), 128u);
+    ASSERT_EQ(compressed.size(), decode(compressed).size());
+    timestamp = 0;
+    while (uncompressed.append(++timestamp, 1.0))
+        ;
+    ASSERT_EQ(8u, uncompressed.size());
+    ASSERT_THROW(uncompressed.append(1, 1.0), std::logic_error);
+}
+
+class TestEmbeddedStore : public ::testing::Test {
+  protected:
+    embedded::EmbeddedStore store_{
+        embedded::EmbeddedOptions{0, 4096, TsDuplicatePolicy::BLOCK,
+                                  [this] { return now_; }}};
+    TimeSeriesStore &db_{store_};
+    uint64_t now_{1000};
+    const std::string key{"embedded:test"};
+};
+
+TEST_F(TestEmbeddedStore, TestAddAndRange) {
+    ASSERT_TRUE(db_.create(key, std::nullopt, {{"sensor", "1"}}));
+    ASSERT_THROW(db_.create(key), sw::redis::ReplyError);
+    ASSERT_EQ(1000u, db_.add(key, TimeStamp{"*"}, 1.5).value());
+    for (uint64_t t = 2000; t <= 10000; t += 1000)
+        db_.add(key, t, static_cast<double>(t) / 1000);
+
+    auto samples = db_.range(key, TimeStamp{"-"}, TimeStamp{"+"});
+    ASSERT_EQ(10u, samples.size());
+    ASSERT_EQ(1.5, samples.front().value());
+    ASSERT_EQ(10000u, samples.back().time().value());
+
+    auto reversed = db_.revRange(key, 3000, 5000, 2);
+    ASSERT_EQ(2u, reversed.size());
+    ASSERT_EQ(5000u, reversed[0].time().value());
+    ASSERT_EQ(4000u, reversed[1].time().value());
+
+    auto filtered = db_.range(key, TimeStamp{"-"}, TimeStamp{"+"},
+                              std::nullopt, std::nullopt, std::nullopt,
+                              {2000, 7000}, std::make_pair(5, 10));
+    ASSERT_EQ(1u, filtered.size());
+    ASSERT_EQ(7000u, filtered[0].time().value());
+
+    auto last = db_.get(key);
+    ASSERT_EQ(10000u, last.time().value());
+    ASSERT_EQ(10.0, last.value());
+    ASSERT_THROW(db_.get("embedded:missing"), sw::redis::ReplyError);
+}
+
+TEST_F(TestEmbeddedStore, TestDuplicatePolicy) {
+    db_.create(key);
+    db_.add(key, 1000, 1);
+    db_.add(key, 2000, 2);
+    db_.add(key, 3000, 3);
+    try {
+        db_.add(key, 2000, 5);
+        FAIL() << "BLOCK accepted a duplicate";
+    } catch (const sw::redis::ReplyError &e) {
+        ASSERT_EQ("TSDB: Error at upsert, update is not supported when "
+                  "DUPLICATE_POLICY is set to BLOCK mode",
+                  std::string{e.what()});
+    }
+    db_.add(key, 2000, 5, std::nullopt, {}, std::nullopt, std::nullopt,
+            TsDuplicatePolicy::SUM);
+    db_.add(key, 2000, 4, std::nullopt, {}, std::nullopt, std::nullopt,
+            TsDuplicatePolicy::MIN);
+    db_.add(key, 1500, 9);
+    auto samples = db_.range(key, TimeStamp{"-"}, TimeStamp{"+"});
+    ASSERT_EQ(4u, samples.size());
+    ASSERT_EQ(1500u, samples[1].time().value());
+    ASSERT_EQ(9.0, samples[1].value());
+    ASSERT_EQ(4.0, samples[2].value());
+
+    db_.create("embedded:last", std::nullopt, {}, std::nullopt, std::nullopt,
+               TsDuplicatePolicy::LAST);
+    db_.add("embedded:last", 1000, 1);
+    db_.add("embedded:last", 1000, 2);
+    ASSERT_EQ(2.0, db_.get("embedded:last").value());
+
+    // ALTER changes the policy of the BLOCK series too.
+    db_.alter(key, std::nullopt, {}, TsDuplicatePolicy::MAX);
+    db_.add(key, 2000, 7);
+    ASSERT_EQ(7.0, db_.range(key, TimeStamp{2000}, TimeStamp{2000})[0].value());
+}
+
+TEST_F(TestEmbeddedStore, TestOutOfOrderAcrossChunks) {
+    db_.create(key, std::nullopt, {}, std::nullopt, 128,
+               TsDuplicatePolicy::LAST);
+    for (uint64_t t = 2; t <= 2000; t += 2)
+        db_.add(key, t, static_cast<double>(t));
+    for (uint64_t t = 1; t < 2000; t += 2)
+        db_.add(key, t, static_cast<double>(t));
+    auto info = db_.info(key);
+    ASSERT_EQ(2000u, info.totalSamples());
+    ASSERT_GT(info.chunkCount(), 1u);
+    ASSERT_EQ(128u, info.chunkSize());
+
+    auto samples = db_.range(key, TimeStamp{"-"}, TimeStamp{"+"});
+    ASSERT_EQ(2000u, samples.size());
+    for (size_t i = 0; i < samples.size(); ++i) {
+        ASSERT_EQ(i + 1, samples[i].time().value());
+        ASSERT_EQ(static_cast<double>(i + 1), samples[i].value());
+    }
+    ASSERT_EQ(1000u, db_.del(key, 501, 1500));
+    ASSERT_EQ(1000u, db_.range(key, TimeStamp{"-"}, TimeStamp{"+"}).size());
+}
+
+TEST_F(TestEmbeddedStore, TestRetention) {
+    db_.create(key, 5000, {}, true, 128);
+    for (uint64_t t = 1000; t <= 100000; t += 1000)
+        db_.add(key, t, 1);
+    ASSERT_THROW(db_.add(key, 90000, 1), sw::redis::ReplyError);
+    auto info = db_.info(key);
+    ASSERT_EQ(5000u, info.retentionTime());
+    // Only whole chunks are dropped, so a few older samples may remain.
+    ASSERT_LT(info.totalSamples(), 20u);
+    ASSERT_LE(info.firstTimeStamp().value(), 95000u);
+    ASSERT_EQ(100000u, info.lastTimeStamp().value());
+}
+
+TEST_F(TestEmbeddedStore, TestAggregation) {
+    db_.create(key);
+    for (uint64_t t = 0; t < 10; ++t)
+        db_.add(key, 1000 + t * 100, static_cast<double>(t));
+    auto avg = db_.range(key, TimeStamp{"-"}, TimeStamp{"+"}, std::nullopt,
+                         TsAggregation::AVG, 500);
+    ASSERT_EQ(2u, avg.size());
+    ASSERT_EQ(1000u, avg[0].time().value());
+    ASSERT_EQ(2.0, avg[0].value());
+    ASSERT_EQ(7.0, avg[1].value());
+
+    auto count = db_.range(key, 1100, 1900, std::nullopt, TsAggregation::COUNT,
+                           500, {}, std::nullopt, TimeStamp{"-"});
+    ASSERT_EQ(2u, count.size());
+    ASSERT_EQ(1100u, count[0].time().value());
+    ASSERT_EQ(5.0, count[0].value());
+    ASSERT_EQ(4.0, count[1].value());
+
+    auto stds = db_.range(key, TimeStamp{"-"}, TimeStamp{"+"}, std::nullopt,
+                          TsAggregation::STDS, 1000);
+    ASSERT_EQ(1u, stds.size());
+    ASSERT_NEAR(3.0276503540974917, stds[0].value(), 1e-12);
+    ASSERT_EQ(9.0, db_.range(key, TimeStamp{"-"}, TimeStamp{"+"},
+                             std::nullopt, TsAggregation::RANGE, 1000)[0]
+                       .value());
+}
+
+TEST_F(TestEmbeddedStore, TestIncrByAndMAdd) {
+    now_ = 5000;
+    ASSERT_EQ(5000u, db_.incrBy(key, 2).value());
+    now_ = 6000;
+    db_.incrBy(key, 3);
+    db_.decrBy(key, 1);
+    ASSERT_EQ(4.0, db_.get(key).value());
+    ASSERT_THROW(db_.incrBy(key, 1, 1000), sw::redis::ReplyError);
+
+    db_.create("embedded:other");
+    auto results = db_.madd({{key, 7000, 1},
+                             {"embedded:missing", 7000, 1},
+                             {"embedded:other", 7000, 2}});
+    ASSERT_EQ(3u, results.size());
+    ASSERT_EQ(7000u, results[0].timeStamp.value());
+    ASSERT_FALSE(results[0].error.has_value());
+    ASSERT_EQ("TSDB: the key does not exist", results[1].error);
+    ASSERT_FALSE(results[2].error.has_value());
+    ASSERT_EQ(2.0, db_.get("embedded:other").value());
+    ASSERT_EQ(1.0, db_.get(key).value());
+}
+
+TEST_F(TestEmbeddedStore, TestCompactionRule) {
+    db_.create(key);
+    db_.create("embedded:avg");
+    ASSERT_TRUE(
+        db_.createRule(key, {"embedded:avg", 1000, TsAggregation::AVG}));
+    ASSERT_THROW(db_.createRule(key, {key, 1000, TsAggregation::AVG}),
+                 sw::redis::ReplyError);
+    for (uint64_t t = 1000; t < 4000; t += 250)
+        db_.add(key, t, static_cast<double>((t - 1000) / 250));
+
+    auto compacted =
+        db_.range("embedded:avg", TimeStamp{"-"}, TimeStamp{"+"});
+    // The last bucket stays open until a later sample arrives.
+    ASSERT_EQ(2u, compacted.size());
+    ASSERT_EQ(2000u, compacted[1].time().value());
+    ASSERT_EQ(5.5, compacted[1].value());
+
+    auto info = db_.info(key);
+    ASSERT_EQ(1u, info.rules().size());
+    ASSERT_EQ("embedded:avg", info.rules()[0].destKey());
+    ASSERT_EQ(key, db_.info("embedded:avg").sourceKey());
+    ASSERT_TRUE(db_.deleteRule(key, "embedded:avg"));
+    ASSERT_TRUE(db_.info(key).rules().empty());
+}
+
+TEST_F(TestEmbeddedStore, TestReplicate) {
+    db_.create(key);
+    for (uint64_t t = 1000; t <= 5000; t += 1000)
+        db_.add(key, t, static_cast<double>(t));
+    embedded::EmbeddedStore store;
+    TimeSeriesStore &target = store;
+    target.create(key);
+    ASSERT_EQ(5u, replicate(db_, target, key, TimeStamp{"-"}, TimeStamp{"+"},
+                            2));
+    auto copied = target.range(key, TimeStamp{"-"}, TimeStamp{"+"});
+    ASSERT_EQ(5u, copied.size());
+    ASSERT_EQ(5000.0, copied.back().value());
+}
+
+} // namespace
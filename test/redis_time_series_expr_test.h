@@ -0,0 +1,144 @@
+#include "redis_time_series_embedded.h"
+#include "redis_time_series_expr.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+using namespace redis_time_series;
+
+class TestExpr : public testing::Test {
+  public:
+    embedded::EmbeddedStore store_;
+    TimeSeriesStore &db_{store_};
+
+  protected:
+    void SetUp() override {
+        for (auto key : {"in", "out", "counter", "room:1", "room:2"})
+            db_.create(key);
+        for (uint64_t t = 1000; t <= 10000; t += 1000) {
+            db_.add("in", t, static_cast<double>(t / 100));
+            db_.add("out", t, static_cast<double>(t / 1000));
+        }
+        // Counter going 0, 10, ..., 40, then reset to 5, 15.
+        uint64_t t = 1000;
+        for (double value : {0, 10, 20, 30, 40, 5, 15})
+            db_.add("counter", t++ * 1000, value);
+        db_.add("room:1", 1000, 20);
+        db_.add("room:1", 3000, 22);
+        db_.add("room:2", 2000, 18);
+    }
+
+    expr::EvalOptions grid(uint64_t from, uint64_t to, uint64_t step) {
+        expr::EvalOptions options;
+        options.grid = align::makeGrid(from, to, step);
+        options.blockRows = 3;
+        options.pageSize = 4;
+        return options;
+    }
+};
+
+TEST_F(TestExpr, TestArithmetic) {
+    expr::Evaluator evaluator{store_, grid(1000, 10000, 1000)};
+    auto flow = evaluator.collect(expr::series("in") - expr::series("out"));
+    ASSERT_EQ(10u, flow.size());
+    for (size_t i = 0; i < flow.size(); ++i) {
+        ASSERT_EQ(1000 * (i + 1), flow.timestamps[i]);
+        ASSERT_DOUBLE_EQ(9.0 * static_cast<double>(i + 1), flow.values[i]);
+    }
+    // Scalar chains fuse into one operator; 2 * (out + 1) - 1.
+    auto scaled = evaluator.collect(-(1 - (expr::series("out") + 1) * 2));
+    ASSERT_DOUBLE_EQ(3, scaled.values[0]);
+    ASSERT_DOUBLE_EQ(21, scaled.values[9]);
+    auto ratio = evaluator.collect(expr::abs(expr::series("out") / -2.0));
+    ASSERT_DOUBLE_EQ(5, ratio.values[9]);
+}
+
+TEST_F(TestExpr, TestRateWithReset) {
+    expr::Evaluator evaluator{store_, grid(1000000, 1006000, 1000)};
+    auto rate = evaluator.collect(expr::rate(expr::series("counter")));
+    ASSERT_TRUE(std::isnan(rate.values[0]));
+    std::vector<double> expected{10, 10, 10, 10, 5, 10};
+    for (size_t i = 0; i < expected.size(); ++i)
+        ASSERT_DOUBLE_EQ(expected[i], rate.values[i + 1]) << i;
+    auto derivative =
+        evaluator.collect(expr::derivative(expr::series("counter")));
+    ASSERT_DOUBLE_EQ(-35, derivative.values[5]);
+}
+
+TEST_F(TestExpr, TestMovingWindows) {
+    expr::Evaluator evaluator{store_, grid(1000, 10000, 1000)};
+    auto out = expr::series("out");
+    auto sum = evaluator.collect(expr::moving(out, expr::Window::SUM, 3000));
+    ASSERT_DOUBLE_EQ(1, sum.values[0]);
+    ASSERT_DOUBLE_EQ(3, sum.values[1]);
+    ASSERT_DOUBLE_EQ(6, sum.values[2]);
+    ASSERT_DOUBLE_EQ(27, sum.values[9]);
+    auto avg = evaluator.collect(expr::moving(out, expr::Window::AVG, 2000));
+    ASSERT_DOUBLE_EQ(9.5, avg.values[9]);
+    auto min = evaluator.collect(expr::moving(-out, expr::Window::MIN, 4000));
+    ASSERT_DOUBLE_EQ(-10, min.values[9]);
+    auto max = evaluator.collect(expr::moving(-out, expr::Window::MAX, 4000));
+    ASSERT_DOUBLE_EQ(-7, max.values[9]);
+}
+
+TEST_F(TestExpr, TestGroups) {
+    auto resolver = [](const std::vector<std::string> &filter) {
+        EXPECT_EQ("room=kitchen", filter.at(0));
+        return std::vector<std::string>{"room:1", "room:2"};
+    };
+    expr::Evaluator evaluator{store_, grid(1000, 3000, 1000), resolver};
+    auto reduce = [&](expr::Reducer reducer) {
+        return evaluator.collect(expr::group({"room=kitchen"}, reducer))
+            .values;
+    };
+    ASSERT_EQ((std::vector<double>{20, 38, 40}), reduce(expr::Reducer::SUM));
+    ASSERT_EQ((std::vector<double>{20, 19, 20}), reduce(expr::Reducer::AVG));
+    ASSERT_EQ((std::vector<double>{1, 2, 2}), reduce(expr::Reducer::COUNT));
+    ASSERT_EQ((std::vector<double>{0, 2, 4}), reduce(expr::Reducer::RANGE));
+    ASSERT_EQ((std::vector<double>{0, 1, 2}), reduce(expr::Reducer::STDP));
+    ASSERT_EQ((std::vector<double>{20, 18, 18}), reduce(expr::Reducer::MIN));
+
+    expr::Evaluator early{store_, grid(0, 0, 1000), resolver};
+    auto none = early.collect(expr::group({"room=kitchen"}));
+    ASSERT_TRUE(std::isnan(none.values[0]));
+
+    expr::Evaluator unresolved{store_, grid(1000, 3000, 1000)};
+    ASSERT_THROW(unresolved.collect(expr::group({"room=kitchen"})),
+                 std::invalid_argument);
+
+    // The spread survives values far from zero.
+    db_.create("big:1");
+    db_.create("big:2");
+    db_.add("big:1", 1000, 1e9 + 1);
+    db_.add("big:2", 1000, 1e9 + 3);
+    expr::Evaluator big{store_, grid(1000, 1000, 1000),
+                        [](const std::vector<std::string> &) {
+                            return std::vector<std::string>{"big:1", "big:2"};
+                        }};
+    ASSERT_DOUBLE_EQ(
+        1, big.collect(expr::group({"big"}, expr::Reducer::STDP)).values[0]);
+}
+
+TEST_F(TestExpr, TestLazyFetching) {
+    db_.create("long");
+    for (uint64_t t = 1; t <= 1000; ++t)
+        db_.add("long", t * 10, static_cast<double>(t));
+    // Only the samples up to the first block past the grid are read.
+    auto options = grid(2000, 2500, 100);
+    options.pageSize = 16;
+    expr::Evaluator evaluator{store_, options};
+    std::size_t blocks = 0;
+    auto stats = evaluator.evaluate(
+        expr::series("long"),
+        [&](std::span<const uint64_t> timestamps,
+            std::span<const double> values) {
+            ++blocks;
+            for (size_t i = 0; i < timestamps.size(); ++i)
+                ASSERT_DOUBLE_EQ(timestamps[i] / 10.0, values[i]);
+        });
+    ASSERT_EQ(2u, blocks);
+    ASSERT_LE(stats.samplesFetched, 1u + 51u + 16u);
+    ASSERT_EQ(1u + 4u, stats.requests);
+}
+
+} // namespace
@@ -0,0 +1,83 @@
+#include "redis_time_series.h"
+#include "redis_time_series_fake_server.h"
+#include "gtest/gtest.h"
+#include <sw/redis++/redis++.h>
+
+namespace {
+
+using namespace redis_time_series;
+
+TEST(TestFakeStore, TestRequestParser) {
+    fake::detail::RequestParser parser;
+    std::string request = "*2\r\n$6\r\nTS.GET\r\n$3\r\nkey\r\nPING\r\n";
+    parser.feed(request.data(), 10);
+    ASSERT_FALSE(parser.next().has_value());
+    parser.feed(request.data() + 10, request.size() - 10);
+    ASSERT_EQ((std::vector<std::string>{"TS.GET", "key"}), parser.next());
+    ASSERT_EQ((std::vector<std::string>{"PING"}), parser.next());
+    ASSERT_FALSE(parser.next().has_value());
+}
+
+TEST(TestFakeStore, TestAddAndRange) {
+    fake::FakeStore store{[] { return uint64_t{5000}; }};
+    ASSERT_EQ("+OK\r\n", store.execute({"TS.CREATE", "a", "LABELS", "k", "v"}));
+    ASSERT_EQ(":1000\r\n", store.execute({"TS.ADD", "a", "1000", "1.5"}));
+    ASSERT_EQ(":5000\r\n", store.execute({"TS.ADD", "a", "*", "2"}));
+    ASSERT_EQ("*2\r\n*2\r\n:1000\r\n+1.5\r\n*2\r\n:5000\r\n+2\r\n",
+              store.execute({"TS.RANGE", "a", "-", "+"}));
+    ASSERT_EQ("*1\r\n*2\r\n:0\r\n+3.5\r\n",
+              store.execute({"TS.RANGE", "a", "-", "+", "AGGREGATION", "sum",
+                             "10000"}));
+    ASSERT_EQ(0u, store.execute({"TS.ADD", "a", "1000", "3"}).find("-ERR"));
+    ASSERT_EQ("*1\r\n$1\r\na\r\n", store.execute({"TS.QUERYINDEX", "k=v"}));
+    ASSERT_EQ(0u, store.execute({"TS.GET", "missing"}).find("-ERR"));
+}
+
+class TestFakeServer : public testing::Test {
+  public:
+    TestFakeServer() {
+        server_.start();
+        inMemory_ = std::make_unique<sw::redis::Redis>(server_.uri());
+    }
+
+    fake::FakeServer server_;
+    std::unique_ptr<sw::redis::Redis> inMemory_;
+    const std::string key = "FAKE_SERVER_TESTS";
+
+  protected:
+    void SetUp() override {}
+    void TearDown() override {}
+};
+
+TEST_F(TestFakeServer, TestClientRoundTrip) {
+    ASSERT_TRUE(client::timeSeriesCreate(inMemory_.get(), key, std::nullopt,
+                                         {{"site", "a"}}));
+    client::timeSeriesMAdd(inMemory_.get(), {{key, TimeStamp{1000}, 1},
+                                             {key, TimeStamp{2000}, 2}});
+    auto samples = client::timeSeriesRange(inMemory_.get(), key,
+                                           TimeStamp{"-"}, TimeStamp{"+"});
+    ASSERT_EQ(2u, samples.size());
+    ASSERT_EQ(2000u, samples[1].time().value());
+
+    auto info = client::timeSeriesInfo(inMemory_.get(), key);
+    ASSERT_EQ(2u, info.totalSamples());
+    ASSERT_EQ(std::optional<std::string_view>{"a"},
+              findLabel(info.labels(), "site"));
+
+    auto series = client::timeSeriesMRange(inMemory_.get(), TimeStamp{"-"},
+                                           TimeStamp{"+"}, {"site=a"});
+    ASSERT_EQ(1u, series.size());
+    ASSERT_EQ(key, std::get<0>(series[0]));
+}
+
+TEST(TestFakeServerFaults, TestInjectedErrors) {
+    fake::FakeServerOptions options;
+    options.errorRate = 1;
+    fake::FakeServer server{options};
+    server.start();
+    sw::redis::Redis db{server.uri()};
+    ASSERT_THROW(db.ping(), sw::redis::ReplyError);
+    ASSERT_EQ(1u, server.stats().injectedErrors);
+}
+
+} // namespace
@@ -0,0 +1,95 @@
+#include "redis_time_series_hedging.h"
+#include "gtest/gtest.h"
+#include <thread>
+
+namespace {
+
+using namespace redis_time_series;
+using namespace std::chrono_literals;
+
+// The queries below never touch the connection, so no server is needed.
+hedging::HedgedReader makeReader() {
+    hedging::HedgeOptions options;
+    options.initialDelay = 20ms;
+    return hedging::HedgedReader{{nullptr, nullptr}, options};
+}
+
+TEST(TestHedging, TestLatencyPercentile) {
+    hedging::LatencyTracker tracker{100};
+    for (int i = 1; i <= 100; ++i)
+        tracker.record(std::chrono::microseconds{i});
+    ASSERT_EQ(100u, tracker.count());
+    ASSERT_EQ(std::chrono::microseconds{95}, tracker.percentile(0.95));
+    ASSERT_EQ(std::chrono::microseconds{1}, tracker.percentile(0));
+}
+
+TEST(TestHedging, TestFastReadIsNotHedged) {
+    auto reader = makeReader();
+    ASSERT_EQ(42, reader.read<int>([](sw::redis::Redis *) { return 42; }));
+    auto metrics = reader.metrics();
+    ASSERT_EQ(1u, metrics.calls);
+    ASSERT_EQ(0u, metrics.hedged);
+}
+
+TEST(TestHedging, TestSlowReadIsHedged) {
+    auto reader = makeReader();
+    auto attempts = std::make_shared<std::atomic<int>>(0);
+    auto result = reader.read<int>([attempts](sw::redis::Redis *) {
+        if (attempts->fetch_add(1) == 0) {
+            std::this_thread::sleep_for(500ms);
+            return 1;
+        }
+        return 2;
+    });
+    ASSERT_EQ(2, result);
+    auto metrics = reader.metrics();
+    ASSERT_EQ(1u, metrics.hedged);
+    ASSERT_EQ(1u, metrics.hedgeWins);
+}
+
+TEST(TestHedging, TestFailedAttemptHedgesImmediately) {
+    auto reader = makeReader();
+    auto attempts = std::make_shared<std::atomic<int>>(0);
+    auto result = reader.read<int>([attempts](sw::redis::Redis *) {
+        if (attempts->fetch_add(1) == 0) throw std::runtime_error("down");
+        return 2;
+    });
+    ASSERT_EQ(2, result);
+    ASSERT_THROW(reader.read<int>([](sw::redis::Redis *) -> int {
+        throw std::runtime_error("down");
+    }),
+                 std::runtime_error);
+}
+
+TEST(TestHedging, TestDeadline) {
+    auto reader = makeReader();
+    auto deadline = hedging::HedgedReader::Clock::now() + 50ms;
+    ASSERT_THROW(reader.read<int>(
+                     [](sw::redis::Redis *) {
+                         std::this_thread::sleep_for(300ms);
+                         return 1;
+                     },
+                     deadline),
+                 sw::redis::TimeoutError);
+    ASSERT_EQ(1u, reader.metrics().deadlineExceeded);
+}
+
+TEST(TestHedging, TestCancellation) {
+    auto reader = makeReader();
+    std::stop_source source;
+    std::thread canceller([&source] {
+        std::this_thread::sleep_for(30ms);
+        source.request_stop();
+    });
+    ASSERT_THROW(reader.read<int>(
+                     [](sw::redis::Redis *) {
+                         std::this_thread::sleep_for(300ms);
+                         return 1;
+                     },
+                     std::nullopt, source.get_token()),
+                 std::runtime_error);
+    canceller.join();
+    ASSERT_EQ(1u, reader.metrics().cancelled);
+}
+
+} // namespace
@@ -0,0 +1,50 @@
+#include "redis_time_series_iso8601.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+using namespace redis_time_series;
+
+TEST(TestIso8601, TestLayouts) {
+    ASSERT_EQ(0u, iso8601::parse("1970-01-01"));
+    ASSERT_EQ(1609459200000u, iso8601::parse("2021-01-01T00:00:00Z"));
+    ASSERT_EQ(1609459200000u, iso8601::parse("2021-01-01 00:00:00"));
+    ASSERT_EQ(1614556800000u, iso8601::parse("2021-03-01t00:00:00z"));
+    ASSERT_EQ(951782400000u, iso8601::parse("2000-02-29T00:00:00Z"));
+    ASSERT_EQ(4102444799000u, iso8601::parse("2099-12-31T23:59:59Z"));
+}
+
+TEST(TestIso8601, TestFractionAndOffset) {
+    ASSERT_EQ(1609459200123u, iso8601::parse("2021-01-01T00:00:00.123Z"));
+    ASSERT_EQ(1609459200500u, iso8601::parse("2021-01-01T00:00:00,5Z"));
+    ASSERT_EQ(1609459200123u,
+              iso8601::parse("2021-01-01T00:00:00.123456789Z"));
+    ASSERT_EQ(1609459200000u, iso8601::parse("2021-01-01T02:00:00+02:00"));
+    ASSERT_EQ(1609459200000u, iso8601::parse("2020-12-31T19:30:00-0430"));
+    ASSERT_EQ(1609459200000u, iso8601::parse("2021-01-01T05:00:00+05"));
+}
+
+TEST(TestIso8601, TestRejectsInvalid) {
+    for (auto text : {"", "2021-01-01T", "2021-1-01T00:00:00Z",
+                      "2021-02-29T00:00:00Z", "2021-13-01", "2021-01-32",
+                      "2021-01-01T24:00:00Z", "2021-01-01T00:60:00Z",
+                      "2021-01-01X00:00:00Z", "2021-01-01T00:00:00.Z",
+                      "2021-01-01T00:00:00+2", "2021-01-01T00:00:00 UTC",
+                      "1969-12-31T23:59:59Z", "2021/01/01"}) {
+        ASSERT_FALSE(iso8601::tryParse(text).has_value()) << text;
+    }
+    ASSERT_THROW(iso8601::parse("yesterday"), std::invalid_argument);
+}
+
+TEST(TestIso8601, TestBatch) {
+    std::vector<std::string> input{"2021-01-01T00:00:00Z",
+                                   "2021-01-01T00:00:01.5+00:00"};
+    ASSERT_EQ((std::vector<uint64_t>{1609459200000, 1609459201500}),
+              iso8601::parseBatch(input));
+
+    input.push_back("bad");
+    std::vector<uint64_t> output(input.size());
+    ASSERT_THROW(iso8601::parseBatch(input, output), std::invalid_argument);
+}
+
+} // namespace
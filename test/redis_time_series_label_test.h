@@ -0,0 +1,66 @@
+#include "redis_time_series.h"
+#include "gtest/gtest.h"
+#include <thread>
+
+namespace {
+
+using namespace redis_time_series;
+
+TEST(TestStringPool, TestInternReturnsSameId) {
+    StringPool pool;
+    auto site = pool.intern("site");
+    ASSERT_EQ(site, pool.intern(std::string{"site"}));
+    ASSERT_NE(site, pool.intern("unit"));
+    ASSERT_EQ("site", pool.view(site));
+    ASSERT_EQ(2u, pool.size());
+}
+
+TEST(TestStringPool, TestFindDoesNotIntern) {
+    StringPool pool;
+    ASSERT_FALSE(pool.find("missing").has_value());
+    ASSERT_EQ(0u, pool.size());
+}
+
+TEST(TestStringPool, TestViewsStayValidWhilePoolGrows) {
+    StringPool pool;
+    auto first = pool.view(pool.intern("first"));
+    for (int i = 0; i < 10000; ++i)
+        pool.intern(fmt::format("value-{}", i));
+    ASSERT_EQ("first", first);
+    ASSERT_EQ("value-9999", pool.view(*pool.find("value-9999")));
+}
+
+TEST(TestStringPool, TestConcurrentIntern) {
+    StringPool pool;
+    std::vector<std::thread> threads;
+    std::vector<std::vector<StringPool::Id>> ids(4);
+    for (size_t t = 0; t < ids.size(); ++t) {
+        threads.emplace_back([&pool, &ids, t] {
+            for (int i = 0; i < 1000; ++i)
+                ids[t].push_back(pool.intern(fmt::format("key-{}", i)));
+        });
+    }
+    for (auto &thread : threads)
+        thread.join();
+    ASSERT_EQ(1000u, pool.size());
+    for (auto &list : ids)
+        ASSERT_EQ(ids[0], list);
+}
+
+TEST(TestLabel, TestLabelsShareInternedStrings) {
+    TimeSeriesLabel lhs{"site", "plant-1"};
+    TimeSeriesLabel rhs{std::string{"site"}, std::string{"plant-1"}};
+    ASSERT_EQ(lhs, rhs);
+    ASSERT_EQ(lhs.key().data(), rhs.key().data());
+    ASSERT_EQ("plant-1", rhs.value());
+}
+
+TEST(TestLabel, TestFindLabel) {
+    std::vector<TimeSeriesLabel> labels{{"site", "plant-1"}, {"unit", "kW"}};
+    ASSERT_EQ("kW", findLabel(labels, "unit"));
+    ASSERT_FALSE(findLabel(labels, "never-interned-key").has_value());
+    ASSERT_TRUE(hasLabel(labels, "site", "plant-1"));
+    ASSERT_FALSE(hasLabel(labels, "site", "plant-2"));
+}
+
+} // namespace
@@ -0,0 +1,110 @@
+#include "redis_time_series_last_value.h"
+#include "gtest/gtest.h"
+#include <sw/redis++/redis++.h>
+
+namespace {
+
+using namespace redis_time_series;
+
+TEST(TestLastValueTable, TestStoreAndLoad) {
+    cache::LastValueTable table{2};
+    ASSERT_FALSE(table.load(0).has_value());
+    table.store(0, cache::LastValue{10, 1.5});
+    ASSERT_EQ((cache::LastValue{10, 1.5}), table.load(0));
+    ASSERT_FALSE(table.load(1).has_value());
+    table.store(0, std::nullopt);
+    ASSERT_FALSE(table.load(0).has_value());
+}
+
+TEST(TestLastValueTable, TestReadersNeverSeeTornValues) {
+    cache::LastValueTable table{1};
+    std::atomic<bool> done{false};
+    std::thread writer([&] {
+        for (uint64_t i = 1; i <= 100000; ++i)
+            table.store(0, cache::LastValue{i, static_cast<double>(i)});
+        done = true;
+    });
+    uint64_t previous = 0;
+    while (!done) {
+        auto value = table.load(0);
+        if (!value.has_value()) continue;
+        ASSERT_EQ(static_cast<double>(value->timestamp), value->value);
+        ASSERT_GE(value->timestamp, previous);
+        previous = value->timestamp;
+    }
+    writer.join();
+}
+
+class TestLastValueCache : public testing::Test {
+  public:
+    TestLastValueCache()
+        : inMemory_{
+              std::make_unique<sw::redis::Redis>("tcp://localhost:6379")} {}
+
+    std::unique_ptr<sw::redis::Redis> inMemory_;
+    const std::string key = "LAST_VALUE_TESTS";
+
+  protected:
+    void SetUp() override {}
+    void TearDown() override { inMemory_->del(key); }
+
+    // Polls `cache` until `key` holds `timestamp` or a second has passed.
+    std::optional<cache::LastValue> waitFor(const cache::LastValueCache &cache,
+                                            uint64_t timestamp) {
+        auto until = std::chrono::steady_clock::now() + std::chrono::seconds{1};
+        while (std::chrono::steady_clock::now() < until) {
+            auto value = cache.get(key);
+            if (value.has_value() && value->timestamp == timestamp)
+                return value;
+            std::this_thread::sleep_for(std::chrono::milliseconds{5});
+        }
+        return cache.get(key);
+    }
+};
+
+TEST_F(TestLastValueCache, TestFollowsWrites) {
+    client::timeSeriesAdd(inMemory_.get(), key, TimeStamp{1000}, 1);
+    cache::LastValueCacheOptions options;
+    options.configureNotifications = true;
+    cache::LastValueCache cache{inMemory_.get(), {key, "LAST_VALUE_MISSING"},
+                                options};
+    cache.start();
+    ASSERT_EQ((cache::LastValue{1000, 1}), cache.get(key));
+    ASSERT_FALSE(cache.get("LAST_VALUE_MISSING").has_value());
+    ASSERT_FALSE(cache.get("LAST_VALUE_UNTRACKED").has_value());
+
+    client::timeSeriesAdd(inMemory_.get(), key, TimeStamp{2000}, 2);
+    ASSERT_EQ((cache::LastValue{2000, 2}), waitFor(cache, 2000));
+    client::timeSeriesMAdd(inMemory_.get(), {{key, TimeStamp{3000}, 3}});
+    ASSERT_EQ((cache::LastValue{3000, 3}), waitFor(cache, 3000));
+    ASSERT_GE(cache.notifications(), 2u);
+
+    inMemory_->del(key);
+    auto until = std::chrono::steady_clock::now() + std::chrono::seconds{1};
+    while (cache.get(key).has_value() &&
+           std::chrono::steady_clock::now() < until)
+        std::this_thread::sleep_for(std::chrono::milliseconds{5});
+    ASSERT_FALSE(cache.get(key).has_value());
+    cache.stop();
+}
+
+TEST_F(TestLastValueCache, TestCoalescesWrites) {
+    client::timeSeriesAdd(inMemory_.get(), key, TimeStamp{1}, 0);
+    cache::LastValueCacheOptions options;
+    options.configureNotifications = true;
+    options.refreshInterval = std::chrono::milliseconds{200};
+    cache::LastValueCache cache{inMemory_.get(), {key}, options};
+    cache.start();
+    auto readsAtStart = cache.reads();
+
+    auto pipeline = inMemory_->pipeline(false);
+    for (uint64_t ts = 2; ts <= 100; ++ts)
+        pipeline.command(command::ADD, key, std::to_string(ts), "1");
+    pipeline.exec();
+    ASSERT_EQ((cache::LastValue{100, 1}), waitFor(cache, 100));
+    ASSERT_EQ(99u, cache.notifications());
+    ASSERT_LE(cache.reads() - readsAtStart, 3u);
+    cache.stop();
+}
+
+} // namespace
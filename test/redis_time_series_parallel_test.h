@@ -0,0 +1,69 @@
+#include "redis_time_series_parallel.h"
+#include "redis_time_series_test_support.h"
+#include "gtest/gtest.h"
+#include <sw/redis++/redis++.h>
+
+namespace {
+
+using namespace redis_time_series;
+using test_support::makeInfo;
+
+TEST(TestPlanSlices, TestSmallRangeIsOneSlice) {
+    auto slices = parallel::planSlices(0, 1000, makeInfo(10, 100, 200), {});
+    ASSERT_EQ(1u, slices.size());
+    ASSERT_EQ((parallel::RangeSlice{0, 1000}), slices[0]);
+}
+
+TEST(TestPlanSlices, TestSlicesCoverRangeInOrder) {
+    parallel::SplitRangeOptions options{4, 10};
+    auto slices =
+        parallel::planSlices(0, 5000, makeInfo(1000, 1000, 1999), options);
+    ASSERT_EQ(4u, slices.size());
+    ASSERT_EQ(0u, slices.front().from);
+    ASSERT_EQ(5000u, slices.back().to);
+    ASSERT_EQ(1250u, slices[1].from);
+    for (size_t i = 1; i < slices.size(); ++i)
+        ASSERT_EQ(slices[i - 1].to + 1, slices[i].from);
+}
+
+TEST(TestPlanSlices, TestDensityScalesWithOverlap) {
+    parallel::SplitRangeOptions options{8, 100};
+    auto slices =
+        parallel::planSlices(0, 1099, makeInfo(1000, 1000, 1999), options);
+    ASSERT_EQ(1u, slices.size());
+}
+
+class TestParallelRange : public testing::Test {
+  public:
+    TestParallelRange()
+        : inMemory_{
+              std::make_unique<sw::redis::Redis>("tcp://localhost:6379")} {}
+
+    std::unique_ptr<sw::redis::Redis> inMemory_;
+    const std::string key = "PARALLEL_RANGE_TESTS";
+
+  protected:
+    void SetUp() override { client::timeSeriesCreate(inMemory_.get(), key); }
+    void TearDown() override { inMemory_->del(key); }
+};
+
+TEST_F(TestParallelRange, TestStitchedRangeMatchesRange) {
+    std::vector<std::tuple<std::string, TimeStamp, double>> samples;
+    for (uint64_t ts = 1; ts <= 1000; ++ts)
+        samples.emplace_back(key, TimeStamp{ts}, static_cast<double>(ts) / 2);
+    client::timeSeriesMAdd(inMemory_.get(), samples);
+
+    parallel::SplitRangeOptions options{4, 10};
+    auto columns = parallel::timeSeriesParallelRange(
+        {inMemory_.get(), inMemory_.get()}, key, 0, 2000, options);
+    auto tuples =
+        client::timeSeriesRange(inMemory_.get(), key, TimeStamp{"-"},
+                                TimeStamp{"+"});
+    ASSERT_EQ(tuples.size(), columns.size());
+    for (size_t i = 0; i < tuples.size(); ++i) {
+        ASSERT_EQ(tuples[i].time().value(), columns.timestamps[i]);
+        ASSERT_EQ(tuples[i].value(), columns.values[i]);
+    }
+}
+
+} // namespace
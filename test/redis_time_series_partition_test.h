@@ -0,0 +1,80 @@
+#include "redis_time_series_partition.h"
+#include "gtest/gtest.h"
+#include <sw/redis++/redis++.h>
+
+namespace {
+
+using namespace redis_time_series;
+
+partition::PartitionOptions secondPartitions(bool hashTag = false) {
+    partition::PartitionOptions options;
+    options.width = std::chrono::milliseconds{1000};
+    options.hashTag = hashTag;
+    return options;
+}
+
+TEST(TestPartitionKeys, TestKeyNames) {
+    auto options = secondPartitions();
+    ASSERT_EQ(2000u, partition::partitionStart(2999, options));
+    ASSERT_EQ("temp:2000", partition::physicalKey("temp", 2000, options));
+    ASSERT_EQ("temp:{2000}",
+              partition::physicalKey("temp", 2000, secondPartitions(true)));
+    ASSERT_EQ(2000u, partition::parsePartitionStart("temp:{2000}"));
+    ASSERT_EQ(2000u, partition::parsePartitionStart("site:a:2000"));
+    ASSERT_FALSE(partition::parsePartitionStart("temp").has_value());
+    ASSERT_FALSE(partition::parsePartitionStart("temp:latest").has_value());
+}
+
+class TestPartition : public testing::Test {
+  public:
+    TestPartition()
+        : inMemory_{
+              std::make_unique<sw::redis::Redis>("tcp://localhost:6379")} {}
+
+    std::unique_ptr<sw::redis::Redis> inMemory_;
+    const std::string key = "PARTITION_TESTS";
+
+  protected:
+    void SetUp() override {}
+    void TearDown() override {
+        auto filter = fmt::format("{}={}", partition::LOGICAL_LABEL, key);
+        auto keys = client::timeSeriesQueryIndex(inMemory_.get(), {filter});
+        if (!keys.empty()) inMemory_->del(keys.begin(), keys.end());
+    }
+};
+
+TEST_F(TestPartition, TestWritesSpreadOverPartitions) {
+    partition::PartitionedSeries series{inMemory_.get(), key,
+                                        {{"unit", "kW"}}, secondPartitions()};
+    series.madd({{500, 1}, {1500, 2}, {2500, 3}});
+    series.add(2600, 4);
+    ASSERT_EQ((std::vector<uint64_t>{0, 1000, 2000}), series.partitions());
+
+    auto columns = series.range(1000, 3000);
+    ASSERT_EQ((std::vector<uint64_t>{1500, 2500, 2600}), columns.timestamps);
+    ASSERT_EQ((std::vector<double>{2, 3, 4}), columns.values);
+}
+
+TEST_F(TestPartition, TestDropBefore) {
+    partition::PartitionedSeries series{inMemory_.get(), key, {},
+                                        secondPartitions()};
+    series.madd({{500, 1}, {1500, 2}, {2500, 3}});
+    ASSERT_EQ(2u, series.dropBefore(2000));
+    ASSERT_EQ((std::vector<uint64_t>{2000}), series.partitions());
+}
+
+TEST_F(TestPartition, TestMRangeMergesPartitions) {
+    partition::PartitionedSeries series{inMemory_.get(), key,
+                                        {{"unit", "kW"}}, secondPartitions()};
+    series.madd({{500, 1}, {1500, 2}, {2500, 3}});
+    auto options = secondPartitions();
+    options.partitionsPerRequest = 1;
+    auto filter = fmt::format("{}={}", partition::LOGICAL_LABEL, key);
+    auto result =
+        partition::mrange(inMemory_.get(), 0, 3000, {filter}, options);
+    ASSERT_EQ(1u, result.size());
+    ASSERT_EQ((std::vector<uint64_t>{500, 1500, 2500}),
+              result[key].timestamps);
+}
+
+} // namespace
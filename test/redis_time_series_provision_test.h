@@ -0,0 +1,155 @@
+#include "redis_time_series_provision.h"
+#include "redis_time_series_test_support.h"
+#include "gtest/gtest.h"
+#include <sw/redis++/redis++.h>
+
+namespace {
+
+using namespace redis_time_series;
+using test_support::makeInfo;
+using command_operator::TsAggregation;
+using command_operator::TsDuplicatePolicy;
+
+std::vector<std::string> provisionArgs(const aux::ArgList &args) {
+    return std::vector<std::string>(args.begin(), args.end());
+}
+
+TEST(TestProvisionPlan, TestCreateArgsEndWithLabels) {
+    auto args = aux::buildTsCreateArgs("key", 1000, {{"a", "1"}}, true,
+                                       std::nullopt, TsDuplicatePolicy::LAST);
+    ASSERT_EQ((std::vector<std::string>{"key", "RETENTION", "1000",
+                                        "UNCOMPRESSED", "DUPLICATE_POLICY",
+                                        "LAST", "LABELS", "a", "1"}),
+              provisionArgs(args));
+}
+
+TEST(TestProvisionPlan, TestIncrDecrByArgsEndWithLabels) {
+    auto args = aux::buildTsIncrDecrByArgs("key", 2.5, TimeStamp{1000}, 5000,
+                                           {{"a", "1"}}, true, 256);
+    ASSERT_EQ((std::vector<std::string>{"key", "2.500000", "TIMESTAMP",
+                                        "1000", "RETENTION", "5000",
+                                        "CHUNK_SIZE", "256", "UNCOMPRESSED",
+                                        "LABELS", "a", "1"}),
+              provisionArgs(args));
+}
+
+TEST(TestProvisionPlan, TestDiff) {
+    provision::SeriesSpec spec{
+        .key = "plant:1",
+        .retentionTime = 5000,
+        .labels = {{"site", "a"}, {"unit", "kW"}},
+        .duplicatePolicy = TsDuplicatePolicy::LAST,
+        .rules = {{"plant:1:1h", 3600000, TsAggregation::AVG},
+                  {"plant:1:1d", 86400000, TsAggregation::MAX}}};
+
+    auto missing = provision::planSeries(spec, std::nullopt);
+    ASSERT_TRUE(missing.create);
+    ASSERT_EQ(2u, missing.createRules.size());
+
+    // Same state, labels in another order: nothing to do.
+    auto same = makeInfo(0, 0, 0,
+                         {.retentionTime = 5000,
+                          .labels = {{"unit", "kW"}, {"site", "a"}},
+                          .rules = spec.rules,
+                          .duplicatePolicy = TsDuplicatePolicy::LAST});
+    ASSERT_TRUE(provision::planSeries(spec, same).empty());
+
+    auto stale = makeInfo(0, 0, 0,
+                          {.retentionTime = 5000,
+                           .labels = {{"site", "b"}},
+                           .rules = {{"plant:1:1h", 60000, TsAggregation::AVG},
+                                     {"plant:1:old", 60000,
+                                      TsAggregation::MIN}},
+                           .duplicatePolicy = TsDuplicatePolicy::BLOCK});
+    auto changes = provision::planSeries(spec, stale);
+    ASSERT_FALSE(changes.create);
+    ASSERT_EQ((std::vector<std::string>{"plant:1", "DUPLICATE_POLICY", "LAST",
+                                        "LABELS", "site", "a", "unit", "kW"}),
+              provisionArgs(*changes.alter));
+    ASSERT_EQ((std::vector<std::string>{"plant:1:1h"}), changes.deleteRules);
+    ASSERT_EQ(2u, changes.createRules.size());
+
+    auto pruned = provision::planSeries(spec, stale, true);
+    ASSERT_EQ((std::vector<std::string>{"plant:1:1h", "plant:1:old"}),
+              pruned.deleteRules);
+
+    provision::SeriesSpec bare{.key = "plant:1"};
+    auto cleared = provision::planSeries(bare, stale);
+    ASSERT_EQ((std::vector<std::string>{"plant:1", "LABELS"}),
+              provisionArgs(*cleared.alter));
+
+    // Retention and policy left unset in the spec are not compared.
+    provision::SeriesSpec labelsOnly{.key = "plant:1",
+                                     .labels = {{"site", "b"}},
+                                     .rules = stale.rules()};
+    ASSERT_TRUE(provision::planSeries(labelsOnly, stale).empty());
+}
+
+class TestProvision : public testing::Test {
+  public:
+    TestProvision()
+        : inMemory_{
+              std::make_unique<sw::redis::Redis>("tcp://localhost:6379")} {}
+
+    std::unique_ptr<sw::redis::Redis> inMemory_;
+    const std::string key = "PROVISION_TESTS";
+
+  protected:
+    void SetUp() override {}
+    void TearDown() override {
+        for (int i = 0; i < 20; ++i) {
+            inMemory_->del(key + ":" + std::to_string(i));
+            inMemory_->del(key + ":" + std::to_string(i) + ":avg");
+        }
+    }
+
+    std::vector<provision::SeriesSpec> specs(const std::string &site) const {
+        std::vector<provision::SeriesSpec> result;
+        for (int i = 0; i < 20; ++i) {
+            auto name = key + ":" + std::to_string(i);
+            result.push_back({.key = name + ":avg",
+                              .retentionTime = 86400000,
+                              .labels = {{"site", site}}});
+            result.push_back(
+                {.key = name,
+                 .retentionTime = 3600000,
+                 .labels = {{"site", site}, {"tag", std::to_string(i)}},
+                 .duplicatePolicy = TsDuplicatePolicy::LAST,
+                 .rules = {{name + ":avg", 60000, TsAggregation::AVG}}});
+        }
+        return result;
+    }
+};
+
+TEST_F(TestProvision, TestIdempotentProvisioning) {
+    provision::ProvisionOptions options;
+    options.batchSize = 7;
+    options.connections = 3;
+    auto first = provision::provisionSeries(inMemory_.get(), specs("a"),
+                                            options);
+    ASSERT_EQ(40u, first.size());
+    for (auto &outcome : first) {
+        ASSERT_FALSE(outcome.error.has_value()) << *outcome.error;
+        ASSERT_TRUE(outcome.created);
+    }
+    ASSERT_EQ(1u, first[1].rulesCreated);
+    auto info = client::timeSeriesInfo(inMemory_.get(), key + ":3");
+    ASSERT_EQ(3600000u, info.retentionTime());
+    ASSERT_EQ(1u, info.rules().size());
+
+    auto again = provision::provisionSeries(inMemory_.get(), specs("a"),
+                                            options);
+    for (auto &outcome : again)
+        ASSERT_FALSE(outcome.changed()) << outcome.key;
+
+    auto moved = provision::provisionSeries(inMemory_.get(), specs("b"),
+                                            options);
+    for (auto &outcome : moved) {
+        ASSERT_TRUE(outcome.altered);
+        ASSERT_FALSE(outcome.created);
+    }
+    auto labels = client::timeSeriesInfo(inMemory_.get(), key + ":3").labels();
+    ASSERT_EQ(2u, labels.size());
+}
+
+} // namespace
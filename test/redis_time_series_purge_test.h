@@ -0,0 +1,110 @@
+#include "redis_time_series_purge.h"
+#include "redis_time_series_test_support.h"
+#include "gtest/gtest.h"
+#include <sw/redis++/redis++.h>
+
+namespace {
+
+using namespace redis_time_series;
+using test_support::makeInfo;
+
+TEST(TestPurgePlan, TestSlices) {
+    // 1000 samples over [1000, 10999]: one sample per 10 ms.
+    auto info = makeInfo(1000, 1000, 10999);
+    std::vector<purge::Slice> slices;
+    purge::planSlices(3, info, 0, 100000, 300, slices);
+    ASSERT_EQ((std::vector<purge::Slice>{{3, 1000, 3999},
+                                         {3, 4000, 6999},
+                                         {3, 7000, 9999},
+                                         {3, 10000, 10999}}),
+              slices);
+
+    slices.clear();
+    purge::planSlices(0, info, 5000, 5500, 300, slices);
+    ASSERT_EQ((std::vector<purge::Slice>{{0, 5000, 5500}}), slices);
+
+    slices.clear();
+    purge::planSlices(0, info, 20000, 30000, 300, slices);
+    purge::planSlices(0, makeInfo(0, 0, 0), 0, 100, 300, slices);
+    ASSERT_TRUE(slices.empty());
+
+    // Ranges up to the largest timestamp do not overflow.
+    auto edge = std::numeric_limits<uint64_t>::max();
+    purge::planSlices(0, makeInfo(2, edge - 10, edge), 0, edge, 1, slices);
+    ASSERT_EQ(3u, slices.size());
+    ASSERT_EQ(edge, slices.back().to);
+}
+
+TEST(TestPurgePlan, TestWaveSizeFollowsBudget) {
+    purge::PurgeOptions options;
+    options.waveBudget = std::chrono::milliseconds{40};
+    options.maxSlicesPerPipeline = 64;
+    using std::chrono::milliseconds;
+    ASSERT_EQ(4u, purge::nextSlicesPerPipeline(8, milliseconds{100}, options));
+    ASSERT_EQ(1u, purge::nextSlicesPerPipeline(1, milliseconds{100}, options));
+    ASSERT_EQ(8u, purge::nextSlicesPerPipeline(8, milliseconds{30}, options));
+    ASSERT_EQ(16u, purge::nextSlicesPerPipeline(8, milliseconds{5}, options));
+    ASSERT_EQ(64u, purge::nextSlicesPerPipeline(64, milliseconds{5}, options));
+}
+
+class TestPurge : public testing::Test {
+  public:
+    TestPurge()
+        : inMemory_{
+              std::make_unique<sw::redis::Redis>("tcp://localhost:6379")} {}
+
+    std::unique_ptr<sw::redis::Redis> inMemory_;
+    const std::string key = "PURGE_TESTS";
+
+  protected:
+    void SetUp() override {
+        // COMMAND INFO answers nil for a command the module lacks.
+        auto info = inMemory_->command("COMMAND", "INFO", command::DEL);
+        if (info->elements == 0 || info->element[0]->type == REDIS_REPLY_NIL)
+            GTEST_SKIP() << "TS.DEL needs RedisTimeSeries 1.6 or later";
+
+        std::vector<std::tuple<std::string, TimeStamp, double>> samples;
+        for (int i = 0; i < 5; ++i) {
+            auto name = key + ":" + std::to_string(i);
+            client::timeSeriesCreate(inMemory_.get(), name, 0,
+                                     {{"purge", i < 4 ? "unit" : "other"}});
+            for (uint64_t ts = 1; ts <= 2000; ++ts)
+                samples.emplace_back(name, TimeStamp{ts}, 1.0);
+        }
+        client::timeSeriesMAdd(inMemory_.get(), samples);
+    }
+    void TearDown() override {
+        for (int i = 0; i < 5; ++i)
+            inMemory_->del(key + ":" + std::to_string(i));
+    }
+};
+
+TEST_F(TestPurge, TestRetentionCut) {
+    purge::PurgeOptions options;
+    options.samplesPerSlice = 70;
+    options.connections = 3;
+    options.slicesPerPipeline = 2;
+    std::size_t reports = 0;
+    uint64_t lastDone = 0;
+    auto result = purge::purgeBefore(
+        inMemory_.get(), {"purge=unit"}, 1501, options,
+        [&](const purge::PurgeProgress &progress) {
+            ++reports;
+            ASSERT_GE(progress.slicesDone, lastDone);
+            lastDone = progress.slicesDone;
+        });
+    ASSERT_TRUE(result.errors.empty());
+    ASSERT_EQ(4u, result.progress.keys);
+    ASSERT_EQ(4u * 1500, result.progress.samplesRemoved);
+    ASSERT_EQ(result.progress.slices, result.progress.slicesDone);
+    ASSERT_EQ(result.progress.waves, reports);
+    ASSERT_GT(result.progress.waves, 1u);
+
+    for (int i = 0; i < 5; ++i) {
+        auto info = client::timeSeriesInfo(inMemory_.get(),
+                                           key + ":" + std::to_string(i));
+        ASSERT_EQ(i < 4 ? 500u : 2000u, info.totalSamples());
+    }
+}
+
+} // namespace
@@ -0,0 +1,141 @@
+#include "redis_time_series_embedded.h"
+#include "redis_time_series_reorder.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+using namespace redis_time_series;
+using command_operator::TsDuplicatePolicy;
+
+class TestReorder : public ::testing::Test {
+  protected:
+    std::vector<std::pair<uint64_t, double>> stored(const std::string &key) {
+        std::vector<std::pair<uint64_t, double>> samples;
+        for (auto &sample : db_.range(key, TimeStamp{"-"}, TimeStamp{"+"}))
+            samples.emplace_back(sample.time().value(), sample.value());
+        return samples;
+    }
+
+    embedded::EmbeddedStore store_;
+    TimeSeriesStore &db_{store_};
+    const std::string key{"reorder:test"};
+};
+
+TEST_F(TestReorder, TestReleasesInOrder) {
+    db_.create(key);
+    reorder::ReorderBuffer buffer{db_, {100, TsDuplicatePolicy::BLOCK, 2}};
+    for (uint64_t t : {1000, 1050, 1020, 1010, 1100, 1090, 1200})
+        buffer.push(key, t, static_cast<double>(t));
+    buffer.flush();
+    // 1200 pushes everything up to 1099 out of the window.
+    ASSERT_EQ((std::vector<std::pair<uint64_t, double>>{
+                  {1000, 1000}, {1010, 1010}, {1020, 1020}, {1050, 1050},
+                  {1090, 1090}}),
+              stored(key));
+    ASSERT_EQ(2u, buffer.pending());
+
+    buffer.drain();
+    ASSERT_EQ(7u, stored(key).size());
+    ASSERT_EQ(0u, buffer.pending());
+    auto stats = buffer.stats();
+    ASSERT_EQ(7u, stats.inOrder);
+    ASSERT_EQ(0u, stats.late + stats.rejected + stats.merged);
+}
+
+TEST_F(TestReorder, TestDuplicatesMergedClientSide) {
+    db_.create(key);
+    db_.create("reorder:sum");
+    reorder::ReorderBuffer buffer{db_, {1000}};
+    buffer.setPolicy("reorder:sum", TsDuplicatePolicy::SUM);
+    buffer.push(key, 1000, 1);
+    buffer.push(key, 1000, 2);
+    buffer.push("reorder:sum", 1000, 1);
+    buffer.push("reorder:sum", 1000, 2);
+    buffer.push("reorder:sum", 1000, 3);
+    buffer.drain();
+
+    ASSERT_EQ(1.0, db_.get(key).value());
+    ASSERT_EQ(6.0, db_.get("reorder:sum").value());
+    auto stats = buffer.stats();
+    ASSERT_EQ(2u, stats.inOrder);
+    ASSERT_EQ(1u, stats.rejected);
+    ASSERT_EQ(2u, stats.merged);
+}
+
+TEST_F(TestReorder, TestLateSamplesWrittenOutOfOrder) {
+    db_.create(key, std::nullopt, {}, std::nullopt, std::nullopt,
+               TsDuplicatePolicy::LAST);
+    reorder::ReorderBuffer buffer{db_, {10, TsDuplicatePolicy::LAST}};
+    for (uint64_t t = 1000; t <= 1100; t += 10)
+        buffer.push(key, t, 1);
+    // Behind what was already released: sent on its own with ON_DUPLICATE.
+    buffer.push(key, 1005, 2);
+    buffer.push(key, 1010, 3);
+    buffer.drain();
+
+    auto samples = stored(key);
+    ASSERT_EQ(12u, samples.size());
+    ASSERT_EQ((std::pair<uint64_t, double>{1005, 2}), samples[1]);
+    ASSERT_EQ((std::pair<uint64_t, double>{1010, 3}), samples[2]);
+    ASSERT_EQ(2u, buffer.stats().late);
+
+    // Under BLOCK the server refuses the late duplicate; it is not retried.
+    db_.create("reorder:blocked");
+    reorder::ReorderBuffer blocking{db_, {0}};
+    blocking.push("reorder:blocked", 1000, 1);
+    blocking.push("reorder:blocked", 2000, 1);
+    blocking.push("reorder:blocked", 1000, 2);
+    ASSERT_EQ(1u, blocking.stats().rejected);
+}
+
+TEST_F(TestReorder, TestMaxPendingBoundsWindow) {
+    db_.create(key);
+    reorder::ReorderOptions options;
+    options.lateness = 1000000;
+    options.maxPending = 3;
+    reorder::ReorderBuffer buffer{db_, options};
+    for (uint64_t t = 1; t <= 10; ++t)
+        buffer.push(key, t * 10, 0);
+    ASSERT_EQ(10u, buffer.pending());
+    buffer.flush();
+    ASSERT_EQ(3u, buffer.pending());
+    ASSERT_EQ(7u, stored(key).size());
+}
+
+TEST_F(TestReorder, TestStarStampedOnArrival) {
+    db_.create(key);
+    reorder::ReorderOptions options;
+    options.lateness = 1000;
+    options.clock = [] { return uint64_t{1500}; };
+    reorder::ReorderBuffer buffer{db_, options};
+    buffer.push({{key, TimeStamp{1000}, 1},
+                 {key, TimeStamp{"*"}, 2},
+                 {key, TimeStamp{1400}, 3}});
+    ASSERT_THROW(
+        buffer.push({{key, TimeStamp{2000}, 4}, {key, TimeStamp{"-"}, 5}}),
+        std::invalid_argument);
+    buffer.drain();
+    ASSERT_EQ((std::vector<std::pair<uint64_t, double>>{
+                  {1000, 1}, {1400, 3}, {1500, 2}}),
+              stored(key));
+}
+
+TEST_F(TestReorder, TestDrainForgetsKeys) {
+    reorder::ReorderBuffer buffer{db_, {0}};
+    buffer.setPolicy(key + ":0", TsDuplicatePolicy::LAST);
+    for (auto i = 0; i < 3; ++i) {
+        db_.create(key + ":" + std::to_string(i));
+        buffer.push(key + ":" + std::to_string(i), 1000, 1);
+    }
+    ASSERT_EQ(3u, buffer.windows());
+    buffer.drain();
+    ASSERT_EQ(0u, buffer.windows());
+
+    // The policy outlives the window.
+    buffer.push(key + ":0", 2000, 1);
+    buffer.push(key + ":0", 2000, 2);
+    buffer.drain();
+    ASSERT_EQ(2.0, db_.get(key + ":0").value());
+}
+
+} // namespace
@@ -0,0 +1,80 @@
+#include "redis_time_series_routing.h"
+#include "gtest/gtest.h"
+#include <sw/redis++/redis++.h>
+#include <thread>
+
+namespace {
+
+using namespace redis_time_series;
+
+TEST(TestRouting, TestReadOnlyCommands) {
+    ASSERT_TRUE(routing::isReadOnly("TS.RANGE"));
+    ASSERT_TRUE(routing::isReadOnly("ts.mget"));
+    ASSERT_TRUE(routing::isReadOnly(command::QUERYINDEX));
+    ASSERT_FALSE(routing::isReadOnly(command::ADD));
+    ASSERT_FALSE(routing::isReadOnly("TS.RANGEX"));
+}
+
+TEST(TestRouting, TestParseInfoSection) {
+    auto fields = routing::parseInfoSection(
+        "# Replication\r\nrole:slave\r\nmaster_link_status:up\r\n"
+        "slave_repl_offset:1234\r\n");
+    ASSERT_EQ("slave", fields["role"]);
+    ASSERT_EQ("1234", fields["slave_repl_offset"]);
+    ASSERT_EQ(3u, fields.size());
+}
+
+// Needs a replica of the test server on port 6380, e.g.
+// redis-server redis/redis.conf --port 6380 --replicaof localhost 6379
+class TestReadRouting : public testing::Test {
+  public:
+    TestReadRouting()
+        : primary_{std::make_unique<sw::redis::Redis>("tcp://localhost:6379")},
+          replica_{std::make_unique<sw::redis::Redis>("tcp://localhost:6380")} {
+    }
+
+    std::unique_ptr<sw::redis::Redis> primary_;
+    std::unique_ptr<sw::redis::Redis> replica_;
+    const std::string key = "ROUTING_TESTS";
+
+  protected:
+    void SetUp() override {
+        try {
+            replica_->ping();
+        } catch (const sw::redis::Error &) {
+            GTEST_SKIP() << "No replica on localhost:6380";
+        }
+    }
+    void TearDown() override { primary_->del(key); }
+};
+
+TEST_F(TestReadRouting, TestWritesGoToPrimary) {
+    routing::ReadRouter router{primary_.get(), {replica_.get()}};
+    auto lease = router.route(command::ADD);
+    ASSERT_FALSE(lease.isReplica());
+    ASSERT_EQ(primary_.get(), lease.get());
+}
+
+TEST_F(TestReadRouting, TestReadsGoToSyncedReplica) {
+    routing::ReadRouter router{primary_.get(), {replica_.get()}};
+    client::timeSeriesAdd(primary_.get(), key, TimeStamp{1000}, 1.5);
+    primary_->command("WAIT", 1, 1000);
+    router.probe();
+
+    auto lease =
+        router.route(command::GET, {std::chrono::milliseconds{5000}, 0});
+    ASSERT_TRUE(lease.isReplica());
+    auto info = client::timeSeriesInfo(lease.get(), key);
+    ASSERT_EQ(TimeStamp{1000}, info.lastTimeStamp());
+}
+
+TEST_F(TestReadRouting, TestUnmetStalenessFallsBackToPrimary) {
+    routing::ReadRouter router{primary_.get(), {replica_.get()}};
+    router.probe();
+    std::this_thread::sleep_for(std::chrono::milliseconds{5});
+    auto stale =
+        router.route(command::RANGE, {std::chrono::milliseconds{0}, 0});
+    ASSERT_FALSE(stale.isReplica());
+}
+
+} // namespace
@@ -0,0 +1,149 @@
+#include "redis_time_series_sketch.h"
+#include "gtest/gtest.h"
+#include <sw/redis++/redis++.h>
+
+#include <random>
+
+namespace {
+
+using namespace redis_time_series;
+
+double exactQuantile(std::vector<double> values, double q) {
+    std::sort(values.begin(), values.end());
+    auto last = static_cast<double>(values.size() - 1);
+    return values[static_cast<std::size_t>(q * last)];
+}
+
+TEST(TestSketch, TestRelativeAccuracy) {
+    std::mt19937_64 random{3};
+    std::lognormal_distribution<double> latency{3, 1};
+    std::vector<double> values;
+    sketch::DDSketch ddsketch;
+    for (int i = 0; i < 100000; ++i) {
+        values.push_back(latency(random) - 5);
+        ddsketch.add(values.back());
+    }
+    ASSERT_EQ(values.size(), ddsketch.count());
+    for (double q : {0.01, 0.1, 0.5, 0.9, 0.95, 0.99, 0.999}) {
+        auto expected = exactQuantile(values, q);
+        ASSERT_NEAR(expected, ddsketch.quantile(q), std::abs(expected) * 0.011)
+            << q;
+    }
+    ASSERT_EQ(*std::min_element(values.begin(), values.end()),
+              ddsketch.quantile(0));
+    ASSERT_EQ(*std::max_element(values.begin(), values.end()),
+              ddsketch.quantile(1));
+    ASSERT_TRUE(std::isnan(sketch::DDSketch{}.quantile(0.5)));
+}
+
+TEST(TestSketch, TestMergeAndBoundedBins) {
+    sketch::SketchOptions options;
+    options.maxBins = 64;
+    sketch::DDSketch low{options}, high{options}, all{options};
+    for (int i = 1; i <= 1000; ++i) {
+        low.add(i);
+        high.add(i * 1000.0);
+        all.add(i);
+        all.add(i * 1000.0);
+    }
+    low.merge(high);
+    ASSERT_EQ(2000u, low.count());
+    ASSERT_LE(low.bins(), 64u);
+    ASSERT_EQ(all.quantile(0.99), low.quantile(0.99));
+    ASSERT_NEAR(980000, low.quantile(0.99), 980000 * 0.01);
+
+    sketch::SketchOptions coarse;
+    coarse.relativeAccuracy = 0.05;
+    ASSERT_THROW(low.merge(sketch::DDSketch{coarse}), std::invalid_argument);
+}
+
+TEST(TestSketch, TestSerialization) {
+    sketch::DDSketch original;
+    for (double value : {-20.0, -1.5, 0.0, 0.25, 3.0, 1e6})
+        original.add(value, 3);
+    auto copy = sketch::DDSketch::deserialize(original.serialize());
+    ASSERT_EQ(original.count(), copy.count());
+    ASSERT_EQ(original.sum(), copy.sum());
+    for (double q : {0.0, 0.2, 0.4, 0.5, 0.8, 1.0})
+        ASSERT_EQ(original.quantile(q), copy.quantile(q));
+    auto bytes = original.serialize();
+    ASSERT_THROW(sketch::DDSketch::deserialize(bytes.substr(0, 20)),
+                 std::invalid_argument);
+    ASSERT_THROW(sketch::DDSketch::deserialize("nope"), std::invalid_argument);
+}
+
+TEST(TestSketch, TestBuckets) {
+    TimeSeriesColumns columns;
+    for (uint64_t t = 0; t < 300; ++t)
+        columns.push_back(1000 + t * 10, static_cast<double>(t));
+    sketch::BucketSketches buckets;
+    sketch::addSamples(buckets, columns, 1000, 0);
+    ASSERT_EQ(3u, buckets.size());
+    ASSERT_EQ(100u, buckets.at(2000).count());
+    ASSERT_EQ(299.0, sketch::mergeBuckets(buckets).quantile(1));
+
+    std::map<std::string, sketch::BucketSketches> series{{"a", buckets},
+                                                         {"b", buckets}};
+    auto merged = sketch::mergeSeries(series);
+    ASSERT_EQ(200u, merged.at(1000).count());
+}
+
+class TestSketchRange : public testing::Test {
+  public:
+    TestSketchRange()
+        : inMemory_{
+              std::make_unique<sw::redis::Redis>("tcp://localhost:6379")} {}
+
+    std::unique_ptr<sw::redis::Redis> inMemory_;
+    const std::string key = "SKETCH_TESTS";
+
+  protected:
+    void SetUp() override {
+        for (auto suffix : {":a", ":b"}) {
+            client::timeSeriesCreate(inMemory_.get(), key + suffix,
+                                     std::nullopt, {{"sketch", "yes"}});
+            std::vector<std::tuple<std::string, TimeStamp, double>> samples;
+            for (uint64_t t = 1; t <= 1000; ++t)
+                samples.emplace_back(key + suffix, t, static_cast<double>(t));
+            client::timeSeriesMAdd(inMemory_.get(), samples);
+        }
+    }
+    void TearDown() override {
+        inMemory_->del(key + ":a");
+        inMemory_->del(key + ":b");
+        inMemory_->del(key + ":sketches");
+    }
+};
+
+TEST_F(TestSketchRange, TestPagedRange) {
+    sketch::BucketOptions options;
+    options.timeBucket = 500;
+    options.pageSize = 64;
+    auto buckets =
+        sketch::rangeSketches(inMemory_.get(), key + ":a", 1, 1000, options);
+    ASSERT_EQ(3u, buckets.size());
+    ASSERT_EQ(499u, buckets.at(0).count());
+    ASSERT_EQ(500u, buckets.at(500).count());
+    ASSERT_NEAR(990, sketch::mergeBuckets(buckets).quantile(0.99), 10);
+
+    sketch::storeSketches(inMemory_.get(), key + ":sketches", buckets);
+    auto loaded =
+        sketch::loadSketches(inMemory_.get(), key + ":sketches", 500, 1000);
+    ASSERT_EQ(2u, loaded.size());
+    ASSERT_EQ(buckets.at(500).quantile(0.5), loaded.at(500).quantile(0.5));
+}
+
+TEST_F(TestSketchRange, TestPagedMultiRange) {
+    sketch::BucketOptions options;
+    options.timeBucket = 1000;
+    options.align = TimeStamp{"-"};
+    options.pageSize = 100;
+    auto series = sketch::multiRangeSketches(inMemory_.get(), {"sketch=yes"},
+                                             1, 1000, options);
+    ASSERT_EQ(2u, series.size());
+    auto merged = sketch::mergeSeries(series);
+    ASSERT_EQ(1u, merged.size());
+    ASSERT_EQ(2000u, merged.at(1).count());
+}
+
+} // namespace
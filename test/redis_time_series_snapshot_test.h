@@ -0,0 +1,143 @@
+#include "redis_time_series_snapshot.h"
+#include "redis_time_series_test_support.h"
+#include "gtest/gtest.h"
+#include <sw/redis++/redis++.h>
+
+namespace {
+
+using namespace redis_time_series;
+using test_support::ReplyBuilder;
+
+TEST(TestSnapshot, TestParseMGet) {
+    ReplyBuilder build;
+    auto *reply = build.array(
+        {build.mgetEntry("SNAPSHOT_TESTS:1", {}, 0, ""),
+         build.mgetEntry("SNAPSHOT_TESTS:2", {{"site", "a"}, {"unit", "kW"}},
+                         1000, "1.5")});
+    snapshot::Snapshot columns;
+    snapshot::parseMGet(*reply, columns);
+    ASSERT_EQ(2u, columns.size());
+    ASSERT_EQ("SNAPSHOT_TESTS:1", columns.key(0));
+    ASSERT_FALSE(columns.hasSample(0));
+    ASSERT_TRUE(std::isnan(columns.values[0]));
+    ASSERT_EQ(1000u, columns.timestamps[1]);
+    ASSERT_EQ(1.5, columns.values[1]);
+    ASSERT_TRUE(columns.labelsOf(0).empty());
+    ASSERT_EQ(2u, columns.labelsOf(1).size());
+    ASSERT_EQ("kW", findLabel(columns.labelsOf(1), "unit"));
+
+    auto entries = parser::parseMGetResponse(*reply);
+    ASSERT_EQ(2u, entries.size());
+    ASSERT_FALSE(std::get<2>(entries[0]).time().hasValue());
+    ASSERT_EQ(1.5, std::get<2>(entries[1]).value());
+    ASSERT_EQ(2u, std::get<1>(entries[1]).size());
+
+    ASSERT_THROW(snapshot::parseMGet(*build.array({build.string("bad")}),
+                                     columns),
+                 sw::redis::ProtoError);
+}
+
+TEST(TestSnapshot, TestParseSelectedLabels) {
+    auto args = aux::buildTsMgetArgs({"snapshot=tests"}, std::nullopt,
+                                     {"site", "unit"});
+    ASSERT_EQ((std::vector<std::string>{"SELECTED_LABELS", "site", "unit",
+                                        "FILTER", "snapshot=tests"}),
+              std::vector<std::string>(args.begin(), args.end()));
+
+    // SELECTED_LABELS reports a label the series lacks as nil.
+    ReplyBuilder build;
+    auto *reply = build.array({build.mgetEntry(
+        "SNAPSHOT_TESTS:1", {{"site", "a"}, {"unit", std::nullopt}}, 1000,
+        "1.5")});
+    snapshot::Snapshot columns;
+    snapshot::parseMGet(*reply, columns);
+    ASSERT_EQ(2u, columns.labelsOf(0).size());
+    ASSERT_EQ("a", findLabel(columns.labelsOf(0), "site"));
+    ASSERT_EQ("", findLabel(columns.labelsOf(0), "unit"));
+}
+
+TEST(TestSnapshot, TestDiff) {
+    ReplyBuilder build;
+    snapshot::Snapshot previous, current;
+    std::vector<snapshot::SeriesChange> changes;
+    std::unordered_map<StringPool::Id, std::size_t> index;
+
+    snapshot::parseMGet(
+        *build.array({build.mgetEntry("SNAPSHOT_TESTS:a", {}, 1, "1"),
+                      build.mgetEntry("SNAPSHOT_TESTS:b", {}, 1, "2")}),
+        current);
+    snapshot::diff(previous, current, changes, index);
+    ASSERT_EQ(2u, changes.size());
+    ASSERT_EQ(snapshot::ChangeKind::ADDED, changes[0].kind);
+
+    // Same rows, only b moved on.
+    std::swap(previous, current);
+    snapshot::parseMGet(
+        *build.array({build.mgetEntry("SNAPSHOT_TESTS:a", {}, 1, "1"),
+                      build.mgetEntry("SNAPSHOT_TESTS:b", {}, 2, "2")}),
+        current);
+    snapshot::diff(previous, current, changes, index);
+    ASSERT_EQ(1u, changes.size());
+    ASSERT_EQ(snapshot::ChangeKind::UPDATED, changes[0].kind);
+    ASSERT_EQ("SNAPSHOT_TESTS:b", changes[0].keyName());
+    ASSERT_EQ(2u, changes[0].timestamp);
+
+    // a is gone, c is new and b changed value at the same timestamp.
+    std::swap(previous, current);
+    snapshot::parseMGet(
+        *build.array({build.mgetEntry("SNAPSHOT_TESTS:c", {}, 5, "5"),
+                      build.mgetEntry("SNAPSHOT_TESTS:b", {}, 2, "3")}),
+        current);
+    snapshot::diff(previous, current, changes, index);
+    ASSERT_EQ(3u, changes.size());
+    ASSERT_EQ(snapshot::ChangeKind::ADDED, changes[0].kind);
+    ASSERT_EQ(snapshot::ChangeKind::UPDATED, changes[1].kind);
+    ASSERT_EQ(3.0, changes[1].value);
+    ASSERT_EQ(snapshot::ChangeKind::REMOVED, changes[2].kind);
+    ASSERT_EQ("SNAPSHOT_TESTS:a", changes[2].keyName());
+}
+
+class TestSnapshotPoller : public testing::Test {
+  public:
+    TestSnapshotPoller()
+        : inMemory_{
+              std::make_unique<sw::redis::Redis>("tcp://localhost:6379")} {}
+
+    std::unique_ptr<sw::redis::Redis> inMemory_;
+    const std::string key = "SNAPSHOT_TESTS";
+
+  protected:
+    void SetUp() override {
+        for (int i = 0; i < 3; ++i)
+            client::timeSeriesCreate(inMemory_.get(),
+                                     key + ":" + std::to_string(i), 0,
+                                     {{"snapshot", "tests"}});
+    }
+    void TearDown() override {
+        for (int i = 0; i < 3; ++i)
+            inMemory_->del(key + ":" + std::to_string(i));
+    }
+};
+
+TEST_F(TestSnapshotPoller, TestPollReportsDeltas) {
+    snapshot::PollOptions options;
+    options.withLabels = true;
+    snapshot::SnapshotPoller poller{inMemory_.get(), {"snapshot=tests"},
+                                    options};
+    ASSERT_EQ(3u, poller.poll().size());
+    ASSERT_EQ("tests", findLabel(poller.current().labelsOf(0), "snapshot"));
+    ASSERT_TRUE(poller.poll().empty());
+
+    client::timeSeriesAdd(inMemory_.get(), key + ":1", TimeStamp{1000}, 7);
+    auto &changes = poller.poll();
+    ASSERT_EQ(1u, changes.size());
+    ASSERT_EQ(key + ":1", changes[0].keyName());
+    ASSERT_EQ(7.0, changes[0].value);
+
+    auto entries = client::timeSeriesMGet(inMemory_.get(), {"snapshot=tests"},
+                                          true);
+    ASSERT_EQ(3u, entries.size());
+    ASSERT_EQ(1u, std::get<1>(entries[0]).size());
+}
+
+} // namespace
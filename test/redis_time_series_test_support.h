@@ -0,0 +1,102 @@
+#pragma once
+
+#include "redis_time_series.h"
+
+#include <deque>
+
+// Helpers shared by the test headers. They live in a named namespace rather
+// than in each header's anonymous one.
+namespace test_support {
+
+// TS.INFO fields other than the sample count and time span, for makeInfo.
+struct InfoFields {
+    uint64_t memoryUsage = 0;
+    uint64_t retentionTime = 0;
+    uint64_t chunkCount = 0;
+    uint64_t chunkSize = 0;
+    std::vector<redis_time_series::TimeSeriesLabel> labels = {};
+    std::vector<redis_time_series::TimeSeriesRule> rules = {};
+    std::optional<redis_time_series::command_operator::TsDuplicatePolicy>
+        duplicatePolicy = std::nullopt;
+};
+
+// A TS.INFO result as the server would report it, e.g.
+// makeInfo(100, 1000, 1990, {.chunkCount = 1, .chunkSize = 4096}).
+inline redis_time_series::TimeSeriesInformation
+makeInfo(uint64_t totalSamples, uint64_t first, uint64_t last,
+         InfoFields fields = {}) {
+    using redis_time_series::TimeStamp;
+    return redis_time_series::TimeSeriesInformation{
+        totalSamples,
+        fields.memoryUsage,
+        TimeStamp{first},
+        TimeStamp{last},
+        fields.retentionTime,
+        fields.chunkCount,
+        fields.chunkSize,
+        std::move(fields.labels),
+        "",
+        std::move(fields.rules),
+        fields.duplicatePolicy};
+}
+
+// Hand-built replies; every node lives as long as the builder.
+class ReplyBuilder {
+  public:
+    redisReply *string(std::string_view text) {
+        return textNode(REDIS_REPLY_STRING, text);
+    }
+    redisReply *error(std::string_view text) {
+        return textNode(REDIS_REPLY_ERROR, text);
+    }
+    redisReply *integer(long long value) {
+        auto *reply = node(REDIS_REPLY_INTEGER);
+        reply->integer = value;
+        return reply;
+    }
+    redisReply *nil() { return node(REDIS_REPLY_NIL); }
+    redisReply *array(std::vector<redisReply *> elements) {
+        auto &storage = children_.emplace_back(std::move(elements));
+        auto *reply = node(REDIS_REPLY_ARRAY);
+        reply->element = storage.data();
+        reply->elements = storage.size();
+        return reply;
+    }
+    // TS.MGET entry [key, labels, [timestamp, value]], or with an empty
+    // sample when `value` is empty. A label whose value is nullopt is
+    // reported as nil, as SELECTED_LABELS does for labels a series lacks.
+    redisReply *
+    mgetEntry(std::string_view key,
+              std::vector<std::pair<std::string, std::optional<std::string>>>
+                  labels,
+              long long timestamp, std::string_view value) {
+        std::vector<redisReply *> pairs;
+        for (auto &[name, text] : labels)
+            pairs.push_back(array(
+                {string(name), text.has_value() ? string(*text) : nil()}));
+        auto *sample = value.empty()
+                           ? array({})
+                           : array({integer(timestamp), string(value)});
+        return array({string(key), array(std::move(pairs)), sample});
+    }
+
+  private:
+    redisReply *node(int type) {
+        auto &reply = nodes_.emplace_back();
+        reply.type = type;
+        return &reply;
+    }
+    redisReply *textNode(int type, std::string_view text) {
+        auto &storage = strings_.emplace_back(text);
+        auto *reply = node(type);
+        reply->str = storage.data();
+        reply->len = storage.size();
+        return reply;
+    }
+
+    std::deque<redisReply> nodes_;
+    std::deque<std::string> strings_;
+    std::deque<std::vector<redisReply *>> children_;
+};
+
+} // namespace test_support
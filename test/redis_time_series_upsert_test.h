@@ -0,0 +1,138 @@
+#include "redis_time_series_upsert.h"
+#include "redis_time_series_test_support.h"
+#include "gtest/gtest.h"
+#include <sw/redis++/redis++.h>
+
+namespace {
+
+using namespace redis_time_series;
+using test_support::ReplyBuilder;
+
+TEST(TestUpsertArgs, TestLabelSetsSentOncePerCall) {
+    upsert::UpsertBatch batch;
+    auto unused = batch.addLabels({{"site", "plant-0"}});
+    auto plant = batch.addLabels({{"site", "plant-1"}, {"unit", "kW"}});
+    ASSERT_EQ(0u, unused);
+    batch.add("UPSERT_TESTS:a", TimeStamp{1000}, 1.5, plant);
+    batch.add("UPSERT_TESTS:b", TimeStamp{1000}, 0.1);
+    batch.add("UPSERT_TESTS:c", TimeStamp{2000}, -2, plant);
+    ASSERT_THROW(batch.add("UPSERT_TESTS:d", TimeStamp{1}, 1, 2),
+                 std::out_of_range);
+
+    upsert::UpsertOptions options;
+    options.retentionTime = 60000;
+    options.duplicatePolicy = command_operator::TsDuplicatePolicy::LAST;
+    auto args = upsert::detail::buildUpsertArgs(batch, 0, 3, options);
+    ASSERT_EQ((std::vector<std::string>{
+                  "3", "UPSERT_TESTS:a", "UPSERT_TESTS:b", "UPSERT_TESTS:c",
+                  "60000", "LAST", "1", "2", "site", "plant-1", "unit", "kW",
+                  "1000", "1.5", "1", "1000", "0.1", "0", "2000", "-2", "1"}),
+              std::vector<std::string>(args.begin(), args.end()));
+
+    // A call without labelled entries sends no label set.
+    args = upsert::detail::buildUpsertArgs(batch, 1, 2, {});
+    ASSERT_EQ((std::vector<std::string>{"1", "UPSERT_TESTS:b", "", "", "0",
+                                        "1000", "0.1", "0"}),
+              std::vector<std::string>(args.begin(), args.end()));
+}
+
+TEST(TestUpsertArgs, TestParseReply) {
+    ReplyBuilder build;
+    auto *failed = build.error("ERR TSDB: the key is not a TSDB key");
+    auto *reply = build.array(
+        {build.array({build.integer(1000), build.integer(1)}), failed,
+         build.array({build.integer(2000), build.integer(0)})});
+
+    std::vector<upsert::UpsertResult> results;
+    upsert::detail::parseUpsertReply(*reply, 3, results);
+    ASSERT_EQ(3u, results.size());
+    ASSERT_EQ(1000u, results[0].timeStamp.value());
+    ASSERT_TRUE(results[0].created);
+    ASSERT_FALSE(results[0].error.has_value());
+    ASSERT_EQ("ERR TSDB: the key is not a TSDB key", results[1].error);
+    ASSERT_EQ(2000u, results[2].timeStamp.value());
+    ASSERT_FALSE(results[2].created);
+
+    ASSERT_THROW(upsert::detail::parseUpsertReply(*reply, 2, results),
+                 sw::redis::ProtoError);
+    ASSERT_THROW(upsert::detail::parseUpsertReply(
+                     *build.array({build.array({build.integer(1)})}), 1,
+                     results),
+                 sw::redis::ProtoError);
+}
+
+class TestBatchUpserter : public testing::Test {
+  public:
+    TestBatchUpserter()
+        : inMemory_{
+              std::make_unique<sw::redis::Redis>("tcp://localhost:6379")} {}
+
+    std::unique_ptr<sw::redis::Redis> inMemory_;
+    const std::string key = "UPSERT_TESTS";
+
+  protected:
+    void SetUp() override {
+        client::timeSeriesCreate(inMemory_.get(), key + ":existing", 0,
+                                 {{"upsert", "existing"}});
+        inMemory_->set(key + ":string", "not a series");
+    }
+    void TearDown() override {
+        for (auto name : {":existing", ":string", ":new-1", ":new-2"})
+            inMemory_->del(key + name);
+    }
+};
+
+TEST_F(TestBatchUpserter, TestCreatesMissingSeries) {
+    upsert::UpsertOptions options;
+    options.batchSize = 2;
+    upsert::BatchUpserter upserter{inMemory_.get(), options};
+    upsert::UpsertBatch batch;
+    auto labels = batch.addLabels({{"upsert", "tests"}, {"unit", "kW"}});
+    batch.add(key + ":existing", TimeStamp{1000}, 1, labels);
+    batch.add(key + ":new-1", TimeStamp{1000}, 2, labels);
+    batch.add(key + ":string", TimeStamp{1000}, 3, labels);
+    batch.add(key + ":new-2", TimeStamp{2000}, 4);
+    batch.add(key + ":new-1", TimeStamp{2000}, 5, labels);
+
+    auto results = upserter.upsert(batch);
+    ASSERT_EQ(5u, results.size());
+    ASSERT_FALSE(results[0].created);
+    ASSERT_TRUE(results[1].created);
+    ASSERT_TRUE(results[2].error.has_value());
+    ASSERT_TRUE(results[3].created);
+    ASSERT_FALSE(results[4].created);
+    ASSERT_EQ(2000u, results[4].timeStamp.value());
+
+    auto info = client::timeSeriesInfo(inMemory_.get(), key + ":new-1");
+    ASSERT_EQ(2u, info.totalSamples());
+    ASSERT_EQ("kW", findLabel(info.labels(), "unit"));
+    ASSERT_EQ("existing",
+              findLabel(client::timeSeriesInfo(inMemory_.get(),
+                                               key + ":existing")
+                            .labels(),
+                        "upsert"));
+    ASSERT_TRUE(
+        client::timeSeriesInfo(inMemory_.get(), key + ":new-2").labels()
+            .empty());
+}
+
+TEST_F(TestBatchUpserter, TestReloadsFlushedScript) {
+    upsert::UpsertOptions options;
+    options.duplicatePolicy = command_operator::TsDuplicatePolicy::LAST;
+    upsert::BatchUpserter upserter{inMemory_.get(), options};
+    upsert::UpsertBatch batch;
+    batch.add(key + ":existing", TimeStamp{1000}, 1);
+    auto sha = upserter.sha();
+    ASSERT_FALSE(upserter.upsert(batch)[0].error.has_value());
+
+    inMemory_->command("SCRIPT", "FLUSH");
+    batch.clear();
+    batch.add(key + ":existing", TimeStamp{1000}, 7);
+    auto results = upserter.upsert(batch);
+    ASSERT_FALSE(results[0].error.has_value());
+    ASSERT_EQ(sha, upserter.sha());
+    ASSERT_EQ(7.0, client::TimeSeriesGet(inMemory_.get(), key + ":existing")
+                       .value());
+}
+
+} // namespace
@@ -0,0 +1,95 @@
+// Standalone fake RedisTimeSeries server for load and fault tests:
+//
+//   fake_server [--host 127.0.0.1] [--port 6379] [--latency-us N]
+//               [--jitter-us N] [--error-rate F] [--disconnect-rate F]
+//               [--seed N]
+//
+// Runs until SIGINT or SIGTERM, then prints the request counters.
+
+#include "redis_time_series_fake_server.h"
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace {
+
+using redis_time_series::fake::FakeServerOptions;
+
+[[noreturn]] void usage(const char *program) {
+    std::fprintf(stderr,
+                 "usage: %s [--host ADDR] [--port N] [--latency-us N] "
+                 "[--jitter-us N] [--error-rate F] [--disconnect-rate F] "
+                 "[--seed N]\n",
+                 program);
+    std::exit(2);
+}
+
+FakeServerOptions parseOptions(int argc, char **argv) {
+    FakeServerOptions options;
+    options.port = 6379;
+    for (int i = 1; i < argc; ++i) {
+        std::string flag = argv[i];
+        if (i + 1 >= argc) usage(argv[0]);
+        std::string value = argv[++i];
+        try {
+            if (flag == "--host")
+                options.host = value;
+            else if (flag == "--port")
+                options.port = static_cast<uint16_t>(std::stoul(value));
+            else if (flag == "--latency-us")
+                options.latency = std::chrono::microseconds{std::stoll(value)};
+            else if (flag == "--jitter-us")
+                options.jitter = std::chrono::microseconds{std::stoll(value)};
+            else if (flag == "--error-rate")
+                options.errorRate = std::stod(value);
+            else if (flag == "--disconnect-rate")
+                options.disconnectRate = std::stod(value);
+            else if (flag == "--seed")
+                options.seed = std::stoull(value);
+            else
+                usage(argv[0]);
+        } catch (const std::logic_error &) {
+            usage(argv[0]);
+        }
+    }
+    return options;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    auto options = parseOptions(argc, argv);
+
+    // Block the signals before any thread starts so only sigwait sees them.
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    redis_time_series::fake::FakeServer server{options};
+    try {
+        server.start();
+    } catch (const std::exception &error) {
+        std::fprintf(stderr, "fake_server: %s\n", error.what());
+        return 1;
+    }
+    std::printf("listening on %s\n", server.uri().c_str());
+    std::fflush(stdout);
+
+    int received = 0;
+    sigwait(&signals, &received);
+    server.stop();
+
+    auto stats = server.stats();
+    std::printf("connections=%llu commands=%llu injected_errors=%llu "
+                "injected_disconnects=%llu\n",
+                static_cast<unsigned long long>(stats.connections),
+                static_cast<unsigned long long>(stats.commands),
+                static_cast<unsigned long long>(stats.injectedErrors),
+                static_cast<unsigned long long>(stats.injectedDisconnects));
+    return 0;
+}
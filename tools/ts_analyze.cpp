@@ -0,0 +1,164 @@
+// Memory footprint report for the time series of a server:
+//
+//   ts_analyze [--uri tcp://127.0.0.1:6379] [--match PATTERN]
+//              [--group-by LABEL] [--batch N] [--sample N]
+//              [--min-savings F] [--top N]
+//              [--migrate KEY --chunk-size N [--uncompressed]]
+//
+// Prints the bytes per sample of every group of series and the series
+// whose chunk size or encoding wastes memory, with the estimated savings.
+// --migrate instead rewrites one series with the given chunk settings.
+
+#include "redis_time_series_analyze.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+namespace {
+
+namespace analyze = redis_time_series::analyze;
+
+struct Options {
+    std::string uri = "tcp://127.0.0.1:6379";
+    std::string match = "*";
+    std::string groupBy;
+    std::size_t top = 20;
+    analyze::AnalyzeOptions analyze;
+    std::string migrate;
+    analyze::MigrateOptions migration;
+};
+
+[[noreturn]] void usage(const char *program) {
+    std::fprintf(stderr,
+                 "usage: %s [--uri URI] [--match PATTERN] [--group-by LABEL] "
+                 "[--batch N] [--sample N] [--min-savings F] [--top N] "
+                 "[--migrate KEY --chunk-size N [--uncompressed]]\n",
+                 program);
+    std::exit(2);
+}
+
+Options parseOptions(int argc, char **argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string flag = argv[i];
+        if (flag == "--uncompressed") {
+            options.migration.compressed = false;
+            continue;
+        }
+        if (i + 1 >= argc) usage(argv[0]);
+        std::string value = argv[++i];
+        try {
+            if (flag == "--uri")
+                options.uri = value;
+            else if (flag == "--match")
+                options.match = value;
+            else if (flag == "--group-by")
+                options.groupBy = value;
+            else if (flag == "--batch")
+                options.analyze.batchSize = std::stoull(value);
+            else if (flag == "--sample")
+                options.analyze.sampleSize = std::stoull(value);
+            else if (flag == "--min-savings")
+                options.analyze.minSavings = std::stod(value);
+            else if (flag == "--top")
+                options.top = std::stoull(value);
+            else if (flag == "--migrate")
+                options.migrate = value;
+            else if (flag == "--chunk-size")
+                options.migration.chunkSize = std::stoull(value);
+            else
+                usage(argv[0]);
+        } catch (const std::logic_error &) {
+            usage(argv[0]);
+        }
+    }
+    return options;
+}
+
+unsigned long long ull(uint64_t value) {
+    return static_cast<unsigned long long>(value);
+}
+
+std::string findings(const analyze::SeriesFootprint &footprint) {
+    std::string text;
+    for (auto finding : footprint.findings) {
+        if (!text.empty()) text += ",";
+        text += analyze::to_string(finding);
+    }
+    return text;
+}
+
+void report(sw::redis::Redis &db, const Options &options) {
+    auto keys = analyze::scanSeries(&db, options.match);
+    auto footprints = analyze::analyzeSeries(&db, keys, options.analyze);
+
+    analyze::GroupFootprint total;
+    for (auto &footprint : footprints) {
+        ++total.series;
+        total.totalSamples += footprint.totalSamples;
+        total.memoryUsage += footprint.memoryUsage;
+        total.savings += footprint.savings();
+    }
+    std::printf("%zu series, %llu samples, %llu bytes, %.2f bytes/sample, "
+                "%llu bytes recoverable\n\n",
+                total.series, ull(total.totalSamples), ull(total.memoryUsage),
+                total.bytesPerSample(), ull(total.savings));
+
+    if (!options.groupBy.empty()) {
+        std::printf("%-24s %8s %14s %14s %10s %14s\n",
+                    options.groupBy.c_str(), "series", "samples", "bytes",
+                    "B/sample", "savings");
+        for (auto &[value, group] :
+             analyze::groupBy(footprints, options.groupBy))
+            std::printf("%-24s %8zu %14llu %14llu %10.2f %14llu\n",
+                        value.empty() ? "(none)" : value.c_str(),
+                        group.series, ull(group.totalSamples),
+                        ull(group.memoryUsage), group.bytesPerSample(),
+                        ull(group.savings));
+        std::printf("\n");
+    }
+
+    std::erase_if(footprints, [](const analyze::SeriesFootprint &footprint) {
+        return footprint.findings.empty();
+    });
+    std::sort(footprints.begin(), footprints.end(),
+              [](const auto &lhs, const auto &rhs) {
+                  return lhs.savings() > rhs.savings();
+              });
+    if (footprints.size() > options.top) footprints.resize(options.top);
+    std::printf("%-32s %10s %10s %10s %14s %-s\n", "key", "B/sample",
+                "chunk", "advised", "savings", "findings");
+    for (auto &footprint : footprints)
+        std::printf("%-32s %10.2f %10llu %10llu %14llu %s\n",
+                    footprint.key.c_str(), footprint.bytesPerSample(),
+                    ull(footprint.chunkSize),
+                    ull(footprint.recommendedChunkSize),
+                    ull(footprint.savings()), findings(footprint).c_str());
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    auto options = parseOptions(argc, argv);
+    try {
+        sw::redis::Redis db{options.uri};
+        if (options.migrate.empty()) {
+            report(db, options);
+            return 0;
+        }
+        auto before = redis_time_series::client::timeSeriesInfo(
+            &db, options.migrate);
+        auto copied =
+            analyze::migrateSeries(&db, options.migrate, options.migration);
+        auto after = redis_time_series::client::timeSeriesInfo(
+            &db, options.migrate);
+        std::printf("%s: %llu samples copied, %llu -> %llu bytes\n",
+                    options.migrate.c_str(), ull(copied),
+                    ull(before.memoryUsage()), ull(after.memoryUsage()));
+    } catch (const std::exception &error) {
+        std::fprintf(stderr, "ts_analyze: %s\n", error.what());
+        return 1;
+    }
+    return 0;
+}